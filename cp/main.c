@@ -17,6 +17,7 @@
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <getopt.h>
@@ -94,6 +95,12 @@ pcap_dumper_t *pcap_dumper;
 pcap_t *pcap_reader;
 
 struct cp_params cp_params;
+
+/** Restore the DP session snapshot after the rules are added */
+static int sess_restore_set;
+/** Generation of the DP session snapshot to restore, 0 for the last one */
+static uint64_t sess_restore_generation;
+
 /**
  * Setting/enable CP RTE LOG_LEVEL.
  */
@@ -133,6 +140,27 @@ parse_arg_ip(const char *optarg, struct in_addr *addr)
 		rte_panic("Invalid argument - %s - Exiting.\n", optarg);
 }
 
+/**
+ * Parses the generation of the DP session snapshot to restore
+ *
+ * @param optarg
+ *   c-string containing the generation, 0 for the last snapshot
+ */
+static void
+parse_arg_sess_restore(const char *optarg)
+{
+	char *end;
+
+	/* strtoull accepts a sign, "-1" would wrap */
+	if (!isdigit((unsigned char)*optarg))
+		rte_panic("Invalid argument - %s - Exiting.\n", optarg);
+	errno = 0;
+	sess_restore_generation = strtoull(optarg, &end, 10);
+	if (*end != '\0' || errno)
+		rte_panic("Invalid argument - %s - Exiting.\n", optarg);
+	sess_restore_set = 1;
+}
+
 /**
  *
  * Parses non-dpdk command line program arguments for control plane
@@ -165,13 +193,14 @@ parse_arg(int argc, char **argv)
 	  {"log_level",   required_argument, NULL, 'l'},
 	  {"pcap_file_in", required_argument, NULL, 'x'},
 	  {"pcap_file_out", required_argument, NULL, 'y'},
+	  {"sess_restore", required_argument, NULL, 'z'},
 	  {0, 0, 0, 0}
 	};
 
 	do {
 		int option_index = 0;
 
-		c = getopt_long(argc, argv, "d:m:s:r:g:w:v:u:i:p:a:l:x:y:", long_options,
+		c = getopt_long(argc, argv, "d:m:s:r:g:w:v:u:i:p:a:l:x:y:z:", long_options,
 		    &option_index);
 
 		if (c == -1)
@@ -234,6 +263,9 @@ parse_arg(int argc, char **argv)
 			pcap_dumper = pcap_dump_open(pcap, optarg);
 			s11_pcap_fd = pcap_fileno(pcap);
 			break;
+		case 'z':
+			parse_arg_sess_restore(optarg);
+			break;
 		default:
 			rte_panic("Unknown argument - %s.", argv[optind]);
 			break;
@@ -412,6 +444,24 @@ init_s5s8_pgwc(void)
 	s5s8_sgwc_sockaddr.sin_addr = s5s8_sgwc_ip;
 }
 
+#ifndef SDN_ODL_BUILD
+/**
+ * @brief
+ * Requests the Data Plane to restore the bearer sessions of its session
+ * snapshot, the result is received by cb_sess_restore
+ */
+static void
+restore_dp_sessions(void)
+{
+	struct dp_id dp_id = { .id = DPN_ID };
+	struct msg_sess_restore restore = {
+		.generation = sess_restore_generation };
+
+	if (session_restore(dp_id, restore) < 0)
+		fprintf(stderr, "Failed to request DP session restore\n");
+}
+#endif
+
 /**
  * @brief
  * Initializes Control Plane data structures, packet filters, and calls for the
@@ -449,6 +499,9 @@ init_cp(void)
 #endif
 	parse_adc_rules();
 	init_packet_filters();
+	/* the restored sessions use the rules added above */
+	if (sess_restore_set)
+		restore_dp_sessions();
 #endif
 
 	create_ue_hash();
@@ -1220,6 +1273,34 @@ cb_ddn(struct msgbuf *msg_payload)
 	return ret;
 }
 
+/**
+ * @brief callback to handle the session restore replies of the data plane
+ * @param msg_payload
+ * message payload received by control plane from the data plane
+ * @return
+ * 0 inicates success, error otherwise
+ */
+static int
+cb_sess_restore(struct msgbuf *msg_payload)
+{
+	uint64_t generation = msg_payload->msg_union.sess_restore.generation;
+	uint32_t bearers = msg_payload->msg_union.sess_restore.bearers;
+
+	if (generation == 0) {
+		fprintf(stderr, "DP has no session snapshot to restore\n");
+		return -1;
+	}
+	if (sess_restore_generation && generation != sess_restore_generation) {
+		fprintf(stderr, "DP session snapshot generation %"PRIu64
+				" not restored, DP has generation %"PRIu64"\n",
+				sess_restore_generation, generation);
+		return -1;
+	}
+	printf("DP session snapshot generation %"PRIu64": %u bearers "
+			"restored\n", generation, bearers);
+	return 0;
+}
+
 /**
  * @brief callback initated by nb listener thread
  * @param arg
@@ -1232,6 +1313,7 @@ listener(__rte_unused void *arg)
 {
 	iface_init_ipc_node();
 	iface_ipc_register_msg_cb(MSG_DDN, cb_ddn);
+	iface_ipc_register_msg_cb(MSG_SESS_RESTORE, cb_sess_restore);
 	while (1)
 		iface_process_ipc_msgs();
 	return 0;
@@ -643,6 +643,11 @@ init_packet_filters(void)
 
 	/* init dpn sdf rules table configuring on dp*/
 	init_sdf_rules();
+
+	/* build the adc and sdf filters added above */
+	struct dp_id dp_id = { .id = DPN_ID };
+	if (filter_commit(dp_id) < 0)
+		rte_exit(EXIT_FAILURE, "Filter commit fail !!!");
 }
 
 static void print_adc_rule(struct adc_rules adc_rule)
@@ -72,11 +72,16 @@ build_dp_msg(enum dp_msg_type mtype, struct dp_id dp_id,
 		msg_payload->msg_union.ue_cdr =
 				*(struct msg_ue_cdr *)param;
 		break;
+	case MSG_SESS_RESTORE:
+		msg_payload->msg_union.sess_restore =
+				*(struct msg_sess_restore *)param;
+		break;
 	case MSG_SDF_DES:
 	case MSG_ADC_TBL_DES:
 	case MSG_PCC_TBL_DES:
 	case MSG_SESS_TBL_DES:
 	case MSG_MTR_DES:
+	case MSG_FILTER_COMMIT:
 		break;
 	case MSG_SDF_ADD:
 	case MSG_SDF_DEL:
@@ -180,6 +185,18 @@ sdf_filter_entry_delete(struct dp_id dp_id, struct pkt_filter pkt_filter_entry)
 #endif
 }
 
+int
+filter_commit(struct dp_id dp_id)
+{
+#ifdef CP_BUILD
+	struct msgbuf msg_payload;
+	build_dp_msg(MSG_FILTER_COMMIT, dp_id, NULL, &msg_payload);
+	return send_dp_msg(dp_id, &msg_payload);
+#else
+	return dp_filter_commit(dp_id);
+#endif
+}
+
 /******************** ADC Rule Table **********************/
 int
 adc_table_create(struct dp_id dp_id, uint32_t max_elements)
@@ -371,6 +388,18 @@ session_delete(struct dp_id dp_id,
 #endif		/* CP_BUILD */
 }
 
+int
+session_restore(struct dp_id dp_id, struct msg_sess_restore restore)
+{
+#ifdef CP_BUILD
+	struct msgbuf msg_payload;
+	build_dp_msg(MSG_SESS_RESTORE, dp_id, (void *)&restore, &msg_payload);
+	return send_dp_msg(dp_id, &msg_payload);
+#else
+	return dp_session_restore(dp_id, &restore);
+#endif		/* CP_BUILD */
+}
+
 /******************** Meter Table **********************/
 int
 meter_profile_table_create(struct dp_id dp_id, uint32_t max_elements)
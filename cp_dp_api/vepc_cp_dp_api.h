@@ -450,6 +450,17 @@ struct msg_ue_cdr {
 							 * write new logs into cdr log file.*/
 } __attribute__((packed, aligned(RTE_CACHE_LINE_SIZE)));
 
+/**
+ * Structure to restore the bearer sessions of the DP session snapshot,
+ * and of the DP reply.
+ */
+struct msg_sess_restore {
+	uint64_t generation;	/* generation of the snapshot to restore,
+				 * 0 for the last one. Reply: generation
+				 * restored, 0 if none.*/
+	uint32_t bearers;	/* Reply: no. of bearers restored*/
+} __attribute__((packed, aligned(RTE_CACHE_LINE_SIZE)));
+
 /********************* SDF Pkt filter table ****************/
 /**
  * @brief Function to create Service Data Flow (SDF) filter
@@ -516,6 +527,22 @@ sdf_filter_entry_add(struct dp_id dp_id, struct pkt_filter pkt_filter_entry);
 int
 sdf_filter_entry_delete(struct dp_id dp_id, struct pkt_filter pkt_filter_entry);
 
+/**
+ * @brief Build the staged SDF and ADC filter changes now.
+ *	Filter adds and deletes are built by the DP once no further change
+ *	came for a short delay; a commit after a batch of changes builds
+ *	them without waiting for the delay.
+ *
+ * @param dp_id
+ *	table identifier.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+int
+filter_commit(struct dp_id dp_id);
+
 /********************* ADC Rule Table ****************/
 /**
  * @brief Function to create Application Detection and
@@ -717,6 +744,22 @@ session_modify(struct dp_id dp_id, struct session_info session);
 int
 session_delete(struct dp_id dp_id, struct session_info session);
 
+/**
+ * @brief To restore the Bearer Sessions of the DP session snapshot, after
+ *	the PCC, ADC, SDF and meter rules the sessions use are added again.
+ *	DP replies with the generation and no. of bearers restored.
+ * @param dp_id
+ *	table identifier.
+ * @param  restore
+ *	generation of the snapshot, 0 for the last one.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+int
+session_restore(struct dp_id dp_id, struct msg_sess_restore restore);
+
 /********************* Meter Table ****************/
 /**
  * @brief Create Meter profile table.
@@ -16,11 +16,17 @@
 
 #define _GNU_SOURCE     /* Expose declaration of tdestroy() */
 #include <search.h>
+#include <errno.h>
+
+#include <rte_cycles.h>
+#include <rte_spinlock.h>
 
 #include "cdr.h"
 #include "acl.h"
 #include "main.h"
 #include "interface.h"
+#include "epc_packet_framework.h"
+#include "flow_cache.h"
 
 #define acl_log(format, ...)    RTE_LOG(ERR, DP, format, ##__VA_ARGS__)
 
@@ -30,9 +36,14 @@
 #define OPTION_SCALAR		"scalar"
 #define ACL_DENY_SIGNATURE	0x00000000
 
-/* Currently restrict acl context to use single category*/
-#define DEFAULT_MAX_CATEGORIES	1
+/* SDF, ADC UL and ADC DL categories, padded to RTE_ACL_RESULTS_MULTIPLIER*/
+#define DEFAULT_MAX_CATEGORIES	4
 #define NB_SOCKETS 8
+/* Staged filter changes are built once no change came for this long */
+#define ACL_COMMIT_DELAY_MS	50
+/* A failed build is retried after the commit delay, doubled per failure
+ * up to this, or at once on a new change */
+#define ACL_RETRY_MAX_MS	(60 * 1000)
 
 #define uint32_t_to_char(ip, a, b, c, d) do {\
 	*a = (unsigned char)((ip) >> 24 & 0xff);\
@@ -277,7 +288,7 @@ struct acl_config {
 struct acl_search {
 	const uint8_t *data_ipv4[MAX_BURST_SZ];
 	struct rte_mbuf *m_ipv4[MAX_BURST_SZ];
-	uint32_t res_ipv4[MAX_BURST_SZ];
+	uint32_t res_ipv4[MAX_BURST_SZ * DEFAULT_MAX_CATEGORIES];
 	int num_ipv4;
 
 	const uint8_t *data_ipv6[MAX_BURST_SZ];
@@ -295,15 +306,13 @@ static struct{
 const char cb_port_delim[] = ":";
 extern struct app_params app;
 
+/* One context holds the SDF, ADC UL and ADC DL rules */
 enum acl_cfg_tbl{
-	SDF_ACTIVE,
-	SDF_STANDBY,
-	ADC_UL_ACTIVE,
-	ADC_UL_STANDBY,
-	ADC_DL_ACTIVE,
-	ADC_DL_STANDBY,
+	ACL_ACTIVE,
+	ACL_STANDBY,
 	MAX_TBLS,
 };
+/* Rules tables, also the ACL category of their rules */
 enum acl_rules_params{
 	SDF_PARAM,
 	ADC_UL_PARAM,
@@ -318,15 +327,38 @@ struct acl_rules_table {
 	int (*compare)(const void *r1p, const void *r2p);
 	void (*print_entry)(const void *nodep, const VISIT which, const int depth);
 	void (*add_entry)(const void *nodep, const VISIT which, const int depth);
+
+	/* Changes are staged in the tree and built on the ACL build core */
+	rte_spinlock_t lock;		/* tree lock, iface and build core*/
+	volatile uint32_t pending;	/* changes not built yet*/
+	volatile uint32_t commit;	/* build pending changes now*/
+	volatile uint64_t last_change;	/* tsc of the last change*/
 };
 
 struct acl_config acl_config[MAX_TBLS];
-struct acl_search acl_search[MAX_PARAM][DP_MAX_LCORE];
-enum acl_cfg_tbl sdf_active_tbl = SDF_ACTIVE;
-enum acl_cfg_tbl adc_ul_active_tbl = ADC_UL_ACTIVE, adc_dl_active_tbl = ADC_DL_ACTIVE;
+struct acl_search acl_search[DP_MAX_LCORE];
+volatile enum acl_cfg_tbl acl_active_tbl = ACL_ACTIVE;
 enum acl_cfg_tbl config_tbl;
+int config_socket;
 struct acl_rules_table acl_rules_table[MAX_PARAM];
 
+/* One build at a time, held while the standby table is built */
+static rte_spinlock_t acl_build_lock = RTE_SPINLOCK_INITIALIZER;
+/* grace period of the last swap */
+static uint64_t acl_retire_period;
+/* completed builds, failed builds (active table kept) */
+static uint64_t acl_builds, acl_build_fail;
+/* failed builds in a row, tsc of the last one and of the next retry */
+static uint32_t acl_fail_streak;
+static uint64_t acl_fail_tsc, acl_retry_tsc;
+/* Set once the ACL build core runs, changes are built at once before */
+static volatile int acl_build_core_up;
+/* PCC changes, their decisions are built with the rules tables */
+static rte_spinlock_t acl_pcc_lock = RTE_SPINLOCK_INITIALIZER;
+static volatile uint32_t acl_pcc_pending;
+static volatile uint32_t acl_pcc_commit;
+static volatile uint64_t acl_pcc_last_change;
+
 #ifdef ACL_READ_CFG
 /* to read cfg file. */
 struct rte_acl_rule *acl_base_ipv4, *acl_base_ipv6;
@@ -422,14 +454,8 @@ static void add_single_rule(const void *nodep, const VISIT which, const int dept
 {
 	struct acl4_rule *r;
 	uint32_t rule_id;
-	/*
-	 * Check numa socket enable or disable based on
-	 * get or set socketid.
-	 */
-	int socketid = app.numa_on?rte_socket_id():0;
-
 	struct acl_config *pacl_config = &acl_config[config_tbl];
-	struct rte_acl_ctx *context = pacl_config->acx_ipv4[socketid];
+	struct rte_acl_ctx *context = pacl_config->acx_ipv4[config_socket];
 #pragma GCC diagnostic push  /* require GCC 4.6 */
 #pragma GCC diagnostic ignored "-Wcast-qual"
 	r = *(struct acl4_rule **) nodep;
@@ -448,14 +474,20 @@ static void add_single_rule(const void *nodep, const VISIT which, const int dept
  * Add rules from local table to rte acl rules table.
  * @param type
  *	table type.
+ * @param param
+ *	rules table to add.
+ * @param socketid
+ *	socket of the table context.
  *
  * @return
  *	void
  */
-static void add_rules_to_rte_acl(enum acl_cfg_tbl type)
+static void add_rules_to_rte_acl(enum acl_cfg_tbl type,
+		enum acl_rules_params param, int socketid)
 {
-	struct acl_rules_table *t = &acl_rules_table[type/2];
+	struct acl_rules_table *t = &acl_rules_table[param];
 	config_tbl = type;
+	config_socket = socketid;
 	twalk(t->root, t->add_entry);
 }
 /**
@@ -511,7 +543,7 @@ static void free_node(void *p)
 int
 dp_acl_rules_table_delete(struct acl_rules_table *t)
 {
-	tdestroy(&t->root, free_node);
+	tdestroy(t->root, free_node);
 	RTE_LOG(INFO, DP, "ACL Rules table: \"%s\" destroyed\n", t->name);
 	memset(t, 0, sizeof(struct acl_rules_table));
 	return 0;
@@ -542,14 +574,20 @@ dp_rules_entry_add(struct acl_rules_table *t,
 		return -1;
 	}
 	*new = *rule;
+	rte_spinlock_lock(&t->lock);
 	/* put node into the tree */
 	if (tsearch(new, &t->root, t->compare) == 0) {
+		rte_spinlock_unlock(&t->lock);
 		RTE_LOG(INFO, DP, "Fail to add acl rule id %d\n",
 				rule->data.userdata - ACL_DENY_SIGNATURE);
+		rte_free(new);
 		return -1;
 	}
 
 	t->num_entries++;
+	t->pending++;
+	t->last_change = rte_rdtsc();
+	rte_spinlock_unlock(&t->lock);
 	return 0;
 }
 
@@ -569,15 +607,24 @@ dp_rules_entry_delete(struct acl_rules_table *t,
 				struct acl4_rule *rule)
 {
 	void **p;
-	/* delete node from the tree */
-	p = tdelete(rule, &t->root, t->compare);
+	void *node;
+
+	rte_spinlock_lock(&t->lock);
+	/* tdelete() returns the parent, free the node found by tfind() */
+	p = tfind(rule, &t->root, t->compare);
 	if (p == NULL) {
+		rte_spinlock_unlock(&t->lock);
 		RTE_LOG(INFO, DP, "Fail to delete acl rule id %d\n",
 						rule->data.userdata - ACL_DENY_SIGNATURE);
 		return -1;
 	}
-	rte_free(*p);
+	node = *p;
+	tdelete(rule, &t->root, t->compare);
+	rte_free(node);
 	t->num_entries--;
+	t->pending++;
+	t->last_change = rte_rdtsc();
+	rte_spinlock_unlock(&t->lock);
 
 	return 0;
 }
@@ -681,9 +728,13 @@ prepare_one_packet_ipv4(struct rte_mbuf **pkts_in, struct acl_search *acl,
 		int index)
 {
 	struct rte_mbuf *pkt = pkts_in[index];
+	struct epc_meta_data *meta_data =
+		(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkt,
+							META_DATA_OFFSET);
 
-	/* Fill acl structure */
-	acl->data_ipv4[acl->num_ipv4] = MBUF_IPV4_2PROTO(pkt);
+	/* Fill acl structure, the UE 5-tuple parsed at RX is laid out as the
+	 * ipv4 header from the proto field on */
+	acl->data_ipv4[acl->num_ipv4] = (const uint8_t *)&meta_data->ue_tuple;
 	acl->m_ipv4[(acl->num_ipv4)++] = pkt;
 }
 
@@ -696,14 +747,15 @@ prepare_acl_parameter(struct rte_mbuf **pkts_in, struct acl_search *acl,
 	acl->num_ipv4 = 0;
 	acl->num_ipv6 = 0;
 
-	/* Prefetch first packets */
+	/* Prefetch first packets meta data */
 	for (i = 0; i < PREFETCH_OFFSET && i < nb_rx; i++)
-		rte_prefetch0(rte_pktmbuf_mtod(pkts_in[i], void *));
+		rte_prefetch0(RTE_MBUF_METADATA_UINT8_PTR(pkts_in[i],
+					META_DATA_OFFSET));
 
 
 	for (i = 0; i < (nb_rx - PREFETCH_OFFSET); i++) {
-		rte_prefetch0(rte_pktmbuf_mtod
-				(pkts_in[i + PREFETCH_OFFSET], void *));
+		rte_prefetch0(RTE_MBUF_METADATA_UINT8_PTR
+				(pkts_in[i + PREFETCH_OFFSET], META_DATA_OFFSET));
 		prepare_one_packet_ipv4(pkts_in, acl, i);
 	}
 
@@ -724,17 +776,6 @@ static inline void send_one_packet(struct rte_mbuf *m, uint32_t res)
 	}
 }
 
-static inline void update_stats(uint32_t *res, int num)
-{
-	int i;
-
-	for (i = 0; i < num; i++) {
-		res[i] &= ~ACL_DENY_SIGNATURE;
-		acl_rule_stats[res[i]]++;
-		RTE_LOG(DEBUG, DP, "ACL_LKUP: rid[%d]:%u\n", i, res[i]);
-	}
-}
-
 /*
  * Parses IPV6 address, exepcts the following format:
  * XXXX:XXXX:XXXX:XXXX:XXXX:XXXX:XXXX:XXXX (where X - is a hexedecimal digit).
@@ -1091,7 +1132,7 @@ static struct rte_acl_ctx *acl_context_init(char *name,
 	acl_param.name = name;
 	acl_param.socket_id = socketid;
 	acl_param.rule_size = RTE_ACL_RULE_SZ(dim);
-	acl_param.max_rule_num = MAX_ACL_RULE_NUM;
+	acl_param.max_rule_num = max_elements;
 	context = rte_acl_create(&acl_param);
 	if (context == NULL)
 		rte_exit(EXIT_FAILURE, "Failed to create ACL context\n");
@@ -1210,49 +1251,87 @@ acl_config_init(struct acl_config *acl_config,
 }
 
 /**
- * To reset and build ACL table.
- *	This funciton reset the acl context rules,
- *	and add the new rules and build table.
- *	This should be called only for standby tables.
+ *	to get standby table id from active table.
  *
  * @param type
- *	table type to reset and build.
+ *	current active table id.
+ *
+ * @return
+ *	standby table id
+ */
+static int
+dp_acl_get_standby(enum acl_cfg_tbl type)
+{
+	return (type % 2)?(type - 1):(type + 1);
+}
+
+/**
+ * To build the standby table and make it active.
+ *	The standby contexts are reset, filled from the SDF, ADC UL and
+ *	ADC DL rules tables, each rules table in its own category, and
+ *	built on each mapped socket. The PCC decisions of the rule ids are
+ *	built with them and swapped at the same time. The active table is
+ *	swapped only if all builds succeed; on failure it stays active and
+ *	the changes stay pending until the retry backoff. The standby table
+ *	is the active table of the last swap, it is reused only after the
+ *	workers passed its grace period.
  *
  * @return
  *	- 0 on success
+ *	- -EAGAIN if a build is running or the standby is still in use
  *	- -1 on failure
  */
 static int
-reset_and_build_rules(enum acl_cfg_tbl type)
+acl_rules_build(void)
 {
 	int dim = RTE_DIM(ipv4_defs);
 	struct rte_acl_config acl_build_param;
-	/*
-	 * Check numa socket enable or disable based on
-	 * get or set socketid.
-	 */
-	int socketid = app.numa_on?rte_socket_id():0;
-	struct rte_acl_param acl_param;
-	char name[MAX_LEN];
-	struct acl_config *pacl_config = &acl_config[type];
-	struct rte_acl_ctx *context = pacl_config->acx_ipv4[socketid];
-
-	if (socketid < 0) {
-		RTE_LOG(ERR, ACL, "Invalid RTE socket Id: %d. \nExit.\n",
-			socketid);
-		return -1;
+	struct acl_rules_table *t;
+	struct acl_config *pacl_config;
+	enum acl_cfg_tbl standby;
+	uint64_t start = rte_rdtsc();
+	uint32_t changes[MAX_PARAM];
+	uint32_t pcc_changes;
+	uint64_t delay_ms;
+	int i, p;
+
+	if (!rte_spinlock_trylock(&acl_build_lock))
+		return -EAGAIN;
+
+	if (qsbr_done() < acl_retire_period) {
+		rte_spinlock_unlock(&acl_build_lock);
+		return -EAGAIN;
 	}
 
-	sprintf(name, "ACLTable-%d", type);
-	acl_param.name = name;
-	acl_param.socket_id = socketid;
-	acl_param.rule_size = RTE_ACL_RULE_SZ(dim);
-	acl_param.max_rule_num = MAX_ACL_RULE_NUM;
+	standby = dp_acl_get_standby(acl_active_tbl);
+	pacl_config = &acl_config[standby];
 
-	/* Delete all rules from the ACL context. */
-	rte_acl_reset_rules(context);
+	/* Delete all rules from the ACL contexts and add the rules tables. */
+	for (i = 0; i < NB_SOCKETS; i++) {
+		if (!pacl_config->mapped[i])
+			continue;
+		rte_acl_reset_rules(pacl_config->acx_ipv4[i]);
+		pacl_config->acx_ipv4_built[i] = 0;
+	}
+	for (p = 0; p < MAX_PARAM; p++) {
+		t = &acl_rules_table[p];
+		rte_spinlock_lock(&t->lock);
+		changes[p] = t->pending;
+		t->pending = 0;
+		t->commit = 0;
+		for (i = 0; i < NB_SOCKETS; i++)
+			if (pacl_config->mapped[i])
+				add_rules_to_rte_acl(standby, p, i);
+		rte_spinlock_unlock(&t->lock);
+	}
 
-	add_rules_to_rte_acl(type);
+	/* PCC changes after this are built again */
+	rte_spinlock_lock(&acl_pcc_lock);
+	pcc_changes = acl_pcc_pending;
+	acl_pcc_pending = 0;
+	acl_pcc_commit = 0;
+	rte_spinlock_unlock(&acl_pcc_lock);
+	filter_pcc_decisions_build(standby);
 
 	/* Perform builds */
 	memset(&acl_build_param, 0, sizeof(acl_build_param));
@@ -1262,26 +1341,111 @@ reset_and_build_rules(enum acl_cfg_tbl type)
 
 	memcpy(&acl_build_param.defs, ipv4_defs,
 			sizeof(ipv4_defs));
-	if (rte_acl_build(context, &acl_build_param) != 0)
-		rte_exit(EXIT_FAILURE, "Failed to build ACL trie\n");
-
-	pacl_config->acx_ipv4_built[socketid] = 1;
-
+	for (i = 0; i < NB_SOCKETS; i++) {
+		if (!pacl_config->mapped[i])
+			continue;
+		if (rte_acl_build(pacl_config->acx_ipv4[i],
+					&acl_build_param) != 0)
+			goto fail;
+		pacl_config->acx_ipv4_built[i] = 1;
 #ifdef DEBUG_ACL
-	rte_acl_dump(context);
+		rte_acl_dump(pacl_config->acx_ipv4[i]);
 #endif
+	}
+
+	/* tries are complete before the workers see the new table */
+	rte_wmb();
+	acl_active_tbl = standby;
+	filter_pcc_decisions_activate(standby);
+	/* flows cached with the old rules are classified again */
+	flow_cache_invalidate();
+	acl_retire_period = qsbr_start();
+	acl_builds++;
+	if (acl_fail_streak)
+		RTE_LOG(NOTICE, DP, "ACL: build succeeded after %u failed"
+				" builds\n", acl_fail_streak);
+	acl_fail_streak = 0;
+	acl_retry_tsc = 0;
+	rte_spinlock_unlock(&acl_build_lock);
+
+	RTE_LOG(DEBUG, DP, "ACL: %u SDF, %u ADC UL, %u ADC DL, %u PCC changes"
+			" built in %"PRIu64" cycles, table %d active\n",
+			changes[SDF_PARAM], changes[ADC_UL_PARAM],
+			changes[ADC_DL_PARAM], pcc_changes, rte_rdtsc() - start,
+			standby);
 	return 0;
+
+fail:
+	acl_build_fail++;
+	for (p = 0; p < MAX_PARAM; p++) {
+		t = &acl_rules_table[p];
+		rte_spinlock_lock(&t->lock);
+		t->pending += changes[p];
+		rte_spinlock_unlock(&t->lock);
+	}
+	rte_spinlock_lock(&acl_pcc_lock);
+	acl_pcc_pending += pcc_changes;
+	rte_spinlock_unlock(&acl_pcc_lock);
+
+	/* retry after a backoff, see acl_build_step() */
+	acl_fail_tsc = rte_rdtsc();
+	delay_ms = (uint64_t)ACL_COMMIT_DELAY_MS <<
+		RTE_MIN(acl_fail_streak, 20u);
+	if (delay_ms > ACL_RETRY_MAX_MS)
+		delay_ms = ACL_RETRY_MAX_MS;
+	acl_retry_tsc = acl_fail_tsc + rte_get_tsc_hz() / 1000 * delay_ms;
+	acl_fail_streak++;
+	rte_spinlock_unlock(&acl_build_lock);
+
+	/* at most once per ACL_RETRY_MAX_MS once the backoff is at max */
+	if (acl_fail_streak == 1 || delay_ms == ACL_RETRY_MAX_MS)
+		RTE_LOG(ERR, DP, "ACL: trie build on socket %d failed, %u in"
+				" a row, table %d stays active, retry in %"
+				PRIu64" ms\n", i, acl_fail_streak,
+				acl_active_tbl, delay_ms);
+	return -1;
+}
+
+/**
+ * Note a change of a rules table. The change is built by the ACL build
+ * core; before the core runs (at init) it is built at once.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+static int
+acl_rules_changed(void)
+{
+	int ret;
+
+	if (acl_build_core_up)
+		return 0;
+
+	ret = acl_rules_build();
+	return (ret == -EAGAIN) ? 0 : ret;
+}
+
+int
+acl_pcc_changed(void)
+{
+	rte_spinlock_lock(&acl_pcc_lock);
+	acl_pcc_pending++;
+	acl_pcc_last_change = rte_rdtsc();
+	rte_spinlock_unlock(&acl_pcc_lock);
+
+	return acl_rules_changed();
 }
 
 /**
  *	To add sdf or adc filter in acl table.
- *	The entries are first stored in local memory and then updated on
- *	standby table.
+ *	The entries are stored in the rules table and built into the
+ *	standby table later, see acl_build_step().
  *
  * @param name
  *	ACL table name (SDF/ADC), only for debug logs.
- * @param type
- *	table to add entry.
+ * @param param
+ *	rules table to add entry.
  * @param pkt_filter
  *	packet filter which include ruleid, priority and
  *		acl rule string to be added.
@@ -1291,7 +1455,8 @@ reset_and_build_rules(enum acl_cfg_tbl type)
  *	- -1 on failure
  */
 static int
-dp_filter_entry_add(char *name, enum acl_cfg_tbl type, struct pkt_filter *pkt_filter)
+dp_filter_entry_add(char *name, enum acl_rules_params param,
+		struct pkt_filter *pkt_filter)
 {
 	struct rte_acl_rule *next;
 	uint32_t rule_id;
@@ -1303,9 +1468,11 @@ dp_filter_entry_add(char *name, enum acl_cfg_tbl type, struct pkt_filter *pkt_fi
 	 */
 	static uint8_t prio = 0;
 	char *buf;
-	if (pkt_filter == NULL)
-		rte_exit(EXIT_FAILURE, "%s:\n"
-				"read msg_payload failed\n", __func__);
+	if (pkt_filter == NULL) {
+		RTE_LOG(ERR, DP, "%s: %s read msg_payload failed\n",
+				__func__, name);
+		return -1;
+	}
 
 	/* TODO: Ensure rule_id does not exceed max num rules*/
 	rule_id = pkt_filter->pcc_rule_id;
@@ -1316,46 +1483,31 @@ dp_filter_entry_add(char *name, enum acl_cfg_tbl type, struct pkt_filter *pkt_fi
 
 	struct acl4_rule r;
 	next = (struct rte_acl_rule *)&r;
-	if (parse_cb_ipv4vlan_rule(buf, next, 0) != 0)
-		rte_exit(EXIT_FAILURE,
-				"%s  parse rules error\n",
-				__func__);
+	if (parse_cb_ipv4vlan_rule(buf, next, 0) != 0) {
+		RTE_LOG(ERR, DP, "%s: %s rule_id:%u parse rules error\n",
+				__func__, name, rule_id);
+		return -1;
+	}
 
 	next->data.userdata = rule_id + ACL_DENY_SIGNATURE;
 	next->data.priority = prio--;
-	next->data.category_mask = -1;
-		if (dp_rules_entry_add(&acl_rules_table[type/2], (struct acl4_rule *)next) < 0)
-			return -1;
-
-	if (reset_and_build_rules(type) < 0)
+	next->data.category_mask = 1 << param;
+	if (dp_rules_entry_add(&acl_rules_table[param],
+				(struct acl4_rule *)next) < 0)
 		return -1;
 
-	return 0;
-}
-/**
- *	to get standby table id from active table.
- *
- * @param type
- *	current active table id.
- *
- * @return
- *	standby table id
- */
-static int
-dp_acl_get_standby(enum acl_cfg_tbl type)
-{
-	return (type % 2)?(type - 1):(type + 1);
+	return acl_rules_changed();
 }
 
 /**
  *	To delete sdf or adc filter in acl table.
- *	The entries are first removed in local memory and then updated on
- *	standby table.
+ *	The entries are removed from the rules table and the standby table
+ *	is built later, see acl_build_step().
  *
  * @param name
  *	ACL table name (SDF/ADC), only for debug logs.
- * @param type
- *	table to add entry.
+ * @param param
+ *	rules table to delete entry.
  * @param pkt_filter
  *	packet filter which include ruleid, priority and
  *		acl rule string to be deleted.
@@ -1365,14 +1517,16 @@ dp_acl_get_standby(enum acl_cfg_tbl type)
  *	- -1 on failure
  */
 static int
-dp_filter_entry_delete(char *name, enum acl_cfg_tbl type,
+dp_filter_entry_delete(char *name, enum acl_rules_params param,
 			struct pkt_filter *pkt_filter_entry)
 {
 	uint32_t rule_id;
 
-	if (pkt_filter_entry == NULL)
-		rte_exit(EXIT_FAILURE, "%s:\n"
-				"read msg_payload failed\n", __func__);
+	if (pkt_filter_entry == NULL) {
+		RTE_LOG(ERR, DP, "%s: %s read msg_payload failed\n",
+				__func__, name);
+		return -1;
+	}
 
 	rule_id = pkt_filter_entry->pcc_rule_id;
 	RTE_LOG(INFO, DP, "ACL DEL:%s rule_id:%d\n",
@@ -1380,36 +1534,72 @@ dp_filter_entry_delete(char *name, enum acl_cfg_tbl type,
 
 	struct acl4_rule rule;
 	rule.data.userdata = rule_id + ACL_DENY_SIGNATURE;
-	dp_rules_entry_delete(&acl_rules_table[type/2], &rule);
+	if (dp_rules_entry_delete(&acl_rules_table[param], &rule) < 0)
+		return -1;
 
-	return reset_and_build_rules(type);
+	return acl_rules_changed();
 }
-/**
- *	To add sdf or adc filter in acl table.
- *	The entries are first stored in local memory and then updated on
- *	standby table.
- *
- * @param name
- *	ACL table name (SDF/ADC), only for debug logs.
- * @param type
- *	table to add entry.
- * @param rule_id
- *	rule id to add default filter.
- *
- * @return
- *	- 0 on success
- *	- -1 on failure
- */
-static int
-default_entry_add(char *name, enum acl_cfg_tbl type, uint32_t rule_id)
+
+void acl_build_step(__rte_unused void *args)
 {
-	struct pkt_filter def_pkt_filter;
-	/* default rule id = max_elements of table */
-	def_pkt_filter.pcc_rule_id = rule_id;
-	sprintf((char *)&def_pkt_filter.u.rule_str[0], "0.0.0.0/0 0.0.0.0/0 0 : 65535 0 : 65535 0x0/0x0\n");
+	static uint64_t delay;
+	struct acl_rules_table *t;
+	int i, pending = 0, commit = 0, quiet = 1, changed = 0;
 
-	if (dp_filter_entry_add(name, type, &def_pkt_filter) < 0)
-		return -1;
+	if (!acl_build_core_up) {
+		delay = rte_get_tsc_hz() / 1000 * ACL_COMMIT_DELAY_MS;
+		acl_build_core_up = 1;
+	}
+
+	/* one build for all tables, once none changed for the delay */
+	for (i = 0; i < MAX_PARAM; i++) {
+		t = &acl_rules_table[i];
+		if (!t->pending)
+			continue;
+		pending = 1;
+		commit |= t->commit;
+		if (rte_rdtsc() - t->last_change < delay)
+			quiet = 0;
+		if (t->last_change > acl_fail_tsc)
+			changed = 1;
+	}
+	if (acl_pcc_pending) {
+		pending = 1;
+		commit |= acl_pcc_commit;
+		if (rte_rdtsc() - acl_pcc_last_change < delay)
+			quiet = 0;
+		if (acl_pcc_last_change > acl_fail_tsc)
+			changed = 1;
+	}
+
+	/* after a failed build only a new change or commit retries early */
+	if (acl_retry_tsc && rte_rdtsc() < acl_retry_tsc &&
+			!changed && !commit)
+		return;
+
+	if (pending && (commit || quiet))
+		acl_rules_build();
+}
+
+int
+dp_filter_commit(struct dp_id dp_id)
+{
+	struct acl_rules_table *t;
+	int i;
+
+	RTE_SET_USED(dp_id);
+
+	for (i = 0; i < MAX_PARAM; i++) {
+		t = &acl_rules_table[i];
+		rte_spinlock_lock(&t->lock);
+		if (t->pending)
+			t->commit = 1;
+		rte_spinlock_unlock(&t->lock);
+	}
+	rte_spinlock_lock(&acl_pcc_lock);
+	if (acl_pcc_pending)
+		acl_pcc_commit = 1;
+	rte_spinlock_unlock(&acl_pcc_lock);
 	return 0;
 }
 
@@ -1434,16 +1624,36 @@ dns_entry_add(struct dp_id dp_id)
 	return 0;
 }
 #endif /* ADC_UPFRONT */
+
+/**
+ * Delete a rules table, its rules are dropped from the ACL context with
+ * the next build.
+ *
+ * @param param
+ *	rules table to delete.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+static int
+acl_rules_table_drop(enum acl_rules_params param)
+{
+	struct acl_rules_table *t = &acl_rules_table[param];
+
+	rte_spinlock_lock(&acl_build_lock);
+	dp_acl_rules_table_delete(t);
+	t->pending = 1;
+	t->last_change = rte_rdtsc();
+	rte_spinlock_unlock(&acl_build_lock);
+
+	return acl_rules_changed();
+}
+
 int
 dp_sdf_filter_table_create(struct dp_id dp_id, uint32_t max_elements)
 {
 	RTE_SET_USED(dp_id);
-	if (acl_config_init(&acl_config[SDF_ACTIVE], "ACLTable-0",
-			max_elements, sizeof(struct acl4_rule)) < 0)
-			return -1;
-	if (acl_config_init(&acl_config[SDF_STANDBY], "ACLTable-1",
-			max_elements, sizeof(struct acl4_rule)) < 0)
-			return -1;
 
 	/* create acl rules table */
 	return dp_acl_rules_table_create(SDF_PARAM, max_elements);
@@ -1452,28 +1662,14 @@ dp_sdf_filter_table_create(struct dp_id dp_id, uint32_t max_elements)
 int
 dp_sdf_filter_table_delete(struct dp_id dp_id)
 {
-	int i;
 	RTE_SET_USED(dp_id);
-	struct acl_config *pacl_config = &acl_config[SDF_ACTIVE];
-	for (i = 0; i < NB_SOCKETS; i++)
-		if (pacl_config->mapped[i])
-			rte_acl_reset(pacl_config->acx_ipv4[i]);
-
-	pacl_config = &acl_config[SDF_STANDBY];
-	for (i = 0; i < NB_SOCKETS; i++)
-		if (pacl_config->mapped[i])
-			rte_acl_reset(pacl_config->acx_ipv4[i]);
-
-	dp_acl_rules_table_delete(&acl_rules_table[SDF_PARAM]);
-
-	return 0;
+	return acl_rules_table_drop(SDF_PARAM);
 }
 
 int
 dp_sdf_filter_entry_add(struct dp_id dp_id, struct pkt_filter *pkt_filter)
 {
 	static int is_first = 1;
-	enum acl_cfg_tbl standby = dp_acl_get_standby(sdf_active_tbl);
 	RTE_SET_USED(dp_id);
 
 	if (is_first == 1) {
@@ -1481,11 +1677,9 @@ dp_sdf_filter_entry_add(struct dp_id dp_id, struct pkt_filter *pkt_filter)
 		is_first = 0;
 	}
 
-	if (dp_filter_entry_add("SDF", standby, pkt_filter) < 0)
+	if (dp_filter_entry_add("SDF", SDF_PARAM, pkt_filter) < 0)
 		return -1;
 
-	sdf_active_tbl = standby;
-
 	RTE_LOG(INFO, DP, "ACL ADD:%s, rule_id:%d, rule:%s\n",
 			"SDF", pkt_filter->pcc_rule_id, pkt_filter->u.rule_str);
 	return 0;
@@ -1495,31 +1689,15 @@ int
 dp_sdf_filter_entry_delete(struct dp_id dp_id,
 			struct pkt_filter *pkt_filter_entry)
 {
-	enum acl_cfg_tbl standby = dp_acl_get_standby(sdf_active_tbl);
 	RTE_SET_USED(dp_id);
-	if (dp_filter_entry_delete("SDF", standby, pkt_filter_entry) < 0)
-		return -1;
-
-	sdf_active_tbl = standby;
-	return 0;
+	return dp_filter_entry_delete("SDF", SDF_PARAM, pkt_filter_entry);
 }
 
 int
 dp_adc_filter_table_create(struct dp_id dp_id, uint32_t max_elements)
 {
 	RTE_SET_USED(dp_id);
-	if (acl_config_init(&acl_config[ADC_UL_ACTIVE], "ACLTable-2",
-			max_elements, sizeof(struct acl4_rule)) < 0)
-			return -1;
-	if (acl_config_init(&acl_config[ADC_UL_STANDBY], "ACLTable-3",
-			max_elements, sizeof(struct acl4_rule)) < 0)
-			return -1;
-	if (acl_config_init(&acl_config[ADC_DL_ACTIVE], "ACLTable-2",
-			max_elements, sizeof(struct acl4_rule)) < 0)
-			return -1;
-	if (acl_config_init(&acl_config[ADC_DL_STANDBY], "ACLTable-3",
-			max_elements, sizeof(struct acl4_rule)) < 0)
-			return -1;
+
 	/* create acl rules table */
 	dp_acl_rules_table_create(ADC_UL_PARAM, max_elements);
 
@@ -1531,80 +1709,40 @@ dp_adc_filter_table_create(struct dp_id dp_id, uint32_t max_elements)
 int
 dp_adc_filter_table_delete(struct dp_id dp_id)
 {
-	int i;
 	RTE_SET_USED(dp_id);
-	struct acl_config *pacl_config;
-
-	pacl_config	= &acl_config[ADC_UL_PARAM];
-	for (i = 0; i < NB_SOCKETS; i++)
-		if (pacl_config->mapped[i])
-			rte_acl_reset(pacl_config->acx_ipv4[i]);
-
-	pacl_config = &acl_config[ADC_UL_STANDBY];
-	for (i = 0; i < NB_SOCKETS; i++)
-		if (pacl_config->mapped[i])
-			rte_acl_reset(pacl_config->acx_ipv4[i]);
-
-	pacl_config = &acl_config[ADC_DL_ACTIVE];
-	for (i = 0; i < NB_SOCKETS; i++)
-		if (pacl_config->mapped[i])
-			rte_acl_reset(pacl_config->acx_ipv4[i]);
-
-	pacl_config = &acl_config[ADC_DL_STANDBY];
-	for (i = 0; i < NB_SOCKETS; i++)
-		if (pacl_config->mapped[i])
-			rte_acl_reset(pacl_config->acx_ipv4[i]);
-
-	dp_acl_rules_table_delete(&acl_rules_table[ADC_UL_PARAM]);
 
-	dp_acl_rules_table_delete(&acl_rules_table[ADC_DL_PARAM]);
+	if (acl_rules_table_drop(ADC_UL_PARAM) < 0)
+		return -1;
 
-	return 0;
+	return acl_rules_table_drop(ADC_DL_PARAM);
 }
 
 int
 dp_adc_filter_entry_add(struct dp_id dp_id, struct pkt_filter *pkt_filter)
 {
-	enum acl_cfg_tbl standby = dp_acl_get_standby(adc_ul_active_tbl);
-
 	RTE_SET_USED(dp_id);
 
-	if (dp_filter_entry_add("ADC", standby, pkt_filter) < 0)
+	if (dp_filter_entry_add("ADC", ADC_UL_PARAM, pkt_filter) < 0)
 		return -1;
-	adc_ul_active_tbl = standby;
 
 	/* swap the src and dst address for DL traffic.*/
 	swap_src_dst_ip((char *)&pkt_filter->u.rule_str[0]);
 
-	standby = dp_acl_get_standby(adc_dl_active_tbl);
-	RTE_SET_USED(dp_id);
-	if (dp_filter_entry_add("ADC", standby, pkt_filter) < 0)
-		return -1;
-	adc_dl_active_tbl = standby;
-	return 0;
+	return dp_filter_entry_add("ADC", ADC_DL_PARAM, pkt_filter);
 }
 
 int
 dp_adc_filter_entry_delete(struct dp_id dp_id,
 				struct pkt_filter *pkt_filter_entry)
 {
-	enum acl_cfg_tbl standby = dp_acl_get_standby(adc_ul_active_tbl);
 	RTE_SET_USED(dp_id);
-	if (dp_filter_entry_delete("ADC", standby, pkt_filter_entry) < 0)
+	if (dp_filter_entry_delete("ADC", ADC_UL_PARAM, pkt_filter_entry) < 0)
 		return -1;
 
-	adc_ul_active_tbl = standby;
-
 	/* swap the src and dst address for DL traffic.*/
 	swap_src_dst_ip((char *)&pkt_filter_entry->u.rule_str[0]);
 
-	standby = dp_acl_get_standby(adc_dl_active_tbl);
-	RTE_SET_USED(dp_id);
-	if (dp_filter_entry_delete("ADC", standby, pkt_filter_entry) < 0)
-		return -1;
-
-	adc_dl_active_tbl = standby;
-	return 0;
+	return dp_filter_entry_delete("ADC", ADC_DL_PARAM, pkt_filter_entry);
 }
 
 /******************** Callback functions **********************/
@@ -1678,16 +1816,53 @@ cb_sdf_filter_entry_delete(struct msgbuf *msg_payload)
 				msg_payload->msg_union.pkt_filter_entry);
 }
 
+/**
+ *  Callback function to build the staged sdf and adc filters.
+ *
+ * @param msg_payload
+ *	payload from CP
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+static int
+cb_filter_commit(struct msgbuf *msg_payload)
+{
+	return filter_commit(msg_payload->dp_id);
+}
+
 /**
  * Initialization of filter table callback functions.
  */
 void app_filter_tbl_init(void)
 {
+	/* the ACL searches the UE 5-tuple of the meta data with ipv4_defs */
+	RTE_BUILD_BUG_ON(offsetof(struct epc_5tuple, src_addr) !=
+			offsetof(struct ipv4_hdr, src_addr) - OFF_IPV42PROTO);
+	RTE_BUILD_BUG_ON(offsetof(struct epc_5tuple, dst_addr) !=
+			offsetof(struct ipv4_hdr, dst_addr) - OFF_IPV42PROTO);
+	RTE_BUILD_BUG_ON(offsetof(struct epc_5tuple, src_port) !=
+			sizeof(struct ipv4_hdr) - OFF_IPV42PROTO);
+	/* a category per rules table */
+	RTE_BUILD_BUG_ON(MAX_PARAM > DEFAULT_MAX_CATEGORIES);
+
+	/* SDF and ADC rules tables share the context */
+	if (acl_config_init(&acl_config[ACL_ACTIVE], "ACLTable-0",
+			MAX_ACL_RULE_NUM * MAX_PARAM,
+			sizeof(struct acl4_rule)) < 0)
+		rte_exit(EXIT_FAILURE, "ACL table create failed\n");
+	if (acl_config_init(&acl_config[ACL_STANDBY], "ACLTable-1",
+			MAX_ACL_RULE_NUM * MAX_PARAM,
+			sizeof(struct acl4_rule)) < 0)
+		rte_exit(EXIT_FAILURE, "ACL table create failed\n");
+
 	/* register msg type in DB*/
 	iface_ipc_register_msg_cb(MSG_SDF_CRE, cb_sdf_filter_table_create);
 	iface_ipc_register_msg_cb(MSG_SDF_DES, cb_sdf_filter_table_delete);
 	iface_ipc_register_msg_cb(MSG_SDF_ADD, cb_sdf_filter_entry_add);
 	iface_ipc_register_msg_cb(MSG_SDF_DEL, cb_sdf_filter_entry_delete);
+	iface_ipc_register_msg_cb(MSG_FILTER_COMMIT, cb_filter_commit);
 #ifdef ADC_UPFRONT
 	/* Create ADC Rule table*/
 	struct dp_id dp_id;
@@ -1699,51 +1874,83 @@ void app_filter_tbl_init(void)
 #endif /* ADC_UPFRONT */
 }
 
-uint32_t *dp_acl_lookup(struct rte_mbuf **m, int nb_rx,
-		struct acl_config *acl_config,
-		struct acl_search *acl_search)
+/**
+ * Classify a burst against the SDF and the ADC rules of a direction in
+ * one pass over the active table.
+ *
+ * @param m
+ *	pointer to pkts.
+ * @param nb_rx
+ *	num. of pkts.
+ * @param sdf_rule_id
+ *	SDF rule id of each pkt, 0 if none matched, SDF_DEFAULT_DROP_RULE_ID
+ *	if the classify failed.
+ * @param adc_rule_id
+ *	ADC rule id of each pkt, 0 if none matched, ADC_DEFAULT_RULE_ID if
+ *	the classify failed.
+ * @param adc_param
+ *	ADC_UL_PARAM or ADC_DL_PARAM.
+ *
+ * @return
+ *	None
+ */
+static inline void
+dp_acl_lookup(struct rte_mbuf **m, int nb_rx, uint32_t *sdf_rule_id,
+		uint32_t *adc_rule_id, enum acl_rules_params adc_param)
 {
-	int socketid;
-	unsigned lcore_id;
-
-	lcore_id = rte_lcore_id();
-	socketid = rte_lcore_to_socket_id(lcore_id);
-
-	if (nb_rx > 0) {
+	unsigned lcore_id = rte_lcore_id();
+	int socketid = rte_lcore_to_socket_id(lcore_id);
+	struct acl_config *pacl_config = &acl_config[acl_active_tbl];
+	struct acl_search *acl = &acl_search[lcore_id];
+	const uint32_t *res;
+	int i;
 
-		prepare_acl_parameter(m, acl_search+lcore_id, nb_rx);
+	if (nb_rx <= 0)
+		return;
 
-		if ((acl_search+lcore_id)->num_ipv4) {
-			rte_acl_classify(acl_config->acx_ipv4[socketid],
-					(acl_search+lcore_id)->data_ipv4,
-					(acl_search+lcore_id)->res_ipv4,
-					(acl_search+lcore_id)->num_ipv4,
-					DEFAULT_MAX_CATEGORIES);
+	prepare_acl_parameter(m, acl, nb_rx);
 
-			update_stats((acl_search+lcore_id)->res_ipv4,
-					(acl_search+lcore_id)->num_ipv4);
+	if (unlikely(rte_acl_classify(pacl_config->acx_ipv4[socketid],
+			acl->data_ipv4, acl->res_ipv4, acl->num_ipv4,
+			DEFAULT_MAX_CATEGORIES) != 0)) {
+		/* no table for this socket, drop by the default rules */
+		for (i = 0; i < nb_rx; i++) {
+			sdf_rule_id[i] = SDF_DEFAULT_DROP_RULE_ID;
+			adc_rule_id[i] = ADC_DEFAULT_RULE_ID;
 		}
+		acl_rule_stats[SDF_DEFAULT_DROP_RULE_ID] += nb_rx;
+		acl_rule_stats[ADC_DEFAULT_RULE_ID] += nb_rx;
+		return;
 	}
-	return (uint32_t *)&(acl_search+lcore_id)->res_ipv4;
-}
 
-uint32_t *sdf_lookup(struct rte_mbuf **m, int nb_rx)
-{
-	return dp_acl_lookup(m, nb_rx, &acl_config[sdf_active_tbl], acl_search[SDF_PARAM]);
+	/* results of a pkt are DEFAULT_MAX_CATEGORIES apart */
+	for (i = 0; i < acl->num_ipv4; i++) {
+		res = &acl->res_ipv4[i * DEFAULT_MAX_CATEGORIES];
+		sdf_rule_id[i] = res[SDF_PARAM] & ~ACL_DENY_SIGNATURE;
+		adc_rule_id[i] = res[adc_param] & ~ACL_DENY_SIGNATURE;
+		acl_rule_stats[sdf_rule_id[i]]++;
+		acl_rule_stats[adc_rule_id[i]]++;
+		RTE_LOG(DEBUG, DP, "ACL_LKUP: rid[%d]: sdf %u adc %u\n", i,
+				sdf_rule_id[i], adc_rule_id[i]);
+	}
 }
 
-uint32_t *adc_ul_lookup(struct rte_mbuf **m, int nb_rx)
+void
+ul_filter_lookup(struct rte_mbuf **m, int nb_rx, uint32_t *sdf_rule_id,
+		uint32_t *adc_rule_id)
 {
-	return dp_acl_lookup(m, nb_rx, &acl_config[adc_ul_active_tbl], acl_search[ADC_UL_PARAM]);
+	dp_acl_lookup(m, nb_rx, sdf_rule_id, adc_rule_id, ADC_UL_PARAM);
 }
-uint32_t *adc_dl_lookup(struct rte_mbuf **m, int nb_rx)
+
+void
+dl_filter_lookup(struct rte_mbuf **m, int nb_rx, uint32_t *sdf_rule_id,
+		uint32_t *adc_rule_id)
 {
-	return dp_acl_lookup(m, nb_rx, &acl_config[adc_dl_active_tbl], acl_search[ADC_DL_PARAM]);
+	dp_acl_lookup(m, nb_rx, sdf_rule_id, adc_rule_id, ADC_DL_PARAM);
 }
 
 int dp_sdf_default_entry_add(struct dp_id dp_id, uint32_t rule_id)
 {
-	enum acl_cfg_tbl standby = dp_acl_get_standby(sdf_active_tbl);
 	struct pkt_filter pktf = {
 			.pcc_rule_id = rule_id,
 		};
@@ -1762,17 +1969,11 @@ int dp_sdf_default_entry_add(struct dp_id dp_id, uint32_t rule_id)
 		0, 0/*proto, proto_mask)*/
 		);
 
-	if (dp_filter_entry_add("SDF", standby, &pktf) < 0)
-		return -1;
-
-	sdf_active_tbl = standby;
-	return 0;
+	return dp_filter_entry_add("SDF", SDF_PARAM, &pktf);
 }
 
 int dp_sdf_default_entry_action_modify(struct dp_id dp_id, uint32_t rule_id)
 {
-	enum acl_cfg_tbl standby = dp_acl_get_standby(sdf_active_tbl);
-
 	RTE_SET_USED(dp_id);
 
 	RTE_LOG(INFO, DP, "ACL DEL:%s rule_id:%d\n",
@@ -1780,7 +1981,7 @@ int dp_sdf_default_entry_action_modify(struct dp_id dp_id, uint32_t rule_id)
 
 	struct acl4_rule rule;
 	rule.data.userdata = rule_id + ACL_DENY_SIGNATURE;
-	if (dp_rules_entry_delete(&acl_rules_table[standby/2], &rule))
+	if (dp_rules_entry_delete(&acl_rules_table[SDF_PARAM], &rule))
 		return -1;
 
 	struct pkt_filter pktf = {
@@ -1799,27 +2000,19 @@ int dp_sdf_default_entry_action_modify(struct dp_id dp_id, uint32_t rule_id)
 		0, 0/*proto, proto_mask)*/
 		);
 
-	if (dp_filter_entry_add("SDF", standby, &pktf) < 0)
-		return -1;
-
-	sdf_active_tbl = standby;
-	return 0;
+	/* the delete is built with the add */
+	return dp_filter_entry_add("SDF", SDF_PARAM, &pktf);
 }
 
 int
 dp_adc_filter_default_entry_add(struct dp_id dp_id)
 {
 	struct pkt_filter adc_filter;
-	enum acl_cfg_tbl standby = dp_acl_get_standby(adc_ul_active_tbl);
 	RTE_SET_USED(dp_id);
 
 	adc_filter.pcc_rule_id = ADC_DEFAULT_RULE_ID;
 	sprintf(adc_filter.u.rule_str, "0.0.0.0/0 0.0.0.0/0 "
 		"0 : 65535 0 : 65535 0x0/0x0\n");
 
-	if (dp_filter_entry_add("ADC", standby, &adc_filter) < 0)
-		return -1;
-	adc_ul_active_tbl = standby;
-
-	return 0;
+	return dp_filter_entry_add("ADC", ADC_UL_PARAM, &adc_filter);
 }
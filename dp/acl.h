@@ -55,45 +55,48 @@
 uint64_t acl_rule_stats[MAX_ACL_RULE_NUM];
 
 /**
- * Function for SDF lookup.
+ * Function for SDF and ADC table lookup for Upstream traffic, one
+ * classify of the burst for both.
  *
  * @param m
  *	pointer to pkts.
  * @param nb_rx
  *	num. of pkts.
+ * @param sdf_rule_id
+ *	SDF rule id of each pkt, 0 if none matched, SDF_DEFAULT_DROP_RULE_ID
+ *	if the classify failed.
+ * @param adc_rule_id
+ *	ADC rule id of each pkt, 0 if none matched, ADC_DEFAULT_RULE_ID if
+ *	the classify failed.
  *
  * @return
- *	array containing search results for each input buf
+ *	None
  */
-uint32_t *
-sdf_lookup(struct rte_mbuf **m, int nb_rx);
+void
+ul_filter_lookup(struct rte_mbuf **m, int nb_rx, uint32_t *sdf_rule_id,
+		uint32_t *adc_rule_id);
 
 /**
- * Function for ADC table lookup for Upsstream traffic.
+ * Function for SDF and ADC table lookup for Downstream traffic, one
+ * classify of the burst for both.
  *
  * @param m
  *	pointer to pkts.
  * @param nb_rx
  *	num. of pkts.
+ * @param sdf_rule_id
+ *	SDF rule id of each pkt, 0 if none matched, SDF_DEFAULT_DROP_RULE_ID
+ *	if the classify failed.
+ * @param adc_rule_id
+ *	ADC rule id of each pkt, 0 if none matched, ADC_DEFAULT_RULE_ID if
+ *	the classify failed.
  *
  * @return
- *	array containing search results for each input buf
+ *	None
  */
-uint32_t *
-adc_ul_lookup(struct rte_mbuf **m, int nb_rx);
-/**
- * Function for ADC table lookup for Downsstream traffic.
- *
- * @param m
- *	pointer to pkts.
- * @param nb_rx
- *	num. of pkts.
- *
- * @return
- *	array containing search results for each input buf
- */
-uint32_t *
-adc_dl_lookup(struct rte_mbuf **m, int nb_rx);
+void
+dl_filter_lookup(struct rte_mbuf **m, int nb_rx, uint32_t *sdf_rule_id,
+		uint32_t *adc_rule_id);
 
 /**
  * Get SDF ACL table base address.
@@ -277,5 +280,41 @@ dp_sdf_default_entry_action_modify(struct dp_id dp_id, uint32_t rule_id);
 int
 dp_adc_filter_default_entry_add(struct dp_id dp_id);
 
+/**
+ * Build the staged filter changes now, without waiting for
+ * ACL_COMMIT_DELAY_MS.
+ *
+ * @param dp_id
+ *	identifier which is unique across DataPlanes.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+int
+dp_filter_commit(struct dp_id dp_id);
+
+/**
+ * Build the SDF and ADC filter and PCC changes staged by the iface core
+ * into the standby tables and make them active. Changes are built once no change
+ * came for ACL_COMMIT_DELAY_MS or on a commit, a failed build keeps the
+ * active table and is retried with a backoff, or at once on a new change.
+ * Runs on a core that does not forward packets.
+ *
+ * @param args
+ *	Unused
+ */
+void acl_build_step(__rte_unused void *args);
+
+/**
+ * Note a change of the SDF/ADC-PCC or PCC tables. The PCC decisions of
+ * the filter rules are built again with the next ACL build.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+int acl_pcc_changed(void);
+
 #endif /* _ACL_H_ */
 
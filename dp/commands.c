@@ -97,6 +97,7 @@ static void cmd_show_stats(void *parsed_result,
 	display_pip_octrs();
 #endif
 #ifdef INSTMNT
+	display_instmnt_rx();
 	display_instmnt_wrkr();
 #endif
 #ifdef AH_STATS
@@ -119,6 +120,116 @@ cmdline_parse_inst_t cmd_obj_show_stats = {
 	},
 };
 
+/**********************************************************/
+struct cmd_mem_result {
+	cmdline_fixed_string_t mem;
+};
+
+cmdline_parse_token_string_t cmd_mem_mem =
+TOKEN_STRING_INITIALIZER(struct cmd_mem_result, mem, "mem");
+
+static void cmd_show_mem(void *parsed_result,
+		struct cmdline *cl,
+		__attribute__((unused)) void *data)
+{
+	RTE_SET_USED(parsed_result);
+	RTE_SET_USED(cl);
+	RTE_SET_USED(data);
+	display_sess_mem();
+}
+
+cmdline_parse_inst_t cmd_obj_show_mem = {
+	.f = cmd_show_mem,  /* function to call */
+	.data = NULL,      /* 2nd arg of func */
+	.help_str = "Show session table memory",
+	.tokens = {        /* token list, NULL terminated */
+		(void *)&cmd_mem_mem,
+		NULL,
+	},
+};
+
+/**********************************************************/
+struct cmd_hash_result {
+	cmdline_fixed_string_t hash;
+	cmdline_fixed_string_t export;
+};
+
+cmdline_parse_token_string_t cmd_hash_hash =
+TOKEN_STRING_INITIALIZER(struct cmd_hash_result, hash, "hash");
+cmdline_parse_token_string_t cmd_hash_export =
+TOKEN_STRING_INITIALIZER(struct cmd_hash_result, export, "export");
+
+static void cmd_show_hash(void *parsed_result,
+		struct cmdline *cl,
+		__attribute__((unused)) void *data)
+{
+	RTE_SET_USED(parsed_result);
+	RTE_SET_USED(cl);
+	RTE_SET_USED(data);
+	display_hash_occupancy();
+}
+
+cmdline_parse_inst_t cmd_obj_show_hash = {
+	.f = cmd_show_hash,  /* function to call */
+	.data = NULL,      /* 2nd arg of func */
+	.help_str = "Show hash table occupancy",
+	.tokens = {        /* token list, NULL terminated */
+		(void *)&cmd_hash_hash,
+		NULL,
+	},
+};
+
+static void cmd_export_hash(void *parsed_result,
+		struct cmdline *cl,
+		__attribute__((unused)) void *data)
+{
+	RTE_SET_USED(parsed_result);
+	RTE_SET_USED(cl);
+	RTE_SET_USED(data);
+	export_hash_occupancy();
+}
+
+cmdline_parse_inst_t cmd_obj_export_hash = {
+	.f = cmd_export_hash,  /* function to call */
+	.data = NULL,      /* 2nd arg of func */
+	.help_str = "Export hash table occupancy to csv",
+	.tokens = {        /* token list, NULL terminated */
+		(void *)&cmd_hash_hash,
+		(void *)&cmd_hash_export,
+		NULL,
+	},
+};
+
+#ifdef FLOW_CACHE
+/**********************************************************/
+struct cmd_flow_result {
+	cmdline_fixed_string_t flow;
+};
+
+cmdline_parse_token_string_t cmd_flow_flow =
+TOKEN_STRING_INITIALIZER(struct cmd_flow_result, flow, "flow");
+
+static void cmd_show_flow(void *parsed_result,
+		struct cmdline *cl,
+		__attribute__((unused)) void *data)
+{
+	RTE_SET_USED(parsed_result);
+	RTE_SET_USED(cl);
+	RTE_SET_USED(data);
+	display_flow_cache_stats();
+}
+
+cmdline_parse_inst_t cmd_obj_show_flow = {
+	.f = cmd_show_flow,  /* function to call */
+	.data = NULL,      /* 2nd arg of func */
+	.help_str = "Show flow cache hit rate",
+	.tokens = {        /* token list, NULL terminated */
+		(void *)&cmd_flow_flow,
+		NULL,
+	},
+};
+#endif	/* FLOW_CACHE */
+
 /**********************************************************/
 struct cmd_quit_result {
 	cmdline_fixed_string_t quit;
@@ -165,6 +276,11 @@ static void cmd_help(__attribute__((unused)) void *parsed_result,
 	cmdline_printf(cl,
 			"Command supported:\n"
 			"- show\n"
+			"- mem\n"
+			"- hash [export]\n"
+#ifdef FLOW_CACHE
+			"- flow\n"
+#endif
 			"- quit\n"
 			"- help\n\n");
 }
@@ -183,6 +299,12 @@ cmdline_parse_inst_t cmd_obj_help = {
 
 cmdline_parse_ctx_t main_ctx[] = {
 	(cmdline_parse_inst_t *)&cmd_obj_show_stats,
+	(cmdline_parse_inst_t *)&cmd_obj_show_mem,
+	(cmdline_parse_inst_t *)&cmd_obj_show_hash,
+	(cmdline_parse_inst_t *)&cmd_obj_export_hash,
+#ifdef FLOW_CACHE
+	(cmdline_parse_inst_t *)&cmd_obj_show_flow,
+#endif
 	(cmdline_parse_inst_t *)&cmd_obj_quit_app,
 	(cmdline_parse_inst_t *)&cmd_obj_help,
 	NULL,
@@ -16,7 +16,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
+#include <limits.h>
 #include <arpa/inet.h>
 
 #include <rte_ethdev.h>
@@ -24,6 +26,7 @@
 #include "main.h"
 #include "cdr.h"
 #include "master_cdr.h"
+#include "sess_pool.h"
 #include "pipeline/epc_packet_framework.h"
 
 /* app config structure */
@@ -105,15 +108,25 @@ static inline void dp_print_usage(void)
 			PRESENCE_WIDTH,    "OPTIONAL",
 			DESCRIPTION_WIDTH, "SGI port mac address of the PGW.");
 
+	printf("| %-*s | %-*s | %-*s |\n",
+			ARGUMENT_WIDTH,    "--ue_pool",
+			PRESENCE_WIDTH,    "OPTIONAL",
+			DESCRIPTION_WIDTH, "UE address pool a.b.c.d/len, up to 4.");
+
 	printf("| %-*s | %-*s | %-*s |\n",
 			ARGUMENT_WIDTH,    "--s1uc",
 			PRESENCE_WIDTH,    "OPTIONAL",
-			DESCRIPTION_WIDTH, "core number to run s1u rx/tx.");
+			DESCRIPTION_WIDTH, "core list to run s1u rx queues, tx.");
 
 	printf("| %-*s | %-*s | %-*s |\n",
 			ARGUMENT_WIDTH,    "--sgic",
 			PRESENCE_WIDTH,    "OPTIONAL",
-			DESCRIPTION_WIDTH, "core number to run sgi rx/tx.");
+			DESCRIPTION_WIDTH, "core list to run sgi rx queues, tx.");
+
+	printf("| %-*s | %-*s | %-*s |\n",
+			ARGUMENT_WIDTH,    "--rx_queues",
+			PRESENCE_WIDTH,    "OPTIONAL",
+			DESCRIPTION_WIDTH, "no. of RSS rx queues per port.");
 
 	printf("| %-*s | %-*s | %-*s |\n",
 			ARGUMENT_WIDTH,    "--bal",
@@ -160,6 +173,24 @@ static inline void dp_print_usage(void)
 			DESCRIPTION_WIDTH,
 			"CDR Master file.");
 
+	printf("| %-*s | %-*s | %-*s |\n",
+			ARGUMENT_WIDTH,    "--sess_snapshot",
+			PRESENCE_WIDTH,    "OPTIONAL",
+			DESCRIPTION_WIDTH,
+			"Session snapshot file, CP restores it.");
+
+	printf("| %-*s | %-*s | %-*s |\n",
+			ARGUMENT_WIDTH,    "--snapshot_secs",
+			PRESENCE_WIDTH,    "OPTIONAL",
+			DESCRIPTION_WIDTH,
+			"Session snapshot interval (s), default 60.");
+
+	printf("| %-*s | %-*s | %-*s |\n",
+			ARGUMENT_WIDTH,    "--max_sessions",
+			PRESENCE_WIDTH,    "OPTIONAL",
+			DESCRIPTION_WIDTH,
+			"Max. bearers, sizes the session pools.");
+
 	printf("| %-*s | %-*s | %-*s |\n",
 			ARGUMENT_WIDTH,    "--numa",
 			PRESENCE_WIDTH,    "MANDATORY",
@@ -181,7 +212,7 @@ static inline void dp_print_usage(void)
 			"--s5s8_sgwu_ip 12.3.1.93\n"
 			"--s5s8_pgwu_ip 14.3.1.93\n"
 			"--sgi_ip 13.1.1.93 --sgi_mac 90:e2:ba:58:c8:65\n"
-			"--s1uc 0 --sgic 1\n"
+			"--s1uc 0,5 --sgic 1,6 --rx_queues 2\n"
 			"--bal 2 --mct 3 --iface 4 --stats 3\n"
 			"--num_workers 2 --numa 0 --log 1\n");
 	exit(0);
@@ -242,6 +273,139 @@ static inline void set_unused_lcore(int *core, uint64_t *used_coremask)
 	rte_panic("No free core available - check coremask");
 }
 
+/**
+ * Function to parse a decimal number within [min, max].
+ *
+ * @param str
+ *	number string.
+ * @param min
+ *	smallest value accepted.
+ * @param max
+ *	largest value accepted.
+ * @param val
+ *	parsed value.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+static inline int
+parse_uint(const char *str, uint32_t min, uint32_t max, uint32_t *val)
+{
+	char *end;
+	unsigned long n;
+
+	/* strtoul accepts a sign, "-1" would wrap */
+	if (*str < '0' || *str > '9')
+		return -1;
+	n = strtoul(str, &end, 10);
+	if (*end != '\0' || n < min || n > max)
+		return -1;
+	*val = n;
+	return 0;
+}
+
+/**
+ * Function to get the max. no. of rx queues of a port.
+ *
+ * @param port
+ *	port id.
+ *
+ * @return
+ *	max. no. of rx queues, 0 if the port does not exist.
+ */
+static uint16_t
+rx_queues_max(uint32_t port)
+{
+	struct rte_eth_dev_info dev_info;
+
+	if (port >= rte_eth_dev_count())
+		return 0;
+	rte_eth_dev_info_get(port, &dev_info);
+	return dev_info.max_rx_queues;
+}
+
+/**
+ * Function to parse a comma separated list of cores, e.g. "1,4,5".
+ *
+ * @param str
+ *	core list string.
+ * @param cores
+ *	array filled with the parsed cores.
+ * @param max_cores
+ *	size of cores array.
+ * @param used_coremask
+ *	mask updated with the parsed cores.
+ *
+ * @return
+ *	- number of cores parsed on success
+ *	- -1 on failure
+ */
+static inline int
+parse_core_list(const char *str, int *cores, unsigned max_cores,
+		uint64_t *used_coremask)
+{
+	char buf[128];
+	char *tok, *end;
+	char *saveptr = NULL;
+	unsigned long core;
+	unsigned n = 0;
+
+	snprintf(buf, sizeof(buf), "%s", str);
+	for (tok = strtok_r(buf, ",", &saveptr); tok != NULL;
+			tok = strtok_r(NULL, ",", &saveptr)) {
+		if (n >= max_cores)
+			return -1;
+		core = strtoul(tok, &end, 10);
+		/* used_coremask has one bit per lcore */
+		if (end == tok || *end != '\0' || core >= RTE_MAX_LCORE ||
+				core >= sizeof(*used_coremask) * CHAR_BIT)
+			return -1;
+		cores[n] = core;
+		*used_coremask |= (1ULL << core);
+		n++;
+	}
+
+	return n ? (int)n : -1;
+}
+
+/**
+ * Function to parse a UE address pool "a.b.c.d/len".
+ *
+ * @param str
+ *	pool string.
+ * @param pool
+ *	pool filled in host byte order.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+static inline int
+parse_ue_pool(const char *str, struct ue_pool *pool)
+{
+	char buf[INET_ADDRSTRLEN + 3];
+	struct in_addr addr;
+	char *len_str, *end;
+	unsigned long len;
+
+	snprintf(buf, sizeof(buf), "%s", str);
+	len_str = strchr(buf, '/');
+	if (len_str == NULL)
+		return -1;
+	*len_str++ = '\0';
+
+	len = strtoul(len_str, &end, 10);
+	if (*end != '\0' || len < UE_POOL_MIN_PREFIX || len > 32)
+		return -1;
+	if (!inet_aton(buf, &addr))
+		return -1;
+
+	pool->size = 1U << (32 - len);
+	pool->net = ntohl(addr.s_addr) & ~(pool->size - 1);
+	return 0;
+}
+
 /**
  * Function to parse command line config.
  *
@@ -265,6 +429,8 @@ parse_config_args(struct app_params *app, int argc, char **argv)
 	struct ether_addr mac_addr;
 	uint64_t used_coremask = 0;
 	const char *master_cdr_file = NULL;
+	int n_core_rx[NUM_SPGW_PORTS] = {0};
+	uint32_t rx_queues;
 
 	static struct option spgw_opts[] = {
 		{"s1u_ip", required_argument, 0, 'i'},
@@ -292,6 +458,11 @@ parse_config_args(struct app_params *app, int argc, char **argv)
 		{"master_cdr", required_argument, 0, 'e'},
 		{"numa", required_argument, 0, 'f'},
 		{"spgw_cfg",  required_argument, 0, 'h'},
+		{"rx_queues", required_argument, 0, 'y'},
+		{"ue_pool", required_argument, 0, 'P'},
+		{"sess_snapshot", required_argument, 0, 'S'},
+		{"snapshot_secs", required_argument, 0, 'I'},
+		{"max_sessions", required_argument, 0, 'M'},
 		{NULL, 0, 0, 0}
 	};
 
@@ -485,26 +656,69 @@ parse_config_args(struct app_params *app, int argc, char **argv)
 			break;
 
 		case 'u':
-			epc_app.core_rx[S1U_PORT_ID] = atoi(optarg);
-			epc_app.core_tx[S1U_PORT_ID] = atoi(optarg);
-			printf("Parsed core_s1u:\t%d\n",
-						epc_app.core_rx[S1U_PORT_ID]);
-			used_coremask |= (1ULL << epc_app.core_rx[S1U_PORT_ID]);
+			n_core_rx[S1U_PORT_ID] = parse_core_list(optarg,
+					epc_app.core_rx[S1U_PORT_ID],
+					MAX_RX_QUEUES, &used_coremask);
+			if (n_core_rx[S1U_PORT_ID] < 0) {
+				printf("Invalid s1u core list ->%s<-\n", optarg);
+				dp_print_usage();
+				return -1;
+			}
+			epc_app.core_tx[S1U_PORT_ID] =
+					epc_app.core_rx[S1U_PORT_ID][0];
+			printf("Parsed core_s1u:\t%s\n", optarg);
 			break;
 
 		case 'g':
-			epc_app.core_rx[SGI_PORT_ID] = atoi(optarg);
-			epc_app.core_tx[SGI_PORT_ID] = atoi(optarg);
-			printf("Parsed core_sgi:\t%d\n",
-						epc_app.core_rx[SGI_PORT_ID]);
-			used_coremask |= (1ULL << epc_app.core_rx[SGI_PORT_ID]);
+			n_core_rx[SGI_PORT_ID] = parse_core_list(optarg,
+					epc_app.core_rx[SGI_PORT_ID],
+					MAX_RX_QUEUES, &used_coremask);
+			if (n_core_rx[SGI_PORT_ID] < 0) {
+				printf("Invalid sgi core list ->%s<-\n", optarg);
+				dp_print_usage();
+				return -1;
+			}
+			epc_app.core_tx[SGI_PORT_ID] =
+					epc_app.core_rx[SGI_PORT_ID][0];
+			printf("Parsed core_sgi:\t%s\n", optarg);
+			break;
+
+		case 'y':
+			if (parse_uint(optarg, 1, MAX_RX_QUEUES,
+					&rx_queues) < 0) {
+				printf("Invalid no. of rx queues ->%s<-, max %d\n",
+						optarg, MAX_RX_QUEUES);
+				dp_print_usage();
+				return -1;
+			}
+			epc_app.n_rx_queues = rx_queues;
+			printf("Parsed rx_queues:\t%u\n", epc_app.n_rx_queues);
+			break;
+
+		case 'P':
+			if (app->n_ue_pools == MAX_UE_POOLS ||
+					parse_ue_pool(optarg,
+					&app->ue_pool[app->n_ue_pools]) < 0) {
+				printf("Invalid ue pool ->%s<-, max %d pools "
+						"of /%d or longer\n", optarg,
+						MAX_UE_POOLS, UE_POOL_MIN_PREFIX);
+				dp_print_usage();
+				return -1;
+			}
+			printf("Parsed ue_pool:\t%s\n", optarg);
+			app->n_ue_pools++;
 			break;
 
 		case 'b':
+#ifndef RX_WORKER_DIRECT
 			epc_app.core_load_balance = atoi(optarg);
 			printf("Parsed core_load_balance:\t%d\n",
 						epc_app.core_load_balance);
 			used_coremask |= (1ULL << epc_app.core_load_balance);
+#else
+			printf("DP compiled with RX_WORKER_DIRECT flag in Makefile."
+				" Ignoring load balancer core assignment");
+#endif
 			break;
 
 		case 'c':
@@ -550,6 +764,33 @@ parse_config_args(struct app_params *app, int argc, char **argv)
 			master_cdr_file = optarg;
 			break;
 
+		case 'S':
+			app->sess_snapshot = optarg;
+			printf("Parsed sess_snapshot:\t%s\n", optarg);
+			break;
+
+		case 'I':
+			if (parse_uint(optarg, 1, UINT32_MAX,
+					&app->sess_snapshot_interval) < 0) {
+				printf("Invalid snapshot_secs ->%s<-\n", optarg);
+				dp_print_usage();
+				return -1;
+			}
+			printf("Parsed snapshot_secs:\t%u\n",
+					app->sess_snapshot_interval);
+			break;
+
+		case 'M':
+			if (parse_uint(optarg, 1, SESS_POOL_BEARERS_MAX,
+					&app->max_sessions) < 0) {
+				printf("Invalid max_sessions ->%s<-, max %u\n",
+						optarg, SESS_POOL_BEARERS_MAX);
+				dp_print_usage();
+				return -1;
+			}
+			printf("Parsed max_sessions:\t%u\n", app->max_sessions);
+			break;
+
 		case 'f':
 			app->numa_on = atoi(optarg);
 			break;
@@ -561,11 +802,31 @@ parse_config_args(struct app_params *app, int argc, char **argv)
 	}			/* end while() */
 
 	set_master_cdr_file(master_cdr_file);
-	set_unused_lcore(&epc_app.core_rx[S1U_PORT_ID], &used_coremask);
-	epc_app.core_tx[S1U_PORT_ID] = epc_app.core_rx[S1U_PORT_ID];
-	set_unused_lcore(&epc_app.core_rx[SGI_PORT_ID], &used_coremask);
-	epc_app.core_tx[SGI_PORT_ID] = epc_app.core_rx[SGI_PORT_ID];
+	if (n_core_rx[S1U_PORT_ID] > epc_app.n_rx_queues ||
+			n_core_rx[SGI_PORT_ID] > epc_app.n_rx_queues) {
+		printf("More rx cores given than rx queues (%u)\n",
+				epc_app.n_rx_queues);
+		return -1;
+	}
+	if (rx_queues_max(app->s1u_port) < epc_app.n_rx_queues ||
+			rx_queues_max(app->sgi_port) < epc_app.n_rx_queues) {
+		printf("Invalid no. of rx queues %u, port s1u supports %u, "
+				"sgi %u\n", epc_app.n_rx_queues,
+				rx_queues_max(app->s1u_port),
+				rx_queues_max(app->sgi_port));
+		return -1;
+	}
+	for (i = 0; i < epc_app.n_rx_queues; ++i)
+		set_unused_lcore(&epc_app.core_rx[S1U_PORT_ID][i],
+				&used_coremask);
+	epc_app.core_tx[S1U_PORT_ID] = epc_app.core_rx[S1U_PORT_ID][0];
+	for (i = 0; i < epc_app.n_rx_queues; ++i)
+		set_unused_lcore(&epc_app.core_rx[SGI_PORT_ID][i],
+				&used_coremask);
+	epc_app.core_tx[SGI_PORT_ID] = epc_app.core_rx[SGI_PORT_ID][0];
+#ifndef RX_WORKER_DIRECT
 	set_unused_lcore(&epc_app.core_load_balance, &used_coremask);
+#endif
 	set_unused_lcore(&epc_app.core_mct, &used_coremask);
 	set_unused_lcore(&epc_app.core_iface, &used_coremask);
 #ifdef STATS
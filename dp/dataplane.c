@@ -24,6 +24,7 @@
 #include <rte_ip.h>
 #include <rte_ip_frag.h>
 #include <rte_errno.h>
+#include <rte_vect.h>
 
 #include "main.h"
 #include "interface.h"
@@ -34,15 +35,19 @@
 #include "util.h"
 #include "meter.h"
 #include "acl.h"
+#include "sess_pool.h"
+#include "grow_hash.h"
+#include "fixed_hash.h"
+#include "sess_snapshot.h"
 #include <sponsdn.h>
 #include <stdbool.h>
 
-struct rte_hash *rte_uplink_hash;
-struct rte_hash *rte_downlink_hash;
-struct rte_hash *rte_adc_hash;
-struct rte_hash *rte_adc_ue_hash;
-struct rte_hash *rte_sess_hash;
-struct rte_hash *rte_ue_hash;
+struct fixed_hash *rte_uplink_hash;
+struct fixed_hash *rte_downlink_hash;
+struct fixed_hash *rte_adc_hash;
+struct grow_hash *rte_adc_ue_hash;
+struct grow_hash *rte_sess_hash;
+struct grow_hash *rte_ue_hash;
 struct rte_hash *rte_sdf_pcc_hash;
 struct rte_hash *rte_adc_pcc_hash;
 
@@ -51,64 +56,48 @@ pcap_dumper_t *pcap_dumper_east;
 pcap_dumper_t *pcap_dumper_west;
 #endif /* PCAP_GEN */
 
-void
-gtpu_decap(struct rte_mbuf **pkts, uint32_t n,
-		uint64_t *pkts_mask)
+static DP_ALWAYS_INLINE void
+gtpu_decap_tmpl(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, const enum dp_config cfg)
 {
 	uint32_t i;
 	int ret = 0;
 	static uint64_t ul_num_dcap;
-	struct ipv4_hdr *ipv4_hdr;
-	struct udp_hdr *udp_hdr;
-	struct gtpu_hdr *gtpu_hdr;
 	struct epc_meta_data *meta_data;
+	uint32_t ip = 0;
 
-	for (i = 0; i < n; i++) {
-		/* reject if not with s1u ip */
-		ipv4_hdr = get_mtoip(pkts[i]);
-		uint32_t ip;
-
-		switch(app.spgw_cfg) {
-			case SPGWU:
-				ip = app.s1u_ip;
-				break;
-
-			case PGWU:
-				ip = app.s5s8_pgwu_ip;
-				break;
+	switch(cfg) {
+		case SPGWU:
+			ip = app.s1u_ip;
+			break;
 
-			default:
-				break;
-		}
+		case PGWU:
+			ip = app.s5s8_pgwu_ip;
+			break;
 
-		if (ipv4_hdr->dst_addr != ip) {
-			RESET_BIT(*pkts_mask, i);
-			continue;
-		}
+		default:
+			break;
+	}
 
-		/* reject un-tunneled packet */
-		udp_hdr = get_mtoudp(pkts[i]);
-		if (ntohs(udp_hdr->dst_port) != UDP_PORT_GTPU) {
-			RESET_BIT(*pkts_mask, i);
-			continue;
-		}
+	/* first stage of the uplink, headers are decapsulated here */
+	prefetch_pkts_start(pkts, n);
+	for (i = 0; i < n; i++) {
+		prefetch_pkts_ahead(pkts, n, i);
+		meta_data =
+		(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[i],
+						META_DATA_OFFSET);
 
-		gtpu_hdr = get_mtogtpu(pkts[i]);
-		if (gtpu_hdr->teid == 0 || gtpu_hdr->msgtype != GTP_GPDU) {
+		/* reject if not a G-PDU with s1u ip, teid and enb ip are
+		 * filled in by RX */
+		if (!is_gpdu_meta(meta_data, ip)) {
 			RESET_BIT(*pkts_mask, i);
 			continue;
 		}
 
-
-		meta_data =
-		(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[i],
-						META_DATA_OFFSET);
-		meta_data->teid = ntohl(gtpu_hdr->teid);
-		meta_data->enb_ipv4 = ntohl(ipv4_hdr->src_addr);
 		RTE_LOG(DEBUG, DP, "Received tunneled packet with teid 0x%x\n",
 				meta_data->teid);
 		RTE_LOG(DEBUG, DP, "From Ue IP " IPV4_ADDR "\n",
-				IPV4_ADDR_FORMAT(gtpu_inner_src_ip(pkts[i])));
+				IPV4_ADDR_FORMAT(meta_data->ue_tuple.src_addr));
 
 		ret = decap_gtpu_hdr(pkts[i]);
 
@@ -120,19 +109,31 @@ gtpu_decap(struct rte_mbuf **pkts, uint32_t n,
 }
 
 void
-gtpu_encap(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
-		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask)
+gtpu_decap_spgwu(struct rte_mbuf **pkts, uint32_t n, uint64_t *pkts_mask)
+{
+	gtpu_decap_tmpl(pkts, n, pkts_mask, SPGWU);
+}
+
+void
+gtpu_decap_pgwu(struct rte_mbuf **pkts, uint32_t n, uint64_t *pkts_mask)
+{
+	gtpu_decap_tmpl(pkts, n, pkts_mask, PGWU);
+}
+
+static DP_ALWAYS_INLINE void
+gtpu_encap_tmpl(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
+		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask,
+		uint8_t portid)
 {
 	uint32_t i;
 	struct dp_session_info *si;
-	struct rte_mbuf *m;
-	uint16_t len;
-	uint32_t src_addr;
-	uint32_t dst_addr;
+	const uint8_t *hdr;
 
+	/* first downlink stage writing the headers */
+	prefetch_pkts_start(pkts, n);
 	for (i = 0; i < n; i++) {
+		prefetch_pkts_ahead(pkts, n, i);
 		si = sess_info[i];
-		m = pkts[i];
 
 		if (!ISSET_BIT(*pkts_mask, i))
 			continue;
@@ -142,51 +143,50 @@ gtpu_encap(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
 			continue;
 		}
 
-		if (!si->dl_s1_info.enb_teid) {
+		/* headers are replaced whole by the owner worker, load once */
+		hdr = si->encap_hdr;
+		if (!encap_hdr_teid(hdr)) {
 			RESET_BIT(*pkts_mask, i);
 			SET_BIT(*pkts_queue_mask, i);
 			continue;
 		}
 
-		if (encap_gtpu_hdr(m, si->dl_s1_info.enb_teid) < 0) {
+		/* outer headers for SPGWU/PGWU are prebuilt per bearer */
+		if (encap_gtpu_tmpl_hdr(pkts[i], hdr, portid) < 0)
 			RESET_BIT(*pkts_mask, i);
-			continue;
-		}
-
-		len = rte_pktmbuf_data_len(m);
-		len = len - ETH_HDR_SIZE;
-
-		if (app.spgw_cfg == PGWU)
-			dst_addr = si->dl_s1_info.s5s8_sgwu_addr.u.ipv4_addr;
-		else
-			dst_addr = si->dl_s1_info.enb_addr.u.ipv4_addr;
-
-		/* construct iphdr */
-		switch(app.spgw_cfg) {
-			case SPGWU:
-				src_addr = app.s1u_ip;
-				break;
-
-			case PGWU:
-				src_addr = app.s5s8_pgwu_ip;
-				break;
-
-			default:
-				break;
-		}
+	}
+}
 
-		construct_ipv4_hdr(m, len, IP_PROTO_UDP, ntohl(src_addr),
-					dst_addr);
+void
+gtpu_encap_spgwu(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
+		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask)
+{
+	gtpu_encap_tmpl(sess_info, pkts, n, pkts_mask, pkts_queue_mask,
+			app.s1u_port);
+}
 
-		len = len - IPv4_HDR_SIZE;
-		/* construct udphdr */
-		construct_udp_hdr(m, len, UDP_PORT_GTPU, UDP_PORT_GTPU);
-	}
+void
+gtpu_encap_pgwu(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
+		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask)
+{
+	gtpu_encap_tmpl(sess_info, pkts, n, pkts_mask, pkts_queue_mask,
+			app.s5s8_pgwu_port);
 }
 
 void
-ul_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
-		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info)
+gtpu_encap(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
+		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask)
+{
+	if (app.spgw_cfg == PGWU)
+		gtpu_encap_pgwu(sess_info, pkts, n, pkts_mask, pkts_queue_mask);
+	else
+		gtpu_encap_spgwu(sess_info, pkts, n, pkts_mask, pkts_queue_mask);
+}
+
+static DP_ALWAYS_INLINE void
+ul_sess_info_get_tmpl(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
+		const enum dp_config cfg)
 {
 	uint32_t j;
 	struct ul_bm_key key[MAX_BURST_SZ];
@@ -199,46 +199,35 @@ ul_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
 	 * After new implementation of ADC-PCC relation lookup will fail.
 	 * Hard coding rule id to 1. (temporary fix)
 	 */
+	/* first stage of the SGWU uplink */
+	if (cfg == SGWU)
+		prefetch_pkts_start(pkts, n);
 	for (j = 0; j < n; j++) {
+		if (cfg == SGWU)
+			prefetch_pkts_ahead(pkts, n, j);
 		key[j].rid =1;
 		key[j].s1u_sgw_teid = 0;
 		key_ptr[j] = &key[j];
 
-		switch (app.spgw_cfg) {
+		meta_data =
+			(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[j],
+			META_DATA_OFFSET);
+
+		switch (cfg) {
 			case SPGWU: {
-				meta_data =
-					(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[j],
-					META_DATA_OFFSET);
+				/* teid validated by gtpu_decap */
 				key[j].s1u_sgw_teid = meta_data->teid;
 				break;
 			}
 
 			case SGWU: {
-				struct ipv4_hdr *ipv4_hdr = NULL;
-				struct udp_hdr *udp_hdr = NULL;
-				struct gtpu_hdr *gtpu_hdr = NULL;
-
-				/* reject if not with s1u ip */
-				ipv4_hdr = get_mtoip(pkts[j]);
-				if (ipv4_hdr->dst_addr != app.s1u_ip) {
+				/* reject if not a G-PDU with s1u ip */
+				if (!is_gpdu_meta(meta_data, app.s1u_ip)) {
 					RESET_BIT(*pkts_mask, j);
 					continue;
 				}
 
-				/* reject un-tunneled packet */
-				udp_hdr = get_mtoudp(pkts[j]);
-				if (ntohs(udp_hdr->dst_port) != UDP_PORT_GTPU) {
-					RESET_BIT(*pkts_mask, j);
-					continue;
-				}
-
-				gtpu_hdr = get_mtogtpu(pkts[j]);
-				if (gtpu_hdr->teid == 0 || gtpu_hdr->msgtype != GTP_GPDU) {
-					RESET_BIT(*pkts_mask, j);
-					continue;
-				}
-
-				key[j].s1u_sgw_teid = ntohl(gtpu_hdr->teid);
+				key[j].s1u_sgw_teid = meta_data->teid;
 				break;
 			}
 
@@ -259,49 +248,76 @@ ul_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
 				"teid:%u, rid:%u\n",
 				key[j].s1u_sgw_teid, key[j].rid);
 			sess_info[j] = NULL;
+		} else {
+			/* stage 2: bearer info is read by the next stages */
+			rte_prefetch0(sess_info[j]);
 		}
 	}
 }
 
+void
+ul_sess_info_get_spgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info)
+{
+	ul_sess_info_get_tmpl(pkts, n, pkts_mask, sess_info, SPGWU);
+}
+
+void
+ul_sess_info_get_sgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info)
+{
+	ul_sess_info_get_tmpl(pkts, n, pkts_mask, sess_info, SGWU);
+}
+
+void
+ul_sess_info_get_pgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info)
+{
+	ul_sess_info_get_tmpl(pkts, n, pkts_mask, sess_info, PGWU);
+}
+
 void
 adc_ue_info_get(struct rte_mbuf **pkts, uint32_t n, uint32_t *res,
 		void **adc_ue_info, uint32_t flow)
 {
 	uint32_t j;
 	struct dl_bm_key key[MAX_BURST_SZ];
-	struct ipv4_hdr *ipv4_hdr;
+	struct epc_meta_data *meta_data;
 	void *key_ptr[MAX_BURST_SZ];
 	uint64_t hit_mask = 0;
 
 	for (j = 0; j < n; j++) {
-		ipv4_hdr = get_mtoip(pkts[j]);
+		meta_data =
+			(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[j],
+			META_DATA_OFFSET);
 		key[j].rid = res[j];
 		if (flow == UL_FLOW)
-			key[j].ue_ipv4 = ntohl(ipv4_hdr->src_addr);
+			key[j].ue_ipv4 = ntohl(meta_data->ue_tuple.src_addr);
 		else
-			key[j].ue_ipv4 = ntohl(ipv4_hdr->dst_addr);
+			key[j].ue_ipv4 = ntohl(meta_data->ue_tuple.dst_addr);
 
 		key_ptr[j] = &key[j];
 	}
 
-	if ((rte_hash_lookup_bulk_data(rte_adc_ue_hash,
-		(const void **)&key_ptr[0], n, &hit_mask, adc_ue_info)) < 0)
-		RTE_LOG(ERR, DP, "ADC UE Bulk LKUP:FAIL!!\n");
+	grow_hash_lookup_bulk_data(rte_adc_ue_hash,
+		(const void **)&key_ptr[0], n, &hit_mask, adc_ue_info);
 
 	for (j = 0; j < n; j++)
 		if (!ISSET_BIT(hit_mask, j))
 			adc_ue_info[j] = NULL;
+		else
+			rte_prefetch0(adc_ue_info[j]);
 }
 
-void
-dl_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
+static DP_ALWAYS_INLINE void
+dl_sess_info_get_tmpl(struct rte_mbuf **pkts, uint32_t n,
 		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
-		struct dp_session_info **si)
+		struct dp_session_info **si, const enum dp_config cfg)
 {
 	uint32_t j;
 	struct dl_bm_key key[MAX_BURST_SZ];
 	void *key_ptr[MAX_BURST_SZ];
-	struct ipv4_hdr *ipv4_hdr = NULL;
+	struct epc_meta_data *meta_data;
 	uint32_t dst_addr = 0;
 	uint64_t hit_mask = 0;
 
@@ -310,40 +326,30 @@ dl_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
 	 * After new implementation of ADC-PCC relation lookup will fail.
 	 * Hard coding rule id to 1. (temporary fix)
 	 */
+	/* first stage of the SGWU downlink */
+	if (cfg == SGWU)
+		prefetch_pkts_start(pkts, n);
 	for (j = 0; j < n; j++) {
+		if (cfg == SGWU)
+			prefetch_pkts_ahead(pkts, n, j);
 		key[j].rid =1;
 		key[j].ue_ipv4 = 0;
 		key_ptr[j] = &key[j];
 
-		switch (app.spgw_cfg) {
-			case SGWU: {
-				struct udp_hdr *udp_hdr = NULL;
-				struct gtpu_hdr *gtpu_hdr = NULL;
-
-				/* reject if not with s1u ip */
-				ipv4_hdr = get_mtoip(pkts[j]);
-				if (ipv4_hdr->dst_addr != app.s5s8_sgwu_ip) {
-					RESET_BIT(*pkts_mask, j);
-					continue;
-				}
-
-				/* reject un-tunneled packet */
-				udp_hdr = get_mtoudp(pkts[j]);
-				if (ntohs(udp_hdr->dst_port) != UDP_PORT_GTPU) {
-					RESET_BIT(*pkts_mask, j);
-					continue;
-				}
+		meta_data =
+		(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[j],
+							META_DATA_OFFSET);
 
-				gtpu_hdr = get_mtogtpu(pkts[j]);
-				if (gtpu_hdr->teid == 0 || gtpu_hdr->msgtype != GTP_GPDU) {
+		switch (cfg) {
+			case SGWU: {
+				/* reject if not a G-PDU with s5s8 sgwu ip */
+				if (!is_gpdu_meta(meta_data, app.s5s8_sgwu_ip)) {
 					RESET_BIT(*pkts_mask, j);
 					continue;
 				}
 
-				uint8_t *pkt_ptr = (uint8_t *) gtpu_hdr;
-				pkt_ptr += GPDU_HDR_SIZE;
-				ipv4_hdr = (struct ipv4_hdr *)pkt_ptr;
-				dst_addr = ntohl(ipv4_hdr->dst_addr);
+				/* UE is the inner destination */
+				dst_addr = ntohl(meta_data->ue_tuple.dst_addr);
 				break;
 			}
 
@@ -352,8 +358,7 @@ dl_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
 			}
 
 			case SPGWU: {
-				ipv4_hdr = get_mtoip(pkts[j]);
-				dst_addr = ntohl(ipv4_hdr->dst_addr);
+				dst_addr = ntohl(meta_data->ue_tuple.dst_addr);
 				break;
 			}
 
@@ -363,9 +368,6 @@ dl_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
 
 
 		key[j].ue_ipv4 = dst_addr;
-		struct epc_meta_data *meta_data =
-		(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[j],
-							META_DATA_OFFSET);
 		meta_data->key.ue_ipv4 = key[j].ue_ipv4;
 		meta_data->key.rid = key[j].rid;
 		RTE_LOG(DEBUG, DP, "BEAR_SESS LKUP:DL_KEY ue_addr:"IPV4_ADDR
@@ -379,6 +381,13 @@ dl_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
 			&hit_mask, (void **)sess_info)) < 0)
 		RTE_LOG(ERR, DP, "SDF BEAR Bulk LKUP:FAIL!!\n");
 
+	/* stage 2: prefetch the bearer info of the hits before
+	 * dereferencing any of them */
+	for (j = 0; j < n; j++)
+		if (ISSET_BIT(hit_mask, j))
+			rte_prefetch0(sess_info[j]);
+
+	/* stage 3: session info, read by the encap and charging stages */
 	for (j = 0; j < n; j++) {
 		if (!ISSET_BIT(hit_mask, j)) {
 			RESET_BIT(*pkts_mask, j);
@@ -390,10 +399,35 @@ dl_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
 			si[j] = NULL;
 		} else {
 			si[j] = sess_info[j]->bear_sess_info;
+			rte_prefetch0(si[j]);
 		}
 	}
 }
 
+void
+dl_sess_info_get_sgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
+		struct dp_session_info **si)
+{
+	dl_sess_info_get_tmpl(pkts, n, pkts_mask, sess_info, si, SGWU);
+}
+
+void
+dl_sess_info_get_spgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
+		struct dp_session_info **si)
+{
+	dl_sess_info_get_tmpl(pkts, n, pkts_mask, sess_info, si, SPGWU);
+}
+
+void
+dl_sess_info_get_pgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
+		struct dp_session_info **si)
+{
+	dl_sess_info_get_tmpl(pkts, n, pkts_mask, sess_info, si, PGWU);
+}
+
 void
 get_pcc_info(void **sess_info, uint32_t n, void **pcc_info)
 {
@@ -410,25 +444,68 @@ get_pcc_info(void **sess_info, uint32_t n, void **pcc_info)
 	}
 }
 
-void
-pcc_gating(struct pcc_id_precedence *sdf_info, struct pcc_id_precedence *adc_info,
-	uint32_t n, uint64_t *pkts_mask)
+/**
+ * @brief Bit i set if the gate of pkt i is closed, for pkts 0 to n - 1
+ * and garbage above.
+ */
+#if defined(RTE_MACHINE_CPUFLAG_SSE4_2) && !defined(PCC_GATING_SCALAR)
+static inline uint64_t
+pcc_gate_closed(const struct pcc_burst_info *sdf_info,
+		const struct pcc_burst_info *adc_info, uint32_t n)
 {
+	const __m128i close = _mm_set1_epi8(CLOSE);
+	__m128i sp, ap, sg, ag, adc, gate;
+	uint64_t closed = 0;
 	uint32_t i;
 
-	for (i = 0; i < n; i++) {
+	RTE_BUILD_BUG_ON(MAX_BURST_SZ % 16);
+
+	/* 16 pkts a step, the arrays are MAX_BURST_SZ long */
+	for (i = 0; i < n; i += 16) {
+		sp = _mm_loadu_si128((const __m128i *)&sdf_info->precedence[i]);
+		ap = _mm_loadu_si128((const __m128i *)&adc_info->precedence[i]);
+		sg = _mm_loadu_si128((const __m128i *)&sdf_info->gate_status[i]);
+		ag = _mm_loadu_si128((const __m128i *)&adc_info->gate_status[i]);
+
 		/* Lowest value, highest precedance. ref: 29.212 */
-		if (sdf_info[i].precedence < adc_info[i].precedence) {
-			if (sdf_info[i].gate_status == CLOSE) {
-				RESET_BIT(*pkts_mask, i);
-			}
+		adc = _mm_cmpeq_epi8(_mm_min_epu8(sp, ap), ap);
+		gate = _mm_blendv_epi8(sg, ag, adc);
+		closed |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(gate, close)) << i;
+	}
+	return closed;
+}
+#else
+static inline uint64_t
+pcc_gate_closed(const struct pcc_burst_info *sdf_info,
+		const struct pcc_burst_info *adc_info, uint32_t n)
+{
+	uint64_t closed = 0;
+	uint8_t gate;
+	uint32_t i;
 
-		} else {
-			if (adc_info[i].gate_status == CLOSE) {
-				RESET_BIT(*pkts_mask, i);
-			}
-		}
+	for (i = 0; i < n; i++) {
+		/* Lowest value, highest precedance. ref: 29.212 */
+		gate = (adc_info->precedence[i] <= sdf_info->precedence[i]) ?
+			adc_info->gate_status[i] : sdf_info->gate_status[i];
+		closed |= (uint64_t)(gate == CLOSE) << i;
 	}
+	return closed;
+}
+#endif
+
+uint64_t
+pcc_gating(const struct pcc_burst_info *sdf_info,
+		const struct pcc_burst_info *adc_info, uint32_t n,
+		uint64_t *pkts_mask)
+{
+	uint64_t gate_mask;
+
+	/* pkts_mask has no bit above n */
+	gate_mask = pcc_gate_closed(sdf_info, adc_info, n) & *pkts_mask;
+	*pkts_mask &= ~gate_mask;
+
+	return gate_mask;
 }
 
 /**
@@ -511,6 +588,24 @@ update_cdr(struct ipcan_dp_bearer_cdr *cdr, struct rte_mbuf *pkt,
 	}
 }
 
+void
+update_gate_cdr(void **adc_ue_info, struct rte_mbuf **pkts,
+		uint64_t gate_mask, uint32_t flow)
+{
+	struct dp_adc_ue_info *adc_ue;
+	uint32_t i;
+
+	while (gate_mask) {
+		i = __builtin_ctzll(gate_mask);
+		gate_mask &= gate_mask - 1;
+
+		adc_ue = (struct dp_adc_ue_info *)adc_ue_info[i];
+		if (adc_ue == NULL)
+			continue;
+		update_cdr(&adc_ue->adc_cdr, pkts[i], flow, DROPPED);
+	}
+}
+
 #ifdef ADC_UPFRONT
 void
 update_adc_cdr(void **adc_ue_info,
@@ -592,10 +687,10 @@ update_bear_cdr(struct dp_sdf_per_bearer_info **sdf_bear_info,
 			continue;
 
 		if (ISSET_BIT(*pkts_mask, i))
-			update_cdr(&si->ipcan_dp_bearer_cdr, pkts[i],
+			update_cdr(&si->cold->ipcan_dp_bearer_cdr, pkts[i],
 					flow, CHARGED);
 		else
-			update_cdr(&si->ipcan_dp_bearer_cdr, pkts[i],
+			update_cdr(&si->cold->ipcan_dp_bearer_cdr, pkts[i],
 					flow, DROPPED);
 	}	/* for (i = 0; i < n; i++)*/
 }
@@ -619,7 +714,7 @@ update_rating_grp_cdr(void **sess_info, uint32_t **rgrp,
 		if (si == NULL)
 			continue;
 
-		if (rgrp[i] == NULL)
+		if (rgrp[i] == NULL || si->ue_info_ptr->rating_grp == NULL)
 			continue;
 
 		rg_idx = get_rg_idx(*rgrp[i], si->ue_info_ptr->rg_idx_map);
@@ -643,12 +738,14 @@ adc_hash_lookup(struct rte_mbuf **pkts, uint32_t n, uint32_t *rid, uint8_t flow)
 	uint32_t *key_ptr[MAX_BURST_SZ];
 	uint64_t hit_mask = 0;
 	struct msg_adc *data[MAX_BURST_SZ];
-	struct ipv4_hdr *ipv4_hdr;
+	struct epc_meta_data *meta_data;
 
 	for (j = 0; j < n; j++) {
-		ipv4_hdr = get_mtoip(pkts[j]);
-		key32[j] = (flow == UL_FLOW) ? ipv4_hdr->dst_addr :
-				ipv4_hdr->src_addr;
+		meta_data =
+			(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[j],
+			META_DATA_OFFSET);
+		key32[j] = (flow == UL_FLOW) ? meta_data->ue_tuple.dst_addr :
+				meta_data->ue_tuple.src_addr;
 		key_ptr[j] = &key32[j];
 	}
 
@@ -656,6 +753,10 @@ adc_hash_lookup(struct rte_mbuf **pkts, uint32_t n, uint32_t *rid, uint8_t flow)
 			n, &hit_mask, (void **)data) < 0)
 		hit_mask = 0;
 
+	for (j = 0; j < n; j++)
+		if (ISSET_BIT(hit_mask, j))
+			rte_prefetch0(data[j]);
+
 	for (j = 0; j < n; j++) {
 		if (ISSET_BIT(hit_mask, j)) {
 			RTE_LOG(DEBUG, DP, "ADC_DNS_LKUP: rid[%d]:%u\n", j,
@@ -743,13 +844,14 @@ update_nexthop_info(struct rte_mbuf **pkts, uint32_t n,
 			if (construct_ether_hdr(pkts[i], portid, &sess_info[i]) < 0)
 				RESET_BIT(*pkts_mask, i);
 		}
-		/* TODO: Set checksum offload.*/
+		/* IPv4 checksum offload is set by the header constructors */
 	}
 }
 
-void
-update_nexts5s8_info(struct rte_mbuf **pkts, uint32_t n,
-		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sdf_bear_info)
+static DP_ALWAYS_INLINE void
+update_nexts5s8_info_tmpl(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sdf_bear_info,
+		const enum dp_config cfg)
 {
 	/*TODO: Do we need to update TEID in GTP header?*/
 	uint16_t len;
@@ -760,22 +862,38 @@ update_nexts5s8_info(struct rte_mbuf **pkts, uint32_t n,
 			len = rte_pktmbuf_data_len(pkts[i]);
 			len = len - ETH_HDR_SIZE;
 
-			if (app.spgw_cfg == SGWU) {
+			if (cfg == SGWU) {
 				/*TODO : Make readable*/
 				uint32_t s5s8_pgwu_addr =
 					sdf_bear_info[i]->bear_sess_info->ul_s1_info.s5s8_pgwu_addr.u.ipv4_addr;
 				construct_ipv4_hdr(pkts[i], len, IP_PROTO_UDP,
-						ntohl(app.s5s8_sgwu_ip), s5s8_pgwu_addr);
-			}else if (app.spgw_cfg == PGWU) {
+						ntohl(app.s5s8_sgwu_ip), s5s8_pgwu_addr,
+						app.s5s8_sgwu_port);
+			}else if (cfg == PGWU) {
 				uint32_t s5s8_sgwu_addr =
 					sdf_bear_info[i]->bear_sess_info->dl_s1_info.s5s8_sgwu_addr.u.ipv4_addr;
 				construct_ipv4_hdr(pkts[i], len, IP_PROTO_UDP,
-						ntohl(app.s5s8_pgwu_ip), s5s8_sgwu_addr);
+						ntohl(app.s5s8_pgwu_ip), s5s8_sgwu_addr,
+						app.s5s8_pgwu_port);
 			}
 		}
 	}
 }
 
+void
+update_nexts5s8_info_sgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sdf_bear_info)
+{
+	update_nexts5s8_info_tmpl(pkts, n, pkts_mask, sdf_bear_info, SGWU);
+}
+
+void
+update_nexts5s8_info_pgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sdf_bear_info)
+{
+	update_nexts5s8_info_tmpl(pkts, n, pkts_mask, sdf_bear_info, PGWU);
+}
+
 void
 update_enb_info(struct rte_mbuf **pkts, uint32_t n,
 		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info)
@@ -791,7 +909,7 @@ update_enb_info(struct rte_mbuf **pkts, uint32_t n,
 			uint32_t enb_addr =
 					sess_info[i]->bear_sess_info->dl_s1_info.enb_addr.u.ipv4_addr;
 			construct_ipv4_hdr(pkts[i], len, IP_PROTO_UDP,
-					ntohl(app.s1u_ip), enb_addr);
+					ntohl(app.s1u_ip), enb_addr, app.s1u_port);
 
 			/*Update tied in GTP U header*/
 			((struct gtpu_hdr *)get_mtogtpu(pkts[i]))->teid  =
@@ -843,43 +961,59 @@ void dp_table_init(void)
 	/*
 	 * Create Uplink DB
 	 */
-	hash_create("iface_uplink_db", &rte_uplink_hash,
+	rte_uplink_hash = fixed_hash_create("iface_uplink_db",
 				LDB_ENTRIES_DEFAULT * HASH_SIZE_FACTOR,
-				sizeof(struct ul_bm_key));
+				sizeof(struct ul_bm_key), rte_socket_id());
+	if (rte_uplink_hash == NULL)
+		rte_exit(EXIT_FAILURE, "error creating iface_uplink_db\n");
 	/*
 	 * Create Downlink DB
 	 */
-	hash_create("iface_downlink_db", &rte_downlink_hash,
+	rte_downlink_hash = fixed_hash_create("iface_downlink_db",
 				LDB_ENTRIES_DEFAULT * HASH_SIZE_FACTOR,
-				sizeof(struct dl_bm_key));
+				sizeof(struct dl_bm_key), rte_socket_id());
+	if (rte_downlink_hash == NULL)
+		rte_exit(EXIT_FAILURE, "error creating iface_downlink_db\n");
 
 	/*
 	 * Create ADC Domain Hash table
 	 */
-	hash_create("adc_domain_hash", &rte_adc_hash, LDB_ENTRIES_DEFAULT,
-			sizeof(uint32_t));
+	rte_adc_hash = fixed_hash_create("adc_domain_hash",
+			LDB_ENTRIES_DEFAULT, sizeof(uint32_t), rte_socket_id());
+	if (rte_adc_hash == NULL)
+		rte_exit(EXIT_FAILURE, "error creating adc_domain_hash\n");
 
 	/*
-	 * Create ADC UE info Hash table
+	 * Create ADC UE info Hash table, grows up to LDB_ENTRIES_DEFAULT
 	 */
-	hash_create("adc_ue_info", &rte_adc_ue_hash, LDB_ENTRIES_DEFAULT,
+	rte_adc_ue_hash = grow_hash_create("adc_ue_info", LDB_ENTRIES_DEFAULT,
 			sizeof(struct dl_bm_key));
+	if (rte_adc_ue_hash == NULL)
+		rte_exit(EXIT_FAILURE, "error creating adc_ue_info hash\n");
 
 	/*
-	 * Create UE Sess Hash table
+	 * Create UE Sess Hash table, grows up to LDB_ENTRIES_DEFAULT
 	 */
-	hash_create("ue_sess_info", &rte_ue_hash, LDB_ENTRIES_DEFAULT,
+	rte_ue_hash = grow_hash_create("ue_sess_info", LDB_ENTRIES_DEFAULT,
 			sizeof(uint32_t));
+	if (rte_ue_hash == NULL)
+		rte_exit(EXIT_FAILURE, "error creating ue_sess_info hash\n");
 
 	/* Create table for sponsored domain names */
 	ret = epc_sponsdn_create(DEFAULT_DN_NUM);
 	if (ret)
 		rte_exit(EXIT_FAILURE,
 			"error allocating sponsored DN context %d\n", ret);
+	/*
+	 * Create session table object pools
+	 */
+	sess_pool_init();
+
 	/*
 	 * Init callback APIs
 	 */
 	app_sess_tbl_init();
+	sess_snapshot_init();
 	app_pcc_tbl_init();
 	app_mtr_tbl_init();
 	app_filter_tbl_init();
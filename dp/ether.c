@@ -157,9 +157,5 @@ int construct_ether_hdr(struct rte_mbuf *m, uint8_t portid,
 
 	ether_addr_copy(&ports_eth_addr[portid], &eth_hdr->s_addr);
 
-#ifdef INSTMNT
-	flag_wrkr_update_diff = 1;
-	total_wrkr_pkts_processed++;
-#endif
 	return 0;
 }
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_hash_crc.h>
+#include <rte_log.h>
+#include <rte_malloc.h>
+#include <rte_prefetch.h>
+#include <rte_vect.h>
+
+#include "fixed_hash.h"
+
+#define RTE_LOGTYPE_DP RTE_LOGTYPE_USER1
+
+/** CRC32 init value of the bucket hash */
+#define FIXED_HASH_INIT		0xffffffff
+/** CRC32 init value of the signature, independent of the bucket bits */
+#define FIXED_HASH_SIG_INIT	0x9e3779b9
+
+static inline uint64_t
+fixed_hash_key(const struct fixed_hash *h, const void *key)
+{
+	uint32_t k32;
+	uint64_t k64;
+
+	if (h->key_len == sizeof(uint32_t)) {
+		memcpy(&k32, key, sizeof(k32));
+		return k32;
+	}
+	memcpy(&k64, key, sizeof(k64));
+	return k64;
+}
+
+static inline uint32_t
+fixed_hash_crc(const struct fixed_hash *h, uint64_t key)
+{
+	if (h->key_len == sizeof(uint32_t))
+		return rte_hash_crc_4byte((uint32_t)key, FIXED_HASH_INIT);
+	return rte_hash_crc_8byte(key, FIXED_HASH_INIT);
+}
+
+/**
+ * @brief Signature of a hash, never 0.
+ */
+static inline uint16_t
+fixed_hash_sig(uint32_t hash)
+{
+	uint16_t sig = rte_hash_crc_4byte(hash, FIXED_HASH_SIG_INIT) >> 16;
+
+	return sig ? sig : 1;
+}
+
+/**
+ * @brief Bit i set if entry i of a bucket has signature sig.
+ */
+#if defined(RTE_MACHINE_CPUFLAG_SSE4_2) && !defined(FIXED_HASH_SCALAR)
+static inline uint32_t
+fixed_hash_sig_match(const struct fixed_hash_bucket *b, uint16_t sig)
+{
+	__m128i eq = _mm_cmpeq_epi16(
+			_mm_load_si128((const __m128i *)b->sig),
+			_mm_set1_epi16(sig));
+
+	/* one byte per lane, one bit per byte */
+	return _mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128()));
+}
+#else
+static inline uint32_t
+fixed_hash_sig_match(const struct fixed_hash_bucket *b, uint16_t sig)
+{
+	uint32_t i, match = 0;
+
+	for (i = 0; i < FIXED_HASH_BUCKET_ENTRIES; i++)
+		match |= (uint32_t)(b->sig[i] == sig) << i;
+	return match;
+}
+#endif
+
+/**
+ * @brief Probe the buckets of a key, bucket index and entry of the key
+ * in *idx and *pos.
+ */
+static inline int
+fixed_hash_find(const struct fixed_hash *h, uint64_t key, uint32_t hash,
+		uint32_t *idx, uint32_t *pos, void **data)
+{
+	const struct fixed_hash_bucket *b;
+	uint16_t sig = fixed_hash_sig(hash);
+	uint32_t i = hash & h->bucket_mask;
+	uint32_t probe, match, e;
+	void *d;
+
+	for (probe = 0; probe < FIXED_HASH_MAX_PROBE; probe++) {
+		b = &h->buckets[i];
+		match = fixed_hash_sig_match(b, sig);
+		while (match) {
+			e = __builtin_ctz(match);
+			/* data before key: a matching key means the data
+			 * was not replaced by a reuse of the entry */
+			d = b->data[e];
+			rte_compiler_barrier();
+			if (b->key[e] == key) {
+				*idx = i;
+				*pos = e;
+				*data = d;
+				return 0;
+			}
+			match &= match - 1;
+		}
+		if (b->ovf == 0)
+			break;
+		i = (i + 1) & h->bucket_mask;
+	}
+	return -ENOENT;
+}
+
+struct fixed_hash *
+fixed_hash_create(const char *name, uint32_t entries, uint32_t key_len,
+		int socket_id)
+{
+	struct fixed_hash *h;
+	uint64_t slots;
+
+	if (key_len != sizeof(uint32_t) && key_len != sizeof(uint64_t)) {
+		RTE_LOG(ERR, DP, "%s hash key length %u not supported\n",
+				name, key_len);
+		return NULL;
+	}
+
+	h = rte_zmalloc_socket("fixed_hash", sizeof(struct fixed_hash),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (h == NULL) {
+		RTE_LOG(ERR, DP, "%s hash alloc failed\n", name);
+		return NULL;
+	}
+
+	snprintf(h->name, sizeof(h->name), "%s", name);
+	h->key_len = key_len;
+	h->entries = entries;
+
+	slots = (uint64_t)entries * 100 / FIXED_HASH_LOAD_MAX;
+	h->num_buckets = rte_align32pow2(RTE_MAX((uint32_t)(
+			(slots + FIXED_HASH_BUCKET_ENTRIES - 1) /
+			FIXED_HASH_BUCKET_ENTRIES), (uint32_t)FIXED_HASH_MAX_PROBE));
+	h->bucket_mask = h->num_buckets - 1;
+	h->buckets = rte_zmalloc_socket(name,
+			sizeof(struct fixed_hash_bucket) * h->num_buckets,
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (h->buckets == NULL) {
+		RTE_LOG(ERR, DP, "%s hash alloc of %u buckets failed\n",
+				name, h->num_buckets);
+		rte_free(h);
+		return NULL;
+	}
+
+	return h;
+}
+
+void fixed_hash_free(struct fixed_hash *h)
+{
+	if (h == NULL)
+		return;
+
+	rte_free(h->buckets);
+	rte_free(h);
+}
+
+int fixed_hash_add_key_data(struct fixed_hash *h, const void *key,
+		void *data)
+{
+	uint64_t k = fixed_hash_key(h, key);
+	uint32_t hash = fixed_hash_crc(h, k);
+	uint32_t home = hash & h->bucket_mask;
+	struct fixed_hash_bucket *b = NULL;
+	uint32_t i, probe, e, empty = 0;
+	void *old;
+
+	if (fixed_hash_find(h, k, hash, &i, &e, &old) == 0) {
+		h->buckets[i].data[e] = data;
+		return 0;
+	}
+
+	i = home;
+	for (probe = 0; probe < FIXED_HASH_MAX_PROBE; probe++) {
+		b = &h->buckets[i];
+		empty = fixed_hash_sig_match(b, 0) &
+			((1 << FIXED_HASH_BUCKET_ENTRIES) - 1);
+		if (empty)
+			break;
+		i = (i + 1) & h->bucket_mask;
+	}
+	if (probe == FIXED_HASH_MAX_PROBE)
+		return -ENOSPC;
+
+	/* lookups probe past the full buckets before the key is visible */
+	for (i = home; i != ((home + probe) & h->bucket_mask);
+			i = (i + 1) & h->bucket_mask)
+		h->buckets[i].ovf++;
+	rte_wmb();
+
+	e = __builtin_ctz(empty);
+	b->key[e] = k;
+	rte_wmb();
+	b->data[e] = data;
+	rte_wmb();
+	b->sig[e] = fixed_hash_sig(hash);
+	h->count++;
+	return 0;
+}
+
+int fixed_hash_del_key(struct fixed_hash *h, const void *key)
+{
+	uint64_t k = fixed_hash_key(h, key);
+	uint32_t hash = fixed_hash_crc(h, k);
+	uint32_t i, e;
+	void *data;
+
+	if (fixed_hash_find(h, k, hash, &i, &e, &data) < 0)
+		return -ENOENT;
+
+	h->buckets[i].sig[e] = 0;
+	rte_wmb();
+	for (e = hash & h->bucket_mask; e != i; e = (e + 1) & h->bucket_mask)
+		h->buckets[e].ovf--;
+	h->count--;
+	return 0;
+}
+
+int fixed_hash_lookup_data(const struct fixed_hash *h, const void *key,
+		void **data)
+{
+	uint64_t k = fixed_hash_key(h, key);
+	uint32_t i, e;
+
+	return fixed_hash_find(h, k, fixed_hash_crc(h, k), &i, &e, data);
+}
+
+int fixed_hash_lookup_bulk_data(const struct fixed_hash *h,
+		const void **keys, uint32_t n, uint64_t *hit_mask, void **data)
+{
+	uint64_t k[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t hash[RTE_HASH_LOOKUP_BULK_MAX];
+	const struct fixed_hash_bucket *b;
+	uint64_t hit = 0;
+	uint32_t i, idx, e;
+
+	for (i = 0; i < n; i++) {
+		k[i] = fixed_hash_key(h, keys[i]);
+		hash[i] = fixed_hash_crc(h, k[i]);
+		b = &h->buckets[hash[i] & h->bucket_mask];
+		rte_prefetch0(b);
+		rte_prefetch0(&b->data[0]);
+	}
+
+	for (i = 0; i < n; i++)
+		if (fixed_hash_find(h, k[i], hash[i], &idx, &e, &data[i]) == 0)
+			hit |= 1ULL << i;
+
+	*hit_mask = hit;
+	return __builtin_popcountll(hit);
+}
+
+int32_t fixed_hash_iterate(const struct fixed_hash *h, const void **key,
+		void **data, uint32_t *next)
+{
+	const struct fixed_hash_bucket *b;
+	uint32_t i, e;
+
+	for (; *next < h->num_buckets * FIXED_HASH_BUCKET_ENTRIES; (*next)++) {
+		i = *next / FIXED_HASH_BUCKET_ENTRIES;
+		e = *next % FIXED_HASH_BUCKET_ENTRIES;
+		b = &h->buckets[i];
+		if (b->sig[e] == 0)
+			continue;
+
+		*key = &b->key[e];
+		*data = b->data[e];
+		return (*next)++;
+	}
+	return -ENOENT;
+}
+
+struct fixed_hash_bucket *
+fixed_hash_bucket_addr(const struct fixed_hash *h, const void *key)
+{
+	uint64_t k = fixed_hash_key(h, key);
+
+	return &h->buckets[fixed_hash_crc(h, k) & h->bucket_mask];
+}
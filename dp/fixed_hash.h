@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FIXED_HASH_H_
+#define _FIXED_HASH_H_
+/**
+ * @file
+ * This file contains macros, data structure definitions and function
+ * prototypes of the hash tables for 4 and 8 byte keys.
+ *
+ * Keys are hashed with the CRC32 instruction. A key is stored in its home
+ * bucket or, when full, in one of the next FIXED_HASH_MAX_PROBE - 1
+ * buckets (linear probing). A bucket holds the 16 bit signatures of its
+ * entries, compared at once with SSE, and the keys in its first cache
+ * line, the data in the second. Every bucket counts the keys probing
+ * past it, a lookup stops at the first bucket with none.
+ *
+ * Adds and deletes must be done by a single writer, lookups are lock free.
+ * Data of deleted keys must be freed after a grace period.
+ */
+#include <stdint.h>
+#include <rte_memory.h>
+#include <rte_hash.h>
+
+/** Entries per bucket */
+#define FIXED_HASH_BUCKET_ENTRIES	6
+/** Signature lanes per bucket, the last two are always empty */
+#define FIXED_HASH_SIG_LANES		8
+/** Max. buckets probed for a key */
+#define FIXED_HASH_MAX_PROBE		16
+/** Max. load factor in percent the table is sized for */
+#define FIXED_HASH_LOAD_MAX		75
+
+/**
+ * Bucket of a fixed key hash table, two cache lines.
+ */
+struct fixed_hash_bucket {
+	/** signatures, 0 if the entry is empty */
+	uint16_t sig[FIXED_HASH_SIG_LANES];
+	/** keys, 4 byte keys are zero extended */
+	uint64_t key[FIXED_HASH_BUCKET_ENTRIES];
+	void *data[FIXED_HASH_BUCKET_ENTRIES];
+	/** keys stored past this bucket with a home bucket up to this one */
+	uint32_t ovf;
+} __rte_cache_aligned;
+
+/**
+ * Hash table for 4 and 8 byte keys.
+ */
+struct fixed_hash {
+	char name[RTE_HASH_NAMESIZE];
+	uint32_t key_len;		/**< 4 or 8*/
+	uint32_t entries;		/**< entries the table is sized for*/
+	uint32_t num_buckets;
+	uint32_t bucket_mask;
+	uint32_t count;			/**< keys stored*/
+	struct fixed_hash_bucket *buckets;
+} __rte_cache_aligned;
+
+/**
+ * Create a fixed key hash table.
+ *
+ * @param name
+ *	table name.
+ * @param entries
+ *	max. no. of entries.
+ * @param key_len
+ *	key length, 4 or 8.
+ * @param socket_id
+ *	NUMA socket of the table.
+ *
+ * @return
+ *	- fixed key hash table
+ *	- NULL on failure
+ */
+struct fixed_hash *
+fixed_hash_create(const char *name, uint32_t entries, uint32_t key_len,
+		int socket_id);
+
+/**
+ * Free a fixed key hash table, no worker may use it anymore.
+ *
+ * @param h
+ *	fixed key hash table.
+ *
+ * @return
+ *	None
+ */
+void fixed_hash_free(struct fixed_hash *h);
+
+/**
+ * Add or update a key.
+ *
+ * @param h
+ *	fixed key hash table.
+ * @param key
+ *	key.
+ * @param data
+ *	data of the key.
+ *
+ * @return
+ *	- 0 on success
+ *	- -ENOSPC if the buckets probed for the key are full
+ */
+int fixed_hash_add_key_data(struct fixed_hash *h, const void *key,
+		void *data);
+
+/**
+ * Delete a key.
+ *
+ * @param h
+ *	fixed key hash table.
+ * @param key
+ *	key.
+ *
+ * @return
+ *	- 0 on success
+ *	- -ENOENT if the key is not found
+ */
+int fixed_hash_del_key(struct fixed_hash *h, const void *key);
+
+/**
+ * Lookup a key, data is not modified if the key is not found.
+ *
+ * @param h
+ *	fixed key hash table.
+ * @param key
+ *	key.
+ * @param data
+ *	data of the key.
+ *
+ * @return
+ *	- 0 on success
+ *	- -ENOENT if the key is not found
+ */
+int fixed_hash_lookup_data(const struct fixed_hash *h, const void *key,
+		void **data);
+
+/**
+ * Lookup up to RTE_HASH_LOOKUP_BULK_MAX keys. The buckets of all keys
+ * are prefetched before the first is probed.
+ *
+ * @param h
+ *	fixed key hash table.
+ * @param keys
+ *	keys.
+ * @param n
+ *	no. of keys.
+ * @param hit_mask
+ *	bit i set if keys[i] is found.
+ * @param data
+ *	data of the keys found.
+ *
+ * @return
+ *	no. of keys found.
+ */
+int fixed_hash_lookup_bulk_data(const struct fixed_hash *h,
+		const void **keys, uint32_t n, uint64_t *hit_mask, void **data);
+
+/**
+ * Iterate over the keys of a table.
+ *
+ * @param h
+ *	fixed key hash table.
+ * @param key
+ *	key found.
+ * @param data
+ *	data of the key found.
+ * @param next
+ *	iterator, 0 to start.
+ *
+ * @return
+ *	- position of the key found
+ *	- -ENOENT at the end of the table
+ */
+int32_t fixed_hash_iterate(const struct fixed_hash *h, const void **key,
+		void **data, uint32_t *next);
+
+/**
+ * Home bucket of a key, for prefetching.
+ *
+ * @param h
+ *	fixed key hash table.
+ * @param key
+ *	key.
+ *
+ * @return
+ *	bucket.
+ */
+struct fixed_hash_bucket *
+fixed_hash_bucket_addr(const struct fixed_hash *h, const void *key);
+
+#endif	/* _FIXED_HASH_H_ */
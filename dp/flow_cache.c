@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_malloc.h>
+
+#include "flow_cache.h"
+
+volatile uint64_t flow_cache_epoch = 1;
+
+struct flow_cache *
+flow_cache_create(const char *name, int socket_id)
+{
+	struct flow_cache *fc;
+
+	RTE_BUILD_BUG_ON(sizeof(struct flow_cache_entry) !=
+			RTE_CACHE_LINE_SIZE);
+	RTE_BUILD_BUG_ON(FLOW_CACHE_ENTRIES & FLOW_CACHE_MASK);
+
+	/* zeroed entries have epoch 0, never hit */
+	fc = rte_zmalloc_socket(name, sizeof(struct flow_cache),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (fc == NULL)
+		rte_exit(EXIT_FAILURE, "%s flow cache alloc failed\n", name);
+
+	return fc;
+}
+
+void flow_cache_free(struct flow_cache *fc)
+{
+	rte_free(fc);
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FLOW_CACHE_H_
+#define _FLOW_CACHE_H_
+/**
+ * @file
+ * This file contains macros, data structure definitions and function
+ * prototypes of the per worker flow cache.
+ *
+ * The cache keeps the SDF and ADC rules, their PCC decisions and the
+ * bearer resolved for the first packet of a UE 5-tuple, so that the next
+ * packets of the flow skip the ACL classify, the ADC and PCC hash lookups
+ * and the bearer lookup. It is direct mapped, one cache line per entry,
+ * and only used by the worker owning it.
+ *
+ * Entries are tagged with flow_cache_epoch. Writers of the filter, PCC
+ * and session tables bump the epoch after the change, which invalidates
+ * all entries at once. Workers read the epoch once per burst, before
+ * looking the tables up: an entry resolved with an old epoch is never hit
+ * again, and the bearers it points to are freed only after the grace
+ * period of the burst (see sess_defer_free).
+ */
+#include <stdint.h>
+#include <string.h>
+#include <rte_common.h>
+#include <rte_memory.h>
+#include <rte_prefetch.h>
+#include <rte_hash_crc.h>
+
+/** Entries per worker, a power of 2. 256 KB, about the L2 of a core */
+#ifndef FLOW_CACHE_ENTRIES
+#define FLOW_CACHE_ENTRIES	4096
+#endif
+#define FLOW_CACHE_MASK		(FLOW_CACHE_ENTRIES - 1)
+/** CRC32 init value of the flow hash */
+#define FLOW_CACHE_HASH_INIT	0xffffffff
+
+/**
+ * Flow key, the UE 5-tuple in network order as parsed at RX.
+ */
+struct flow_key {
+	uint32_t src_addr;
+	uint32_t dst_addr;
+	uint16_t src_port;
+	uint16_t dst_port;
+	uint32_t teid;		/**< uplink GTP-U teid, 0 downlink*/
+	uint8_t proto;
+	uint8_t dir;		/**< UL_FLOW or DL_FLOW*/
+	uint16_t pad;		/**< 0, compared with the key*/
+};
+
+/**
+ * Resolved flow, one cache line.
+ */
+struct flow_cache_entry {
+	uint64_t epoch;		/**< flow_cache_epoch of the results, 0 empty*/
+	struct flow_key key;
+	/* SDF and ADC PCC decisions, by value */
+	uint8_t sdf_precedence;
+	uint8_t sdf_gate_status;
+	uint8_t adc_precedence;
+	uint8_t adc_gate_status;
+	uint32_t sdf_pcc_id;
+	uint32_t adc_pcc_id;
+	/* rules of the ACL, the ADC rule before the domain lookup */
+	uint32_t sdf_rule_id;
+	uint32_t adc_rule_id;
+	void *bearer;		/**< struct dp_sdf_per_bearer_info*/
+	void *adc_ue_info;	/**< struct dp_adc_ue_info, uplink only*/
+} __rte_cache_aligned;
+
+/**
+ * Flow cache of a worker.
+ */
+struct flow_cache {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t stale;		/**< misses on entries of an old epoch*/
+	struct flow_cache_entry ent[FLOW_CACHE_ENTRIES];
+} __rte_cache_aligned;
+
+/**
+ * Epoch of the filter, PCC and session tables, from 1.
+ */
+extern volatile uint64_t flow_cache_epoch;
+
+/**
+ * Invalidate the flow caches of all workers. Called after a change of the
+ * tables the flows are resolved with, before entries unlinked by the
+ * change are freed.
+ *
+ * @return
+ *	None
+ */
+static inline void flow_cache_invalidate(void)
+{
+	__sync_add_and_fetch(&flow_cache_epoch, 1);
+}
+
+/**
+ * Set the key of a flow.
+ *
+ * @param key
+ *	key to set.
+ * @param proto
+ *	UE 5-tuple protocol.
+ * @param src_addr
+ *	UE 5-tuple source address.
+ * @param dst_addr
+ *	UE 5-tuple destination address.
+ * @param src_port
+ *	UE 5-tuple source port.
+ * @param dst_port
+ *	UE 5-tuple destination port.
+ * @param teid
+ *	uplink GTP-U teid, 0 downlink.
+ * @param dir
+ *	UL_FLOW or DL_FLOW.
+ *
+ * @return
+ *	None
+ */
+static inline void
+flow_key_set(struct flow_key *key, uint8_t proto, uint32_t src_addr,
+		uint32_t dst_addr, uint16_t src_port, uint16_t dst_port,
+		uint32_t teid, uint8_t dir)
+{
+	key->src_addr = src_addr;
+	key->dst_addr = dst_addr;
+	key->src_port = src_port;
+	key->dst_port = dst_port;
+	key->teid = teid;
+	key->proto = proto;
+	key->dir = dir;
+	key->pad = 0;
+}
+
+/**
+ * @brief 1 if the flow keys are equal.
+ */
+static inline int
+flow_key_equal(const struct flow_key *a, const struct flow_key *b)
+{
+	uint64_t a0, a1, b0, b1;
+	uint32_t a2, b2;
+
+	memcpy(&a0, a, sizeof(a0));
+	memcpy(&b0, b, sizeof(b0));
+	memcpy(&a1, (const uint8_t *)a + 8, sizeof(a1));
+	memcpy(&b1, (const uint8_t *)b + 8, sizeof(b1));
+	memcpy(&a2, (const uint8_t *)a + 16, sizeof(a2));
+	memcpy(&b2, (const uint8_t *)b + 16, sizeof(b2));
+
+	return ((a0 ^ b0) | (a1 ^ b1) | (a2 ^ b2)) == 0;
+}
+
+/**
+ * Look a burst of flows up.
+ *
+ * @param fc
+ *	flow cache.
+ * @param key
+ *	flow keys.
+ * @param n
+ *	no. of flows.
+ * @param lookup_mask
+ *	flows to look up, bit i for key[i].
+ * @param ent
+ *	entry of each flow looked up, on a miss the entry to insert it in.
+ * @param epoch
+ *	epoch of the burst, to insert the flows missed with.
+ *
+ * @return
+ *	hit mask, bit i set if key[i] is found.
+ */
+static inline uint64_t
+flow_cache_lookup(struct flow_cache *fc, const struct flow_key *key,
+		uint32_t n, uint64_t lookup_mask, struct flow_cache_entry **ent,
+		uint64_t *epoch)
+{
+	uint64_t hit_mask = 0;
+	uint64_t e;
+	uint32_t i, hits = 0;
+
+	/* epoch before any table lookup of the burst */
+	e = flow_cache_epoch;
+	rte_compiler_barrier();
+	*epoch = e;
+
+	for (i = 0; i < n; i++) {
+		if (!(lookup_mask & (1ULL << i)))
+			continue;
+		ent[i] = &fc->ent[rte_hash_crc(&key[i], sizeof(key[i]),
+				FLOW_CACHE_HASH_INIT) & FLOW_CACHE_MASK];
+		rte_prefetch0(ent[i]);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!(lookup_mask & (1ULL << i)))
+			continue;
+		if (!flow_key_equal(&ent[i]->key, &key[i]))
+			continue;
+		if (ent[i]->epoch != e) {
+			fc->stale++;
+			continue;
+		}
+		hit_mask |= 1ULL << i;
+		hits++;
+		rte_prefetch0(ent[i]->bearer);
+	}
+
+	fc->hits += hits;
+	fc->misses += __builtin_popcountll(lookup_mask) - hits;
+	return hit_mask;
+}
+
+/**
+ * Key and epoch of an entry, after its results are set. The entry
+ * replaces the flow cached in it before.
+ *
+ * @param ent
+ *	entry returned by flow_cache_lookup for the flow.
+ * @param key
+ *	flow key.
+ * @param epoch
+ *	epoch returned by flow_cache_lookup.
+ *
+ * @return
+ *	None
+ */
+static inline void
+flow_cache_insert(struct flow_cache_entry *ent, const struct flow_key *key,
+		uint64_t epoch)
+{
+	ent->key = *key;
+	ent->epoch = epoch;
+}
+
+/**
+ * Create the flow cache of a worker. Exits on failure.
+ *
+ * @param name
+ *	cache name.
+ * @param socket_id
+ *	NUMA socket of the worker.
+ *
+ * @return
+ *	flow cache.
+ */
+struct flow_cache *flow_cache_create(const char *name, int socket_id);
+
+/**
+ * Free a flow cache.
+ *
+ * @param fc
+ *	flow cache.
+ *
+ * @return
+ *	None
+ */
+void flow_cache_free(struct flow_cache *fc);
+
+#endif	/* _FLOW_CACHE_H_ */
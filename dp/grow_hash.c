@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_hash.h>
+#include <rte_log.h>
+#include <rte_malloc.h>
+
+#include "main.h"
+#include "epc_packet_framework.h"
+#include "grow_hash.h"
+
+/**
+ * @brief Create the next table of a growable hash table.
+ */
+static struct rte_hash *
+grow_hash_table(struct grow_hash *gh, uint32_t entries)
+{
+	char name[RTE_HASH_NAMESIZE];
+	struct rte_hash_parameters rte_hash_params = {
+		.name = name,
+		.entries = entries,
+		.key_len = gh->key_len,
+		.hash_func = DEFAULT_HASH_FUNC,
+		.hash_func_init_val = 0,
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_hash *h;
+
+	snprintf(name, sizeof(name), "%s_%u", gh->name, gh->gen++);
+	h = rte_hash_create(&rte_hash_params);
+	if (h == NULL)
+		RTE_LOG(ERR, DP, "%s hash create failed: %s (%u)\n", name,
+				rte_strerror(rte_errno), rte_errno);
+	return h;
+}
+
+struct grow_hash *
+grow_hash_create(const char *name, uint32_t max_entries, uint32_t key_len)
+{
+	struct grow_hash *gh;
+
+	gh = rte_zmalloc("grow_hash", sizeof(struct grow_hash),
+			RTE_CACHE_LINE_SIZE);
+	if (gh == NULL) {
+		RTE_LOG(ERR, DP, "%s hash alloc failed\n", name);
+		return NULL;
+	}
+
+	snprintf(gh->name, sizeof(gh->name) - 4, "%s", name);
+	gh->key_len = key_len;
+	gh->max_entries = max_entries;
+	gh->capacity = RTE_MIN(max_entries, (uint32_t)GROW_HASH_MIN_ENTRIES);
+	gh->cur = grow_hash_table(gh, gh->capacity);
+	if (gh->cur == NULL) {
+		rte_free(gh);
+		return NULL;
+	}
+
+	return gh;
+}
+
+void grow_hash_free(struct grow_hash *gh)
+{
+	if (gh == NULL)
+		return;
+
+	rte_hash_free(gh->cur);
+	rte_hash_free(gh->old);
+	rte_hash_free(gh->retired);
+	rte_free(gh);
+}
+
+/**
+ * @brief Start moving the entries to a table twice as large.
+ */
+static int
+grow_hash_resize(struct grow_hash *gh)
+{
+	struct rte_hash *h;
+	uint32_t entries;
+
+	if (gh->old != NULL || gh->retired != NULL ||
+			gh->capacity >= gh->max_entries)
+		return -1;
+
+	entries = RTE_MIN((uint64_t)gh->capacity * 2,
+			(uint64_t)gh->max_entries);
+	h = grow_hash_table(gh, entries);
+	if (h == NULL)
+		return -1;
+
+	gh->resize_start = rte_rdtsc();
+	gh->iter = 0;
+	gh->old = gh->cur;
+	/* workers seeing the new table also see the old one */
+	rte_wmb();
+	gh->cur = h;
+	gh->capacity = entries;
+
+	RTE_LOG(INFO, DP, "%s hash resize to %u entries, %u stored\n",
+			gh->name, entries, gh->count);
+	return 0;
+}
+
+void grow_hash_step(struct grow_hash *gh)
+{
+	const void *key;
+	void *data;
+	uint32_t pos;
+	unsigned i;
+
+	if (gh->retired != NULL && qsbr_done() >= gh->retire_period) {
+		rte_hash_free(gh->retired);
+		gh->retired = NULL;
+	}
+
+	if (gh->old == NULL)
+		return;
+
+	for (i = 0; i < GROW_HASH_STEP; i++) {
+		pos = gh->iter;
+		if (rte_hash_iterate(gh->old, &key, &data, &gh->iter) < 0)
+			break;
+
+		/* keys added since the resize started are newer */
+		if (rte_hash_lookup(gh->cur, key) >= 0)
+			continue;
+		if (rte_hash_add_key_data(gh->cur, key, data) < 0) {
+			/* the key is still served by the old table, stop
+			 * here and retry the move on the next step */
+			if (gh->move_fail++ == 0)
+				RTE_LOG(ERR, DP, "%s hash resize failed to "
+						"move key, retrying\n",
+						gh->name);
+			gh->iter = pos;
+			return;
+		}
+	}
+
+	if (i == GROW_HASH_STEP)
+		return;
+
+	/* every key is in the new table, retire the old one */
+	gh->retired = gh->old;
+	gh->old = NULL;
+	gh->retire_period = qsbr_start();
+
+	gh->last_resize_cycles = rte_rdtsc() - gh->resize_start;
+	if (gh->last_resize_cycles > gh->max_resize_cycles)
+		gh->max_resize_cycles = gh->last_resize_cycles;
+	gh->resizes++;
+}
+
+int grow_hash_add_key_data(struct grow_hash *gh, const void *key, void *data)
+{
+	int exists;
+
+	if (gh->old == NULL &&
+			(uint64_t)gh->count * 100 >=
+			(uint64_t)gh->capacity * GROW_HASH_LOAD_MAX)
+		grow_hash_resize(gh);
+	grow_hash_step(gh);
+
+	exists = rte_hash_lookup(gh->cur, key) >= 0 ||
+		(gh->old != NULL && rte_hash_lookup(gh->old, key) >= 0);
+
+	if (rte_hash_add_key_data(gh->cur, key, data) < 0) {
+		/* full before reaching the load factor, grow now */
+		if (grow_hash_resize(gh) < 0 ||
+				rte_hash_add_key_data(gh->cur, key, data) < 0) {
+			gh->add_fail++;
+			return -ENOSPC;
+		}
+	}
+
+	/* the old table keeps serving lookups until moved, update it */
+	if (gh->old != NULL && exists)
+		rte_hash_add_key_data(gh->old, key, data);
+
+	if (!exists)
+		gh->count++;
+	return 0;
+}
+
+int grow_hash_del_key(struct grow_hash *gh, const void *key)
+{
+	int found;
+
+	found = rte_hash_del_key(gh->cur, key) >= 0;
+	if (gh->old != NULL && rte_hash_del_key(gh->old, key) >= 0)
+		found = 1;
+
+	if (!found)
+		return -ENOENT;
+
+	gh->count--;
+	return 0;
+}
+
+int grow_hash_lookup_data(struct grow_hash *gh, const void *key, void **data)
+{
+	struct rte_hash *cur = gh->cur;
+	struct rte_hash *old;
+
+	/* old NULL after cur moved means the move is complete */
+	rte_compiler_barrier();
+	old = gh->old;
+	rte_compiler_barrier();
+
+	if (rte_hash_lookup_data(cur, key, data) >= 0)
+		return 0;
+
+	if (old != NULL && rte_hash_lookup_data(old, key, data) >= 0)
+		return 0;
+
+	return -ENOENT;
+}
+
+int grow_hash_lookup_bulk_data(struct grow_hash *gh, const void **keys,
+		uint32_t n, uint64_t *hit_mask, void **data)
+{
+	const void *miss_key[RTE_HASH_LOOKUP_BULK_MAX];
+	void *miss_data[RTE_HASH_LOOKUP_BULK_MAX];
+	uint8_t miss_pos[RTE_HASH_LOOKUP_BULK_MAX];
+	struct rte_hash *cur = gh->cur;
+	struct rte_hash *old;
+	uint64_t hit = 0, miss_hit = 0;
+	uint32_t i, n_miss = 0;
+
+	rte_compiler_barrier();
+	old = gh->old;
+	rte_compiler_barrier();
+
+	if (rte_hash_lookup_bulk_data(cur, keys, n, &hit, data) < 0)
+		hit = 0;
+
+	if (old == NULL || (uint32_t)__builtin_popcountll(hit) == n) {
+		*hit_mask = hit;
+		return __builtin_popcountll(hit);
+	}
+
+	/* resize in progress, keys not moved yet are in the old table */
+	for (i = 0; i < n; i++) {
+		if (!ISSET_BIT(hit, i)) {
+			miss_key[n_miss] = keys[i];
+			miss_pos[n_miss++] = i;
+		}
+	}
+
+	if (rte_hash_lookup_bulk_data(old, miss_key, n_miss, &miss_hit,
+			miss_data) < 0)
+		miss_hit = 0;
+	for (i = 0; i < n_miss; i++) {
+		if (ISSET_BIT(miss_hit, i)) {
+			data[miss_pos[i]] = miss_data[i];
+			hit |= 1ULL << miss_pos[i];
+		}
+	}
+
+	*hit_mask = hit;
+	return __builtin_popcountll(hit);
+}
+
+int32_t grow_hash_iterate(const struct grow_hash *gh, const void **key,
+		void **data, uint32_t *next)
+{
+	if (gh->old != NULL)
+		return -EBUSY;
+
+	return rte_hash_iterate(gh->cur, key, data, next);
+}
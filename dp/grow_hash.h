@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GROW_HASH_H_
+#define _GROW_HASH_H_
+/**
+ * @file
+ * This file contains macros, data structure definitions and function
+ * prototypes of the growable hash tables.
+ *
+ * A growable table starts small. When its load factor reaches
+ * GROW_HASH_LOAD_MAX it allocates a table twice as large and moves the
+ * entries in steps of GROW_HASH_STEP, done by every add and by the
+ * iface core when idle. Lookups try the new table, then the old one
+ * until the move completes. The old table is freed after a grace period.
+ * Adds, deletes and steps must be done by a single writer.
+ */
+#include <stdint.h>
+#include <rte_hash.h>
+
+/** Initial no. of entries of a growable table */
+#define GROW_HASH_MIN_ENTRIES	(64 * 1024)
+/** Load factor in percent starting a resize */
+#define GROW_HASH_LOAD_MAX	75
+/** Max. entries moved per resize step */
+#define GROW_HASH_STEP		64
+
+/**
+ * Growable hash table.
+ */
+struct grow_hash {
+	/** Table adds go to */
+	struct rte_hash *volatile cur;
+	/** Table being moved to cur, NULL if no resize is in progress */
+	struct rte_hash *volatile old;
+	/** Moved table, freed once retire_period completed */
+	struct rte_hash *retired;
+	uint64_t retire_period;
+
+	char name[RTE_HASH_NAMESIZE];
+	uint32_t key_len;
+	uint32_t max_entries;	/**< entries cur may grow to*/
+	uint32_t capacity;	/**< entries of cur*/
+	uint32_t count;		/**< keys stored*/
+	uint32_t iter;		/**< next position of old to move*/
+	uint32_t gen;		/**< tables created*/
+
+	/* metrics */
+	uint64_t resizes;		/**< completed resizes*/
+	uint64_t resize_start;		/**< tsc at the start of the resize*/
+	uint64_t last_resize_cycles;	/**< duration of the last resize*/
+	uint64_t max_resize_cycles;	/**< longest resize*/
+	uint64_t add_fail;		/**< adds failed, table full*/
+	uint64_t move_fail;		/**< moves failed, retried later*/
+};
+
+/**
+ * Create a growable hash table.
+ *
+ * @param name
+ *	table name, tables created are named name_<n>.
+ * @param max_entries
+ *	max. no. of entries the table may grow to.
+ * @param key_len
+ *	key length.
+ *
+ * @return
+ *	- growable hash table
+ *	- NULL on failure
+ */
+struct grow_hash *
+grow_hash_create(const char *name, uint32_t max_entries, uint32_t key_len);
+
+/**
+ * Free a growable hash table, no worker may use it anymore.
+ *
+ * @param gh
+ *	growable hash table.
+ *
+ * @return
+ *	None
+ */
+void grow_hash_free(struct grow_hash *gh);
+
+/**
+ * Add or update a key. Does a resize step.
+ *
+ * @param gh
+ *	growable hash table.
+ * @param key
+ *	key.
+ * @param data
+ *	data of the key.
+ *
+ * @return
+ *	- 0 on success
+ *	- -ENOSPC if the table is full
+ */
+int grow_hash_add_key_data(struct grow_hash *gh, const void *key, void *data);
+
+/**
+ * Delete a key.
+ *
+ * @param gh
+ *	growable hash table.
+ * @param key
+ *	key.
+ *
+ * @return
+ *	- 0 on success
+ *	- -ENOENT if the key is not found
+ */
+int grow_hash_del_key(struct grow_hash *gh, const void *key);
+
+/**
+ * Lookup a key.
+ *
+ * @param gh
+ *	growable hash table.
+ * @param key
+ *	key.
+ * @param data
+ *	data of the key.
+ *
+ * @return
+ *	- 0 on success
+ *	- -ENOENT if the key is not found
+ */
+int grow_hash_lookup_data(struct grow_hash *gh, const void *key, void **data);
+
+/**
+ * Lookup up to RTE_HASH_LOOKUP_BULK_MAX keys.
+ *
+ * @param gh
+ *	growable hash table.
+ * @param keys
+ *	keys.
+ * @param n
+ *	no. of keys.
+ * @param hit_mask
+ *	bit i set if keys[i] is found.
+ * @param data
+ *	data of the keys found.
+ *
+ * @return
+ *	no. of keys found.
+ */
+int grow_hash_lookup_bulk_data(struct grow_hash *gh, const void **keys,
+		uint32_t n, uint64_t *hit_mask, void **data);
+
+/**
+ * Iterate over the keys of a table. Only while no resize is in progress.
+ * Keys added, deleted or moved by cuckoo displacement between two calls
+ * may be missed or returned twice.
+ *
+ * @param gh
+ *	growable hash table.
+ * @param key
+ *	key found.
+ * @param data
+ *	data of the key found.
+ * @param next
+ *	iterator, 0 to start.
+ *
+ * @return
+ *	- position of the key found
+ *	- -ENOENT at the end of the table
+ *	- -EBUSY if a resize is in progress
+ */
+int32_t grow_hash_iterate(const struct grow_hash *gh, const void **key,
+		void **data, uint32_t *next);
+
+/**
+ * Move up to GROW_HASH_STEP entries of a resize in progress, free the
+ * table of a completed resize once its grace period completed. An entry
+ * failing to move stays in the old table, where lookups still find it,
+ * and the move is retried by the next step.
+ *
+ * @param gh
+ *	growable hash table.
+ *
+ * @return
+ *	None
+ */
+void grow_hash_step(struct grow_hash *gh);
+
+/**
+ * Load factor of a growable hash table in percent.
+ *
+ * @param gh
+ *	growable hash table.
+ *
+ * @return
+ *	load factor.
+ */
+static inline uint32_t grow_hash_load(const struct grow_hash *gh)
+{
+	return (uint64_t)gh->count * 100 / gh->capacity;
+}
+
+#endif	/* _GROW_HASH_H_ */
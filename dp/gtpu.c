@@ -16,8 +16,11 @@
 
 #include <arpa/inet.h>
 #include <rte_ip.h>
+#include <rte_memcpy.h>
 #include "main.h"
 #include "gtpu.h"
+#include "ether.h"
+#include "ipv4.h"
 
 /**
  * Function to construct gtpu header.
@@ -112,6 +115,108 @@ int encap_gtpu_hdr(struct rte_mbuf *m, uint32_t teid)
 	return 0;
 }
 
+void build_gtpu_encap_hdr(uint8_t *hdr, const struct dl_s1_info *dl_s1_info)
+{
+	struct ether_hdr *eth_hdr = (struct ether_hdr *)hdr;
+	struct ipv4_hdr *ipv4_hdr = (struct ipv4_hdr *)&eth_hdr[1];
+	struct udp_hdr *udp_hdr = (struct udp_hdr *)&ipv4_hdr[1];
+	uint8_t *gpdu_hdr = (uint8_t *)&udp_hdr[1];
+	uint8_t portid;
+	uint32_t src_addr;
+	uint32_t dst_addr;
+
+	memset(hdr, 0, ENCAP_HDR_SIZE);
+
+	if (app.spgw_cfg == PGWU) {
+		portid = app.s5s8_pgwu_port;
+		src_addr = app.s5s8_pgwu_ip;
+		dst_addr = htonl(dl_s1_info->s5s8_sgwu_addr.u.ipv4_addr);
+	} else {
+		/* SPGWU, and SGWU for the buffered packets it notifies */
+		portid = app.s1u_port;
+		src_addr = app.s1u_ip;
+		dst_addr = htonl(dl_s1_info->enb_addr.u.ipv4_addr);
+	}
+
+	/* dst mac is resolved per packet by update_nexthop_info */
+	ether_addr_copy(&ports_eth_addr[portid], &eth_hdr->s_addr);
+	eth_hdr->ether_type = htons(ETH_TYPE_IPv4);
+
+	/* same defaults as build_ipv4_default_hdr */
+	ipv4_hdr->version_ihl = 0x45;
+	ipv4_hdr->packet_id = 0x1513;
+	ipv4_hdr->time_to_live = 64;
+	ipv4_hdr->next_proto_id = IP_PROTO_UDP;
+	ipv4_hdr->src_addr = src_addr;
+	ipv4_hdr->dst_addr = dst_addr;
+	ipv4_hdr->hdr_checksum = rte_ipv4_cksum(ipv4_hdr);
+
+	udp_hdr->src_port = htons(UDP_PORT_GTPU);
+	udp_hdr->dst_port = htons(UDP_PORT_GTPU);
+
+#ifdef GTPU_HDR_SEQNB
+	*(gpdu_hdr++) = (GTPU_VERSION << 5) |
+					(GTP_PROTOCOL_TYPE_GTP << 4) |
+					(GTPU_SEQPRESENT << 1);
+#else
+	*(gpdu_hdr++) = (GTPU_VERSION << 5) | (GTP_PROTOCOL_TYPE_GTP << 4);
+#endif  /* GTPU_HDR_SEQNB */
+	*(gpdu_hdr++) = GTP_GPDU;
+	gpdu_hdr += 2;
+	*((uint32_t *) gpdu_hdr) = htonl(dl_s1_info->enb_teid);
+}
+
+int encap_gtpu_tmpl_hdr(struct rte_mbuf *m, const uint8_t *hdr,
+		uint8_t portid)
+{
+	uint8_t *pkt_ptr;
+	struct ipv4_hdr *ipv4_hdr;
+	struct udp_hdr *udp_hdr;
+	struct gtpu_hdr *gtpu_hdr;
+	uint16_t len;
+	uint32_t cksum;
+
+	len = rte_pktmbuf_data_len(m) - ETH_HDR_SIZE;
+
+	/* The template replaces the ether header of the inner packet */
+	pkt_ptr = (uint8_t *) rte_pktmbuf_prepend(m,
+			ENCAP_HDR_SIZE - ETH_HDR_SIZE);
+	if (pkt_ptr == NULL) {
+		RTE_LOG(ERR, DP, "Error: Failed to add GTPU header\n");
+		return -1;
+	}
+	rte_memcpy(pkt_ptr, hdr, ENCAP_HDR_SIZE);
+
+	ipv4_hdr = (struct ipv4_hdr *)(pkt_ptr + ETH_HDR_SIZE);
+	udp_hdr = (struct udp_hdr *)&ipv4_hdr[1];
+	gtpu_hdr = (struct gtpu_hdr *)&udp_hdr[1];
+
+#ifdef GTPU_HDR_SEQNB
+	gtpu_hdr->msglen = htons(len + sizeof(GTPU_STATIC_SEQNB));
+	gtpu_hdr->seqnb = GTPU_STATIC_SEQNB | htons(gtpu_seqnb);
+	gtpu_seqnb++;
+#else
+	gtpu_hdr->msglen = htons(len);
+#endif  /* GTPU_HDR_SEQNB */
+	len += GPDU_HDR_SIZE + UDP_HDR_SIZE;
+	udp_hdr->dgram_len = htons(len);
+	len += IPv4_HDR_SIZE;
+	ipv4_hdr->total_length = htons(len);
+
+	if (ports_ip_cksum_offload[portid]) {
+		set_ipv4_cksum_offload(m, ipv4_hdr);
+		return 0;
+	}
+
+	/* RFC 1624: the template checksum covers a zero total_length */
+	cksum = (uint16_t)~ipv4_hdr->hdr_checksum;
+	cksum += ipv4_hdr->total_length;
+	cksum = (cksum & 0xffff) + (cksum >> 16);
+	ipv4_hdr->hdr_checksum = (uint16_t)~cksum;
+
+	return 0;
+}
+
 uint32_t gtpu_inner_src_ip(struct rte_mbuf *m)
 {
 	uint8_t *pkt_ptr;
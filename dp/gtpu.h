@@ -22,6 +22,7 @@
  * prototypes of GTPU header parsing and constructor.
  */
 #include "util.h"
+#include "epc_packet_framework.h"
 
 #define GTPU_VERSION		0x01
 #define GTP_PROTOCOL_TYPE_GTP	0x01
@@ -56,6 +57,28 @@ struct gtpu_hdr {
 };
 #pragma pack()
 
+/**
+ * Function to check from the RX meta data that a packet is a G-PDU with a
+ * valid teid sent to dst_ipv4.
+ *
+ * @param meta_data
+ *	meta data of the packet
+ * @param dst_ipv4
+ *	expected outer IPv4 destination, network byte order
+ *
+ * @return
+ *	- 1 if packet is a valid G-PDU
+ *	- 0 otherwise
+ */
+static inline int
+is_gpdu_meta(const struct epc_meta_data *meta_data, uint32_t dst_ipv4)
+{
+	return (meta_data->valid & EPC_META_GTPU) &&
+		meta_data->dst_ipv4 == dst_ipv4 &&
+		meta_data->teid != 0 &&
+		meta_data->gtpu_msgtype == GTP_GPDU;
+}
+
 /**
  * Function to return pointer to gtpu headers.
  *
@@ -96,6 +119,52 @@ int decap_gtpu_hdr(struct rte_mbuf *m);
  */
 int encap_gtpu_hdr(struct rte_mbuf *m, uint32_t teid);
 
+/**
+ * Function to build the downlink outer headers of a bearer from its
+ * dl_s1_info. Lengths are left 0 and patched per packet by
+ * encap_gtpu_tmpl_hdr, the IPv4 checksum covers the zero length.
+ *
+ * @param hdr
+ *	ENCAP_HDR_SIZE bytes written, not yet visible to the workers.
+ * @param dl_s1_info
+ *	downlink S1u info of the bearer.
+ * @return
+ *	None
+ */
+void build_gtpu_encap_hdr(uint8_t *hdr, const struct dl_s1_info *dl_s1_info);
+
+/**
+ * Function to return the downlink teid of a bearer, network byte order,
+ * from its prebuilt outer headers.
+ *
+ * @param hdr
+ *	prebuilt outer headers of the bearer.
+ * @return
+ *	teid, 0 if the bearer has no downlink tunnel.
+ */
+static inline uint32_t encap_hdr_teid(const uint8_t *hdr)
+{
+	return ((const struct gtpu_hdr *)&hdr[ETH_HDR_SIZE +
+			IPv4_HDR_SIZE + UDP_HDR_SIZE])->teid;
+}
+
+/**
+ * Function for encapsulation of gtpu headers using the outer headers
+ * prebuilt by build_gtpu_encap_hdr.
+ *
+ * @param m
+ *	mbuf pointer
+ * @param hdr
+ *	prebuilt outer headers, ENCAP_HDR_SIZE bytes.
+ * @param portid
+ *	egress port, selects checksum offload or software checksum.
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+int encap_gtpu_tmpl_hdr(struct rte_mbuf *m, const uint8_t *hdr,
+		uint8_t portid);
+
 /**
  * Function to get inner dst ip of tunneled packet.
  *
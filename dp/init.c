@@ -48,6 +48,20 @@
  */
 #define MBUF_CACHE_SIZE 250
 
+/**
+ * RSS hash fields used to spread packets over the RX queues of a port.
+ * By default the outer IP/UDP tuple is hashed. With RSS_UE_HASH only the
+ * IPv4 addresses are hashed, so on SGi all packets of a UE land on the same
+ * queue regardless of L4 ports.
+ */
+#ifdef RSS_UE_HASH
+#define DP_RSS_HF	ETH_RSS_IPV4
+#else
+#define DP_RSS_HF	(ETH_RSS_IP | ETH_RSS_UDP)
+#endif
+
+uint8_t ports_ip_cksum_offload[RTE_MAX_ETHPORTS];
+
 /**
  * default port config structure .
  */
@@ -72,7 +86,15 @@ static const struct rte_eth_conf port_conf_default = {
 static inline int port_init(uint8_t port, struct rte_mempool *mbuf_pool)
 {
 	struct rte_eth_conf port_conf = port_conf_default;
-	const uint16_t rx_rings = 1, tx_rings = 1;
+	struct rte_eth_dev_info dev_info;
+	struct rte_eth_txconf txconf;
+	const uint16_t rx_rings = epc_app.n_rx_queues;
+#ifdef TX_WORKER_DIRECT
+	/* one tx queue per worker plus the ARP/ICMP queue */
+	const uint16_t tx_rings = WORKER_TX_QUEUE(epc_app.num_workers);
+#else
+	const uint16_t tx_rings = 1;
+#endif
 	int retval;
 	uint16_t q;
 
@@ -80,6 +102,42 @@ static inline int port_init(uint8_t port, struct rte_mempool *mbuf_pool)
 		return -1;
 	/* TODO: use q 1 for arp */
 
+	rte_eth_dev_info_get(port, &dev_info);
+	if (rx_rings > dev_info.max_rx_queues) {
+		RTE_LOG(ERR, DP, "Port %u supports only %u RX queues\n",
+				port, dev_info.max_rx_queues);
+		return -1;
+	}
+	if (tx_rings > dev_info.max_tx_queues) {
+		RTE_LOG(ERR, DP, "Port %u supports only %u TX queues\n",
+				port, dev_info.max_tx_queues);
+		return -1;
+	}
+
+	/* Spread RX queues with RSS */
+	if (rx_rings > 1) {
+		port_conf.rxmode.mq_mode = ETH_MQ_RX_RSS;
+		port_conf.rx_adv_conf.rss_conf.rss_key = NULL;
+		port_conf.rx_adv_conf.rss_conf.rss_hf =
+				DP_RSS_HF & dev_info.flow_type_rss_offloads;
+		if (port_conf.rx_adv_conf.rss_conf.rss_hf == 0) {
+			RTE_LOG(ERR, DP, "Port %u does not support RSS on "
+					"the requested fields\n", port);
+			return -1;
+		}
+	}
+
+	/* Offload the IPv4 checksum of the headers built by the dataplane,
+	 * otherwise the header constructors compute it in software. */
+	txconf = dev_info.default_txconf;
+	if (dev_info.tx_offload_capa & DEV_TX_OFFLOAD_IPV4_CKSUM) {
+		ports_ip_cksum_offload[port] = 1;
+		/* keep the PMD off its no-offload tx path */
+		txconf.txq_flags &= ~ETH_TXQ_FLAGS_NOXSUMS;
+	}
+	RTE_LOG(INFO, DP, "Port %u IPv4 checksum: %s\n", port,
+			ports_ip_cksum_offload[port] ? "offload" : "software");
+
 	/* Configure the Ethernet device. */
 	retval = rte_eth_dev_configure(port, rx_rings, tx_rings, &port_conf);
 	if (retval != 0)
@@ -98,7 +156,7 @@ static inline int port_init(uint8_t port, struct rte_mempool *mbuf_pool)
 	for (q = 0; q < tx_rings; q++) {
 		retval = rte_eth_tx_queue_setup(port, q, TX_RING_SIZE,
 				rte_eth_dev_socket_id(port),
-				NULL);
+				&txconf);
 		if (retval < 0)
 			return retval;
 	}
@@ -131,14 +189,21 @@ void dp_port_init(void)
 {
 	struct rte_mempool *mbuf_pool;
 	uint32_t nb_ports;
+	uint32_t nb_mbufs;
 	uint8_t portid;
 
 	nb_ports = rte_eth_dev_count();
 	if (nb_ports < 2 || (nb_ports & 1))
 		rte_exit(EXIT_FAILURE, "Error: number of ports must be two\n");
 
+	/* Extra mbufs to cover the descriptors of the additional queues */
+	nb_mbufs = NUM_MBUFS + (epc_app.n_rx_queues - 1) * RX_RING_SIZE;
+#ifdef TX_WORKER_DIRECT
+	nb_mbufs += epc_app.num_workers * TX_RING_SIZE;
+#endif
+
 	/* Creates a new mempool in memory to hold the mbufs. */
-	mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL", NUM_MBUFS * nb_ports,
+	mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL", nb_mbufs * nb_ports,
 			MBUF_CACHE_SIZE, 0,
 			RTE_MBUF_DEFAULT_BUF_SIZE,
 			rte_socket_id());
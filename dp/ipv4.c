@@ -21,27 +21,34 @@
  *
  * @param m
  *	mbuf pointer
+ * @param portid
+ *	egress port.
  *
  * @return
  *	None
  */
-static void update_ckcum(struct rte_mbuf *m)
+static void update_ckcum(struct rte_mbuf *m, uint8_t portid)
 {
 	struct ipv4_hdr *ipv4_hdr;
 
-	/* update Ip checksum */
 	ipv4_hdr = get_mtoip(m);
+	if (ports_ip_cksum_offload[portid]) {
+		set_ipv4_cksum_offload(m, ipv4_hdr);
+		return;
+	}
+
+	/* update Ip checksum */
 	ipv4_hdr->hdr_checksum = 0;
 	ipv4_hdr->hdr_checksum = rte_ipv4_cksum((struct ipv4_hdr *)ipv4_hdr);
 }
 
 void
 construct_ipv4_hdr(struct rte_mbuf *m, uint16_t len, uint8_t protocol,
-		   uint32_t src_ip, uint32_t dst_ip)
+		   uint32_t src_ip, uint32_t dst_ip, uint8_t portid)
 {
 	build_ipv4_default_hdr(m);
 
 	set_ipv4_hdr(m, len, protocol, src_ip, dst_ip);
 
-	update_ckcum(m);
+	update_ckcum(m, portid);
 }
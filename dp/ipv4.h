@@ -105,6 +105,26 @@ set_ipv4_hdr(struct rte_mbuf *m, uint16_t len, uint8_t protocol,
 
 }
 
+/**
+ * Function to hand the IPv4 header checksum of a packet over to the NIC.
+ *
+ * @param m
+ *	mbuf pointer
+ * @param ipv4_hdr
+ *	outer IPv4 header of m, right after an untagged ether header.
+ *
+ * @return
+ *	None
+ */
+static inline void
+set_ipv4_cksum_offload(struct rte_mbuf *m, struct ipv4_hdr *ipv4_hdr)
+{
+	ipv4_hdr->hdr_checksum = 0;
+	m->l2_len = ETH_HDR_SIZE;
+	m->l3_len = IPv4_HDR_SIZE;
+	m->ol_flags |= PKT_TX_IPV4 | PKT_TX_IP_CKSUM;
+}
+
 /**
  * Function to construct ipv4 header.
  *
@@ -116,12 +136,14 @@ set_ipv4_hdr(struct rte_mbuf *m, uint16_t len, uint8_t protocol,
  *	next protocol id
  * @param src_ip
  * @param dst_ip
+ * @param portid
+ *	egress port, selects checksum offload or software checksum.
  *
  * @return
  *	None
  */
 void
 construct_ipv4_hdr(struct rte_mbuf *m, uint16_t len, uint8_t protocol,
-		   uint32_t src_ip, uint32_t dst_ip);
+		   uint32_t src_ip, uint32_t dst_ip, uint8_t portid);
 
 #endif				/* _IPV4_H_ */
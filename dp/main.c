@@ -53,11 +53,12 @@ int main(int argc, char **argv)
 	argc -= ret;
 	argv += ret;
 
-	dp_port_init();
-
 	/* DP Init */
 	dp_init(argc, argv);
 
+	/* Ports are configured after args parsing to size the RX queues */
+	dp_port_init();
+
 /** Note :In dpdk set max log level is INFO, here override the
  *  max value of RTE_LOG_INFO for enable DEBUG logs (dpdk-16.11.4).
  */
@@ -76,7 +77,7 @@ int main(int argc, char **argv)
 			 */
 
 			/*S1U port handler*/
-			register_worker(s1u_pkt_handler, app.s1u_port);
+			register_worker(s1u_pkt_handler_sgwu, app.s1u_port);
 
 			/*S5/8 port handler*/
 			register_worker(sgw_s5_s8_pkt_handler, app.s5s8_sgwu_port);
@@ -94,7 +95,7 @@ int main(int argc, char **argv)
 			register_worker(pgw_s5_s8_pkt_handler, app.s5s8_pgwu_port);
 
 			/*SGi port handler*/
-			register_worker(sgi_pkt_handler, app.sgi_port);
+			register_worker(sgi_pkt_handler_pgwu, app.sgi_port);
 			break;
 
 		case SPGWU:
@@ -106,10 +107,10 @@ int main(int argc, char **argv)
 			 */
 
 			/*S1U port handler*/
-			register_worker(s1u_pkt_handler, app.s1u_port);
+			register_worker(s1u_pkt_handler_spgwu, app.s1u_port);
 
 			/*SGi port handler*/
-			register_worker(sgi_pkt_handler, app.sgi_port);
+			register_worker(sgi_pkt_handler_spgwu, app.sgi_port);
 			break;
 
 		default:
@@ -28,6 +28,8 @@
 #endif /* PCAP_GEN */
 
 #include <rte_ether.h>
+#include <rte_mbuf.h>
+#include <rte_prefetch.h>
 #include <rte_hash.h>
 #include <rte_malloc.h>
 #include <rte_meter.h>
@@ -39,6 +41,7 @@
 #include "dp_ipc_api.h"
 #include "meter.h"
 #include "structs.h"
+#include "util.h"
 
 /**
  * dataplane rte logs.
@@ -77,6 +80,7 @@ extern uint8_t RTE_LOG_INFO;
  * max prefetch.
  */
 #define PREFETCH_OFFSET	8
+
 /**
  * set nth bit.
  */
@@ -147,6 +151,58 @@ extern uint8_t RTE_LOG_INFO;
  */
 #define META_DATA_OFFSET 128
 
+/**
+ * Prefetch the first packets of a burst loop that calls
+ * prefetch_pkts_ahead(): the mbufs of 2 * PREFETCH_OFFSET packets, the
+ * meta data and headers of PREFETCH_OFFSET packets.
+ * @param pkts
+ *	pointer to mbuf of packets.
+ * @param n
+ *	number of pkts.
+ */
+static inline void
+prefetch_pkts_start(struct rte_mbuf **pkts, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < 2 * PREFETCH_OFFSET && i < n; i++)
+		rte_prefetch0(pkts[i]);
+
+	for (i = 0; i < PREFETCH_OFFSET && i < n; i++) {
+		rte_prefetch0(RTE_MBUF_METADATA_UINT8_PTR(pkts[i],
+					META_DATA_OFFSET));
+		rte_prefetch0(rte_pktmbuf_mtod(pkts[i], void *));
+	}
+}
+
+/**
+ * Software pipeline of a burst loop, called for packet i before it is
+ * processed: stage 0 prefetches the mbuf 2 * PREFETCH_OFFSET packets
+ * ahead, stage 1 the meta data and headers PREFETCH_OFFSET packets ahead,
+ * which need the mbuf data pointer of stage 0. Only a window of the burst
+ * is in flight, however large the burst.
+ * @param pkts
+ *	pointer to mbuf of packets.
+ * @param n
+ *	number of pkts.
+ * @param i
+ *	packet processed next.
+ */
+static inline void
+prefetch_pkts_ahead(struct rte_mbuf **pkts, uint32_t n, uint32_t i)
+{
+	if (i + 2 * PREFETCH_OFFSET < n)
+		rte_prefetch0(pkts[i + 2 * PREFETCH_OFFSET]);
+
+	if (i + PREFETCH_OFFSET < n) {
+		rte_prefetch0(RTE_MBUF_METADATA_UINT8_PTR(
+					pkts[i + PREFETCH_OFFSET],
+					META_DATA_OFFSET));
+		rte_prefetch0(rte_pktmbuf_mtod(pkts[i + PREFETCH_OFFSET],
+					void *));
+	}
+}
+
 /**
  * max records charging.
  */
@@ -218,6 +274,26 @@ enum dp_config {
 	SPGWU = 03,
 };
 
+/*
+ * Datapath functions depending on the DP type are written once as always
+ * inlined templates taking the type as constant argument and instantiated
+ * per type, so that no per packet branch on app.spgw_cfg is left.
+ */
+#define DP_ALWAYS_INLINE	inline __attribute__((always_inline))
+
+/** Max. UE address pools given with --ue_pool */
+#define MAX_UE_POOLS		4
+/** Shortest UE address pool prefix, bounds the downlink array size */
+#define UE_POOL_MIN_PREFIX	10
+
+/**
+ * UE address pool, addresses in host byte order.
+ */
+struct ue_pool {
+	uint32_t net;				/* pool network address */
+	uint32_t size;				/* no. of addresses */
+};
+
 /**
  * Application configure structure .
  */
@@ -245,6 +321,12 @@ struct app_params {
 	struct ether_addr s5s8_sgwu_ether_addr;	/* s5s8_sgwu mac addr */
 	struct ether_addr s5s8_pgwu_ether_addr;	/* s5s8_pgwu mac addr */
 	struct ether_addr sgi_ether_addr;		/* sgi mac addr */
+	struct ue_pool ue_pool[MAX_UE_POOLS];	/* UE address pools */
+	uint32_t n_ue_pools;			/* no. of UE address pools */
+	const char *sess_snapshot;		/* session snapshot file */
+	uint32_t sess_snapshot_interval;	/* seconds between snapshots */
+	uint32_t max_sessions;			/* bearers the session pools
+						 * hold, 0 - default */
 };
 
 /** extern the app config struct */
@@ -256,6 +338,9 @@ struct ether_addr ports_eth_addr[RTE_MAX_ETHPORTS];
 /** ethernet addresses of ports */
 extern struct ether_addr ports_eth_addr[];
 
+/** ports computing the outer IPv4 checksum on TX, set at port init */
+extern uint8_t ports_ip_cksum_offload[];
+
 /** ADC sponsored dns table msg payload */
 struct msg_adc {
 	uint32_t ipv4;
@@ -298,12 +383,21 @@ struct dp_adc_rules {
 } __attribute__((packed, aligned(RTE_CACHE_LINE_SIZE)));
 
 /**
- * Bearer Session information structure
+ * Size of the outer ether, IPv4, UDP and GTPU headers prepended to
+ * downlink packets.
  */
-struct dp_session_info {
-	struct ip_addr ue_addr;				/**< UE ip address*/
-	struct ul_s1_info ul_s1_info;			/**< UpLink S1u info*/
-	struct dl_s1_info dl_s1_info;			/**< DownLink S1u info*/
+#define ENCAP_HDR_SIZE	(ETH_HDR_SIZE + IPv4_HDR_SIZE + UDP_HDR_SIZE + \
+			GPDU_HDR_SIZE)
+
+/**
+ * Bearer configuration and charging, read on session updates and CDR
+ * export. Only the CDR is updated per packet.
+ */
+struct dp_session_cold {
+	uint32_t service_id;						/**< Type of service given
+									 * to this session like
+									 * Internet, Management, CIPA etc
+									 */
 	uint8_t linked_bearer_id;				/**< Linked EPS Bearer ID (LBI)*/
 
 	/* PCC rules related params*/
@@ -314,45 +408,66 @@ struct dp_session_info {
 
 	/* Charging Data Records*/
 	struct ipcan_dp_bearer_cdr ipcan_dp_bearer_cdr;	/**< IP CAN bearer CDR*/
+} __attribute__((packed, aligned(RTE_CACHE_LINE_SIZE)));
 
-	uint32_t client_id;
-	uint64_t sess_id;						/**< session id of this bearer
-									 * last 4 bits of sess_id
-									 * maps to bearer id*/
-	uint32_t service_id;						/**< Type of service given
-									 * to this session like
-									 * Internet, Management, CIPA etc
-									 */
+/**
+ * Bearer Session information structure.
+ * The first cache line holds what the downlink fast path reads per packet,
+ * the second the tunnel and buffering state, configuration and charging
+ * are in dp_session_cold.
+ */
+struct dp_session_info {
+	/* Fast path, first cache line */
+	uint8_t *encap_hdr;			/**< DownLink outer headers,
+						 * ENCAP_HDR_SIZE bytes built
+						 * from dl_s1_info, replaced
+						 * whole by the owner worker*/
 	struct ue_session_info *ue_info_ptr;	/**< Pointer to UE info of this bearer */
-
 	/** Session state for use with downlink data processing*/
 	enum dp_session_state sess_state;
+
+	/* Downlink buffering and tunnels */
 	/** Ring to hold the DL pkts for this session */
 	struct rte_ring *dl_ring;
+	uint32_t client_id;
+	uint64_t sess_id;						/**< session id of this bearer
+									 * last 4 bits of sess_id
+									 * maps to bearer id*/
+	struct ip_addr ue_addr;				/**< UE ip address*/
+	struct ul_s1_info ul_s1_info;			/**< UpLink S1u info*/
+	struct dl_s1_info dl_s1_info;			/**< DownLink S1u info*/
+
+	struct dp_session_cold *cold;		/**< configuration and CDRs*/
 } __attribute__((packed, aligned(RTE_CACHE_LINE_SIZE)));
 
 /**
- * UE Session information structure
+ * UE Session information structure.
+ * Rating group CDRs are a separate allocation, made only with
+ * RATING_GRP_CDR.
  */
 struct ue_session_info {
-	struct ip_addr ue_addr;			/**< UE ip address*/
-	uint32_t bearer_count;			/**< Num. of bearers configured*/
+	/* APN meters, read per packet with APN_MTR */
 	struct rte_meter_srtcm ul_apn_mtr_obj;
 	/**< UL APN meter object pointer*/
 	struct rte_meter_srtcm dl_apn_mtr_obj;
 	/**< DL APN meter object pointer*/
+	uint64_t ul_apn_mtr_drops;	/**< drop count due to ul apn metering*/
+	uint64_t dl_apn_mtr_drops;	/**< drop count due to dl apn metering*/
 
 	/* rating groups CDRs*/
 	struct rating_group_index_map rg_idx_map[MAX_RATING_GRP]; /**< Rating group index*/
-	struct ipcan_dp_bearer_cdr rating_grp[MAX_RATING_GRP];	/**< rating groups CDRs*/
+	struct ipcan_dp_bearer_cdr *rating_grp;	/**< MAX_RATING_GRP rating
+						 * groups CDRs, or NULL*/
+
+	uint32_t bearer_count;			/**< Num. of bearers configured*/
 	uint32_t ul_apn_mtr_idx;	/**< UL APN meter profile index*/
 	uint32_t dl_apn_mtr_idx;	/**< DL APN meter profile index*/
-	uint64_t ul_apn_mtr_drops;	/**< drop count due to ul apn metering*/
-	uint64_t dl_apn_mtr_drops;	/**< drop count due to dl apn metering*/
 
 	/* ADC rules related params*/
 	uint32_t num_adc_rules;					/**< No. of ADC rule*/
 	uint32_t adc_rule_id[MAX_ADC_RULES]; 	/**< list of ADC rule id*/
+
+	struct ip_addr ue_addr;			/**< UE ip address*/
 } __attribute__((packed, aligned(RTE_CACHE_LINE_SIZE)));
 
 /**
@@ -375,11 +490,6 @@ struct dp_adc_ue_info {
 	struct rte_meter_srtcm mtr_obj;	/**< meter object for this SDF flow */
 } __attribute__((packed, aligned(RTE_CACHE_LINE_SIZE)));
 
-#ifdef INSTMNT
-extern uint32_t flag_wrkr_update_diff;
-extern uint64_t total_wrkr_pkts_processed;
-#endif				/* INSTMNT */
-
 extern int arp_icmp_get_dest_mac_address(const uint32_t ipaddr,
 		const uint32_t phy_port,
 		struct ether_addr *hw_addr,
@@ -437,7 +547,7 @@ void
 dp_init(int argc, char **argv);
 
 /**
- * Decap gtpu header.
+ * Decap gtpu header, SPGWU and PGWU specialized variants.
  *
  * @param pkts
  *	pointer to mbuf of incoming packets.
@@ -447,7 +557,10 @@ dp_init(int argc, char **argv);
  * 	bit mask to process the pkts, reset bit to free the pkt.
  */
 void
-gtpu_decap(struct rte_mbuf **pkts, uint32_t n,
+gtpu_decap_spgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask);
+void
+gtpu_decap_pgwu(struct rte_mbuf **pkts, uint32_t n,
 		uint64_t *pkts_mask);
 
 /**
@@ -466,9 +579,21 @@ void
 gtpu_encap(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
 		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask);
 
+/**
+ * SPGWU and PGWU specialized variants of gtpu_encap, used by the
+ * worker handlers of each mode.
+ */
+void
+gtpu_encap_spgwu(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
+		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask);
+void
+gtpu_encap_pgwu(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
+		uint32_t n, uint64_t *pkts_mask, uint64_t *pkts_queue_mask);
+
 /*************************pkt_handler.ci functions start*********************/
 /**
- * Function to handle incoming pkts on s1u interface.
+ * Function to handle incoming pkts on s1u interface, SPGWU and SGWU
+ * specialized variants.
  *
  * @param p
  *	pointer to pipeline.
@@ -482,11 +607,15 @@ gtpu_encap(struct dp_session_info **sess_info, struct rte_mbuf **pkts,
  *	- -1 on failure
  */
 int
-s1u_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
-		int wk_index);
+s1u_pkt_handler_spgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index);
+int
+s1u_pkt_handler_sgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index);
 
 /**
- * Function to handle incoming pkts on sgi interface.
+ * Function to handle incoming pkts on sgi interface, SPGWU and PGWU
+ * specialized variants.
  *
  * @param p
  *	pointer to pipeline.
@@ -500,12 +629,59 @@ s1u_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
  *	- -1 on failure
  */
 int
-sgi_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
-		int wk_index);
+sgi_pkt_handler_spgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index);
+int
+sgi_pkt_handler_pgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index);
+
+/**
+ * Session control command of the iface core, sent on the notify ring of
+ * the worker owning the UE of the bearer. The owner applies it between
+ * bursts and is the only writer of the downlink state of its bearers.
+ */
+/**
+ * Commands of a sess_ctrl_msg.
+ */
+enum sess_ctrl_op {
+	SESS_CTRL_MODIFY,	/**< apply new dl info and outer headers*/
+	SESS_CTRL_CREATE,	/**< bearer created again, as modify and
+				 * set sess_state*/
+	SESS_CTRL_DELETE,	/**< release dl_ring of a deleted bearer*/
+};
+
+struct sess_ctrl_msg {
+	enum sess_ctrl_op op;			/**< command*/
+	uint64_t sess_id;			/**< bearer session id*/
+	struct dp_session_info *data;		/**< bearer, already out of
+						 * the session table on
+						 * delete*/
+	struct dl_s1_info dl_s1_info;		/**< new DownLink S1u info*/
+	enum dp_session_state sess_state;	/**< state to set on
+						 * SESS_CTRL_CREATE*/
+	uint8_t *encap_hdr;			/**< outer headers built from
+						 * dl_s1_info, the replaced
+						 * ones once applied*/
+};
+
+/**
+ * Function to return an applied or dropped sess_ctrl_msg to the iface
+ * core, which frees the outer headers it carries, and the bearer of a
+ * delete, after their grace period.
+ * Called by the workers.
+ *
+ * @param m
+ *	control mbuf of the sess_ctrl_msg.
+ *
+ * @return
+ *	None
+ */
+void sess_ctrl_done(struct rte_mbuf *m);
 
 /**
  * Function to handle notifications from CP which needs updates to
  * an active session. So worker core should process them.
+ * Applies the sess_ctrl_msg commands of the iface core.
  *
  * @param p
  *	pointer to pipeline.
@@ -649,7 +825,8 @@ adc_gating(uint32_t *rid, void **adc_info, uint32_t n,
 
 /************* Session information function prototype***********/
 /**
- * Get the UL session info from table lookup.
+ * Get the UL session info from table lookup, gateway mode specialized
+ * variants.
  * @param pkts
  *	pointer to mbuf of incoming packets.
  * @param n
@@ -660,10 +837,17 @@ adc_gating(uint32_t *rid, void **adc_info, uint32_t n,
  *	session information returned after hash lookup.
  */
 void
-ul_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
+ul_sess_info_get_spgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info);
+void
+ul_sess_info_get_sgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info);
+void
+ul_sess_info_get_pgwu(struct rte_mbuf **pkts, uint32_t n,
 		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info);
 /**
- * Get the DL session info from table lookup.
+ * Get the DL session info from table lookup, gateway mode specialized
+ * variants.
  * @param pkts
  *	pointer to mbuf of incoming packets.
  * @param n
@@ -674,27 +858,69 @@ ul_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
  *	session information returned after hash lookup.
  */
 void
-dl_sess_info_get(struct rte_mbuf **pkts, uint32_t n,
+dl_sess_info_get_sgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
+		struct dp_session_info **si);
+void
+dl_sess_info_get_spgwu(struct rte_mbuf **pkts, uint32_t n,
 		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
 		struct dp_session_info **si);
+void
+dl_sess_info_get_pgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sess_info,
+		struct dp_session_info **si);
+
 
+/**
+ * PCC decisions of a burst, one array per field for vector compares.
+ */
+struct pcc_burst_info {
+	uint8_t precedence[MAX_BURST_SZ];	/**< precedence, 255 none*/
+	uint8_t gate_status[MAX_BURST_SZ];	/**< OPEN or CLOSE*/
+	uint32_t pcc_id[MAX_BURST_SZ];		/**< pcc rule id, 0 none*/
+} __rte_cache_aligned;
 
 /**
- * Gate the incoming pkts based on PCC entry info.
- * @param pcc_info
- *	list of pcc id precedence struct pionters.
- *	pcc information.
+ * Gate the incoming pkts based on PCC entry info. The PCC rule with the
+ * lowest precedence value of the SDF and ADC rules of a pkt decides,
+ * the ADC rule on a tie (ref: 29.212). Pkts with a closed gate are reset
+ * in pkts_mask.
+ * @param sdf_info
+ *	PCC decisions of the SDF rules.
+ * @param adc_info
+ *	PCC decisions of the ADC rules.
  * @param  n
  *	number of pkts.
  * @param  pkts_mask
  *	bit mask to process the pkts, reset bit to free the pkt.
  *
  * @return
+ *	mask of the pkts dropped by a closed gate.
+ */
+uint64_t
+pcc_gating(const struct pcc_burst_info *sdf_info,
+		const struct pcc_burst_info *adc_info, uint32_t n,
+		uint64_t *pkts_mask);
+
+/**
+ * Record the pkts dropped by a closed gate in the CDR of their ADC UE
+ * info. Pkts without one are recorded in their SDF CDR by
+ * update_sdf_cdr.
+ * @param adc_ue_info
+ *	list of per adc ue structs pointer.
+ * @param  pkts
+ *	mbuf pkts.
+ * @param  gate_mask
+ *	pkts dropped by a closed gate, from pcc_gating.
+ * @param  flow
+ *	direction of flow (UL_FLOW, DL_FLOW).
+ *
+ * @return
  * Void
  */
 void
-pcc_gating(struct pcc_id_precedence *sdf_info, struct pcc_id_precedence *adc_info,
-		uint32_t n, uint64_t *pkts_mask);
+update_gate_cdr(void **adc_ue_info, struct rte_mbuf **pkts,
+		uint64_t gate_mask, uint32_t flow);
 /**
  * Get ADC filter entry.
  * @param rid
@@ -955,6 +1181,12 @@ void app_filter_tbl_init(void);
 void
 app_sess_tbl_init(void);
 
+/**
+ * Move entries of the session tables being resized, called by the
+ * iface core between messages.
+ */
+void sess_tbl_resize_step(void);
+
 /********************* ADC Rule Table ****************/
 /**
  * Create ADC Rule table.
@@ -1131,6 +1363,36 @@ dp_session_modify(struct dp_id dp_id, struct session_info *session);
 int
 dp_session_delete(struct dp_id dp_id, struct session_info *session);
 
+/**
+ * Restore Bearer sessions from the last session snapshot.
+ * @param dp_id
+ *	table identifier.
+ * @param  restore
+ *	generation of the snapshot, 0 for any.
+ *
+ * @return
+ *	- 0 - success
+ *	- -1 - fail
+ */
+int
+dp_session_restore(struct dp_id dp_id, struct msg_sess_restore *restore);
+
+/**
+ * Add a Bearer session of a session snapshot in the state it was saved
+ * in. Default bearers must be added before the dedicated ones.
+ * @param  session
+ *	Session information
+ * @param  sess_state
+ *	session state.
+ *
+ * @return
+ *	- 0 - success
+ *	- -1 - fail
+ */
+int
+sess_restore_bearer(struct session_info *session,
+		enum dp_session_state sess_state);
+
 /********************* Meter Table ****************/
 /**
  * Create Meter profile table.
@@ -1266,7 +1528,7 @@ iface_lookup_adc_ue_data(struct dl_bm_key *key,
  *
  * This function is thread safe (Read Only).
  */
-struct rte_hash_bucket *bucket_ul_addr(uint64_t key);
+struct fixed_hash_bucket *bucket_ul_addr(uint64_t key);
 
 /**
  * @brief Function to return address of downlink hash table
@@ -1274,7 +1536,39 @@ struct rte_hash_bucket *bucket_ul_addr(uint64_t key);
  *
  * This function is thread safe (Read Only).
  */
-struct rte_hash_bucket *bucket_dl_addr(uint64_t key);
+struct fixed_hash_bucket *bucket_dl_addr(uint64_t key);
+
+/** Max. entries per bucket of the DP hash tables */
+#define HASH_OCC_BUCKET_ENTRIES	8
+
+/**
+ * Bucket occupancy of a DP hash table.
+ */
+struct hash_occupancy {
+	const char *name;
+	uint64_t entries;	/**< keys stored*/
+	uint64_t capacity;	/**< entries the buckets can hold*/
+	uint64_t buckets;
+	uint32_t bucket_entries;	/**< entries per bucket*/
+	/** buckets holding i entries */
+	uint64_t hist[HASH_OCC_BUCKET_ENTRIES + 1];
+	uint64_t alt;		/**< keys outside their primary bucket*/
+	uint64_t probes;	/**< buckets read to find every key once*/
+};
+
+/**
+ * @brief Scan the buckets of the DP hash tables. The counts are
+ * approximate while the tables are updated.
+ *
+ * @param occ
+ *	filled with the occupancy of each table.
+ * @param n
+ *	max. no. of tables.
+ *
+ * @return
+ *	no. of tables filled.
+ */
+unsigned sess_tbl_occupancy(struct hash_occupancy *occ, unsigned n);
 
 /**
  * @brief Function to create hash table..
@@ -1465,15 +1759,17 @@ filter_pcc_entry_delete(enum filter_pcc_type type, uint32_t pcc_id,
 		uint32_t n, uint32_t *rule_ids);
 
 /**
- * Search SDF-PCC or ADC-PCC association hash for SDF/ADC ruleid as a key
+ * Get the PCC decisions of SDF/ADC rule ids from the decision table of
+ * the active ACL table. Rule ids without a PCC rule get pcc id 0,
+ * precedence 255 and an open gate.
  * @param type
- *	Type of hash table, SDF/ADC.
- * @param pcc_id
+ *	Type of rules, SDF/ADC.
+ * @param rule_ids
  *	SDF/ADC rule ids to be used for searching.
  * @param  n
  *	Number of SDF/ADC rules.
  * @param  pcc_info
- *	Pointer to matched PCC info.
+ *	PCC decisions of the burst, entry i for rule_ids[i].
  *
  * @return
  *	0 - on success
@@ -1481,10 +1777,35 @@ filter_pcc_entry_delete(enum filter_pcc_type type, uint32_t pcc_id,
  */
 int
 filter_pcc_entry_lookup(enum filter_pcc_type type, uint32_t *rule_ids,
-		uint32_t n, struct pcc_id_precedence *pcc_info);
+		uint32_t n, struct pcc_burst_info *pcc_info);
+
+/**
+ * Build the PCC decision tables of an ACL table from the SDF-PCC and
+ * ADC-PCC association hashes and the PCC table. Each SDF/ADC rule id
+ * gets the decision of its highest precedence PCC rule. Called by the
+ * ACL build, the table must not be in use by the workers.
+ * @param tbl
+ *	ACL table, 0 to PCC_DECISION_TBLS - 1.
+ *
+ * @return
+ *	None
+ */
+void
+filter_pcc_decisions_build(unsigned int tbl);
 
 /**
- * update nexthop info.
+ * Make the PCC decision tables of an ACL table active, with the ACL table.
+ * @param tbl
+ *	ACL table, 0 to PCC_DECISION_TBLS - 1.
+ *
+ * @return
+ *	None
+ */
+void
+filter_pcc_decisions_activate(unsigned int tbl);
+
+/**
+ * update nexthop info, SGWU and PGWU specialized variants.
  * @param pkts
  *	pointer to mbuf of packets.
  * @param n
@@ -1495,8 +1816,11 @@ filter_pcc_entry_lookup(enum filter_pcc_type type, uint32_t *rule_ids,
  *	pointer to session bear info
  */
 void
-update_nexts5s8_info(struct rte_mbuf **pkts, uint32_t n, uint64_t *pkts_mask,
-		struct dp_sdf_per_bearer_info **sdf_bear_info);
+update_nexts5s8_info_sgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sdf_bear_info);
+void
+update_nexts5s8_info_pgwu(struct rte_mbuf **pkts, uint32_t n,
+		uint64_t *pkts_mask, struct dp_sdf_per_bearer_info **sdf_bear_info);
 
 /**
  * update enb ip in ip header and s1u tied in gtp header.
@@ -15,6 +15,7 @@
  */
 
 #include <rte_mbuf.h>
+#include <rte_spinlock.h>
 
 #include "vepc_cp_dp_api.h"
 #include "main.h"
@@ -27,6 +28,20 @@
 struct rte_hash *rte_pcc_hash;
 extern struct rte_hash *rte_sdf_pcc_hash;
 extern struct rte_hash *rte_adc_pcc_hash;
+
+/* PCC hashes lock, iface core writes and the ACL build reads them */
+static rte_spinlock_t filter_pcc_lock = RTE_SPINLOCK_INITIALIZER;
+/* PCC decisions by SDF/ADC rule id, of each ACL table */
+static struct pcc_decision *pcc_decisions[PCC_DECISION_TBLS][FILTER_TYPES];
+/* decisions of the active ACL table, NULL before the first build */
+static struct pcc_decision * volatile pcc_decisions_active[FILTER_TYPES];
+/* rule ids without PCC rule pass */
+static const struct pcc_decision pcc_decision_default = {
+	.pcc_id = 0,
+	.precedence = 255,
+	.gate_status = 1,
+};
+
 /**
  * @brief Called by DP to lookup key-value in PCC table.
  *
@@ -54,8 +69,11 @@ int
 dp_pcc_table_delete(struct dp_id dp_id)
 {
 	RTE_SET_USED(dp_id);
+	rte_spinlock_lock(&filter_pcc_lock);
 	rte_hash_free(rte_pcc_hash);
-	return 0;
+	rte_pcc_hash = NULL;
+	rte_spinlock_unlock(&filter_pcc_lock);
+	return acl_pcc_changed();
 }
 
 int
@@ -72,8 +90,10 @@ dp_pcc_entry_add(struct dp_id dp_id, struct pcc_rules *entry)
 	memcpy(pcc, entry, sizeof(struct pcc_rules));
 
 	key32 = entry->rule_id;
+	rte_spinlock_lock(&filter_pcc_lock);
 	ret = rte_hash_add_key_data(rte_pcc_hash, &key32,
 				  pcc);
+	rte_spinlock_unlock(&filter_pcc_lock);
 	if (ret < 0) {
 		RTE_LOG(ERR, DP, "Failed to add entry in hash table");
 		return -1;
@@ -102,20 +122,28 @@ dp_pcc_entry_delete(struct dp_id dp_id, struct pcc_rules *entry)
 	uint32_t key32;
 	int ret;
 	key32 = entry->rule_id;
+	rte_spinlock_lock(&filter_pcc_lock);
 	ret = rte_hash_lookup_data(rte_pcc_hash, &key32,
 				  (void **)&pcc);
 	if (ret < 0) {
+		rte_spinlock_unlock(&filter_pcc_lock);
 		RTE_LOG(ERR, DP, "Failed to del\n"
 			"pcc key 0x%x to hash table\n",
 			 key32);
 		return -1;
 	}
 	ret = rte_hash_del_key(rte_pcc_hash, &key32);
-	if (ret < 0)
+	if (ret < 0) {
+		rte_spinlock_unlock(&filter_pcc_lock);
 		return -1;
+	}
 
+	/* the ACL build reads PCC rules under the lock only */
 	rte_free(pcc);
-	return 0;
+	rte_spinlock_unlock(&filter_pcc_lock);
+
+	/* SDF/ADC rules of the PCC rule fall back to the next one */
+	return acl_pcc_changed();
 }
 
 /******************** Call back functions **********************/
@@ -274,6 +302,7 @@ filter_pcc_entry_add(enum filter_pcc_type type, uint32_t pcc_id,
 	else
 		return -1;
 
+	rte_spinlock_lock(&filter_pcc_lock);
 	for (i = 0; i < n; i++) {
 		/* TODO: In sdf/adc/pcc config files, section start with 0
 		 *       but CP pushes rules starting with id = 1.
@@ -364,19 +393,93 @@ filter_pcc_entry_add(enum filter_pcc_type type, uint32_t pcc_id,
 			}
 		}
 	}
-	return 0;
+	rte_spinlock_unlock(&filter_pcc_lock);
+
+	/* the workers take the new decisions with the next ACL build */
+	return acl_pcc_changed();
+}
+
+void
+filter_pcc_decisions_build(unsigned int tbl)
+{
+	struct rte_hash *hash[FILTER_TYPES];
+	struct pcc_decision *d;
+	struct filter_pcc_data *pinfo;
+	struct dp_pcc_rules *pcc;
+	const void *key;
+	uint32_t next, rule_id, i;
+	int t, j;
+
+	hash[FILTER_SDF] = rte_sdf_pcc_hash;
+	hash[FILTER_ADC] = rte_adc_pcc_hash;
+
+	for (t = 0; t < FILTER_TYPES; t++) {
+		d = pcc_decisions[tbl][t];
+		if (d == NULL) {
+			d = rte_zmalloc("pcc_decisions",
+					MAX_ACL_RULE_NUM * sizeof(struct pcc_decision),
+					RTE_CACHE_LINE_SIZE);
+			if (d == NULL)
+				rte_panic("Failed to allocate memory for pcc_decisions");
+			pcc_decisions[tbl][t] = d;
+		}
+
+		for (i = 0; i < MAX_ACL_RULE_NUM; i++)
+			d[i] = pcc_decision_default;
+
+		if (hash[t] == NULL)
+			continue;
+
+		rte_spinlock_lock(&filter_pcc_lock);
+		next = 0;
+		while (rte_hash_iterate(hash[t], &key, (void **)&pinfo,
+					&next) >= 0) {
+			/* keys are the ACL rule ids, see filter_pcc_entry_add */
+			rule_id = *(const uint32_t *)key;
+			if (rule_id >= MAX_ACL_RULE_NUM) {
+				RTE_LOG(DEBUG, DP, "PCC: rule id %u out of range\n",
+						rule_id);
+				continue;
+			}
+			/* lowest precedence value last, skip deleted PCC rules */
+			for (j = pinfo->entries - 1; j >= 0; j--) {
+				if (rte_pcc_hash == NULL ||
+						iface_lookup_pcc_data(
+						pinfo->pcc_info[j].pcc_id, &pcc) < 0)
+					continue;
+				d[rule_id].pcc_id = pinfo->pcc_info[j].pcc_id;
+				d[rule_id].precedence = pinfo->pcc_info[j].precedence;
+				d[rule_id].gate_status =
+					pinfo->pcc_info[j].gate_status;
+				d[rule_id].ul_mtr_idx = pcc->qos.ul_mtr_profile_index;
+				d[rule_id].dl_mtr_idx = pcc->qos.dl_mtr_profile_index;
+				d[rule_id].rating_group = pcc->rating_group;
+				break;
+			}
+		}
+		rte_spinlock_unlock(&filter_pcc_lock);
+	}
+}
+
+void
+filter_pcc_decisions_activate(unsigned int tbl)
+{
+	int t;
+
+	for (t = 0; t < FILTER_TYPES; t++)
+		pcc_decisions_active[t] = pcc_decisions[tbl][t];
 }
 
 /**
- * Search SDF-PCC or ADC-PCC association hash for SDF/ADC ruleid as a key
+ * Get the PCC decisions of SDF/ADC rule ids, no hash lookup.
  * @param type
- *  Type of hash table, SDF/ADC.
- * @param pcc_id
+ *  Type of rules, SDF/ADC.
+ * @param rule_ids
  *  SDF/ADC rule ids to be used for searching.
  * @param  n
  *  Number of SDF/ADC rules.
  * @param  pcc_info
- *  Pointer to matched PCC info.
+ *  PCC decisions of the burst, entry i for rule_ids[i].
  *
  * @return
  *  0 - on success
@@ -384,36 +487,34 @@ filter_pcc_entry_add(enum filter_pcc_type type, uint32_t pcc_id,
  */
 int
 filter_pcc_entry_lookup(enum filter_pcc_type type, uint32_t* rule_ids,
-		uint32_t n, struct pcc_id_precedence *pcc_ids)
+		uint32_t n, struct pcc_burst_info *pcc_ids)
 {
-	int ret = 0;
+	const struct pcc_decision *d, *r;
 	uint32_t i;
-	struct filter_pcc_data *pinfo = NULL;
-	struct rte_hash *hash = NULL;
 
-	if (type == FILTER_SDF)
-		hash = rte_sdf_pcc_hash;
-	else if (type == FILTER_ADC)
-		hash = rte_adc_pcc_hash;
-	else {
+	if (type >= FILTER_TYPES) {
 		RTE_LOG(INFO, DP, "filter_pcc_entry_lookup hash type mistmatch");
 		return -1;
 	}
 
-	for (i = 0; i < n; i++) {
-		ret = rte_hash_lookup_data(hash, &rule_ids[i], (void **)&pinfo);
+	/* read once per burst, not reused before the burst's grace period */
+	d = pcc_decisions_active[type];
 
-		if (ret < 0 || pinfo == NULL) {
-			/* TODO : If there is no matching pcc rule, what should be
-			 *        values of pcc? Currently hardcoding to 0 with
-			 *        gate-status 1 (pass traffic)
-			 */
-			pcc_ids[i].pcc_id = 0;
-			pcc_ids[i].precedence = 255;
-			pcc_ids[i].gate_status = 1;
-		} else {
-			pcc_ids[i] = pinfo->pcc_info[pinfo->entries - 1];
-		}
+	for (i = 0; i < n; i++)
+		if (d != NULL && rule_ids[i] < MAX_ACL_RULE_NUM)
+			rte_prefetch0(&d[rule_ids[i]]);
+
+	for (i = 0; i < n; i++) {
+		/* TODO : If there is no matching pcc rule, what should be
+		 *        values of pcc? Currently hardcoding to 0 with
+		 *        gate-status 1 (pass traffic)
+		 */
+		r = &pcc_decision_default;
+		if (d != NULL && rule_ids[i] < MAX_ACL_RULE_NUM)
+			r = &d[rule_ids[i]];
+		pcc_ids->pcc_id[i] = r->pcc_id;
+		pcc_ids->precedence[i] = r->precedence;
+		pcc_ids->gate_status[i] = r->gate_status;
 	}
 	return 0;
 }
@@ -35,6 +35,7 @@
 #include <rte_hash.h>
 #include <rte_jhash.h>
 #include <rte_port_ring.h>
+#include <rte_port_ethdev.h>
 #include <rte_table_stub.h>
 #include <rte_mbuf.h>
 #include <rte_ring.h>
@@ -1236,6 +1237,20 @@ epc_arp_icmp_init(void)
 
 	/* Output ports */
 	for (i = 0; i < epc_app.n_ports; i++) {
+#ifdef TX_WORKER_DIRECT
+		/* ARP/ICMP keeps a dedicated NIC tx queue */
+		struct rte_port_ethdev_writer_nodrop_params port_ethdev_params = {
+			.port_id = epc_app.ports[i],
+			.queue_id = ARP_ICMP_TX_QUEUE,
+			.tx_burst_sz = epc_app.burst_size_tx_write,
+			.n_retries = 0,
+		};
+
+		struct rte_pipeline_port_out_params port_params = {
+			.ops = &rte_port_ethdev_writer_nodrop_ops,
+			.arg_create = (void *) &port_ethdev_params,
+		};
+#else
 		struct rte_port_ring_writer_params port_ring_params = {
 			.ring = epc_app.ring_tx[epc_app.core_mct][i],
 			.tx_burst_sz = epc_app.burst_size_tx_write,
@@ -1245,6 +1260,7 @@ epc_arp_icmp_init(void)
 			.ops = &rte_port_ring_writer_ops,
 			.arg_create = (void *) &port_ring_params,
 		};
+#endif
 
 		if (rte_pipeline_port_out_create(p, &port_params, &params->port_out_id[i])) {
 			rte_panic("%s: Unable to configure output port for ring RX %i\n", __func__, i);
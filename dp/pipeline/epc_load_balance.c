@@ -15,6 +15,7 @@
  */
 
 #include <string.h>
+#include <inttypes.h>
 #include <sched.h>
 
 #include "rte_common.h"
@@ -48,6 +49,11 @@ static inline void epc_lb_set_port_id(struct rte_mbuf *m, uint32_t port_id)
 	uint32_t core_id;
 
 	set_worker_core_id(&core_id, ue_ipv4_hash_offset);
+#ifdef RETA_BALANCE
+	/* hold ports follow the worker ports */
+	if (reta_bucket_held(ue_ipv4_hash_offset))
+		core_id = epc_app.num_workers;
+#endif
 
 	*offset_port_id = port_id + (core_id << 1);
 }
@@ -109,10 +115,9 @@ void epc_load_balance_init(struct epc_load_balance_params *param)
 	/* Output port configuration */
 	for (i = 0; i < epc_app.num_workers; i++) {
 		unsigned core_id = epc_app.worker_cores[i];
-		epc_app.worker_core_mapping[core_id] = i;
 		struct rte_port_ring_writer_params port_ring_params = {
 #ifdef RX_LB_TX
-			.ring = epc_app.ring_tx[i][1],
+			.ring = epc_app.ring_tx[core_id][1],
 #else
 			.ring = epc_app.epc_work_rx[core_id][0],
 #endif
@@ -120,7 +125,12 @@ void epc_load_balance_init(struct epc_load_balance_params *param)
 		};
 
 		struct rte_pipeline_port_out_params port_params = {
+#ifdef RETA_BALANCE
+			/* the RETA balancer also enqueues on the worker rings */
+			.ops = &rte_port_ring_multi_writer_ops,
+#else
 			.ops = &rte_port_ring_writer_ops,
+#endif
 			.arg_create = (void *)&port_ring_params,
 			.f_action = NULL,
 			.arg_ah = NULL,
@@ -133,7 +143,7 @@ void epc_load_balance_init(struct epc_load_balance_params *param)
 			     __func__, i);
 		}
 #ifdef RX_LB_TX
-		port_ring_params.ring = epc_app.ring_tx[i][0];
+		port_ring_params.ring = epc_app.ring_tx[core_id][0];
 #else
 		port_ring_params.ring = epc_app.epc_work_rx[core_id][1];
 #endif
@@ -144,6 +154,28 @@ void epc_load_balance_init(struct epc_load_balance_params *param)
 			     __func__, i);
 		}
 	}
+#ifdef RETA_BALANCE
+	for (i = 0; i < epc_app.n_ports; i++) {
+		struct rte_port_ring_writer_params port_ring_params = {
+			.ring = epc_app.reta_hold_rx[i],
+			.tx_burst_sz = epc_app.burst_size_rx_write
+		};
+
+		struct rte_pipeline_port_out_params port_params = {
+			.ops = &rte_port_ring_writer_ops,
+			.arg_create = (void *)&port_ring_params,
+			.f_action = NULL,
+			.arg_ah = NULL,
+		};
+
+		if (rte_pipeline_port_out_create
+		    (p, &port_params, &param->hold_port_out_id[i])) {
+			rte_panic
+			("%s: Unable to configure output port for hold ring %i\n",
+			     __func__, i);
+		}
+	}
+#endif
 
 	/* table configuration */
 	/* Tables */
@@ -227,5 +259,302 @@ void epc_load_balance(void *args)
 	if (++param->flush_count >= param->flush_max) {
 		rte_pipeline_flush(param->pipeline);
 		param->flush_count = 0;
+#ifdef RETA_BALANCE
+		param->quiesce_count++;
+#endif
+	}
+}
+#ifdef RETA_BALANCE
+
+/* Interval between two balancing decisions */
+#define RETA_BALANCE_INTERVAL_MS	1000
+/* Imbalance, in percent above the average worker load, that triggers a
+ * bucket migration */
+#define RETA_BALANCE_THRESHOLD		25
+/* Burst size used to release held packets */
+#define RETA_RELEASE_BURST		32
+/* Longest wait for a pause in the traffic of the held bucket before its
+ * hold is lifted anyway */
+#define RETA_RELEASE_MAX_MS		100
+/* Maximum number of RX/LB pipelines feeding the worker rings */
+#define RETA_MAX_DISTRIBUTORS		(NUM_SPGW_PORTS * MAX_RX_QUEUES)
+
+enum reta_balance_state {
+	RETA_IDLE,	/* measure load, pick a bucket to migrate */
+	RETA_HOLD,	/* wait for distributors to see the held bucket */
+	RETA_DRAIN,	/* wait for the old worker to dequeue the bucket */
+	RETA_QUIESCE,	/* wait for the old worker to process the bucket */
+	RETA_SWITCH,	/* wait for the old worker to see the new owner */
+	RETA_FLUSH,	/* forward the held bucket until its traffic pauses */
+	RETA_RELEASE,	/* release packets still in flight to the hold rings */
+};
+
+static enum reta_balance_state reta_state = RETA_IDLE;
+static uint64_t reta_next_tsc;
+static uint32_t reta_bucket;
+static uint32_t reta_from;
+static uint32_t reta_to;
+static uint32_t reta_last_pkts[DP_MAX_LCORE][RETA_SIZE];
+static uint64_t reta_load[RETA_SIZE];
+static uint64_t reta_dist_snap[RETA_MAX_DISTRIBUTORS];
+static uint32_t reta_ring_snap[NUM_SPGW_PORTS];
+static uint32_t reta_hold_snap[NUM_SPGW_PORTS];
+static uint64_t reta_release_tsc;
+static uint64_t reta_worker_snap;
+
+/**
+ * Quiesce counter of the distributor (RX or LB pipeline) at index i.
+ * Returns NULL past the last distributor.
+ */
+static volatile uint64_t *reta_distributor(unsigned i)
+{
+#ifdef RX_WORKER_DIRECT
+	if (i >= NUM_SPGW_PORTS * epc_app.n_rx_queues)
+		return NULL;
+	return &epc_app.rx_params[i % NUM_SPGW_PORTS]
+			[i / NUM_SPGW_PORTS].quiesce_count;
+#else
+	if (i > 0)
+		return NULL;
+	return &epc_app.lb_params.quiesce_count;
+#endif
+}
+
+static void reta_snap_distributors(void)
+{
+	volatile uint64_t *count;
+	unsigned i;
+
+	for (i = 0; (count = reta_distributor(i)) != NULL; i++)
+		reta_dist_snap[i] = *count;
+}
+
+/**
+ * Check that every distributor flushed its pipeline twice since the last
+ * snapshot, i.e. all packets classified before the snapshot are enqueued.
+ */
+static int reta_distributors_quiesced(void)
+{
+	volatile uint64_t *count;
+	unsigned i;
+
+	for (i = 0; (count = reta_distributor(i)) != NULL; i++)
+		if (*count - reta_dist_snap[i] < 2)
+			return 0;
+	return 1;
+}
+
+/**
+ * Move the packets of the held bucket to the worker ring of its new owner.
+ * Packets that do not fit in the worker ring are dropped and counted.
+ */
+static void reta_release_held(void)
+{
+	struct rte_mbuf *pkts[RETA_RELEASE_BURST];
+	unsigned port, n, sent;
+	uint32_t core = epc_app.worker_cores[reta_to];
+	uint64_t drops = 0;
+
+	for (port = 0; port < epc_app.n_ports; port++) {
+		while ((n = rte_ring_sc_dequeue_burst(epc_app.reta_hold_rx[port],
+				(void **)pkts, RETA_RELEASE_BURST)) > 0) {
+			sent = rte_ring_mp_enqueue_burst(
+					epc_app.epc_work_rx[core][port],
+					(void **)pkts, n);
+			drops += n - sent;
+			while (sent < n)
+				rte_pktmbuf_free(pkts[sent++]);
+		}
+	}
+
+	if (unlikely(drops)) {
+		epc_app.reta_drops += drops;
+		RTE_LOG(WARNING, EPC, "RETA bucket %u: %" PRIu64 " held packets"
+				" dropped, worker %u ring full\n",
+				reta_bucket, drops, reta_to);
 	}
 }
+
+static void reta_snap_held(void)
+{
+	unsigned port;
+
+	for (port = 0; port < epc_app.n_ports; port++)
+		reta_hold_snap[port] = epc_app.reta_hold_rx[port]->prod.tail;
+}
+
+/**
+ * Check that no packet of the held bucket reached the hold rings since
+ * the last snapshot.
+ */
+static int reta_held_idle(void)
+{
+	unsigned port;
+
+	for (port = 0; port < epc_app.n_ports; port++)
+		if (epc_app.reta_hold_rx[port]->prod.tail !=
+				reta_hold_snap[port])
+			return 0;
+	return 1;
+}
+
+/**
+ * Pick the bucket to migrate from the packets processed per bucket since
+ * the last decision. Returns 0 if a bucket was picked, -1 otherwise.
+ */
+static int reta_pick_bucket(void)
+{
+	uint64_t worker_load[DP_MAX_LCORE] = {0};
+	uint64_t total = 0, gap, best = 0;
+	uint32_t i, b, max_wk = 0, min_wk = 0;
+
+	memset(reta_load, 0, sizeof(reta_load));
+	for (i = 0; i < epc_app.num_workers; i++) {
+		uint32_t *pkts = epc_app.worker[i].reta_pkts;
+
+		for (b = 0; b < RETA_SIZE; b++) {
+			uint32_t cur = pkts[b];
+
+			reta_load[b] += (uint32_t)(cur - reta_last_pkts[i][b]);
+			reta_last_pkts[i][b] = cur;
+		}
+	}
+
+	for (b = 0; b < RETA_SIZE; b++) {
+		worker_load[epc_app.reta[b]] += reta_load[b];
+		total += reta_load[b];
+	}
+
+	for (i = 1; i < epc_app.num_workers; i++) {
+		if (worker_load[i] > worker_load[max_wk])
+			max_wk = i;
+		if (worker_load[i] < worker_load[min_wk])
+			min_wk = i;
+	}
+
+	if (max_wk == min_wk || worker_load[max_wk] * 100 * epc_app.num_workers
+			<= total * (100 + RETA_BALANCE_THRESHOLD))
+		return -1;
+
+	/* hottest bucket that does not overload the least loaded worker */
+	gap = worker_load[max_wk] - worker_load[min_wk];
+	reta_bucket = RETA_NO_BUCKET;
+	for (b = 0; b < RETA_SIZE; b++) {
+		if (epc_app.reta[b] != max_wk)
+			continue;
+		if (reta_load[b] > best && reta_load[b] < gap) {
+			best = reta_load[b];
+			reta_bucket = b;
+		}
+	}
+
+	if (reta_bucket == RETA_NO_BUCKET)
+		return -1;
+
+	reta_from = max_wk;
+	reta_to = min_wk;
+	return 0;
+}
+
+void epc_reta_balance(__rte_unused void *args)
+{
+	struct epc_worker_params *from;
+	uint32_t core;
+	unsigned port;
+
+	switch (reta_state) {
+	case RETA_IDLE:
+		if (rte_rdtsc() < reta_next_tsc)
+			return;
+		reta_next_tsc = rte_rdtsc() +
+			rte_get_tsc_hz() * RETA_BALANCE_INTERVAL_MS / 1000;
+		if (epc_app.num_workers < 2 || reta_pick_bucket() < 0)
+			return;
+		epc_app.reta_hold_bucket = reta_bucket;
+		rte_mb();
+		reta_snap_distributors();
+		reta_state = RETA_HOLD;
+		break;
+
+	case RETA_HOLD:
+		if (!reta_distributors_quiesced())
+			return;
+		core = epc_app.worker_cores[reta_from];
+		for (port = 0; port < epc_app.n_ports; port++)
+			reta_ring_snap[port] =
+				epc_app.epc_work_rx[core][port]->prod.tail;
+		reta_state = RETA_DRAIN;
+		break;
+
+	case RETA_DRAIN:
+		core = epc_app.worker_cores[reta_from];
+		for (port = 0; port < epc_app.n_ports; port++)
+			if ((int32_t)(epc_app.epc_work_rx[core][port]->cons.tail -
+					reta_ring_snap[port]) < 0)
+				return;
+		reta_worker_snap = epc_app.worker[reta_from].quiesce_count;
+		reta_state = RETA_QUIESCE;
+		break;
+
+	case RETA_QUIESCE:
+		from = &epc_app.worker[reta_from];
+		if (from->quiesce_count == reta_worker_snap)
+			return;
+		rte_mb();
+		epc_app.reta[reta_bucket] = reta_to;
+		rte_wmb();
+		reta_worker_snap = from->quiesce_count;
+		reta_state = RETA_SWITCH;
+		break;
+
+	case RETA_SWITCH:
+		/* notifications of the bucket may still be in flight to the
+		 * old worker, let it forward them with the new owner in place */
+		from = &epc_app.worker[reta_from];
+		if (from->quiesce_count == reta_worker_snap)
+			return;
+		reta_snap_held();
+		reta_release_held();
+		reta_snap_distributors();
+		reta_release_tsc = rte_rdtsc() +
+			rte_get_tsc_hz() * RETA_RELEASE_MAX_MS / 1000;
+		reta_state = RETA_FLUSH;
+		break;
+
+	case RETA_FLUSH:
+		/* keep the hold, and forward the bucket in order through the
+		 * hold rings, until it saw no packet for a distributor flush:
+		 * lifting it with packets on their way to the hold rings lets
+		 * the packets sent directly to the new owner overtake them */
+		reta_release_held();
+		if (!reta_distributors_quiesced())
+			return;
+		if (!reta_held_idle() && rte_rdtsc() < reta_release_tsc) {
+			reta_snap_held();
+			reta_snap_distributors();
+			return;
+		}
+		epc_app.reta_hold_bucket = RETA_NO_BUCKET;
+		rte_mb();
+		reta_snap_distributors();
+		reta_state = RETA_RELEASE;
+		break;
+
+	case RETA_RELEASE:
+		/* packets classified before the release reach the hold rings
+		 * at the latest on the next distributor flush */
+		if (!reta_distributors_quiesced())
+			return;
+		reta_release_held();
+		epc_app.reta_migrations++;
+		RTE_LOG(INFO, EPC, "RETA bucket %u moved from worker %u to %u\n",
+				reta_bucket, reta_from, reta_to);
+		reta_state = RETA_IDLE;
+		break;
+
+	default:
+		reta_state = RETA_IDLE;
+		break;
+	}
+}
+#endif
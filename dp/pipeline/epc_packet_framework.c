@@ -48,11 +48,13 @@
 #include "meter.h"
 #include "acl.h"
 #include "commands.h"
+#include "sess_snapshot.h"
 
 struct rte_ring *epc_mct_spns_dns_rx;
 struct epc_app_params epc_app = {
 	/* Ports */
 	.n_ports = NUM_SPGW_PORTS,
+	.n_rx_queues = 1,
 
 	/* Rings */
 	.ring_rx_size = EPC_DEFAULT_RING_SZ,
@@ -66,15 +68,18 @@ struct epc_app_params epc_app = {
 	.burst_size_tx_read = EPC_DEFAULT_BURST_SZ,
 	.burst_size_tx_write = EPC_BURST_SZ_64,
 
-	.core_rx[S1U_PORT_ID] = -1,
+	.core_rx[S1U_PORT_ID] = {[0 ... MAX_RX_QUEUES - 1] = -1},
 	.core_tx[S1U_PORT_ID] = -1,
-	.core_rx[SGI_PORT_ID] = -1,
+	.core_rx[SGI_PORT_ID] = {[0 ... MAX_RX_QUEUES - 1] = -1},
 	.core_tx[SGI_PORT_ID] = -1,
 	.core_load_balance = -1,
 	.core_mct = -1,
 	.core_iface = -1,
 	.core_stats = -1,
 	.core_spns_dns = -1,
+#ifdef RETA_BALANCE
+	.reta_hold_bucket = RETA_NO_BUCKET,
+#endif
 };
 
 static void *dp_zmq_thread(__rte_unused void *arg)
@@ -112,8 +117,14 @@ static void epc_iface_core(__rte_unused void *args)
 	/*
 	 * Poll message que. Populate hash table from que.
 	 */
-	while (1)
+	while (1) {
 		iface_process_ipc_msgs();
+#ifndef SDN_ODL_BUILD
+		/* ZMQ thread writes the tables, its adds do the steps */
+		sess_tbl_resize_step();
+		sess_snapshot_step();
+#endif
+	}
 #endif
 }
 
@@ -121,42 +132,80 @@ static void epc_init_lcores(void)
 {
 	unsigned i;
 
-	epc_alloc_lcore(epc_rx, &epc_app.rx_params[WEST_PORT_ID],
-						epc_app.core_rx[WEST_PORT_ID]);
-	epc_alloc_lcore(epc_rx, &epc_app.rx_params[EAST_PORT_ID],
-						epc_app.core_rx[EAST_PORT_ID]);
+	for (i = 0; i < epc_app.n_rx_queues; i++) {
+		epc_alloc_lcore(epc_rx, &epc_app.rx_params[WEST_PORT_ID][i],
+						epc_app.core_rx[WEST_PORT_ID][i]);
+		epc_alloc_lcore(epc_rx, &epc_app.rx_params[EAST_PORT_ID][i],
+						epc_app.core_rx[EAST_PORT_ID][i]);
+	}
 
+#ifndef RX_WORKER_DIRECT
 	epc_alloc_lcore(epc_load_balance, &epc_app.lb_params,
 						epc_app.core_load_balance);
+#endif
 	epc_alloc_lcore(epc_arp_icmp, NULL, epc_app.core_mct);
+#ifdef RETA_BALANCE
+	epc_alloc_lcore(epc_reta_balance, NULL, epc_app.core_mct);
+#endif
 
 	for (i = 0; i < epc_app.num_workers; i++) {
 		epc_alloc_lcore(epc_worker_core, &epc_app.worker[i],
 				epc_app.worker_cores[i]);
 	}
 
+#ifndef TX_WORKER_DIRECT
 	epc_alloc_lcore(epc_tx, &epc_app.tx_params[WEST_PORT_ID],
 						epc_app.core_tx[WEST_PORT_ID]);
 	epc_alloc_lcore(epc_tx, &epc_app.tx_params[EAST_PORT_ID],
 						epc_app.core_tx[EAST_PORT_ID]);
+#endif
 
 	epc_alloc_lcore(epc_iface_core, NULL, epc_app.core_iface);
 
 	epc_alloc_lcore(scan_dns_ring, NULL, epc_app.core_spns_dns);
+	epc_alloc_lcore(acl_build_step, NULL, epc_app.core_spns_dns);
 #ifdef STATS
 	epc_alloc_lcore(epc_stats_core, NULL, epc_app.core_stats);
 #endif
 }
 
 #define for_each_port(port) for (port = 0; port < epc_app.n_ports; port++)
-#define for_each_core(core) for (core = 0; core < DP_MAX_LCORE; core++)
+#define for_each_worker(i) for (i = 0; i < epc_app.num_workers; i++)
 
 /* initialize rings common to all pipelines */
 static void epc_init_rings(void)
 {
 	uint32_t i;
 	uint32_t port;
+	unsigned rx_ring_flags = RING_F_SC_DEQ;
+	unsigned work_ring_flags = RING_F_SP_ENQ | RING_F_SC_DEQ;
+
+	/* with RSS every RX queue pipeline enqueues to the same rings */
+	if (epc_app.n_rx_queues == 1)
+		rx_ring_flags |= RING_F_SP_ENQ;
+#ifdef RX_WORKER_DIRECT
+	/* worker rings are fed by the RX pipelines, no load balancer */
+	work_ring_flags = rx_ring_flags;
+#endif
+#ifdef RETA_BALANCE
+	/* the RETA balancer releases held packets on the worker rings */
+	work_ring_flags = RING_F_SC_DEQ;
+
+	for_each_port(port) {
+		char name[32];
 
+		snprintf(name, sizeof(name), "reta_hold_rx_%u", port);
+		epc_app.reta_hold_rx[port] = rte_ring_create(name,
+				epc_app.ring_rx_size,
+				rte_socket_id(),
+				RING_F_SC_DEQ);
+
+		if (epc_app.reta_hold_rx[port] == NULL)
+			rte_exit(EXIT_FAILURE,"Cannot create RETA hold ring %u\n",
+					port);
+	}
+#endif
+#ifndef RX_WORKER_DIRECT
 	/* create communication rings between RX-core and lb core */
 	for_each_port(port) {
 		char name[32];
@@ -165,12 +214,12 @@ static void epc_init_rings(void)
 		epc_app.epc_lb_rx[port] = rte_ring_create(name,
 				epc_app.ring_rx_size,
 				rte_socket_id(),
-				RING_F_SP_ENQ |
-				RING_F_SC_DEQ);
+				rx_ring_flags);
 
 		if (epc_app.epc_lb_rx[port] == NULL)
 			rte_exit(EXIT_FAILURE,"Cannot create RX ring %u\n", port);
 	}
+#endif
 
 	/* create communication rings between RX-core and mct core */
 	for_each_port(port) {
@@ -180,8 +229,7 @@ static void epc_init_rings(void)
 		epc_app.epc_mct_rx[port] = rte_ring_create(name,
 				epc_app.ring_rx_size,
 				rte_socket_id(),
-				RING_F_SP_ENQ |
-				RING_F_SC_DEQ);
+				rx_ring_flags);
 		if (epc_app.epc_mct_rx[port] == NULL)
 			rte_exit(EXIT_FAILURE,"Cannot create RX ring %u\n", port);
 
@@ -199,37 +247,50 @@ static void epc_init_rings(void)
 	if (epc_mct_spns_dns_rx == NULL)
 		rte_panic("Cannot create RX ring %u\n", port);
 
+	/*
+	 * Create transmit & receive rings only for the worker cores, plus the
+	 * transmit ring of the mct core, so that ring memory grows with the
+	 * number of workers rather than with DP_MAX_LCORE.
+	 */
 	for_each_port(port) {
-		/* Create transmit & receive rings per core */
-		for_each_core(i) {
+		for_each_worker(i) {
 			char name[32];
+			uint32_t core = epc_app.worker_cores[i];
 
-			snprintf(name, sizeof(name), "epc_work_rx_%u_%u", i,
+			snprintf(name, sizeof(name), "epc_work_rx_%u_%u", core,
 					port);
-			epc_app.epc_work_rx[i][port] =
+			epc_app.epc_work_rx[core][port] =
 				rte_ring_create(name, epc_app.ring_rx_size,
 						rte_socket_id(),
-						RING_F_SP_ENQ | RING_F_SC_DEQ);
+						work_ring_flags);
 
-			if (epc_app.epc_work_rx[i][port] == NULL)
-				rte_exit(EXIT_FAILURE,"Cannot create RX ring %u\n", i);
-
-			snprintf(name, sizeof(name), "app_ring_tx_%u_%u", i,
+			if (epc_app.epc_work_rx[core][port] == NULL)
+				rte_exit(EXIT_FAILURE,"Cannot create RX ring %u\n", core);
+#ifndef TX_WORKER_DIRECT
+			snprintf(name, sizeof(name), "app_ring_tx_%u_%u", core,
 					port);
 
-			epc_app.ring_tx[i][port] = rte_ring_create(name,
-					epc_app.
-					ring_tx_size,
-					rte_socket_id
-					(),
-					RING_F_SP_ENQ
-					|
-					RING_F_SC_DEQ);
-
-			if (epc_app.ring_tx[i][port] == NULL)
-				rte_exit(EXIT_FAILURE,"Cannot create TX ring %u\n", i);
+			epc_app.ring_tx[core][port] = rte_ring_create(name,
+					epc_app.ring_tx_size,
+					rte_socket_id(),
+					RING_F_SP_ENQ | RING_F_SC_DEQ);
 
+			if (epc_app.ring_tx[core][port] == NULL)
+				rte_exit(EXIT_FAILURE,"Cannot create TX ring %u\n", core);
+#endif
 		}
+#ifndef TX_WORKER_DIRECT
+		snprintf(name, sizeof(name), "app_ring_tx_%u_%u",
+				epc_app.core_mct, port);
+		epc_app.ring_tx[epc_app.core_mct][port] = rte_ring_create(name,
+				epc_app.ring_tx_size,
+				rte_socket_id(),
+				RING_F_SP_ENQ | RING_F_SC_DEQ);
+
+		if (epc_app.ring_tx[epc_app.core_mct][port] == NULL)
+			rte_exit(EXIT_FAILURE,"Cannot create TX ring %u\n",
+					epc_app.core_mct);
+#endif
 	}
 }
 
@@ -243,23 +304,8 @@ static inline void epc_run_pipeline(void)
 	lcore = rte_lcore_id();
 	config = &epc_app.lcores[lcore];
 
-#ifdef INSTMNT
-	uint64_t start_tsc, end_tsc;
-
-	if (lcore == epc_app.worker_cores[0]) {
-		for (i = 0; i < config->allocated; i++) {
-			start_tsc = rte_rdtsc();
-			config->launch[i].func(config->launch[i].arg);
-			if (flag_wrkr_update_diff) {
-				end_tsc = rte_rdtsc();
-				diff_tsc_wrkr += end_tsc - start_tsc;
-				flag_wrkr_update_diff = 0;
-			}
-		}
-	} else
-#endif
-		for (i = 0; i < config->allocated; i++)
-			config->launch[i].func(config->launch[i].arg);
+	for (i = 0; i < config->allocated; i++)
+		config->launch[i].func(config->launch[i].arg);
 }
 static int epc_lcore_main_loop(__attribute__ ((unused))
 		void *arg)
@@ -301,14 +347,34 @@ void epc_init_packet_framework(uint8_t east_port_id, uint8_t west_port_id)
 		exit(1);
 	}
 
+	if (epc_app.num_workers == 0 || epc_app.num_workers >= DP_MAX_LCORE) {
+		printf("number of workers %u must be in range 1 - %d\n",
+				epc_app.num_workers, DP_MAX_LCORE - 1);
+		exit(1);
+	}
+
 	epc_app.ports[WEST_PORT_ID] = west_port_id;
 	epc_app.ports[EAST_PORT_ID] = east_port_id;
-	RTE_LOG(INFO, DP, "west rx/tx running on lcore    :\t%d\n",
-						epc_app.core_rx[WEST_PORT_ID]);
-	RTE_LOG(INFO, DP, "east rx/tx running on lcore    :\t%d\n",
-						epc_app.core_rx[EAST_PORT_ID]);
+#ifndef TX_WORKER_DIRECT
+	RTE_LOG(INFO, DP, "west tx running on lcore       :\t%d\n",
+						epc_app.core_tx[WEST_PORT_ID]);
+	RTE_LOG(INFO, DP, "east tx running on lcore       :\t%d\n",
+						epc_app.core_tx[EAST_PORT_ID]);
+#else
+	RTE_LOG(INFO, DP, "workers transmit on their own NIC tx queues\n");
+#endif
+	for (i = 0; i < epc_app.n_rx_queues; i++) {
+		RTE_LOG(INFO, DP, "west rx queue %u on lcore      :\t%d\n",
+					i, epc_app.core_rx[WEST_PORT_ID][i]);
+		RTE_LOG(INFO, DP, "east rx queue %u on lcore      :\t%d\n",
+					i, epc_app.core_rx[EAST_PORT_ID][i]);
+	}
+#ifndef RX_WORKER_DIRECT
 	RTE_LOG(INFO, DP, "load balancer running on lcore:\t%d\n",
 						epc_app.core_load_balance);
+#else
+	RTE_LOG(INFO, DP, "load balancer disabled, rx feeds workers directly\n");
+#endif
 	RTE_LOG(INFO, DP, "multicast running on lcore    :\t%d\n",
 						epc_app.core_mct);
 	RTE_LOG(INFO, DP, "iface running on lcore        :\t%d\n",
@@ -335,22 +401,35 @@ void epc_init_packet_framework(uint8_t east_port_id, uint8_t west_port_id)
 	/*
 	 * Initialize pipelines
 	 */
+#ifndef TX_WORKER_DIRECT
 	epc_tx_init(&epc_app.tx_params[WEST_PORT_ID],
-				epc_app.core_rx[WEST_PORT_ID], WEST_PORT_ID);
+				epc_app.core_tx[WEST_PORT_ID], WEST_PORT_ID);
 	epc_tx_init(&epc_app.tx_params[EAST_PORT_ID],
-				epc_app.core_rx[EAST_PORT_ID], EAST_PORT_ID);
+				epc_app.core_tx[EAST_PORT_ID], EAST_PORT_ID);
+#endif
+
+	for (i = 0; i < epc_app.num_workers; i++)
+		epc_app.worker_core_mapping[epc_app.worker_cores[i]] = i;
+
+	/* spread the RETA buckets evenly over the workers */
+	for (i = 0; i < RETA_SIZE; i++)
+		epc_app.reta[i] = i % epc_app.num_workers;
 
 	epc_arp_icmp_init();
+#ifndef RX_WORKER_DIRECT
 	epc_load_balance_init(&epc_app.lb_params);
+#endif
 
 	for (i = 0; i < epc_app.num_workers; i++)
 		epc_worker_core_init(&epc_app.worker[i],
 				epc_app.worker_cores[i], i);
 
-	epc_rx_init(&epc_app.rx_params[WEST_PORT_ID],
-				epc_app.core_rx[WEST_PORT_ID], WEST_PORT_ID);
-	epc_rx_init(&epc_app.rx_params[EAST_PORT_ID],
-				epc_app.core_rx[EAST_PORT_ID], EAST_PORT_ID);
+	for (i = 0; i < epc_app.n_rx_queues; i++) {
+		epc_rx_init(&epc_app.rx_params[WEST_PORT_ID][i],
+				epc_app.core_rx[WEST_PORT_ID][i], WEST_PORT_ID, i);
+		epc_rx_init(&epc_app.rx_params[EAST_PORT_ID][i],
+				epc_app.core_rx[EAST_PORT_ID][i], EAST_PORT_ID, i);
+	}
 
 	/*
 	 * Assign pipelines to cores
@@ -24,6 +24,7 @@
  */
 #include <rte_pipeline.h>
 #include <rte_hash_crc.h>
+#include <rte_branch_prediction.h>
 
 extern uint64_t num_dns_processed;
 
@@ -75,6 +76,36 @@ struct dl_bm_key {
 	uint32_t rid;
 };
 
+/**
+ * UE packet 5-tuple in network byte order. Fields are at the same offsets
+ * from proto as in the IPv4 and L4 headers, so that the tuple can be used
+ * as ACL IPv4 search key.
+ */
+struct epc_5tuple {
+	/** IP protocol */
+	uint8_t proto;
+	/** IPv4 header checksum position, unused */
+	uint16_t pad0;
+	/** Source address */
+	uint32_t src_addr;
+	/** Destination address */
+	uint32_t dst_addr;
+	/** L4 source port */
+	uint16_t src_port;
+	/** L4 destination port */
+	uint16_t dst_port;
+	/** Padding, ACL reads 4 bytes per field */
+	uint8_t pad1;
+} __attribute__((__packed__));
+
+/* epc_meta_data validity bits, set by the RX pipelines */
+/** outer IPv4 header: l3_offset, l4_offset and dst_ipv4 are valid */
+#define EPC_META_IPV4		(1 << 0)
+/** GTP-U header: teid, enb_ipv4 and gtpu_msgtype are valid */
+#define EPC_META_GTPU		(1 << 1)
+/** ue_tuple is valid, inner header of a G-PDU or the outer IPv4 header */
+#define EPC_META_UE_TUPLE	(1 << 2)
+
 /** Meta data used for directing packets to cores */
 struct epc_meta_data {
 	/** pipeline output port ID */
@@ -89,6 +120,18 @@ struct epc_meta_data {
 	uint32_t teid;
 	/** DL Bearer Map key */
 	struct dl_bm_key key;
+	/** Validity of the fields parsed at RX, EPC_META_* bits */
+	uint8_t valid;
+	/** GTP-U message type */
+	uint8_t gtpu_msgtype;
+	/** Outer IPv4 header offset */
+	uint16_t l3_offset;
+	/** Outer L4 header offset */
+	uint16_t l4_offset;
+	/** Outer IPv4 destination, network byte order */
+	uint32_t dst_ipv4;
+	/** UE packet 5-tuple, inner header for GTP-U */
+	struct epc_5tuple ue_tuple;
 };
 
 /*
@@ -111,7 +154,51 @@ struct epc_meta_data {
 
 #define DP_MAX_LCORE RTE_PIPELINE_PORT_OUT_MAX
 
-/** Rx pipeline parameters - Per input port */
+/**
+ * Max number of RSS RX queues per port. Each queue is served by its own
+ * Rx pipeline instance.
+ */
+#define MAX_RX_QUEUES		8
+
+#if defined(RX_WORKER_DIRECT) && (defined(RX_TX) || defined(RX_LB_TX))
+#error "RX_WORKER_DIRECT can not be combined with RX_TX or RX_LB_TX"
+#endif
+
+#if defined(TX_WORKER_DIRECT) && (defined(RX_TX) || defined(RX_LB_TX))
+#error "TX_WORKER_DIRECT can not be combined with RX_TX or RX_LB_TX"
+#endif
+
+#if defined(RETA_BALANCE) && (defined(RX_TX) || defined(RX_LB_TX))
+#error "RETA_BALANCE can not be combined with RX_TX or RX_LB_TX"
+#endif
+
+/**
+ * Number of buckets of the worker indirection table (RETA), power of 2.
+ * Each bucket of ue_ipv4_hash values is owned by exactly one worker.
+ */
+#define RETA_SIZE		512
+
+/**
+ * RETA bucket of an ue_ipv4_hash.
+ */
+#define RETA_BUCKET(hash)	((hash) & (RETA_SIZE - 1))
+
+/**
+ * No RETA bucket is migrating.
+ */
+#define RETA_NO_BUCKET		RETA_SIZE
+
+/**
+ * NIC TX queue used by the ARP/ICMP pipeline with TX_WORKER_DIRECT.
+ */
+#define ARP_ICMP_TX_QUEUE	0
+
+/**
+ * NIC TX queue owned by worker wk_index with TX_WORKER_DIRECT.
+ */
+#define WORKER_TX_QUEUE(wk_index)	(ARP_ICMP_TX_QUEUE + 1 + (wk_index))
+
+/** Rx pipeline parameters - Per input port RX queue */
 struct epc_rx_params {
 	/** Count since last flush */
 	int flush_count;
@@ -119,18 +206,33 @@ struct epc_rx_params {
 	int flush_max;
 	/** RTE pipeline params */
 	struct rte_pipeline_params pipeline_params;
+	/** NIC RX queue read by this pipeline */
+	uint16_t queue_id;
 	/** Input port id */
 	uint32_t port_in_id;
 	/** Output port IDs  [0]-> load balance, [1]-> master
-	  * control thr
+	  * control thr. With RX_WORKER_DIRECT [0..num_workers - 1]->
+	  * worker rings, [num_workers]-> master control thr
 	  */
-	uint32_t port_out_id[2];
+	uint32_t port_out_id[DP_MAX_LCORE];
 	/** Table ID - ports connect to this table */
 	uint32_t table_id;
 	/** RTE pipeline */
 	struct rte_pipeline *pipeline;
 	/** pipeline name */
 	char name[PIPE_NAME_SIZE];
+#ifdef RETA_BALANCE
+	/** Pipeline flushes, used by the RETA balancer to detect
+	  * quiescence of this distributor
+	  */
+	volatile uint64_t quiesce_count;
+#endif
+#ifdef INSTMNT
+	/** Cycles spent in the RX action handler of this pipeline */
+	uint64_t instmnt_cycles;
+	/** Packets classified by the RX action handler of this pipeline */
+	uint64_t instmnt_pkts;
+#endif
 } __rte_cache_aligned;
 
 /** Tx pipeline parameters - Per output port */
@@ -173,6 +275,14 @@ struct epc_load_balance_params {
 	struct rte_pipeline *pipeline;
 	/** pipeline name */
 	char name[PIPE_NAME_SIZE];
+#ifdef RETA_BALANCE
+	/** Output port IDs of the RETA hold rings */
+	uint32_t hold_port_out_id[NUM_SPGW_PORTS];
+	/** Pipeline flushes, used by the RETA balancer to detect
+	  * quiescence of this distributor
+	  */
+	volatile uint64_t quiesce_count;
+#endif
 } __rte_cache_aligned;
 
 /** Worker pipeline parameters - Per output port */
@@ -210,6 +320,28 @@ struct epc_worker_params {
 	struct rte_ring *notify_ring;
 	/** Pool for notification msg pkts */
 	struct rte_mempool *notify_msg_pool;
+	/** Session grace period seen by this worker at its last quiescent
+	  * state, between two pipeline runs. QSBR_OFFLINE until it runs.
+	  */
+	volatile uint64_t qsbr_period;
+#ifdef FLOW_CACHE
+	/** Filter, PCC and bearer results of the flows of this worker */
+	struct flow_cache *flow_cache;
+#endif
+#ifdef RETA_BALANCE
+	/** Pipeline runs, used by the RETA balancer to detect that packets
+	  * dequeued by this worker are fully processed
+	  */
+	volatile uint64_t quiesce_count;
+	/** Packets processed per RETA bucket, written by this worker only */
+	uint32_t reta_pkts[RETA_SIZE];
+#endif
+#ifdef INSTMNT
+	/** Cycles spent in the packet handlers of this worker */
+	uint64_t instmnt_cycles;
+	/** Packets passed to the packet handlers of this worker */
+	uint64_t instmnt_pkts;
+#endif
 } __rte_cache_aligned;
 
 typedef int (*epc_packet_handler) (struct rte_pipeline*, struct rte_mbuf **pkts,
@@ -232,7 +364,7 @@ struct epc_lcore_config {
 struct epc_app_params {
 	/* CPU cores */
 	struct epc_lcore_config lcores[DP_MAX_LCORE];
-	int core_rx[NUM_SPGW_PORTS];
+	int core_rx[NUM_SPGW_PORTS][MAX_RX_QUEUES];
 	int core_tx[NUM_SPGW_PORTS];
 	int core_load_balance;
 	int core_mct;
@@ -246,6 +378,8 @@ struct epc_app_params {
 	/* Ports */
 	uint32_t ports[NUM_SPGW_PORTS];
 	uint32_t n_ports;
+	/* Number of RSS RX queues per port */
+	uint16_t n_rx_queues;
 	uint32_t port_rx_ring_size;
 	uint32_t port_tx_ring_size;
 
@@ -258,6 +392,21 @@ struct epc_app_params {
 	/* Tx rings */
 	struct rte_ring *ring_tx[DP_MAX_LCORE][NUM_SPGW_PORTS];
 
+	/* Worker indirection table, RETA bucket -> worker index */
+	uint8_t reta[RETA_SIZE];
+	/* Session grace period, advanced by the session table writer */
+	volatile uint64_t qsbr_period;
+#ifdef RETA_BALANCE
+	/* Bucket held back from the workers while it migrates */
+	volatile uint32_t reta_hold_bucket;
+	/* Rings buffering the packets of the held bucket, per port */
+	struct rte_ring *reta_hold_rx[NUM_SPGW_PORTS];
+	/* Number of completed bucket migrations */
+	uint64_t reta_migrations;
+	/* Number of held packets dropped on release, worker ring full */
+	uint64_t reta_drops;
+#endif
+
 	uint32_t ring_rx_size;
 	uint32_t ring_tx_size;
 
@@ -272,7 +421,7 @@ struct epc_app_params {
 	/* Pipeline params */
 	struct epc_load_balance_params lb_params;
 	struct epc_tx_params tx_params[NUM_SPGW_PORTS];
-	struct epc_rx_params rx_params[NUM_SPGW_PORTS];
+	struct epc_rx_params rx_params[NUM_SPGW_PORTS][MAX_RX_QUEUES];
 	struct epc_worker_params worker[DP_MAX_LCORE];
 } __rte_cache_aligned;
 
@@ -313,8 +462,12 @@ void epc_load_balance_init(struct epc_load_balance_params *param);
  * @param port_id
  *	Rx Port ID
  *
+ * @param queue_id
+ *	NIC RX queue of port_id read by this pipeline
+ *
  */
-void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id);
+void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id,
+		uint16_t queue_id);
 
 /**
  * Initializes Tx pipeline
@@ -446,6 +599,67 @@ void register_worker(epc_packet_handler f, int port);
  */
 void packet_framework_launch(void);
 
+#ifdef RETA_BALANCE
+/**
+ * RETA balancer function. Periodically moves a hot RETA bucket from the
+ * most loaded worker to the least loaded one, based on the packets each
+ * worker processed per bucket. A migration holds the bucket back from the
+ * workers, drains the old worker and only then hands the bucket, and with
+ * it the sessions and meters of its UEs, over to the new worker.
+ *
+ * @param args
+ *	Unused
+ */
+void epc_reta_balance(__rte_unused void *args);
+#endif
+
+/**
+ * Worker qsbr_period before the worker runs, a worker that does not run
+ * holds no session references.
+ */
+#define QSBR_OFFLINE	UINT64_MAX
+
+/**
+ * Report a quiescent state of a worker: it holds no reference to session
+ * table entries looked up before this point.
+ */
+static inline void qsbr_quiescent(struct epc_worker_params *param)
+{
+	/* x86 does not reorder this store with the loads and stores of the
+	 * burst, keep the compiler from doing so */
+	rte_compiler_barrier();
+	param->qsbr_period = epc_app.qsbr_period;
+}
+
+/**
+ * Start a new grace period. Table entries unlinked before can be freed
+ * once qsbr_done() reaches the returned period. Called by the iface and
+ * the ACL build core.
+ */
+static inline uint64_t qsbr_start(void)
+{
+	/* unlink is visible before the new period */
+	rte_mb();
+	return __sync_add_and_fetch(&epc_app.qsbr_period, 1);
+}
+
+/**
+ * Oldest grace period not yet completed by all workers.
+ */
+static inline uint64_t qsbr_done(void)
+{
+	uint64_t min = QSBR_OFFLINE;
+	uint64_t period;
+	unsigned i;
+
+	for (i = 0; i < epc_app.num_workers; i++) {
+		period = epc_app.worker[i].qsbr_period;
+		if (period < min)
+			min = period;
+	}
+	return min;
+}
+
 static inline void set_ue_ipv4_hash(uint32_t *hash, const uint32_t *ue_ip)
 {
 #ifdef SKIP_LB_HASH_CRC
@@ -458,10 +672,17 @@ static inline void set_ue_ipv4_hash(uint32_t *hash, const uint32_t *ue_ip)
 static inline void
 set_worker_core_id(uint32_t *worker_core_id, uint32_t *hash)
 {
-	if (rte_is_power_of_2(epc_app.num_workers))
-		*worker_core_id = *hash & (epc_app.num_workers - 1);
-	else
-		*worker_core_id = *hash % (epc_app.num_workers);
+	*worker_core_id = epc_app.reta[RETA_BUCKET(*hash)];
+}
+
+#ifdef RETA_BALANCE
+/**
+ * Check if the RETA bucket of hash is held back for migration.
+ */
+static inline int reta_bucket_held(const uint32_t *hash)
+{
+	return unlikely(RETA_BUCKET(*hash) == epc_app.reta_hold_bucket);
 }
+#endif
 
 #endif /* __EPC_PACKET_FRAMEWORK_H__ */
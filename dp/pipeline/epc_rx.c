@@ -39,129 +39,463 @@
 #include <rte_udp.h>
 #include <rte_mbuf.h>
 #include <rte_port_ring.h>
+#include <rte_vect.h>
 
 #include "epc_packet_framework.h"
 #include "main.h"
 #include "gtpu.h"
 
-#ifndef SKIP_LB_GTPU_AH
-static inline void epc_s1u_rx_set_port_id(struct rte_mbuf *m)
+#ifdef RX_WORKER_DIRECT
+#ifdef RETA_BALANCE
+/**
+ * Output port of the RETA hold ring, follows the mct ring.
+ */
+#define RX_HOLD_PORT	(epc_app.num_workers + 1)
+
+/**
+ * Number of RX pipeline output ports: one ring per worker, the mct ring
+ * and the RETA hold ring.
+ */
+#define RX_NUM_PORT_OUT	(epc_app.num_workers + 2)
+#else
+/**
+ * Number of RX pipeline output ports: one ring per worker and the mct ring.
+ */
+#define RX_NUM_PORT_OUT	(epc_app.num_workers + 1)
+#endif
+
+/**
+ * Translate the RX classification (0 - worker traffic, 1 - mct) into the
+ * output port of the owning worker ring, or the mct ring that follows the
+ * worker rings.
+ */
+static inline void
+epc_rx_set_worker_port(uint32_t *port_id, uint32_t *ue_ipv4_hash)
+{
+	if (likely(*port_id == 0)) {
+		set_worker_core_id(port_id, ue_ipv4_hash);
+#ifdef RETA_BALANCE
+		if (reta_bucket_held(ue_ipv4_hash))
+			*port_id = RX_HOLD_PORT;
+#endif
+	} else {
+		*port_id = epc_app.num_workers;
+	}
+}
+#else
+#define RX_NUM_PORT_OUT	NUM_SPGW_PORTS
+#endif
+
+/**
+ * Parse the outer IPv4, UDP and GTP-U headers and the UE 5-tuple once,
+ * workers only consume the meta data. Only UDP to the GTP-U port of
+ * gtpu_ip, the local GTP-U address of the ingress port, is GTP-U and
+ * gives the inner UE 5-tuple; other packets, and all with gtpu_ip 0, give
+ * the outer one.
+ */
+static inline void
+epc_rx_parse_meta(struct rte_mbuf *m, struct epc_meta_data *meta_data,
+		uint32_t gtpu_ip)
 {
 	uint8_t *m_data = rte_pktmbuf_mtod(m, uint8_t *);
-	struct epc_meta_data *meta_data =
-	    (struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(m,
-							META_DATA_OFFSET);
-	uint32_t *port_id_offset = &meta_data->port_id;
-	uint32_t *ue_ipv4_hash_offset = &meta_data->ue_ipv4_hash;
+	struct ether_hdr *eh = (struct ether_hdr *)&m_data[0];
 	struct ipv4_hdr *ipv4_hdr =
 	    (struct ipv4_hdr *)&m_data[sizeof(struct ether_hdr)];
+	struct ipv4_hdr *ue_hdr = ipv4_hdr;
 	struct udp_hdr *udph;
+	struct gtpu_hdr *gtpu_hdr;
+	uint16_t *ports;
 	uint32_t ip_len;
-	struct ether_hdr *eh = (struct ether_hdr *)&m_data[0];
-	uint32_t ipv4_packet;
 
-	ipv4_packet = (eh->ether_type == htons(ETHER_TYPE_IPv4));
+	meta_data->valid = 0;
+
+	if (unlikely(eh->ether_type != htons(ETHER_TYPE_IPv4)))
+		return;
 
 	if (unlikely(m->ol_flags
 		& (PKT_RX_L4_CKSUM_BAD
 		| PKT_RX_IP_CKSUM_BAD))) {
-		RTE_LOG(ERR, EPC, "Bad checksum\n");
-		ipv4_packet = 0;
+		RTE_LOG(DEBUG, EPC, "Bad checksum\n");
+		/* put packets with bad checksum to kernel */
+		return;
 	}
 
-	*port_id_offset = 1;
+	ip_len = (ipv4_hdr->version_ihl & 0xf) << 2;
+	meta_data->l3_offset = sizeof(struct ether_hdr);
+	meta_data->l4_offset = sizeof(struct ether_hdr) + ip_len;
+	meta_data->dst_ipv4 = ipv4_hdr->dst_addr;
+	meta_data->valid = EPC_META_IPV4;
+
+	if (ipv4_hdr->next_proto_id == IPPROTO_UDP &&
+			ipv4_hdr->dst_addr == gtpu_ip && gtpu_ip != 0) {
+		udph = (struct udp_hdr *)&m_data[meta_data->l4_offset];
+		if (likely(udph->dst_port == htons(UDP_PORT_GTPU))) {
+			gtpu_hdr = (struct gtpu_hdr *)RTE_PTR_ADD(udph,
+					UDP_HDR_SIZE);
+			meta_data->teid = ntohl(gtpu_hdr->teid);
+			meta_data->enb_ipv4 = ntohl(ipv4_hdr->src_addr);
+			meta_data->gtpu_msgtype = gtpu_hdr->msgtype;
+			meta_data->valid |= EPC_META_GTPU;
+
+			/* no UE packet in GTP-U signalling messages */
+			if (gtpu_hdr->msgtype != GTP_GPDU)
+				return;
 
-	if (likely(ipv4_packet && ipv4_hdr->next_proto_id == IPPROTO_UDP)) {
-		ip_len = (ipv4_hdr->version_ihl & 0xf) << 2;
-		udph =
-		    (struct udp_hdr *)&m_data[sizeof(struct ether_hdr) +
-					      ip_len];
-		if (likely(udph->dst_port == htons(2152))) {
 			/* TODO: Inner could be ipv6 ? */
+			ue_hdr = (struct ipv4_hdr *)RTE_PTR_ADD(gtpu_hdr,
+					GPDU_HDR_SIZE);
+		}
+	}
 
-			RTE_LOG(DEBUG, EPC, "Function:%s::\n\t"
-					 "gtpu_hdrsz= %lu\n",
-					 __func__, sizeof(struct gtpu_hdr));
+	ports = (uint16_t *)RTE_PTR_ADD(ue_hdr,
+			(ue_hdr->version_ihl & 0xf) << 2);
+	meta_data->ue_tuple.proto = ue_hdr->next_proto_id;
+	meta_data->ue_tuple.src_addr = ue_hdr->src_addr;
+	meta_data->ue_tuple.dst_addr = ue_hdr->dst_addr;
+	meta_data->ue_tuple.src_port = ports[0];
+	meta_data->ue_tuple.dst_port = ports[1];
+	meta_data->valid |= EPC_META_UE_TUPLE;
+}
 
-			struct ipv4_hdr *inner_ipv4_hdr =
-			    (struct ipv4_hdr *)RTE_PTR_ADD(udph,
-							   UDP_HDR_SIZE +
-							   sizeof(struct
-								  gtpu_hdr));
+/**
+ * Number of packets classified together on the fixed offset header words.
+ */
+#define RX_CLASSIFY_LANES	4
 
-			const uint32_t *p =
-			    (const uint32_t *)&inner_ipv4_hdr->src_addr;
+/**
+ * Bad checksum flags, such packets go through epc_rx_parse_meta.
+ */
+#define RX_CKSUM_BAD	(PKT_RX_L4_CKSUM_BAD | PKT_RX_IP_CKSUM_BAD)
+
+/**
+ * Fixed offset header words of an untagged IPv4 packet without options,
+ * in memory order: ether type + version/ihl at 12, fragment/ttl/protocol
+ * at 20 and UDP destination port at 36.
+ */
+#define RX_WORD_ETH_IP		12
+#define RX_WORD_PROTO		20
+#define RX_WORD_UDP_DPORT	36
+
+#define RX_ETH_IP_MASK		rte_cpu_to_be_32(0xffffff00)
+#define RX_ETH_IP_SIG		rte_cpu_to_be_32((ETHER_TYPE_IPv4 << 16) | 0x4500)
+#define RX_PROTO_MASK		rte_cpu_to_be_32(0x000000ff)
+#define RX_PROTO_SIG		rte_cpu_to_be_32(IPPROTO_UDP)
+#define RX_UDP_DPORT_MASK	rte_cpu_to_be_32(0xffff0000)
+#define RX_UDP_DPORT_SIG	rte_cpu_to_be_32(UDP_PORT_GTPU << 16)
+
+static inline uint32_t
+rx_hdr_word(struct rte_mbuf *m, uint32_t offset)
+{
+	return *(uint32_t *)(rte_pktmbuf_mtod(m, uint8_t *) + offset);
+}
+
+/**
+ * Classify RX_CLASSIFY_LANES packets on their fixed offset header words.
+ * Bit i of ipv4_mask is set for an untagged IPv4 packet without options
+ * and with good checksums, bit i of gtpu_mask if it is also UDP to the
+ * GTP-U port.
+ */
+#if defined(RTE_MACHINE_CPUFLAG_SSE2) && !defined(RX_SCALAR_CLASSIFY)
+static inline void
+epc_rx_classify(struct rte_mbuf **pkts, uint32_t *ipv4_mask,
+		uint32_t *gtpu_mask)
+{
+	const __m128i eth_ip_mask = _mm_set1_epi32(RX_ETH_IP_MASK);
+	const __m128i eth_ip_sig = _mm_set1_epi32(RX_ETH_IP_SIG);
+	const __m128i proto_mask = _mm_set1_epi32(RX_PROTO_MASK);
+	const __m128i proto_sig = _mm_set1_epi32(RX_PROTO_SIG);
+	const __m128i dport_mask = _mm_set1_epi32(RX_UDP_DPORT_MASK);
+	const __m128i dport_sig = _mm_set1_epi32(RX_UDP_DPORT_SIG);
+	__m128i eth_ip, proto, dport, ipv4, gtpu;
+	uint32_t bad = 0;
+	uint32_t i;
+
+	/* gather the header words of the four packets */
+	eth_ip = _mm_set_epi32(rx_hdr_word(pkts[3], RX_WORD_ETH_IP),
+			rx_hdr_word(pkts[2], RX_WORD_ETH_IP),
+			rx_hdr_word(pkts[1], RX_WORD_ETH_IP),
+			rx_hdr_word(pkts[0], RX_WORD_ETH_IP));
+	proto = _mm_set_epi32(rx_hdr_word(pkts[3], RX_WORD_PROTO),
+			rx_hdr_word(pkts[2], RX_WORD_PROTO),
+			rx_hdr_word(pkts[1], RX_WORD_PROTO),
+			rx_hdr_word(pkts[0], RX_WORD_PROTO));
+	dport = _mm_set_epi32(rx_hdr_word(pkts[3], RX_WORD_UDP_DPORT),
+			rx_hdr_word(pkts[2], RX_WORD_UDP_DPORT),
+			rx_hdr_word(pkts[1], RX_WORD_UDP_DPORT),
+			rx_hdr_word(pkts[0], RX_WORD_UDP_DPORT));
+
+	/* compare all lanes against the IPv4 and GTP-U signatures */
+	ipv4 = _mm_cmpeq_epi32(_mm_and_si128(eth_ip, eth_ip_mask), eth_ip_sig);
+	gtpu = _mm_and_si128(
+		_mm_cmpeq_epi32(_mm_and_si128(proto, proto_mask), proto_sig),
+		_mm_cmpeq_epi32(_mm_and_si128(dport, dport_mask), dport_sig));
+	gtpu = _mm_and_si128(gtpu, ipv4);
+
+	for (i = 0; i < RX_CLASSIFY_LANES; i++)
+		bad |= !!(pkts[i]->ol_flags & RX_CKSUM_BAD) << i;
+
+	*ipv4_mask = _mm_movemask_ps(_mm_castsi128_ps(ipv4)) & ~bad;
+	*gtpu_mask = _mm_movemask_ps(_mm_castsi128_ps(gtpu)) & ~bad;
+}
+#else
+static inline void
+epc_rx_classify(struct rte_mbuf **pkts, uint32_t *ipv4_mask,
+		uint32_t *gtpu_mask)
+{
+	uint32_t i;
+
+	*ipv4_mask = 0;
+	*gtpu_mask = 0;
+	for (i = 0; i < RX_CLASSIFY_LANES; i++) {
+		struct rte_mbuf *m = pkts[i];
 
-			RTE_LOG(DEBUG, EPC, "gtpu packet\n");
-			*port_id_offset = 0;
+		if ((rx_hdr_word(m, RX_WORD_ETH_IP) & RX_ETH_IP_MASK) !=
+				RX_ETH_IP_SIG || (m->ol_flags & RX_CKSUM_BAD))
+			continue;
 
-			set_ue_ipv4_hash(ue_ipv4_hash_offset, p);
+		*ipv4_mask |= 1 << i;
+		if ((rx_hdr_word(m, RX_WORD_PROTO) & RX_PROTO_MASK) ==
+				RX_PROTO_SIG &&
+				(rx_hdr_word(m, RX_WORD_UDP_DPORT) &
+				 RX_UDP_DPORT_MASK) == RX_UDP_DPORT_SIG)
+			*gtpu_mask |= 1 << i;
+	}
+}
+#endif
+
+/**
+ * epc_rx_parse_meta for a packet classified by epc_rx_classify, headers
+ * are at fixed offsets.
+ */
+static inline void
+epc_rx_parse_meta_fixed(struct rte_mbuf *m, struct epc_meta_data *meta_data,
+		uint32_t gtpu, uint32_t gtpu_ip)
+{
+	struct ipv4_hdr *ipv4_hdr = rte_pktmbuf_mtod_offset(m,
+			struct ipv4_hdr *, sizeof(struct ether_hdr));
+	struct ipv4_hdr *ue_hdr = ipv4_hdr;
+	struct gtpu_hdr *gtpu_hdr;
+	uint16_t *ports;
+
+	meta_data->l3_offset = sizeof(struct ether_hdr);
+	meta_data->l4_offset = sizeof(struct ether_hdr) + IPv4_HDR_SIZE;
+	meta_data->dst_ipv4 = ipv4_hdr->dst_addr;
+	meta_data->valid = EPC_META_IPV4;
+
+	/* GTP-U only to the local GTP-U address of the ingress port */
+	if (gtpu && ipv4_hdr->dst_addr == gtpu_ip && gtpu_ip != 0) {
+		gtpu_hdr = (struct gtpu_hdr *)RTE_PTR_ADD(ipv4_hdr,
+				IPv4_HDR_SIZE + UDP_HDR_SIZE);
+		meta_data->teid = ntohl(gtpu_hdr->teid);
+		meta_data->enb_ipv4 = ntohl(ipv4_hdr->src_addr);
+		meta_data->gtpu_msgtype = gtpu_hdr->msgtype;
+		meta_data->valid |= EPC_META_GTPU;
+
+		if (gtpu_hdr->msgtype != GTP_GPDU)
+			return;
+
+		ue_hdr = (struct ipv4_hdr *)RTE_PTR_ADD(gtpu_hdr,
+				GPDU_HDR_SIZE);
+	}
+
+	ports = (uint16_t *)RTE_PTR_ADD(ue_hdr,
+			(ue_hdr->version_ihl & 0xf) << 2);
+	meta_data->ue_tuple.proto = ue_hdr->next_proto_id;
+	meta_data->ue_tuple.src_addr = ue_hdr->src_addr;
+	meta_data->ue_tuple.dst_addr = ue_hdr->dst_addr;
+	meta_data->ue_tuple.src_port = ports[0];
+	meta_data->ue_tuple.dst_port = ports[1];
+	meta_data->valid |= EPC_META_UE_TUPLE;
+}
+
+/**
+ * Parse the meta data of a burst, RX_CLASSIFY_LANES packets at a time.
+ * Packets that miss the fixed offset signatures and the tail of the burst
+ * go through epc_rx_parse_meta. gtpu_ip as in epc_rx_parse_meta.
+ */
+static inline void
+epc_rx_parse_burst(struct rte_mbuf **pkts, uint32_t n, uint32_t gtpu_ip)
+{
+	struct epc_meta_data *meta_data;
+	uint32_t ipv4_mask, gtpu_mask;
+	uint32_t i, j;
+
+	for (i = 0; i + RX_CLASSIFY_LANES <= n; i += RX_CLASSIFY_LANES) {
+		epc_rx_classify(&pkts[i], &ipv4_mask, &gtpu_mask);
+
+		for (j = 0; j < RX_CLASSIFY_LANES; j++) {
+			meta_data = (struct epc_meta_data *)
+				RTE_MBUF_METADATA_UINT8_PTR(pkts[i + j],
+						META_DATA_OFFSET);
+			if (ipv4_mask & (1 << j))
+				epc_rx_parse_meta_fixed(pkts[i + j], meta_data,
+						gtpu_mask & (1 << j), gtpu_ip);
+			else
+				epc_rx_parse_meta(pkts[i + j], meta_data,
+						gtpu_ip);
 		}
 	}
+
+	for (; i < n; i++) {
+		meta_data = (struct epc_meta_data *)
+			RTE_MBUF_METADATA_UINT8_PTR(pkts[i], META_DATA_OFFSET);
+		epc_rx_parse_meta(pkts[i], meta_data, gtpu_ip);
+	}
+}
+
+/**
+ * set_ue_ipv4_hash of RX_CLASSIFY_LANES UE ips. The CRC32 instructions
+ * of the lanes do not depend on each other and overlap in the core.
+ */
+#if defined(RTE_MACHINE_CPUFLAG_SSE4_2) && !defined(SKIP_LB_HASH_CRC)
+static inline void
+epc_rx_hash_lanes(uint32_t *hash, const uint32_t *ue_ip)
+{
+	uint32_t h0, h1, h2, h3;
+
+	/* same CRC32-C as rte_hash_crc_4byte */
+	h0 = _mm_crc32_u32(PRIME_VALUE, ue_ip[0]);
+	h1 = _mm_crc32_u32(PRIME_VALUE, ue_ip[1]);
+	h2 = _mm_crc32_u32(PRIME_VALUE, ue_ip[2]);
+	h3 = _mm_crc32_u32(PRIME_VALUE, ue_ip[3]);
+	hash[0] = h0;
+	hash[1] = h1;
+	hash[2] = h2;
+	hash[3] = h3;
+}
+#else
+static inline void
+epc_rx_hash_lanes(uint32_t *hash, const uint32_t *ue_ip)
+{
+	uint32_t i;
+
+	for (i = 0; i < RX_CLASSIFY_LANES; i++)
+		set_ue_ipv4_hash(&hash[i], &ue_ip[i]);
+}
+#endif
+
+/**
+ * Set the UE ip hash of the packets sent to a worker port, and with
+ * RX_WORKER_DIRECT the worker port itself. ue_ip holds the UE ip of each
+ * packet of the burst, RX_CLASSIFY_LANES are hashed at a time.
+ */
+static inline void
+epc_rx_set_hash_burst(struct rte_mbuf **pkts, uint32_t n,
+		const uint32_t *ue_ip)
+{
+	struct epc_meta_data *meta_data;
+	uint32_t hash[RX_CLASSIFY_LANES];
+	uint32_t i, j, lanes;
+
+	for (i = 0; i < n; i += lanes) {
+		lanes = RTE_MIN(n - i, (uint32_t)RX_CLASSIFY_LANES);
+		if (lanes == RX_CLASSIFY_LANES)
+			epc_rx_hash_lanes(hash, &ue_ip[i]);
+		else
+			for (j = 0; j < lanes; j++)
+				set_ue_ipv4_hash(&hash[j], &ue_ip[i + j]);
+
+		for (j = 0; j < lanes; j++) {
+			meta_data = (struct epc_meta_data *)
+				RTE_MBUF_METADATA_UINT8_PTR(pkts[i + j],
+						META_DATA_OFFSET);
+			if (likely(!meta_data->port_id))
+				meta_data->ue_ipv4_hash = hash[j];
+#ifdef RX_WORKER_DIRECT
+			epc_rx_set_worker_port(&meta_data->port_id,
+					&meta_data->ue_ipv4_hash);
+#endif
+		}
+	}
+}
+
+#ifndef SKIP_LB_GTPU_AH
+static inline void epc_s1u_rx_set_port_id(struct rte_mbuf *m, uint32_t *ue_ip)
+{
+	struct epc_meta_data *meta_data =
+	    (struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(m,
+							META_DATA_OFFSET);
+	uint32_t *port_id_offset = &meta_data->port_id;
+
+	*port_id_offset = 1;
+	*ue_ip = 0;
+
+	if (likely(meta_data->valid & EPC_META_GTPU)) {
+		/* hash signalling messages on the teid, no UE ip */
+		*ue_ip = (meta_data->valid & EPC_META_UE_TUPLE) ?
+				meta_data->ue_tuple.src_addr :
+				meta_data->teid;
+
+		RTE_LOG(DEBUG, EPC, "gtpu packet\n");
+		*port_id_offset = 0;
+	}
 }
 
 static int epc_s1u_rx_port_in_action_handler(struct rte_pipeline *p,
 					struct rte_mbuf **pkts, uint32_t n,
 					void *arg)
 {
+#ifndef SKIP_RX_META
+	uint32_t ue_ip[RTE_PORT_IN_BURST_SIZE_MAX];
 	uint32_t i;
-
+#endif
+#ifdef INSTMNT
+	struct epc_rx_params *param = arg;
+	uint64_t start_tsc = rte_rdtsc();
+#else
 	RTE_SET_USED(arg);
+#endif
+
 	RTE_SET_USED(p);
 
-	for (i = 0; i < n; i++) {
-		struct rte_mbuf *m = pkts[i];
-#ifdef SKIP_RX_META
-		RTE_SET_USED(m);
-#else
-		epc_s1u_rx_set_port_id(m);
+#ifndef SKIP_RX_META
+	/* GTP-U of the eNB, or of the SGW-U on a PGW-U */
+	epc_rx_parse_burst(pkts, n, app.spgw_cfg == PGWU ?
+			app.s5s8_pgwu_ip : app.s1u_ip);
+	for (i = 0; i < n; i++)
+		epc_s1u_rx_set_port_id(pkts[i], &ue_ip[i]);
+	epc_rx_set_hash_burst(pkts, n, ue_ip);
+#endif
+#ifdef INSTMNT
+	param->instmnt_cycles += rte_rdtsc() - start_tsc;
+	param->instmnt_pkts += n;
 #endif
-	}
 	return 0;
 }
 #endif				/*SKIP_LB_GTPU_AH */
 
-static inline void epc_sgi_rx_set_port_id(struct rte_mbuf *m)
+static inline void epc_sgi_rx_set_port_id(struct rte_mbuf *m, uint32_t *ue_ip)
 {
 	uint8_t *m_data = rte_pktmbuf_mtod(m, uint8_t *);
 	struct epc_meta_data *meta_data =
 	    (struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(m,
 							META_DATA_OFFSET);
 	uint32_t *port_id_offset = &meta_data->port_id;
-	uint32_t *ue_ipv4_hash_offset = &meta_data->ue_ipv4_hash;
-	struct ipv4_hdr *ipv4_hdr =
-	    (struct ipv4_hdr *)&m_data[sizeof(struct ether_hdr)];
-
 	struct ether_hdr *eh = (struct ether_hdr *)&m_data[0];
 	uint32_t ipv4_packet;
 	int bcast;
 
-	ipv4_packet = (eh->ether_type == htons(ETHER_TYPE_IPv4));
+	ipv4_packet = meta_data->valid & EPC_META_IPV4;
 	bcast = is_broadcast_ether_addr(&eh->d_addr);
 
-	if (unlikely(m->ol_flags
-		& (PKT_RX_L4_CKSUM_BAD | PKT_RX_IP_CKSUM_BAD))) {
-		RTE_LOG(DEBUG, EPC, "Bad checksum\n");
-		/* put packets with bad checksum to kernel */
-		ipv4_packet = 0;
-	}
-
 	if (app.spgw_cfg == SGWU) {
 		*port_id_offset = ipv4_packet &&
-				((ipv4_hdr->dst_addr == app.s5s8_sgwu_ip) &&
+				((meta_data->dst_ipv4 == app.s5s8_sgwu_ip) &&
 				 !bcast) ? 0 : 1;
 	} else {
 		*port_id_offset = ipv4_packet &&
-				((ipv4_hdr->dst_addr != app.sgi_ip) &&
+				((meta_data->dst_ipv4 != app.sgi_ip) &&
 				 !bcast) ? 0 : 1;
 	}
 
+	*ue_ip = 0;
 	if (likely(!*port_id_offset)) {
-		const uint32_t *p = (const uint32_t *)&ipv4_hdr->dst_addr;
+		/* UE is the inner destination of S5/S8 G-PDUs */
+		*ue_ip = (meta_data->valid & EPC_META_UE_TUPLE) ?
+				meta_data->ue_tuple.dst_addr :
+				meta_data->dst_ipv4;
 
 		RTE_LOG(DEBUG, EPC, "SGI packet\n");
-
-		set_ue_ipv4_hash(ue_ipv4_hash_offset, p);
 	}
 }
 
@@ -170,23 +504,36 @@ epc_sgi_rx_port_in_action_handler(struct rte_pipeline *p,
 					struct rte_mbuf **pkts,
 					  uint32_t n, void *arg)
 {
+#ifndef SKIP_RX_META
+	uint32_t ue_ip[RTE_PORT_IN_BURST_SIZE_MAX];
 	uint32_t i;
-
+#endif
+#ifdef INSTMNT
+	struct epc_rx_params *param = arg;
+	uint64_t start_tsc = rte_rdtsc();
+#else
 	RTE_SET_USED(arg);
-	RTE_SET_USED(p);
-	for (i = 0; i < n; i++) {
-		struct rte_mbuf *m = pkts[i];
-#ifdef SKIP_RX_META
+#endif
 
-		RTE_SET_USED(m);
-#else
-		epc_sgi_rx_set_port_id(m);
+	RTE_SET_USED(p);
+#ifndef SKIP_RX_META
+	/* only the S5/S8 side of a SGW-U carries GTP-U, the UE of SGi
+	 * packets is their outer destination */
+	epc_rx_parse_burst(pkts, n, app.spgw_cfg == SGWU ?
+			app.s5s8_sgwu_ip : 0);
+	for (i = 0; i < n; i++)
+		epc_sgi_rx_set_port_id(pkts[i], &ue_ip[i]);
+	epc_rx_set_hash_burst(pkts, n, ue_ip);
+#endif
+#ifdef INSTMNT
+	param->instmnt_cycles += rte_rdtsc() - start_tsc;
+	param->instmnt_pkts += n;
 #endif
-	}
 	return 0;
 }
 
-void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id)
+void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id,
+		uint16_t queue_id)
 {
 	struct rte_pipeline *p;
 	unsigned i;
@@ -220,7 +567,9 @@ void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id)
 
 	memset(param, 0, sizeof(*param));
 
-	snprintf((char *)param->name, PIPE_NAME_SIZE, "epc_rx_%d", port_id);
+	snprintf((char *)param->name, PIPE_NAME_SIZE, "epc_rx_%d_%d", port_id,
+			queue_id);
+	param->queue_id = queue_id;
 	param->pipeline_params.socket_id = rte_socket_id();
 	param->pipeline_params.name = param->name;
 	param->pipeline_params.offset_port_id = META_DATA_OFFSET;
@@ -240,12 +589,13 @@ void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id)
 
 	struct rte_port_ethdev_reader_params port_ethdev_params = {
 		.port_id = epc_app.ports[port_id],
-		.queue_id = 0,
+		.queue_id = queue_id,
 	};
 
 	struct rte_pipeline_port_in_params port_params = {
 		.ops = &rte_port_ethdev_reader_ops,
 		.arg_create = (void *)&port_ethdev_params,
+		.arg_ah = param,
 		.burst_size = epc_app.burst_size_rx_read,
 	};
 #ifndef SKIP_LB_GTPU_AH
@@ -260,7 +610,11 @@ void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id)
 			  __func__, port_id);
 	}
 
-	for (i = 0; i < NUM_SPGW_PORTS; i++) {
+	if (RX_NUM_PORT_OUT > DP_MAX_LCORE)
+		rte_panic("%s: Too many workers %u for rx port %d\n",
+				__func__, epc_app.num_workers, port_id);
+
+	for (i = 0; i < RX_NUM_PORT_OUT; i++) {
 		struct rte_port_ring_writer_params port_ring_params = {
 			.tx_burst_sz = epc_app.burst_size_rx_write,
 		};
@@ -274,6 +628,15 @@ void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id)
 		 /* push pkts on mct core rings.tx_core reads from these*/
 		if (1)
 			port_ring_params.ring = epc_app.ring_tx[epc_app.core_mct][port_id ^ 1];
+#elif defined(RX_WORKER_DIRECT)
+		/* push pkts straight on the owning worker ring */
+		if (i < epc_app.num_workers)
+			port_ring_params.ring =
+				epc_app.epc_work_rx[epc_app.worker_cores[i]][port_id];
+#ifdef RETA_BALANCE
+		else if (i == RX_HOLD_PORT)
+			port_ring_params.ring = epc_app.reta_hold_rx[port_id];
+#endif
 #else
 		if (i == 0)
 			port_ring_params.ring = epc_app.epc_lb_rx[port_id];
@@ -281,6 +644,16 @@ void epc_rx_init(struct epc_rx_params *param, int core, uint8_t port_id)
 		else
 			port_ring_params.ring = epc_app.epc_mct_rx[port_id];
 
+		/* rings shared by the pipelines of several RX queues need the
+		 * multi producer writer, the ring flags alone are not enough */
+		if (epc_app.n_rx_queues > 1)
+			port_params.ops = &rte_port_ring_multi_writer_ops;
+#if defined(RX_WORKER_DIRECT) && defined(RETA_BALANCE)
+		/* the RETA balancer also enqueues on the worker rings */
+		if (i < epc_app.num_workers)
+			port_params.ops = &rte_port_ring_multi_writer_ops;
+#endif
+
 		if (rte_pipeline_port_out_create
 		    (p, &port_params, &param->port_out_id[i])) {
 			rte_panic
@@ -348,5 +721,8 @@ void epc_rx(void *args)
 	if (++param->flush_count >= param->flush_max) {
 		rte_pipeline_flush(param->pipeline);
 		param->flush_count = 0;
+#ifdef RETA_BALANCE
+		param->quiesce_count++;
+#endif
 	}
 }
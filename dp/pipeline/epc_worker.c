@@ -36,6 +36,7 @@
 
 #include "epc_packet_framework.h"
 #include "main.h"
+#include "flow_cache.h"
 
 #define BUILD_WK_ARG(x, y) ((x << 8) | (y & 0xff))
 #define WK_GET_PORT(x) (x >> 8)
@@ -51,8 +52,37 @@ static inline int port_in_func(struct rte_pipeline *p, struct rte_mbuf **pkts,
 	int port = WK_GET_PORT(arg);
 	int wk_index = WK_GET_INDEX(arg);
 	epc_packet_handler f = epc_worker_func[port];
-
+#ifdef INSTMNT
+	struct epc_worker_params *wk_params = &epc_app.worker[wk_index];
+	uint64_t start_tsc = rte_rdtsc();
+	int ret;
+#endif
+#ifdef RETA_BALANCE
+	uint32_t *reta_pkts = epc_app.worker[wk_index].reta_pkts;
+	uint32_t i;
+#endif
+
+#ifdef RETA_BALANCE
+	/* measure the load of each RETA bucket for the balancer */
+	prefetch_pkts_start(pkts, n);
+	for (i = 0; i < n; i++) {
+		struct epc_meta_data *meta_data =
+			(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(
+					pkts[i], META_DATA_OFFSET);
+
+		prefetch_pkts_ahead(pkts, n, i);
+		reta_pkts[RETA_BUCKET(meta_data->ue_ipv4_hash)]++;
+	}
+#endif
+
+#ifdef INSTMNT
+	ret = f(p, pkts, n, wk_index);
+	wk_params->instmnt_cycles += rte_rdtsc() - start_tsc;
+	wk_params->instmnt_pkts += n;
+	return ret;
+#else
 	return f(p, pkts, n, wk_index);
+#endif
 }
 
 void epc_worker_core_init(struct epc_worker_params *param, int core,
@@ -63,6 +93,7 @@ void epc_worker_core_init(struct epc_worker_params *param, int core,
 	char name[32];
 
 	memset(param, 0, sizeof(*param));
+	param->qsbr_period = QSBR_OFFLINE;
 
 	snprintf((char *)param->name, PIPE_NAME_SIZE, "epc_worker_%d", core);
 	param->pipeline_params.socket_id = rte_socket_id();
@@ -73,10 +104,18 @@ void epc_worker_core_init(struct epc_worker_params *param, int core,
 		rte_panic("Unable to configure the pipeline\n");
 	snprintf(name, sizeof(name), "notify_%d", core);
 
+#ifdef RETA_BALANCE
+	/* workers forward notifications of migrated buckets to the owner */
+	param->notify_ring =
+		rte_ring_create(name, NOTIFY_RING_SIZE,
+			rte_socket_id(),
+			RING_F_SC_DEQ);
+#else
 	param->notify_ring =
 		rte_ring_create(name, NOTIFY_RING_SIZE,
 			rte_socket_id(),
 			RING_F_SP_ENQ | RING_F_SC_DEQ);
+#endif
 
 	snprintf(name, sizeof(name), "ring_container_%d", core);
 	param->dl_ring_container =
@@ -88,6 +127,12 @@ void epc_worker_core_init(struct epc_worker_params *param, int core,
 				DL_PKT_POOL_CACHE_SIZE, 0,
 				RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
 
+#ifdef FLOW_CACHE
+	snprintf(name, sizeof(name), "flow_cache_%d", core);
+	param->flow_cache = flow_cache_create(name,
+			rte_lcore_to_socket_id(core));
+#endif
+
 	for (i = 0; i < epc_app.n_ports; i++) {
 		struct rte_port_ring_reader_params port_ring_params = {
 			.ring = epc_app.epc_work_rx[core][i],
@@ -127,6 +172,19 @@ void epc_worker_core_init(struct epc_worker_params *param, int core,
 	}
 
 	for (i = 0; i < epc_app.n_ports; i++) {
+#ifdef TX_WORKER_DIRECT
+		/* transmit on the NIC tx queue owned by this worker */
+		struct rte_port_ethdev_writer_params port_ethdev_params = {
+			.port_id = epc_app.ports[i],
+			.queue_id = WORKER_TX_QUEUE(worker_index),
+			.tx_burst_sz = epc_app.burst_size_worker_write,
+		};
+
+		struct rte_pipeline_port_out_params port_params = {
+			.ops = &rte_port_ethdev_writer_ops,
+			.arg_create = (void *)&port_ethdev_params,
+		};
+#else
 		struct rte_port_ring_writer_params port_ring_params = {
 			.ring = epc_app.ring_tx[core][i],
 			.tx_burst_sz = epc_app.burst_size_worker_write,
@@ -136,6 +194,7 @@ void epc_worker_core_init(struct epc_worker_params *param, int core,
 			.ops = &rte_port_ring_writer_ops,
 			.arg_create = (void *)&port_ring_params,
 		};
+#endif
 
 		if (rte_pipeline_port_out_create
 				(p, &port_params, &param->port_out_id[i])) {
@@ -224,6 +283,10 @@ void epc_worker_core(void *args)
 		rte_pipeline_flush(param->pipeline);
 		param->flush_count = 0;
 	}
+	qsbr_quiescent(param);
+#ifdef RETA_BALANCE
+	param->quiesce_count++;
+#endif
 }
 
 void register_worker(epc_packet_handler f, int port)
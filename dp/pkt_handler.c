@@ -27,68 +27,183 @@
 #include "main.h"
 #include "acl.h"
 #include "interface.h"
+#include "gtpu.h"
+#include "flow_cache.h"
 
 #ifdef PCAP_GEN
 extern pcap_dumper_t *pcap_dumper_east;
 extern pcap_dumper_t *pcap_dumper_west;
 #endif /* PCAP_GEN */
+/**
+ * Function to send the downlink packets buffered for a bearer while
+ * it was idle.
+ */
+static void
+flush_dl_ring(struct dp_session_info *data, int wk_index)
+{
+	struct rte_mbuf *pkts[MAX_BURST_SZ];
+	struct dp_session_info *sess_info[MAX_BURST_SZ];
+	struct dp_sdf_per_bearer_info *sdf_info[MAX_BURST_SZ];
+	struct epc_worker_params *wk_params = &epc_app.worker[wk_index];
+	struct rte_ring *ring = data->dl_ring;
+	uint64_t pkt_mask, pkts_queue_mask = 0;
+	unsigned int ret, i;
+
+	if (!ring)
+		return; /* No dl ring*/
+
+	/* de-queue this ring and send the downlink pkts*/
+	while ((ret = rte_ring_sc_dequeue_burst(ring, (void **)pkts,
+				MAX_BURST_SZ)) != 0) {
+		pkt_mask = (~0LLU) >> (64 - ret);
+		for (i = 0; i < ret; ++i)
+			sess_info[i] = data;
+		gtpu_encap(&sess_info[0], pkts, ret,
+				&pkt_mask, &pkts_queue_mask);
+		if (pkts_queue_mask != 0)
+			RTE_LOG(ERR, DP, "Something is wrong!!, the "
+					"session still doesnt hv "
+					"enb teid\n");
+		update_nexthop_info(pkts, ret, &pkt_mask, app.s1u_port,
+				&sdf_info[0]);
+		for (i = 0; i < ret; ++i)
+			rte_pipeline_port_out_packet_insert(wk_params->pipeline,
+					app.s1u_port, pkts[i]);
+	}
+
+	data->dl_ring = NULL;
+	if (rte_ring_enqueue(wk_params->dl_ring_container, ring) ==
+			-ENOBUFS) {
+		RTE_LOG(ERR, DP, "Can't put ring back, so free it\n");
+		rte_ring_free(ring);
+	}
+}
+
+/**
+ * Function to apply the new downlink info of a bearer on its owner
+ * worker: outer headers, then the session state. The replaced headers
+ * are left in msg for the iface core to free.
+ */
+static void
+sess_ctrl_apply(struct dp_session_info *data,
+		struct sess_ctrl_msg *msg, int wk_index)
+{
+	uint8_t *hdr = data->encap_hdr;
+
+	data->dl_s1_info = msg->dl_s1_info;
+	/* bursts see either the old or the new headers, never a mix */
+	rte_wmb();
+	data->encap_hdr = msg->encap_hdr;
+	msg->encap_hdr = hdr;
+
+	if (msg->op == SESS_CTRL_CREATE) {
+		/* bearer created again, e.g. restored */
+		data->sess_state = msg->sess_state;
+		if (data->sess_state == CONNECTED)
+			flush_dl_ring(data, wk_index);
+		return;
+	}
+
+	if (!data->dl_s1_info.enb_teid) {
+		if (data->sess_state == CONNECTED)
+			data->sess_state = IDLE;
+		return;
+	}
+
+	switch (data->sess_state) {
+	case IDLE:
+		data->sess_state = CONNECTED;
+		break;
+
+	case IN_PROGRESS:
+		/* DDN answered, release what was buffered meanwhile */
+		data->sess_state = CONNECTED;
+		flush_dl_ring(data, wk_index);
+		break;
+
+	default:
+		RTE_LOG(DEBUG, DP, "No state change");
+	}
+}
+
+/**
+ * Function to release the dl ring of a deleted bearer on its owner
+ * worker, dropping what was buffered while it was idle.
+ */
+static void
+release_dl_ring(struct dp_session_info *data, int wk_index)
+{
+	struct rte_mbuf *pkts[MAX_BURST_SZ];
+	struct epc_worker_params *wk_params = &epc_app.worker[wk_index];
+	struct rte_ring *ring = data->dl_ring;
+	unsigned int ret, i, count = 0;
+
+	if (!ring)
+		return; /* No dl ring*/
+
+	while ((ret = rte_ring_sc_dequeue_burst(ring, (void **)pkts,
+				MAX_BURST_SZ)) != 0) {
+		for (i = 0; i < ret; ++i)
+			rte_pktmbuf_free(pkts[i]);
+		count += ret;
+	}
+
+	data->dl_ring = NULL;
+	if (rte_ring_enqueue(wk_params->dl_ring_container, ring) ==
+			-ENOBUFS) {
+		RTE_LOG(ERR, DP, "Can't put ring back, so free it - "
+				"dropped %u pkts\n", count);
+		rte_ring_free(ring);
+	}
+}
+
 int
 notification_handler(struct rte_pipeline *p,
 	struct rte_mbuf **pkts,
 	uint32_t n,
 	void *arg)
 {
-	struct rte_mbuf *buf_pkt = NULL;
-	uint64_t pkt_mask = 0, pkts_queue_mask = 0;
-	struct rte_ring *ring;
-	int64_t *sess;
-	unsigned int ret = 32, num = 32, i;
+	struct sess_ctrl_msg *msg;
 	struct dp_session_info *data;
-	struct dp_session_info *sess_info[MAX_BURST_SZ];
 	int wk_index = (uintptr_t)arg;
-	struct epc_worker_params *wk_params = &epc_app.worker[wk_index];
-	struct dp_sdf_per_bearer_info *sdf_info[MAX_BURST_SZ];
+	unsigned int i;
 
-	for (i = 0; i < n; ++i) {
-		buf_pkt = pkts[i];
-		sess = rte_pktmbuf_mtod(buf_pkt, uint64_t *);
-		data = get_session_data(*sess, 1);
-
-		if (data == NULL)
-			continue;
+	RTE_SET_USED(p);
 
-		rte_ctrlmbuf_free(buf_pkt);
-		ring = data->dl_ring;
-		if (data->sess_state != CONNECTED)
-			data->sess_state = CONNECTED;
-
-		if (!ring)
-			continue; /* No dl ring*/
-		/* de-queue this ring and send the downlink pkts*/
-		while (ret) {
-			ret = rte_ring_sc_dequeue_burst(ring,
-					(void **)pkts, num);
-			pkt_mask = (1 << ret) - 1;
-			for (i = 0; i < ret; ++i)
-				sess_info[i] = data;
-			gtpu_encap(&sess_info[0], (struct rte_mbuf **)pkts, ret,
-					&pkt_mask, &pkts_queue_mask);
-			if (pkts_queue_mask != 0)
-				RTE_LOG(ERR, DP, "Something is wrong!!, the "
-						"session still doesnt hv "
-						"enb teid\n");
-			update_nexthop_info((struct rte_mbuf **)pkts, num,
-					&pkt_mask, app.s1u_port, &sdf_info[0]);
-			for (i = 0; i < ret; ++i)
-				rte_pipeline_port_out_packet_insert(
-					epc_app.worker[wk_index].pipeline,
-					app.s1u_port, pkts[i]);
-		}
-		if (rte_ring_enqueue(wk_params->dl_ring_container, ring) ==
-				ENOBUFS) {
-			RTE_LOG(ERR, DP, "Can't put ring back, so free it\n");
-			rte_ring_free(ring);
+	for (i = 0; i < n; ++i) {
+		msg = rte_pktmbuf_mtod(pkts[i], struct sess_ctrl_msg *);
+		/* the iface core frees the bearer only once its delete is
+		 * done, so data outlives every command queued for it */
+		data = msg->data;
+#ifdef RETA_BALANCE
+		{
+			uint32_t ue_ip = rte_cpu_to_be_32(
+					data->ue_addr.u.ipv4_addr);
+			uint32_t hash, owner;
+
+			/* the RETA bucket of this UE moved to another worker
+			 * after the notification was queued, forward it. It
+			 * is never applied here: if the owner ring is full it
+			 * is queued again on this ring for a later poll */
+			set_ue_ipv4_hash(&hash, &ue_ip);
+			set_worker_core_id(&owner, &hash);
+			if (owner != (uint32_t)wk_index) {
+				while (rte_ring_enqueue(epc_app.worker[owner].
+						notify_ring, pkts[i]) == -ENOBUFS &&
+						rte_ring_enqueue(epc_app.
+						worker[wk_index].notify_ring,
+						pkts[i]) == -ENOBUFS)
+					; /* both full, retry */
+				continue;
+			}
 		}
+#endif
+
+		if (msg->op == SESS_CTRL_DELETE)
+			release_dl_ring(data, wk_index);
+		else
+			sess_ctrl_apply(data, msg, wk_index);
+		sess_ctrl_done(pkts[i]);
 	}
 
 	return 0;
@@ -105,7 +220,7 @@ sgw_s5_s8_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts,
 	pkts_mask = (~0LLU) >> (64 - n);
 
 	/* Get downlink session info */
-	dl_sess_info_get(pkts, n, &pkts_mask, &sdf_info[0], &si[0]);
+	dl_sess_info_get_sgwu(pkts, n, &pkts_mask, &sdf_info[0], &si[0]);
 
 	update_enb_info(pkts, n, &pkts_mask, &sdf_info[0]);
 
@@ -122,86 +237,275 @@ sgw_s5_s8_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts,
 	return 0;
 }
 
-void
-filter_ul_traffic(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
-		int wk_index, uint64_t *pkts_mask)
+/**
+ * SDF and ADC rules, PCC decisions and bearers of a burst.
+ */
+struct flow_results {
+	/* rules of the ACL, the ADC rule before the domain lookup */
+	uint32_t sdf_rule_id[MAX_BURST_SZ];
+	uint32_t adc_rule_id[MAX_BURST_SZ];
+	struct pcc_burst_info sdf_info;
+	struct pcc_burst_info adc_info;
+	void *adc_ue_info[MAX_BURST_SZ];
+	struct dp_sdf_per_bearer_info *bearer[MAX_BURST_SZ];
+	/* session of the bearer, downlink only */
+	struct dp_session_info *si[MAX_BURST_SZ];
+};
+
+/**
+ * Resolve the SDF and ADC rules, their PCC decisions and the bearer of
+ * each packet. Packets without a bearer are reset in pkts_mask.
+ */
+static DP_ALWAYS_INLINE void
+resolve_flows(struct rte_mbuf **pkts, uint32_t n, uint64_t *pkts_mask,
+		struct flow_results *r, const uint32_t flow,
+		const enum dp_config cfg)
 {
-	uint32_t *sdf_rule_id = NULL;
-	struct pcc_id_precedence sdf_info[MAX_BURST_SZ];
-	struct pcc_id_precedence adc_info[MAX_BURST_SZ];
-	void *adc_ue_info[MAX_BURST_SZ] = {NULL};
-	struct dp_sdf_per_bearer_info *sdf_bearer_info[MAX_BURST_SZ] = {NULL};
-	uint64_t adc_pkts_mask = 0;
-	uint32_t *adc_rule_a;
+	uint32_t adc_rule_a[MAX_BURST_SZ];
 	uint32_t adc_rule_b[MAX_BURST_SZ];
+	uint32_t i;
 
-	sdf_rule_id = sdf_lookup(pkts, n);
+	/* SDF and ADC table lookup*/
+	if (flow == UL_FLOW)
+		ul_filter_lookup(pkts, n, &r->sdf_rule_id[0],
+				&r->adc_rule_id[0]);
+	else
+		dl_filter_lookup(pkts, n, &r->sdf_rule_id[0],
+				&r->adc_rule_id[0]);
 
-	filter_pcc_entry_lookup(FILTER_SDF, sdf_rule_id, n, &sdf_info[0]);
-
-	/* ADC table lookup*/
-	adc_rule_a = adc_ul_lookup(pkts, n);
+	filter_pcc_entry_lookup(FILTER_SDF, r->sdf_rule_id, n, &r->sdf_info);
 
 	/* ADC Hash table lookup*/
-	adc_hash_lookup(pkts, n, &adc_rule_b[0], UL_FLOW);
+	adc_hash_lookup(pkts, n, &adc_rule_b[0], flow);
 
 	/* if adc rule is found in adc domain name table (from hash lookup),
 	 * overwrite the result from filter table.	*/
+	memcpy(adc_rule_a, r->adc_rule_id, n * sizeof(adc_rule_a[0]));
 	update_adc_rid_from_domain_lookup(adc_rule_a, &adc_rule_b[0], n);
 
 	/* get ADC UE info struct*/
-	adc_ue_info_get(pkts, n, adc_rule_a, &adc_ue_info[0], UL_FLOW);
+	if (flow == UL_FLOW) {
+		adc_ue_info_get(pkts, n, adc_rule_a, &r->adc_ue_info[0],
+				UL_FLOW);
+	} else {
+		for (i = 0; i < n; i++)
+			r->adc_ue_info[i] = NULL;
+	}
+
+	filter_pcc_entry_lookup(FILTER_ADC, adc_rule_a, n, &r->adc_info);
+
+	if (flow == UL_FLOW) {
+		if (cfg == PGWU)
+			ul_sess_info_get_pgwu(pkts, n, pkts_mask,
+					&r->bearer[0]);
+		else
+			ul_sess_info_get_spgwu(pkts, n, pkts_mask,
+					&r->bearer[0]);
+	} else {
+		if (cfg == PGWU)
+			dl_sess_info_get_pgwu(pkts, n, pkts_mask,
+					&r->bearer[0], &r->si[0]);
+		else
+			dl_sess_info_get_spgwu(pkts, n, pkts_mask,
+					&r->bearer[0], &r->si[0]);
+	}
+}
+
+#ifdef FLOW_CACHE
+/**
+ * Resolve a burst with the flow cache of the worker. Hits take the results
+ * of their flow, misses are resolved and cached if they have a bearer.
+ * Packets already reset in pkts_mask or without a UE 5-tuple are resolved
+ * but not cached.
+ */
+static DP_ALWAYS_INLINE void
+flow_cache_resolve(struct rte_mbuf **pkts, uint32_t n, int wk_index,
+		uint64_t *pkts_mask, struct flow_results *r,
+		const uint32_t flow, const enum dp_config cfg)
+{
+	struct flow_cache *fc = epc_app.worker[wk_index].flow_cache;
+	struct flow_key key[MAX_BURST_SZ];
+	struct flow_cache_entry *ent[MAX_BURST_SZ];
+	struct rte_mbuf *miss_pkts[MAX_BURST_SZ];
+	uint32_t miss_idx[MAX_BURST_SZ];
+	struct flow_results m;
+	struct flow_cache_entry *e;
+	struct epc_meta_data *meta_data;
+	uint64_t lookup_mask = 0, miss_mask = 0;
+	uint64_t hit_mask, epoch;
+	uint32_t i, j, nb_miss = 0;
+
+	/* first stage of the downlink */
+	if (flow == DL_FLOW)
+		prefetch_pkts_start(pkts, n);
+	for (i = 0; i < n; i++) {
+		if (flow == DL_FLOW)
+			prefetch_pkts_ahead(pkts, n, i);
+		meta_data =
+			(struct epc_meta_data *)RTE_MBUF_METADATA_UINT8_PTR(pkts[i],
+			META_DATA_OFFSET);
+		if (!ISSET_BIT(*pkts_mask, i) ||
+				!(meta_data->valid & EPC_META_UE_TUPLE))
+			continue;
+
+		flow_key_set(&key[i], meta_data->ue_tuple.proto,
+				meta_data->ue_tuple.src_addr,
+				meta_data->ue_tuple.dst_addr,
+				meta_data->ue_tuple.src_port,
+				meta_data->ue_tuple.dst_port,
+				(flow == UL_FLOW) ? meta_data->teid : 0, flow);
+		SET_BIT(lookup_mask, i);
+	}
+
+	hit_mask = flow_cache_lookup(fc, key, n, lookup_mask, ent, &epoch);
+
+	for (i = 0; i < n; i++) {
+		if (!ISSET_BIT(hit_mask, i)) {
+			miss_idx[nb_miss] = i;
+			miss_pkts[nb_miss] = pkts[i];
+			if (ISSET_BIT(*pkts_mask, i))
+				SET_BIT(miss_mask, nb_miss);
+			nb_miss++;
+			continue;
+		}
+
+		e = ent[i];
+		r->sdf_rule_id[i] = e->sdf_rule_id;
+		r->adc_rule_id[i] = e->adc_rule_id;
+		acl_rule_stats[e->sdf_rule_id]++;
+		acl_rule_stats[e->adc_rule_id]++;
+		r->sdf_info.pcc_id[i] = e->sdf_pcc_id;
+		r->sdf_info.precedence[i] = e->sdf_precedence;
+		r->sdf_info.gate_status[i] = e->sdf_gate_status;
+		r->adc_info.pcc_id[i] = e->adc_pcc_id;
+		r->adc_info.precedence[i] = e->adc_precedence;
+		r->adc_info.gate_status[i] = e->adc_gate_status;
+		r->adc_ue_info[i] = e->adc_ue_info;
+		r->bearer[i] = e->bearer;
+	}
+
+	if (nb_miss)
+		resolve_flows(miss_pkts, nb_miss, &miss_mask, &m, flow, cfg);
+
+	for (j = 0; j < nb_miss; j++) {
+		i = miss_idx[j];
+		r->sdf_rule_id[i] = m.sdf_rule_id[j];
+		r->adc_rule_id[i] = m.adc_rule_id[j];
+		r->sdf_info.pcc_id[i] = m.sdf_info.pcc_id[j];
+		r->sdf_info.precedence[i] = m.sdf_info.precedence[j];
+		r->sdf_info.gate_status[i] = m.sdf_info.gate_status[j];
+		r->adc_info.pcc_id[i] = m.adc_info.pcc_id[j];
+		r->adc_info.precedence[i] = m.adc_info.precedence[j];
+		r->adc_info.gate_status[i] = m.adc_info.gate_status[j];
+		r->adc_ue_info[i] = m.adc_ue_info[j];
+		r->bearer[i] = m.bearer[j];
+		if (flow == DL_FLOW)
+			r->si[i] = m.si[j];
+
+		if (!ISSET_BIT(miss_mask, j)) {
+			RESET_BIT(*pkts_mask, i);
+			continue;
+		}
+		if (!ISSET_BIT(lookup_mask, i))
+			continue;
+
+		e = ent[i];
+		e->sdf_precedence = m.sdf_info.precedence[j];
+		e->sdf_gate_status = m.sdf_info.gate_status[j];
+		e->adc_precedence = m.adc_info.precedence[j];
+		e->adc_gate_status = m.adc_info.gate_status[j];
+		e->sdf_pcc_id = m.sdf_info.pcc_id[j];
+		e->adc_pcc_id = m.adc_info.pcc_id[j];
+		e->sdf_rule_id = m.sdf_rule_id[j];
+		e->adc_rule_id = m.adc_rule_id[j];
+		e->bearer = m.bearer[j];
+		e->adc_ue_info = m.adc_ue_info[j];
+		flow_cache_insert(e, &key[i], epoch);
+	}
+
+	if (flow == UL_FLOW)
+		return;
+
+	/* session of the downlink hits, as dl_sess_info_get */
+	for (i = 0; i < n; i++) {
+		if (!ISSET_BIT(hit_mask, i))
+			continue;
+		r->si[i] = r->bearer[i]->bear_sess_info;
+		rte_prefetch0(r->si[i]);
+	}
+}
+#endif	/* FLOW_CACHE */
 
-	filter_pcc_entry_lookup(FILTER_ADC, adc_rule_a, n, &adc_info[0]);
+static DP_ALWAYS_INLINE void
+filter_ul_traffic(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
+		int wk_index, uint64_t *pkts_mask, const enum dp_config cfg)
+{
+	struct flow_results r;
+	uint64_t adc_pkts_mask = 0;
+	uint64_t gate_mask;
+
+#ifdef FLOW_CACHE
+	flow_cache_resolve(pkts, n, wk_index, pkts_mask, &r, UL_FLOW, cfg);
+#else
+	resolve_flows(pkts, n, pkts_mask, &r, UL_FLOW, cfg);
+#endif
 
-	pcc_gating(&sdf_info[0], &adc_info[0], n, pkts_mask);
+	gate_mask = pcc_gating(&r.sdf_info, &r.adc_info, n, pkts_mask);
 
-	ul_sess_info_get(pkts, n, pkts_mask, &sdf_bearer_info[0]);
+	/* gated pkts of ADC UEs, the SDF CDR takes the others */
+	update_gate_cdr(&r.adc_ue_info[0], pkts, gate_mask, UL_FLOW);
 
-	update_sdf_cdr(&adc_ue_info[0], &sdf_bearer_info[0], pkts, n,
+	update_sdf_cdr(&r.adc_ue_info[0], &r.bearer[0], pkts, n,
 			&adc_pkts_mask, pkts_mask, UL_FLOW);
 
 	return;
 }
 
 int
-s1u_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
-		int wk_index)
+s1u_pkt_handler_spgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index)
 {
 	struct dp_sdf_per_bearer_info *sdf_info[MAX_BURST_SZ];
 	uint64_t pkts_mask;
-	uint32_t next_port;
 
 	pkts_mask = (~0LLU) >> (64 - n);
 
-	switch(app.spgw_cfg) {
-		case SPGWU: {
-			/* Decap GTPU and update meta data*/
-			gtpu_decap(pkts, n, &pkts_mask);
+	/* Decap GTPU and update meta data*/
+	gtpu_decap_spgwu(pkts, n, &pkts_mask);
 
-			/*Apply adc, sdf, pcc filters on uplink traffic*/
-			filter_ul_traffic(p, pkts, n, wk_index, &pkts_mask);
+	/*Apply adc, sdf, pcc filters on uplink traffic*/
+	filter_ul_traffic(p, pkts, n, wk_index, &pkts_mask, SPGWU);
 
-			/*Set next hop directly to SGi*/
-			next_port = app.sgi_port;
-			break;
-		}
+	/* Update nexthop L2 header, next hop directly to SGi*/
+	update_nexthop_info(pkts, n, &pkts_mask, app.sgi_port, &sdf_info[0]);
 
-		case SGWU: {
-			ul_sess_info_get(pkts, n, &pkts_mask, &sdf_info[0]);
+#ifdef PCAP_GEN
+	dump_pcap(pkts, n, pcap_dumper_west);
+#endif /* PCAP_GEN */
 
-			/* Set next hop IP to S5/S8 PGW port*/
-			next_port = app.s5s8_sgwu_port;
-			update_nexts5s8_info(pkts, n, &pkts_mask, &sdf_info[0]);
-			break;
-		}
+	/* Intimate the packets to be dropped*/
+	rte_pipeline_ah_packet_drop(p, ~pkts_mask);
 
-		default:
-			break;
-	}
+	return 0;
+}
+
+int
+s1u_pkt_handler_sgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index)
+{
+	struct dp_sdf_per_bearer_info *sdf_info[MAX_BURST_SZ];
+	uint64_t pkts_mask;
+
+	pkts_mask = (~0LLU) >> (64 - n);
+
+	ul_sess_info_get_sgwu(pkts, n, &pkts_mask, &sdf_info[0]);
+
+	/* Set next hop IP to S5/S8 PGW port*/
+	update_nexts5s8_info_sgwu(pkts, n, &pkts_mask, &sdf_info[0]);
 
 	/* Update nexthop L2 header*/
-	update_nexthop_info(pkts, n, &pkts_mask, next_port, &sdf_info[0]);
+	update_nexthop_info(pkts, n, &pkts_mask, app.s5s8_sgwu_port,
+			&sdf_info[0]);
 
 #ifdef PCAP_GEN
 	dump_pcap(pkts, n, pcap_dumper_west);
@@ -222,10 +526,10 @@ pgw_s5_s8_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts,
 
 	pkts_mask = (~0LLU) >> (64 - n);
 
-	gtpu_decap(pkts, n, &pkts_mask);
+	gtpu_decap_pgwu(pkts, n, &pkts_mask);
 
 	/*Apply adc, sdf, pcc filters on uplink traffic*/
-	filter_ul_traffic(p, pkts, n, wk_index, &pkts_mask);
+	filter_ul_traffic(p, pkts, n, wk_index, &pkts_mask, PGWU);
 
 	/* Update nexthop L2 header*/
 	update_nexthop_info(pkts, n, &pkts_mask, app.sgi_port, &sdf_info[0]);
@@ -240,47 +544,39 @@ pgw_s5_s8_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts,
 	return 0;
 }
 
-static uint64_t
+static DP_ALWAYS_INLINE uint64_t
 filter_dl_traffic(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
 		int wk_index, struct dp_sdf_per_bearer_info *sdf_info[],
-		struct dp_session_info *si[])
+		struct dp_session_info *si[], const enum dp_config cfg)
 {
-	uint32_t *sdf_rule_id = NULL;
+	struct flow_results r;
 	uint64_t pkts_mask;
-	struct pcc_id_precedence sdf_info_dl[MAX_BURST_SZ];
-	struct pcc_id_precedence adc_info_dl[MAX_BURST_SZ];
 	uint64_t adc_pkts_mask = 0;
-	void *adc_ue_info[MAX_BURST_SZ] = {NULL};
+	uint64_t gate_mask;
+	uint32_t i;
 
 	pkts_mask = (~0LLU) >> (64 - n);
 
-	sdf_rule_id = sdf_lookup(pkts, n);
-
-	filter_pcc_entry_lookup(FILTER_SDF, sdf_rule_id, n, &sdf_info_dl[0]);
-
-	uint32_t *adc_rule_a;
-	uint32_t adc_rule_b[MAX_BURST_SZ];
-
-	/* ADC table lookup*/
-	adc_rule_a = adc_dl_lookup(pkts, n);
+#ifdef FLOW_CACHE
+	flow_cache_resolve(pkts, n, wk_index, &pkts_mask, &r, DL_FLOW, cfg);
+#else
+	resolve_flows(pkts, n, &pkts_mask, &r, DL_FLOW, cfg);
+#endif
 
 	/* Identify the DNS rule and update the meta*/
-	update_dns_meta(pkts, n, adc_rule_a);
-
-	/* ADC Hash table lookup*/
-	adc_hash_lookup(pkts, n, &adc_rule_b[0], DL_FLOW);
-
-	/* if adc rule is found in adc domain name table (from hash lookup),
-	 * overwrite the result from filter table.	*/
-	update_adc_rid_from_domain_lookup(adc_rule_a, &adc_rule_b[0], n);
+	update_dns_meta(pkts, n, r.adc_rule_id);
 
-	filter_pcc_entry_lookup(FILTER_ADC, adc_rule_a, n, &adc_info_dl[0]);
+	gate_mask = pcc_gating(&r.sdf_info, &r.adc_info, n, &pkts_mask);
 
-	pcc_gating(&sdf_info_dl[0], &adc_info_dl[0], n, &pkts_mask);
+	/* gated pkts of ADC UEs, the SDF CDR takes the others */
+	update_gate_cdr(&r.adc_ue_info[0], pkts, gate_mask, DL_FLOW);
 
-	dl_sess_info_get(pkts, n, &pkts_mask, &sdf_info[0], &si[0]);
+	for (i = 0; i < n; i++) {
+		sdf_info[i] = r.bearer[i];
+		si[i] = r.si[i];
+	}
 
-	update_sdf_cdr(&adc_ue_info[0], &sdf_info[0], pkts, n,
+	update_sdf_cdr(&r.adc_ue_info[0], &sdf_info[0], pkts, n,
 			&adc_pkts_mask, &pkts_mask, DL_FLOW);
 #ifdef HYPERSCAN_DPI
 	/* Send cloned dns pkts to dns handler*/
@@ -291,61 +587,66 @@ filter_dl_traffic(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
 }
 
 /**
- * Process Downlink traffic: sdf and adc filter, metering, charging and encap gtpu.
- * Update adc hash if dns reply is found with ip addresses.
+ * Process Downlink traffic of SPGWU: sdf and adc filter, metering,
+ * charging and encap gtpu. Update adc hash if dns reply is found with
+ * ip addresses.
  */
 int
-sgi_pkt_handler(struct rte_pipeline *p, struct rte_mbuf **pkts, uint32_t n,
-		int wk_index)
+sgi_pkt_handler_spgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index)
 {
 	struct dp_sdf_per_bearer_info *sdf_info[MAX_BURST_SZ];
 	struct dp_session_info *si[MAX_BURST_SZ];
 	uint64_t pkts_mask, pkts_queue_mask = 0;
-	uint32_t next_port;
 
-	pkts_mask = (~0LLU) >> (64 - n);
+	/* Filter Downlink traffic. Apply adc, sdf, pcc*/
+	pkts_mask = filter_dl_traffic(p, pkts, n, wk_index, sdf_info, si,
+			SPGWU);
 
-	/**
-	 * TODO : filter_dl_traffic and gtpu_encap can be called irrespective
-	 *      of app configuration.
-	 *      Do we need enqueue_dl_pkts and hijack ?
-	 */
-	switch(app.spgw_cfg) {
-		case SPGWU:
-			/* Filter Downlink traffic. Apply adc, sdf, pcc*/
-			pkts_mask = filter_dl_traffic(p, pkts, n, wk_index, sdf_info, si);
-
-			/* Encap GTPU header*/
-			gtpu_encap(&si[0], pkts, n, &pkts_mask, &pkts_queue_mask);
-
-			/*Next port is S1U for SPGW*/
-			next_port = app.s1u_port;
-
-			/* En-queue DL pkts */
-			if (pkts_queue_mask) {
-				rte_pipeline_ah_packet_hijack(p, pkts_queue_mask);
-				enqueue_dl_pkts(&sdf_info[0], pkts, pkts_queue_mask, wk_index);
-			}
-			break;
+	/* Encap GTPU header*/
+	gtpu_encap_spgwu(&si[0], pkts, n, &pkts_mask, &pkts_queue_mask);
 
-		case PGWU:
-			/*Filter downlink traffic. Apply adc, sdf, pcc*/
-			pkts_mask = filter_dl_traffic(p, pkts, n, wk_index, sdf_info, si);
+	/* En-queue DL pkts */
+	if (pkts_queue_mask) {
+		rte_pipeline_ah_packet_hijack(p, pkts_queue_mask);
+		enqueue_dl_pkts(&sdf_info[0], pkts, pkts_queue_mask, wk_index);
+	}
 
-			/* Encap for S5/S8*/
-			gtpu_encap(&si[0], pkts, n, &pkts_mask, &pkts_queue_mask);
+	/* Update nexthop L2 header, next port is S1U for SPGW*/
+	update_nexthop_info(pkts, n, &pkts_mask, app.s1u_port, &sdf_info[0]);
 
-			/*Set next port to S5/S8*/
-			next_port = app.s5s8_pgwu_port;
-			break;
+#ifdef PCAP_GEN
+	dump_pcap(pkts, n, pcap_dumper_east);
+#endif /* PCAP_GEN */
 
-		default:
-			break;
-	}
+	/* Intimate the packets to be dropped*/
+	rte_pipeline_ah_packet_drop(p, ~pkts_mask);
 
+	return 0;
+}
 
-	/* Update nexthop L2 header*/
-	update_nexthop_info(pkts, n, &pkts_mask, next_port, &sdf_info[0]);
+/**
+ * Process Downlink traffic of PGWU: sdf and adc filter, metering,
+ * charging and encap gtpu towards S5/S8.
+ */
+int
+sgi_pkt_handler_pgwu(struct rte_pipeline *p, struct rte_mbuf **pkts,
+		uint32_t n, int wk_index)
+{
+	struct dp_sdf_per_bearer_info *sdf_info[MAX_BURST_SZ];
+	struct dp_session_info *si[MAX_BURST_SZ];
+	uint64_t pkts_mask, pkts_queue_mask = 0;
+
+	/*Filter downlink traffic. Apply adc, sdf, pcc*/
+	pkts_mask = filter_dl_traffic(p, pkts, n, wk_index, sdf_info, si,
+			PGWU);
+
+	/* Encap for S5/S8*/
+	gtpu_encap_pgwu(&si[0], pkts, n, &pkts_mask, &pkts_queue_mask);
+
+	/* Update nexthop L2 header, next port is S5/S8*/
+	update_nexthop_info(pkts, n, &pkts_mask, app.s5s8_pgwu_port,
+			&sdf_info[0]);
 
 #ifdef PCAP_GEN
 	dump_pcap(pkts, n, pcap_dumper_east);
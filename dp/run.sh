@@ -79,6 +79,10 @@ if [ -n "${SGI_GW_IP}" ]; then
 	fi
 fi
 
+if [ -n "${RX_QUEUES}" ]; then
+	ARGS="$ARGS --rx_queues $RX_QUEUES"
+fi
+
 if [ -n "${CDR_PATH}" ]; then
 	ARGS="$ARGS --cdr_path $CDR_PATH"
 fi
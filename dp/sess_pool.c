@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_lcore.h>
+#include <rte_log.h>
+#include <rte_errno.h>
+#include <rte_mempool.h>
+
+#include "main.h"
+#include "epc_packet_framework.h"
+#include "sess_pool.h"
+
+struct sess_pool sess_pools[SESS_POOL_MAX] = {
+	[SESS_POOL_BEARER] = {
+		.name = "dp_session_info",
+		.elt_size = sizeof(struct dp_session_info),
+		.per_bearer = 1,
+	},
+	[SESS_POOL_BEARER_COLD] = {
+		.name = "dp_session_cold",
+		.elt_size = sizeof(struct dp_session_cold),
+		.per_bearer = 1,
+	},
+	[SESS_POOL_UE] = {
+		.name = "ue_session_info",
+		.elt_size = sizeof(struct ue_session_info),
+		.per_bearer = 1,
+	},
+	[SESS_POOL_RATING_GRP] = {
+		.name = "rating group cdr",
+		.elt_size = sizeof(struct ipcan_dp_bearer_cdr) * MAX_RATING_GRP,
+#ifdef RATING_GRP_CDR
+		.per_bearer = 1,
+#endif
+	},
+	[SESS_POOL_SDF_BEARER] = {
+		.name = "dp_sdf_per_bearer_info",
+		.elt_size = sizeof(struct dp_sdf_per_bearer_info),
+		.per_bearer = 2,
+	},
+	[SESS_POOL_ADC_UE] = {
+		.name = "dp_adc_ue_info",
+		.elt_size = sizeof(struct dp_adc_ue_info),
+		.per_bearer = 1,
+	},
+	[SESS_POOL_ENCAP_HDR] = {
+		.name = "encap_hdr",
+		.elt_size = ENCAP_HDR_SIZE,
+		/* plus the replaced ones waiting for their grace period */
+		.per_bearer = 2,
+	},
+};
+
+void sess_pool_init(void)
+{
+	char name[RTE_MEMPOOL_NAMESIZE];
+	unsigned socket_id = rte_socket_id();
+	uint32_t bearers = app.max_sessions;
+	unsigned i;
+
+	if (!bearers)
+		bearers = SESS_POOL_BEARERS_DEFAULT;
+
+	/* workers dereference the objects, keep them on their socket */
+	if (epc_app.num_workers)
+		socket_id = rte_lcore_to_socket_id(epc_app.worker_cores[0]);
+
+	for (i = 0; i < SESS_POOL_MAX; i++) {
+		struct sess_pool *pool = &sess_pools[i];
+
+		pool->size = pool->per_bearer * bearers;
+		if (!pool->size)
+			continue;
+
+		snprintf(name, sizeof(name), "sess_pool_%u", i);
+		/* only the session table writer gets and puts */
+		pool->mp = rte_mempool_create(name, pool->size, pool->elt_size,
+				0, 0, NULL, NULL, NULL, NULL, socket_id,
+				MEMPOOL_F_SP_PUT | MEMPOOL_F_SC_GET);
+		if (pool->mp == NULL)
+			rte_exit(EXIT_FAILURE, "%s pool create failed: %s (%u)\n",
+					pool->name, rte_strerror(rte_errno),
+					rte_errno);
+
+		RTE_LOG(INFO, DP, "%s pool: %u x %u B on socket %u\n",
+				pool->name, pool->size, pool->elt_size, socket_id);
+	}
+}
+
+int sess_pool_alloc_bulk(enum sess_pool_type type, void **objs, unsigned n)
+{
+	struct sess_pool *pool = &sess_pools[type];
+	unsigned i;
+
+	if (pool->mp == NULL ||
+			rte_mempool_get_bulk(pool->mp, objs, n) < 0) {
+		pool->alloc_fail += n;
+		return -1;
+	}
+
+	for (i = 0; i < n; i++)
+		memset(objs[i], 0, pool->elt_size);
+	pool->alloc += n;
+	return 0;
+}
+
+void sess_pool_free_bulk(enum sess_pool_type type, void * const *objs,
+		unsigned n)
+{
+	struct sess_pool *pool = &sess_pools[type];
+	unsigned i;
+
+	for (i = 0; i < n; i++)
+		if (objs[i] == NULL)
+			break;
+	if (i == n) {
+		rte_mempool_put_bulk(pool->mp, objs, n);
+		pool->free += n;
+		return;
+	}
+
+	/* a NULL in the mempool would be handed out by the next alloc */
+	for (i = 0; i < n; i++) {
+		if (objs[i] == NULL)
+			continue;
+		rte_mempool_put(pool->mp, objs[i]);
+		pool->free++;
+	}
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SESS_POOL_H_
+#define _SESS_POOL_H_
+/**
+ * @file
+ * This file contains macros, data structure definitions and function
+ * prototypes of the fixed size object pools backing the session tables.
+ * Pools are preallocated on the NUMA socket of the worker cores, session
+ * setup and teardown do not use the rte_malloc heap.
+ */
+#include <stdint.h>
+#include <rte_mempool.h>
+
+/**
+ * Bearers the pools are sized for without --max_sessions.
+ */
+#define SESS_POOL_BEARERS_DEFAULT	((1 << 16) * HASH_SIZE_FACTOR)
+/**
+ * Upper bound of --max_sessions.
+ */
+#define SESS_POOL_BEARERS_MAX		(1 << 24)
+
+/**
+ * Session table object types, one pool each.
+ */
+enum sess_pool_type {
+	SESS_POOL_BEARER,	/**< struct dp_session_info*/
+	SESS_POOL_BEARER_COLD,	/**< struct dp_session_cold*/
+	SESS_POOL_UE,		/**< struct ue_session_info*/
+	SESS_POOL_RATING_GRP,	/**< MAX_RATING_GRP rating group CDRs*/
+	SESS_POOL_SDF_BEARER,	/**< struct dp_sdf_per_bearer_info*/
+	SESS_POOL_ADC_UE,	/**< struct dp_adc_ue_info*/
+	SESS_POOL_ENCAP_HDR,	/**< ENCAP_HDR_SIZE downlink outer headers*/
+	SESS_POOL_MAX
+};
+
+/**
+ * Pool of one object type with its allocation statistics.
+ * Only the session table writer allocates and frees.
+ */
+struct sess_pool {
+	const char *name;		/**< object name*/
+	struct rte_mempool *mp;		/**< backing mempool*/
+	uint32_t elt_size;		/**< object size*/
+	uint32_t per_bearer;		/**< objects per bearer*/
+	uint32_t size;			/**< number of objects*/
+	uint64_t alloc;			/**< objects allocated*/
+	uint64_t free;			/**< objects freed*/
+	uint64_t alloc_fail;		/**< allocations failed, pool empty*/
+};
+
+/** session table object pools */
+extern struct sess_pool sess_pools[SESS_POOL_MAX];
+
+/**
+ * Create the session table object pools on the socket of the worker
+ * cores, sized for app.max_sessions bearers. Exits on failure.
+ *
+ * @param
+ *	Void
+ *
+ * @return
+ *	None
+ */
+void sess_pool_init(void);
+
+/**
+ * Allocate n zeroed objects from a pool, all or none.
+ *
+ * @param type
+ *	object type.
+ * @param objs
+ *	array filled with n objects.
+ * @param n
+ *	number of objects.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 if the pool has less than n objects left
+ */
+int sess_pool_alloc_bulk(enum sess_pool_type type, void **objs, unsigned n);
+
+/**
+ * Return n objects to a pool.
+ *
+ * @param type
+ *	object type.
+ * @param objs
+ *	objects allocated from this pool, NULL entries are skipped.
+ * @param n
+ *	number of objects.
+ *
+ * @return
+ *	None
+ */
+void sess_pool_free_bulk(enum sess_pool_type type, void * const *objs,
+		unsigned n);
+
+/**
+ * Allocate a zeroed object from a pool.
+ *
+ * @param type
+ *	object type.
+ *
+ * @return
+ *	object, NULL if the pool is empty.
+ */
+static inline void *sess_pool_alloc(enum sess_pool_type type)
+{
+	void *obj;
+
+	if (sess_pool_alloc_bulk(type, &obj, 1) < 0)
+		return NULL;
+	return obj;
+}
+
+/**
+ * Return an object to a pool.
+ *
+ * @param type
+ *	object type.
+ * @param obj
+ *	object allocated from this pool, or NULL.
+ *
+ * @return
+ *	None
+ */
+static inline void sess_pool_free(enum sess_pool_type type, void *obj)
+{
+	if (obj == NULL)
+		return;
+	sess_pool_free_bulk(type, &obj, 1);
+}
+
+/**
+ * Number of objects of a pool in use, including the ones waiting for
+ * their grace period.
+ *
+ * @param type
+ *	object type.
+ *
+ * @return
+ *	objects in use.
+ */
+static inline uint64_t sess_pool_in_use(enum sess_pool_type type)
+{
+	return sess_pools[type].alloc - sess_pools[type].free;
+}
+
+#endif	/* _SESS_POOL_H_ */
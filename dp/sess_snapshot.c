@@ -0,0 +1,690 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <rte_common.h>
+#include <rte_atomic.h>
+#include <rte_log.h>
+
+#include "main.h"
+#include "interface.h"
+#include "grow_hash.h"
+#include "sess_snapshot.h"
+
+extern struct grow_hash *rte_sess_hash;
+extern struct grow_hash *rte_ue_hash;
+extern struct grow_hash *rte_adc_ue_hash;
+
+/**
+ * Snapshot state, used by the iface core only.
+ */
+static struct {
+	/** Loaded snapshot not restored yet, records NULL if none */
+	struct sess_snapshot_hdr hdr;
+	struct sess_snapshot_bearer *bearer;
+	struct sess_snapshot_ue *ue;
+	struct sess_snapshot_adc_ue *adc_ue;
+
+	uint64_t generation;	/**< generation of the last snapshot*/
+	time_t last_save;	/**< time of the last snapshot*/
+} snap;
+
+/** States of the snapshot being saved */
+enum sess_snapshot_state {
+	SNAP_IDLE,	/**< none*/
+	SNAP_FILL,	/**< iface core copies the records*/
+	SNAP_WRITE,	/**< writer thread writes the copy*/
+	SNAP_WRITTEN,	/**< writer thread done, write_errno set*/
+};
+
+/**
+ * Snapshot being saved. The iface core copies the records in steps, the
+ * writer thread owns the copy from SNAP_WRITE until it sets SNAP_WRITTEN.
+ */
+static struct {
+	volatile enum sess_snapshot_state state;
+	struct sess_snapshot_hdr hdr;
+	struct sess_snapshot_bearer *bearer;
+	struct sess_snapshot_ue *ue;
+	struct sess_snapshot_adc_ue *adc_ue;
+	uint32_t bearer_cap;	/**< records allocated*/
+	uint32_t ue_cap;
+	uint32_t adc_ue_cap;
+
+	uint32_t table;		/**< table being copied, 0 bearers, 1 UEs,
+				 * 2 ADC UEs*/
+	uint32_t next;		/**< iterator of the table being copied*/
+
+	pthread_t writer;
+	int write_errno;	/**< errno of the write, 0 on success*/
+} save;
+
+/**
+ * @brief Free the records of the loaded snapshot.
+ */
+static void
+sess_snapshot_drop(void)
+{
+	free(snap.bearer);
+	free(snap.ue);
+	free(snap.adc_ue);
+	snap.bearer = NULL;
+	snap.ue = NULL;
+	snap.adc_ue = NULL;
+}
+
+/**
+ * @brief Read n records of size sz, NULL on failure or if n is 0.
+ */
+static void *
+sess_snapshot_read(FILE *fp, uint32_t n, size_t sz)
+{
+	void *rec;
+
+	if (n == 0)
+		return NULL;
+
+	rec = malloc((size_t)n * sz);
+	if (rec == NULL)
+		return NULL;
+
+	if (fread(rec, sz, n, fp) != n) {
+		free(rec);
+		return NULL;
+	}
+	return rec;
+}
+
+/**
+ * @brief Load the snapshot file.
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 on failure
+ */
+static int
+sess_snapshot_load(const char *path)
+{
+	struct sess_snapshot_hdr *hdr = &snap.hdr;
+	FILE *fp;
+	int ret = -1;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		RTE_LOG(INFO, DP, "No session snapshot %s: %s\n", path,
+				strerror(errno));
+		return -1;
+	}
+
+	if (fread(hdr, sizeof(*hdr), 1, fp) != 1 ||
+			hdr->magic != SESS_SNAPSHOT_MAGIC ||
+			hdr->version != SESS_SNAPSHOT_VERSION ||
+			hdr->bearer_size != sizeof(struct sess_snapshot_bearer) ||
+			hdr->ue_size != sizeof(struct sess_snapshot_ue) ||
+			hdr->adc_ue_size != sizeof(struct sess_snapshot_adc_ue)) {
+		RTE_LOG(ERR, DP, "Invalid session snapshot %s\n", path);
+		goto out;
+	}
+	/* a failed snapshot does not reuse the generation */
+	snap.generation = hdr->generation;
+
+	snap.bearer = sess_snapshot_read(fp, hdr->bearers,
+			sizeof(struct sess_snapshot_bearer));
+	snap.ue = sess_snapshot_read(fp, hdr->ues,
+			sizeof(struct sess_snapshot_ue));
+	snap.adc_ue = sess_snapshot_read(fp, hdr->adc_ues,
+			sizeof(struct sess_snapshot_adc_ue));
+	if ((hdr->bearers && snap.bearer == NULL) ||
+			(hdr->ues && snap.ue == NULL) ||
+			(hdr->adc_ues && snap.adc_ue == NULL)) {
+		RTE_LOG(ERR, DP, "Truncated session snapshot %s\n", path);
+		sess_snapshot_drop();
+		goto out;
+	}
+
+	RTE_LOG(INFO, DP, "Session snapshot %s generation %"PRIu64": "
+			"%u bearers, %u UEs, %u ADC UEs\n", path,
+			hdr->generation, hdr->bearers, hdr->ues, hdr->adc_ues);
+	ret = 0;
+out:
+	fclose(fp);
+	return ret;
+}
+
+static void
+sess_snapshot_fill_bearer(struct sess_snapshot_bearer *b,
+		const struct dp_session_info *data)
+{
+	const struct ue_session_info *ue = data->ue_info_ptr;
+	uint32_t i;
+
+	memset(b, 0, sizeof(*b));
+	b->sess_id = data->sess_id;
+	b->client_id = data->client_id;
+	b->service_id = data->cold->service_id;
+	b->sess_state = data->sess_state;
+	b->ue_addr = data->ue_addr.u.ipv4_addr;
+
+	b->sgw_teid = data->ul_s1_info.sgw_teid;
+	b->ul_enb_addr = data->ul_s1_info.enb_addr.u.ipv4_addr;
+	b->ul_sgw_addr = data->ul_s1_info.sgw_addr.u.ipv4_addr;
+	b->s5s8_pgwu_addr = data->ul_s1_info.s5s8_pgwu_addr.u.ipv4_addr;
+
+	b->enb_teid = data->dl_s1_info.enb_teid;
+	b->dl_enb_addr = data->dl_s1_info.enb_addr.u.ipv4_addr;
+	b->dl_sgw_addr = data->dl_s1_info.sgw_addr.u.ipv4_addr;
+	b->s5s8_sgwu_addr = data->dl_s1_info.s5s8_sgwu_addr.u.ipv4_addr;
+
+	b->ul_apn_mtr_idx = ue->ul_apn_mtr_idx;
+	b->dl_apn_mtr_idx = ue->dl_apn_mtr_idx;
+	b->num_adc_rules = ue->num_adc_rules;
+	for (i = 0; i < ue->num_adc_rules; i++)
+		b->adc_rule_id[i] = ue->adc_rule_id[i];
+
+	b->num_ul_pcc_rules = data->cold->num_ul_pcc_rules;
+	for (i = 0; i < data->cold->num_ul_pcc_rules; i++)
+		b->ul_pcc_rule_id[i] = data->cold->ul_pcc_rule_id[i];
+	b->num_dl_pcc_rules = data->cold->num_dl_pcc_rules;
+	for (i = 0; i < data->cold->num_dl_pcc_rules; i++)
+		b->dl_pcc_rule_id[i] = data->cold->dl_pcc_rule_id[i];
+
+	b->cdr = data->cold->ipcan_dp_bearer_cdr;
+}
+
+/**
+ * @brief Make room for n + 1 records of size sz, NULL on failure.
+ */
+static void *
+sess_snapshot_reserve(void *rec, uint32_t *cap, uint32_t n, size_t sz)
+{
+	uint32_t new_cap;
+	void *tmp;
+
+	if (n < *cap)
+		return rec;
+
+	new_cap = *cap ? *cap * 2 : SESS_SNAPSHOT_STEP;
+	tmp = realloc(rec, (size_t)new_cap * sz);
+	if (tmp == NULL) {
+		free(rec);
+		return NULL;
+	}
+	*cap = new_cap;
+	return tmp;
+}
+
+/**
+ * @brief Free the records of the snapshot being saved.
+ */
+static void
+sess_snapshot_save_drop(void)
+{
+	free(save.bearer);
+	free(save.ue);
+	free(save.adc_ue);
+	memset(&save, 0, sizeof(save));
+}
+
+/**
+ * @brief Copy up to SESS_SNAPSHOT_STEP records of the tables into the
+ * snapshot being saved.
+ *
+ * @return
+ *	- 1 once every table is copied
+ *	- 0 if records are left
+ *	- -EBUSY if a table resize is in progress
+ *	- -ENOMEM on failure
+ */
+static int
+sess_snapshot_fill(void)
+{
+	struct sess_snapshot_hdr *hdr = &save.hdr;
+	const struct dp_session_info *data;
+	const struct ue_session_info *ue;
+	const struct dp_adc_ue_info *adc_ue;
+	struct sess_snapshot_ue *u;
+	struct sess_snapshot_adc_ue *a;
+	const void *key;
+	void *next_data;
+	uint32_t n;
+
+	/* records move while resizing */
+	if (rte_sess_hash->old != NULL || rte_ue_hash->old != NULL ||
+			rte_adc_ue_hash->old != NULL)
+		return -EBUSY;
+
+	for (n = 0; n < SESS_SNAPSHOT_STEP; n++) {
+		switch (save.table) {
+		case 0:
+			if (grow_hash_iterate(rte_sess_hash, &key, &next_data,
+					&save.next) < 0)
+				break;
+			save.bearer = sess_snapshot_reserve(save.bearer,
+					&save.bearer_cap, hdr->bearers,
+					sizeof(*save.bearer));
+			if (save.bearer == NULL)
+				return -ENOMEM;
+			data = next_data;
+			sess_snapshot_fill_bearer(&save.bearer[hdr->bearers++],
+					data);
+			continue;
+
+		case 1:
+			if (grow_hash_iterate(rte_ue_hash, &key, &next_data,
+					&save.next) < 0)
+				break;
+			ue = next_data;
+			if (ue->rating_grp == NULL)
+				continue;
+			save.ue = sess_snapshot_reserve(save.ue, &save.ue_cap,
+					hdr->ues, sizeof(*save.ue));
+			if (save.ue == NULL)
+				return -ENOMEM;
+			u = &save.ue[hdr->ues++];
+			memset(u, 0, sizeof(*u));
+			memcpy(&u->ue_sess_id, key, sizeof(u->ue_sess_id));
+			memcpy(u->rg_idx_map, ue->rg_idx_map,
+					sizeof(u->rg_idx_map));
+			memcpy(u->rating_grp, ue->rating_grp,
+					sizeof(u->rating_grp));
+			continue;
+
+		case 2:
+			if (grow_hash_iterate(rte_adc_ue_hash, &key,
+					&next_data, &save.next) < 0)
+				break;
+			save.adc_ue = sess_snapshot_reserve(save.adc_ue,
+					&save.adc_ue_cap, hdr->adc_ues,
+					sizeof(*save.adc_ue));
+			if (save.adc_ue == NULL)
+				return -ENOMEM;
+			adc_ue = next_data;
+			a = &save.adc_ue[hdr->adc_ues++];
+			memset(a, 0, sizeof(*a));
+			memcpy(&a->key, key, sizeof(a->key));
+			a->adc_cdr = adc_ue->adc_cdr;
+			continue;
+
+		default:
+			return 1;
+		}
+		/* end of this table */
+		save.table++;
+		save.next = 0;
+	}
+	return save.table > 2;
+}
+
+/**
+ * @brief Write the copied snapshot to a temporary file and rename it to
+ * the snapshot file, the last complete snapshot is kept on failure. Runs
+ * in its own thread, the iface core does not wait for the disk.
+ */
+static void *
+sess_snapshot_write(__rte_unused void *arg)
+{
+	const struct sess_snapshot_hdr *hdr = &save.hdr;
+	char tmp[PATH_MAX];
+	FILE *fp;
+	int err = 0;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", app.sess_snapshot);
+	fp = fopen(tmp, "w");
+	if (fp == NULL) {
+		save.write_errno = errno;
+		goto out;
+	}
+
+	err |= fwrite(hdr, sizeof(*hdr), 1, fp) != 1;
+	if (hdr->bearers)
+		err |= fwrite(save.bearer, sizeof(*save.bearer),
+				hdr->bearers, fp) != hdr->bearers;
+	if (hdr->ues)
+		err |= fwrite(save.ue, sizeof(*save.ue), hdr->ues, fp) !=
+				hdr->ues;
+	if (hdr->adc_ues)
+		err |= fwrite(save.adc_ue, sizeof(*save.adc_ue),
+				hdr->adc_ues, fp) != hdr->adc_ues;
+	err |= fflush(fp) != 0;
+	err |= fsync(fileno(fp)) != 0;
+	err |= fclose(fp) != 0;
+
+	if (err || rename(tmp, app.sess_snapshot) < 0) {
+		save.write_errno = errno ? errno : EIO;
+		unlink(tmp);
+	}
+out:
+	rte_wmb();
+	save.state = SNAP_WRITTEN;
+	return NULL;
+}
+
+/**
+ * @brief Advance the snapshot being saved by one step.
+ *
+ * @return
+ *	- 1 once the snapshot is saved or failed
+ *	- 0 while in progress
+ *	- -EBUSY if a table resize is in progress, the snapshot restarts
+ */
+static int
+sess_snapshot_save(void)
+{
+	int ret;
+
+	switch (save.state) {
+	case SNAP_IDLE:
+		save.hdr.magic = SESS_SNAPSHOT_MAGIC;
+		save.hdr.version = SESS_SNAPSHOT_VERSION;
+		save.hdr.generation = snap.generation + 1;
+		save.hdr.time = time(NULL);
+		save.hdr.bearer_size = sizeof(struct sess_snapshot_bearer);
+		save.hdr.ue_size = sizeof(struct sess_snapshot_ue);
+		save.hdr.adc_ue_size = sizeof(struct sess_snapshot_adc_ue);
+		save.state = SNAP_FILL;
+		/* fall through */
+
+	case SNAP_FILL:
+		ret = sess_snapshot_fill();
+		if (ret == 0)
+			return 0;
+		if (ret == -EBUSY) {
+			sess_snapshot_save_drop();
+			return -EBUSY;
+		}
+		if (ret < 0) {
+			RTE_LOG(ERR, DP, "Failed to alloc session snapshot\n");
+			sess_snapshot_save_drop();
+			return 1;
+		}
+
+		save.state = SNAP_WRITE;
+		ret = pthread_create(&save.writer, NULL, sess_snapshot_write,
+				NULL);
+		if (ret != 0) {
+			RTE_LOG(ERR, DP, "Failed to start session snapshot "
+					"writer: %s\n", strerror(ret));
+			sess_snapshot_save_drop();
+			return 1;
+		}
+		return 0;
+
+	case SNAP_WRITE:
+		return 0;
+
+	case SNAP_WRITTEN:
+		pthread_join(save.writer, NULL);
+		if (save.write_errno) {
+			RTE_LOG(ERR, DP, "Failed to write session snapshot "
+					"%s: %s\n", app.sess_snapshot,
+					strerror(save.write_errno));
+		} else {
+			snap.generation = save.hdr.generation;
+			RTE_LOG(DEBUG, DP, "Session snapshot generation %"
+					PRIu64": %u bearers, %u UEs, "
+					"%u ADC UEs\n", save.hdr.generation,
+					save.hdr.bearers, save.hdr.ues,
+					save.hdr.adc_ues);
+		}
+		sess_snapshot_save_drop();
+		return 1;
+	}
+	return 1;
+}
+
+void sess_snapshot_step(void)
+{
+	time_t now;
+
+	if (app.sess_snapshot == NULL || rte_sess_hash == NULL)
+		return;
+
+	now = time(NULL);
+	if (save.state == SNAP_IDLE &&
+			now - snap.last_save < (time_t)app.sess_snapshot_interval)
+		return;
+
+	if (snap.bearer != NULL) {
+		/* keep the loaded snapshot until the CP restores it */
+		if (rte_sess_hash->count == 0)
+			return;
+		RTE_LOG(NOTICE, DP, "Sessions created without restore, "
+				"session snapshot generation %"PRIu64
+				" dropped\n", snap.hdr.generation);
+		sess_snapshot_drop();
+	}
+
+	/* restarted on the next call once the resize completes */
+	if (sess_snapshot_save() == 1)
+		snap.last_save = now;
+}
+
+/**
+ * @brief Session info of a bearer record.
+ */
+static void
+sess_snapshot_session_info(const struct sess_snapshot_bearer *b,
+		struct session_info *entry)
+{
+	uint32_t i;
+
+	memset(entry, 0, sizeof(*entry));
+	entry->sess_id = b->sess_id;
+	entry->bearer_id = UE_BEAR_ID(b->sess_id);
+	entry->client_id = b->client_id;
+	entry->service_id = b->service_id;
+	entry->ue_addr.iptype = IPTYPE_IPV4;
+	entry->ue_addr.u.ipv4_addr = b->ue_addr;
+
+	entry->ul_s1_info.sgw_teid = b->sgw_teid;
+	entry->ul_s1_info.enb_addr.iptype = IPTYPE_IPV4;
+	entry->ul_s1_info.enb_addr.u.ipv4_addr = b->ul_enb_addr;
+	entry->ul_s1_info.sgw_addr.iptype = IPTYPE_IPV4;
+	entry->ul_s1_info.sgw_addr.u.ipv4_addr = b->ul_sgw_addr;
+	entry->ul_s1_info.s5s8_pgwu_addr.iptype = IPTYPE_IPV4;
+	entry->ul_s1_info.s5s8_pgwu_addr.u.ipv4_addr = b->s5s8_pgwu_addr;
+
+	entry->dl_s1_info.enb_teid = b->enb_teid;
+	entry->dl_s1_info.enb_addr.iptype = IPTYPE_IPV4;
+	entry->dl_s1_info.enb_addr.u.ipv4_addr = b->dl_enb_addr;
+	entry->dl_s1_info.sgw_addr.iptype = IPTYPE_IPV4;
+	entry->dl_s1_info.sgw_addr.u.ipv4_addr = b->dl_sgw_addr;
+	entry->dl_s1_info.s5s8_sgwu_addr.iptype = IPTYPE_IPV4;
+	entry->dl_s1_info.s5s8_sgwu_addr.u.ipv4_addr = b->s5s8_sgwu_addr;
+
+	entry->ul_apn_mtr_idx = b->ul_apn_mtr_idx;
+	entry->dl_apn_mtr_idx = b->dl_apn_mtr_idx;
+	/* ADC rules are per UE, added with the default bearer */
+	if (entry->bearer_id == DEFAULT_BEARER) {
+		entry->num_adc_rules = RTE_MIN(b->num_adc_rules,
+				(uint32_t)MAX_ADC_RULES);
+		for (i = 0; i < entry->num_adc_rules; i++)
+			entry->adc_rule_id[i] = b->adc_rule_id[i];
+	}
+
+	entry->num_ul_pcc_rules = RTE_MIN(b->num_ul_pcc_rules,
+			(uint32_t)MAX_PCC_RULES);
+	for (i = 0; i < entry->num_ul_pcc_rules; i++)
+		entry->ul_pcc_rule_id[i] = b->ul_pcc_rule_id[i];
+	entry->num_dl_pcc_rules = RTE_MIN(b->num_dl_pcc_rules,
+			(uint32_t)MAX_PCC_RULES);
+	for (i = 0; i < entry->num_dl_pcc_rules; i++)
+		entry->dl_pcc_rule_id[i] = b->dl_pcc_rule_id[i];
+
+	entry->ipcan_dp_bearer_cdr = b->cdr;
+}
+
+/**
+ * @brief Restore the bearers of the loaded snapshot, default bearers
+ * first, then the UE rating group and ADC UE CDRs.
+ *
+ * @return
+ *	no. of bearers restored.
+ */
+static uint32_t
+sess_snapshot_restore(void)
+{
+	const struct sess_snapshot_hdr *hdr = &snap.hdr;
+	struct ue_session_info *ue;
+	struct dp_adc_ue_info *adc_ue;
+	struct session_info entry;
+	enum dp_session_state state;
+	uint32_t i, pass, n = 0;
+	int dflt;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < hdr->bearers; i++) {
+			dflt = UE_BEAR_ID(snap.bearer[i].sess_id) ==
+				DEFAULT_BEARER;
+			if (dflt != (pass == 0))
+				continue;
+
+			/* the packets buffered for a DDN are lost, the next
+			 * downlink packet of an idle UE sends a new one */
+			state = snap.bearer[i].sess_state == CONNECTED ?
+				CONNECTED : IDLE;
+			sess_snapshot_session_info(&snap.bearer[i], &entry);
+			if (sess_restore_bearer(&entry, state) == 0)
+				n++;
+		}
+	}
+
+	/* workers may account packets of the restored UEs meanwhile,
+	 * the CDR copies below lose these */
+	for (i = 0; i < hdr->ues; i++) {
+		ue = NULL;
+		grow_hash_lookup_data(rte_ue_hash, &snap.ue[i].ue_sess_id,
+				(void **)&ue);
+		if (ue == NULL || ue->rating_grp == NULL)
+			continue;
+		memcpy(ue->rg_idx_map, snap.ue[i].rg_idx_map,
+				sizeof(ue->rg_idx_map));
+		memcpy(ue->rating_grp, snap.ue[i].rating_grp,
+				sizeof(snap.ue[i].rating_grp));
+	}
+
+	for (i = 0; i < hdr->adc_ues; i++) {
+		adc_ue = NULL;
+		grow_hash_lookup_data(rte_adc_ue_hash, &snap.adc_ue[i].key,
+				(void **)&adc_ue);
+		if (adc_ue != NULL)
+			adc_ue->adc_cdr = snap.adc_ue[i].adc_cdr;
+	}
+
+	return n;
+}
+
+/**
+ * @brief Send the restore result to the CP.
+ */
+static void
+sess_snapshot_reply(const struct msg_sess_restore *reply)
+{
+#ifndef SDN_ODL_BUILD
+	struct msgbuf msg_payload = {
+		.mtype = MSG_SESS_RESTORE,
+		.dp_id.id = DPN_ID,
+		.msg_union.sess_restore = *reply };
+
+	if (comm_node[COMM_SOCKET].send(&msg_payload,
+			sizeof(struct msgbuf)) < 0)
+		perror("msgsnd");
+#else
+	RTE_SET_USED(reply);
+#endif
+}
+
+int
+dp_session_restore(struct dp_id dp_id, struct msg_sess_restore *restore)
+{
+	struct msg_sess_restore reply = {0};
+	int ret = -1;
+
+	RTE_SET_USED(dp_id);
+
+	if (snap.bearer == NULL) {
+		RTE_LOG(ERR, DP, "No session snapshot to restore\n");
+	} else if (rte_sess_hash == NULL) {
+		RTE_LOG(ERR, DP, "Sess Hash Table not yet setup\n");
+	} else if (restore->generation != 0 &&
+			restore->generation != snap.hdr.generation) {
+		RTE_LOG(ERR, DP, "Session snapshot generation %"PRIu64
+				" requested, %"PRIu64" loaded\n",
+				restore->generation, snap.hdr.generation);
+		reply.generation = snap.hdr.generation;
+	} else {
+		reply.generation = snap.hdr.generation;
+		reply.bearers = sess_snapshot_restore();
+		RTE_LOG(NOTICE, DP, "Session snapshot generation %"PRIu64
+				": %u of %u bearers restored\n",
+				reply.generation, reply.bearers,
+				snap.hdr.bearers);
+		sess_snapshot_drop();
+		ret = 0;
+	}
+
+	sess_snapshot_reply(&reply);
+	return ret;
+}
+
+/**
+ *  Call back to restore the bearer sessions of the snapshot.
+ *
+ * @param
+ *	msg_payload - payload from CP
+ * @return
+ *	- 0 Success.
+ *	- -1 Failure.
+ */
+static int
+cb_session_restore(struct msgbuf *msg_payload)
+{
+	return session_restore(msg_payload->dp_id,
+			msg_payload->msg_union.sess_restore);
+}
+
+void sess_snapshot_init(void)
+{
+	iface_ipc_register_msg_cb(MSG_SESS_RESTORE, cb_session_restore);
+
+	if (app.sess_snapshot == NULL)
+		return;
+
+#ifdef SDN_ODL_BUILD
+	/* the ZMQ thread writes the tables, the iface core can not copy
+	 * them, and the CP can not request a restore */
+	RTE_LOG(NOTICE, DP, "Session snapshots not supported with "
+			"SDN_ODL_BUILD, %s ignored\n", app.sess_snapshot);
+	app.sess_snapshot = NULL;
+	return;
+#endif
+
+	if (app.sess_snapshot_interval == 0)
+		app.sess_snapshot_interval = SESS_SNAPSHOT_INTERVAL;
+	/* first snapshot one interval after startup */
+	snap.last_save = time(NULL);
+
+	sess_snapshot_load(app.sess_snapshot);
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SESS_SNAPSHOT_H_
+#define _SESS_SNAPSHOT_H_
+/**
+ * @file
+ * This file contains macros, data structure definitions and function
+ * prototypes of the session table snapshot.
+ *
+ * The iface core periodically saves the bearer, UE rating group and
+ * ADC UE state to the file given with --sess_snapshot, each snapshot with
+ * a generation one higher than the last. It copies SESS_SNAPSHOT_STEP
+ * records per step, a writer thread writes and syncs the copy. Sessions
+ * created or deleted during the copy may be missed or saved twice, a
+ * restored duplicate is applied again.
+ *
+ * The file is loaded at startup, the CP started with --sess_restore
+ * restores it with session_restore() once the rules the sessions use are
+ * added again. Snapshots start again after the restore, or when the CP
+ * creates sessions without one. Not supported with SDN_ODL_BUILD.
+ *
+ * Only IPv4 addresses are saved, like the DP uses. SDF CDRs are not saved.
+ */
+#include <stdint.h>
+
+#include "main.h"
+
+/** Snapshot file magic, "SESS" */
+#define SESS_SNAPSHOT_MAGIC	0x53455353
+/** Snapshot file format version */
+#define SESS_SNAPSHOT_VERSION	1
+/** Seconds between snapshots if --snapshot_secs is not given */
+#define SESS_SNAPSHOT_INTERVAL	60
+/** Max. records copied per snapshot step */
+#define SESS_SNAPSHOT_STEP	256
+
+/**
+ * Snapshot file header, followed by the bearer, UE and ADC UE records.
+ */
+struct sess_snapshot_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t generation;		/**< snapshot generation, from 1*/
+	uint64_t time;			/**< snapshot time, seconds since epoch*/
+	uint32_t bearers;		/**< no. of bearer records*/
+	uint32_t ues;			/**< no. of UE records*/
+	uint32_t adc_ues;		/**< no. of ADC UE records*/
+	/* record sizes, differ if the file is of another build*/
+	uint16_t bearer_size;
+	uint16_t ue_size;
+	uint16_t adc_ue_size;
+	uint16_t pad;
+};
+
+/**
+ * Bearer record, addresses and teids as in struct session_info.
+ */
+struct sess_snapshot_bearer {
+	uint64_t sess_id;
+	uint32_t client_id;
+	uint32_t service_id;
+	uint32_t sess_state;		/**< enum dp_session_state*/
+	uint32_t ue_addr;
+
+	uint32_t sgw_teid;
+	uint32_t ul_enb_addr;
+	uint32_t ul_sgw_addr;
+	uint32_t s5s8_pgwu_addr;
+
+	uint32_t enb_teid;
+	uint32_t dl_enb_addr;
+	uint32_t dl_sgw_addr;
+	uint32_t s5s8_sgwu_addr;
+
+	/* UE params, the default bearer restores them*/
+	uint32_t ul_apn_mtr_idx;
+	uint32_t dl_apn_mtr_idx;
+	uint32_t num_adc_rules;
+	uint32_t adc_rule_id[MAX_ADC_RULES];
+
+	uint32_t num_ul_pcc_rules;
+	uint32_t ul_pcc_rule_id[MAX_PCC_RULES];
+	uint32_t num_dl_pcc_rules;
+	uint32_t dl_pcc_rule_id[MAX_PCC_RULES];
+
+	struct ipcan_dp_bearer_cdr cdr;	/**< IP CAN bearer CDR*/
+};
+
+/**
+ * UE record, saved for UEs with rating group CDRs.
+ */
+struct sess_snapshot_ue {
+	uint32_t ue_sess_id;
+	struct rating_group_index_map rg_idx_map[MAX_RATING_GRP];
+	struct ipcan_dp_bearer_cdr rating_grp[MAX_RATING_GRP];
+};
+
+/**
+ * ADC UE record.
+ */
+struct sess_snapshot_adc_ue {
+	struct dl_bm_key key;
+	struct ipcan_dp_bearer_cdr adc_cdr;
+};
+
+/**
+ * Load the snapshot file given with --sess_snapshot and register the
+ * restore callback. A missing or invalid file is logged and ignored.
+ *
+ * @return
+ *	None
+ */
+void sess_snapshot_init(void);
+
+/**
+ * Write a snapshot if the snapshot interval passed. Called by the iface
+ * core, the session table writer.
+ *
+ * @return
+ *	None
+ */
+void sess_snapshot_step(void);
+
+#endif	/* _SESS_SNAPSHOT_H_ */
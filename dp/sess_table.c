@@ -15,6 +15,7 @@
  */
 
 #define _GNU_SOURCE     /* Expose declaration of tdestroy() */
+#include <stddef.h>
 #include <search.h>
 #include <rte_mbuf.h>
 #include <rte_common.h>
@@ -25,6 +26,8 @@
 #include <rte_cfgfile.h>
 #include <rte_hash.h>
 #include <rte_hash_crc.h>
+#include <rte_cycles.h>
+#include <rte_lcore.h>
 
 
 #include "vepc_cp_dp_api.h"
@@ -35,17 +38,333 @@
 #include "cdr.h"
 #include "session_cdr.h"
 #include "meter.h"
+#include "gtpu.h"
+#include "sess_pool.h"
+#include "grow_hash.h"
+#include "fixed_hash.h"
+#include "flow_cache.h"
 
 #define SESS_CREATE 0
 #define SESS_MODIFY 1
 #define SESS_DEL 2
 
-extern struct rte_hash *rte_sess_hash;
-extern struct rte_hash *rte_ue_hash;
-extern struct rte_hash *rte_uplink_hash;
-extern struct rte_hash *rte_downlink_hash;
-extern struct rte_hash *rte_adc_hash;
-extern struct rte_hash *rte_adc_ue_hash;
+extern struct grow_hash *rte_sess_hash;
+extern struct grow_hash *rte_ue_hash;
+extern struct fixed_hash *rte_uplink_hash;
+extern struct fixed_hash *rte_downlink_hash;
+extern struct fixed_hash *rte_adc_hash;
+extern struct grow_hash *rte_adc_ue_hash;
+
+#ifdef UL_TEID_TABLE
+/**
+ * First s1u sgw teid allocated by the CP, see base_s1u_sgw_gtpu_teid.
+ */
+#define UL_TEID_BASE		0xf0000000
+/**
+ * Uplink teid table size, low bits of the teid offset index it.
+ */
+#define UL_TEID_TBL_BITS	20
+#define UL_TEID_TBL_SIZE	(1 << UL_TEID_TBL_BITS)
+#define UL_TEID_GEN_SHIFT	48
+#define UL_TEID_GEN_MASK	(~0ULL << UL_TEID_GEN_SHIFT)
+/**
+ * Rule id of the uplink bearer lookup, see ul_sess_info_get.
+ */
+#define UL_TEID_RID		1
+#endif	/* UL_TEID_TABLE */
+
+/**
+ * Initial number of session table entries waiting for their grace period,
+ * the FIFO doubles when a stalled worker keeps it full.
+ */
+#define SESS_DEFER_INIT	8192
+
+/**
+ * Max. objects returned to a pool at once on reclaim.
+ */
+#define SESS_RECLAIM_BURST	32
+
+/**
+ * Pool type of entries allocated with rte_malloc.
+ */
+#define SESS_DEFER_HEAP	SESS_POOL_MAX
+
+/**
+ * Size of the ring returning sess_ctrl_msg from the workers, less are
+ * kept in flight so that the workers never find it full.
+ */
+#define SESS_CTRL_DONE_SIZE	NOTIFY_RING_SIZE
+
+/**
+ * Entry unlinked from the session tables, freed once every worker passed
+ * a quiescent state after period.
+ */
+struct sess_defer {
+	void *obj;
+	uint32_t type;		/**< sess_pool_type or SESS_DEFER_HEAP*/
+	uint64_t period;
+};
+
+/**
+ * FIFO of unlinked entries, only the session table writer uses it.
+ * sess_defer_size is a power of 2, 0 until the first entry.
+ */
+static struct sess_defer *sess_defer_q;
+static uint32_t sess_defer_size;
+static uint32_t sess_defer_head;
+static uint32_t sess_defer_tail;
+
+/**
+ * @brief Free the unlinked entries whose grace period completed.
+ */
+static void
+sess_reclaim(void)
+{
+	uint64_t done = qsbr_done();
+	void *objs[SESS_POOL_MAX][SESS_RECLAIM_BURST];
+	unsigned n[SESS_POOL_MAX] = {0};
+	unsigned i;
+
+	while (sess_defer_tail != sess_defer_head) {
+		struct sess_defer *d =
+			&sess_defer_q[sess_defer_tail & (sess_defer_size - 1)];
+
+		if (d->period > done)
+			break;
+		sess_defer_tail++;
+
+		if (d->type == SESS_DEFER_HEAP) {
+			rte_free(d->obj);
+			continue;
+		}
+		objs[d->type][n[d->type]++] = d->obj;
+		if (n[d->type] == SESS_RECLAIM_BURST) {
+			sess_pool_free_bulk(d->type, objs[d->type],
+					SESS_RECLAIM_BURST);
+			n[d->type] = 0;
+		}
+	}
+
+	for (i = 0; i < SESS_POOL_MAX; i++)
+		if (n[i])
+			sess_pool_free_bulk(i, objs[i], n[i]);
+}
+
+/**
+ * @brief Double the FIFO of unlinked entries, or create it.
+ */
+static int
+sess_defer_grow(void)
+{
+	uint32_t size = sess_defer_size ? sess_defer_size * 2 : SESS_DEFER_INIT;
+	uint32_t n = sess_defer_head - sess_defer_tail;
+	struct sess_defer *q;
+	uint32_t i;
+
+	q = rte_malloc("sess_defer_q", size * sizeof(*q), RTE_CACHE_LINE_SIZE);
+	if (q == NULL)
+		return -1;
+
+	for (i = 0; i < n; i++)
+		q[i] = sess_defer_q[(sess_defer_tail + i) &
+			(sess_defer_size - 1)];
+	rte_free(sess_defer_q);
+
+	if (sess_defer_size)
+		RTE_LOG(NOTICE, DP, "Session defer FIFO grown to %u entries\n",
+				size);
+	sess_defer_q = q;
+	sess_defer_size = size;
+	sess_defer_tail = 0;
+	sess_defer_head = n;
+	return 0;
+}
+
+/**
+ * @brief Free an entry removed from the session tables once no worker
+ * can hold a reference to it. Workers look the tables up without
+ * locks, a burst may still use the entry after rte_hash_del_key.
+ */
+static void
+sess_defer_free(uint32_t type, void *obj)
+{
+	struct sess_defer *d;
+	uint64_t period;
+
+	if (obj == NULL)
+		return;
+
+	/* cached flows no longer point to obj after the grace period */
+	flow_cache_invalidate();
+	period = qsbr_start();
+
+	sess_reclaim();
+	if (sess_defer_head - sess_defer_tail == sess_defer_size &&
+			sess_defer_grow() < 0) {
+		/* never reused rather than freed under a burst */
+		RTE_LOG(ERR, DP, "Session defer FIFO full, leaked entry of "
+				"type %u\n", type);
+		return;
+	}
+
+	d = &sess_defer_q[sess_defer_head & (sess_defer_size - 1)];
+	d->obj = obj;
+	d->type = type;
+	d->period = period;
+	sess_defer_head++;
+}
+
+/**
+ * sess_ctrl_msg applied or dropped by the workers, back to the iface core.
+ */
+static struct rte_ring *sess_ctrl_done_ring;
+/** sess_ctrl_msg sent and not yet back on sess_ctrl_done_ring */
+static uint32_t sess_ctrl_inflight;
+
+void
+sess_ctrl_done(struct rte_mbuf *m)
+{
+	/* sess_ctrl_send keeps less in flight than the ring holds */
+	if (rte_ring_mp_enqueue(sess_ctrl_done_ring, m) == -ENOBUFS)
+		RTE_LOG(ERR, DP, "Session ctrl done ring full\n");
+}
+
+/**
+ * @brief Free the outer headers replaced by the workers, and the deleted
+ * bearers released by their owner, once the bursts are done with them.
+ */
+static void
+sess_ctrl_reclaim(void)
+{
+	struct rte_mbuf *m[MAX_BURST_SZ];
+	struct sess_ctrl_msg *msg;
+	unsigned n, i;
+
+	while ((n = rte_ring_sc_dequeue_burst(sess_ctrl_done_ring,
+				(void **)m, MAX_BURST_SZ)) != 0) {
+		for (i = 0; i < n; i++) {
+			msg = rte_pktmbuf_mtod(m[i], struct sess_ctrl_msg *);
+			sess_defer_free(SESS_POOL_ENCAP_HDR, msg->encap_hdr);
+			if (msg->op == SESS_CTRL_DELETE) {
+				struct dp_session_info *data = msg->data;
+
+				sess_defer_free(SESS_POOL_ENCAP_HDR,
+						data->encap_hdr);
+				sess_defer_free(SESS_POOL_BEARER_COLD,
+						data->cold);
+				sess_defer_free(SESS_POOL_BEARER, data);
+			}
+			rte_ctrlmbuf_free(m[i]);
+		}
+		sess_ctrl_inflight -= n;
+	}
+}
+
+/**
+ * @brief Allocate a session control command for the worker owning the UE
+ * of a bearer. For SESS_CTRL_MODIFY and SESS_CTRL_CREATE the new outer
+ * headers are built from dl_info. Nothing is visible to the workers until sess_ctrl_post.
+ */
+static struct rte_mbuf *
+sess_ctrl_prepare(struct dp_session_info *data, enum sess_ctrl_op op,
+		const struct dl_s1_info *dl_info, uint32_t *wk_id)
+{
+	struct rte_mbuf *buf_pkt;
+	struct sess_ctrl_msg *msg;
+	uint8_t *hdr = NULL;
+	uint32_t hash;
+	uint32_t ue_ip;
+
+	sess_ctrl_reclaim();
+	if (sess_ctrl_inflight >= SESS_CTRL_DONE_SIZE - 1) {
+		RTE_LOG(ERR, DP, "Too many session ctrl msgs in flight, "
+				"dropped sess_id:0x%"PRIx64"\n", data->sess_id);
+		return NULL;
+	}
+
+	if (op != SESS_CTRL_DELETE) {
+		hdr = sess_pool_alloc(SESS_POOL_ENCAP_HDR);
+		if (hdr == NULL) {
+			RTE_LOG(ERR, DP, "Failed to alloc outer headers for "
+					"sess_id:0x%"PRIx64"\n", data->sess_id);
+			return NULL;
+		}
+		build_gtpu_encap_hdr(hdr, dl_info);
+	}
+
+	/* the load balancer hashes the UE ip in network byte order */
+	ue_ip = rte_cpu_to_be_32(data->ue_addr.u.ipv4_addr);
+	set_ue_ipv4_hash(&hash, &ue_ip);
+	set_worker_core_id(wk_id, &hash);
+
+	buf_pkt = rte_ctrlmbuf_alloc(epc_app.worker[*wk_id].notify_msg_pool);
+	if (buf_pkt == NULL) {
+		RTE_LOG(ERR, DP, "Failed to alloc session ctrl msg for "
+				"sess_id:0x%"PRIx64"\n", data->sess_id);
+		if (hdr != NULL)
+			sess_pool_free(SESS_POOL_ENCAP_HDR, hdr);
+		return NULL;
+	}
+
+	msg = rte_pktmbuf_mtod(buf_pkt, struct sess_ctrl_msg *);
+	msg->op = op;
+	msg->sess_id = data->sess_id;
+	msg->data = data;
+	if (dl_info != NULL)
+		msg->dl_s1_info = *dl_info;
+	msg->encap_hdr = hdr;
+	return buf_pkt;
+}
+
+/**
+ * @brief Drop a command of sess_ctrl_prepare that was not posted.
+ */
+static void
+sess_ctrl_cancel(struct rte_mbuf *buf_pkt)
+{
+	struct sess_ctrl_msg *msg =
+		rte_pktmbuf_mtod(buf_pkt, struct sess_ctrl_msg *);
+
+	/* deletes carry no outer headers */
+	if (msg->encap_hdr != NULL)
+		sess_pool_free(SESS_POOL_ENCAP_HDR, msg->encap_hdr);
+	rte_ctrlmbuf_free(buf_pkt);
+}
+
+/**
+ * @brief Queue a command of sess_ctrl_prepare to its worker. Less
+ * commands are in flight than a notify ring holds, the enqueue only
+ * fails on a bug.
+ */
+static int
+sess_ctrl_post(struct rte_mbuf *buf_pkt, uint32_t wk_id)
+{
+	if (rte_ring_enqueue(epc_app.worker[wk_id].notify_ring,
+			buf_pkt) == -ENOBUFS) {
+		RTE_LOG(ERR, DP, "Worker %u ctrl ring full\n", wk_id);
+		sess_ctrl_cancel(buf_pkt);
+		return -1;
+	}
+	sess_ctrl_inflight++;
+	return 0;
+}
+
+/**
+ * @brief Send the new downlink info of a bearer to the worker owning its
+ * UE, the worker updates dl_s1_info, swaps in the outer headers built here
+ * and updates the session state.
+ */
+static int
+sess_ctrl_send(struct dp_session_info *data, const struct dl_s1_info *dl_info)
+{
+	struct rte_mbuf *buf_pkt;
+	uint32_t wk_id;
+
+	buf_pkt = sess_ctrl_prepare(data, SESS_CTRL_MODIFY, dl_info, &wk_id);
+	if (buf_pkt == NULL)
+		return -1;
+	return sess_ctrl_post(buf_pkt, wk_id);
+}
 
 #define DEBUG_SESS_TABLE 0
 
@@ -89,6 +408,15 @@ struct rte_hash_signatures {
 	};
 };
 
+/** Key entry of the key table, the key follows the data */
+struct rte_hash_key {
+	union {
+		uintptr_t idata;
+		void *pdata;
+	};
+	char key[0];
+} __attribute__((aligned(16)));
+
 #define RTE_HASH_BUCKET_ENTRIES         4
 /** Bucket structure */
 struct rte_hash_bucket {
@@ -127,69 +455,420 @@ struct rte_hash {
 	struct rte_hash_bucket *buckets;
 } __rte_cache_aligned;
 
+#ifdef UL_TEID_TABLE
+/**
+ * Uplink bearers indexed by s1u sgw teid - UL_TEID_BASE. Each entry packs
+ * the sdf per bearer info address in the low 48 bits and the remaining
+ * high bits of the teid offset as generation tag in the upper 16 bits,
+ * 0 when empty. Workers read an entry with a single load, a tag mismatch
+ * (stale or colliding teid) falls back to rte_uplink_hash, which always
+ * holds every entry.
+ */
+static uint64_t *ul_teid_tbl;
+
+/**
+ * @brief Index and generation tag of a teid in ul_teid_tbl.
+ */
+static inline uint32_t
+ul_teid_idx(uint32_t teid, uint64_t *gen)
+{
+	uint32_t off = teid - UL_TEID_BASE;
+
+	*gen = (uint64_t)(off >> UL_TEID_TBL_BITS) << UL_TEID_GEN_SHIFT;
+	return off & (UL_TEID_TBL_SIZE - 1);
+}
+
+/**
+ * @brief Index an uplink hash entry in ul_teid_tbl if its slot is free.
+ */
+static void
+ul_teid_add(const struct ul_bm_key *key, void *psdf)
+{
+	uint64_t gen;
+	uint32_t idx;
+
+	if (ul_teid_tbl == NULL || key->rid != UL_TEID_RID ||
+			((uintptr_t)psdf >> UL_TEID_GEN_SHIFT))
+		return;
+
+	idx = ul_teid_idx(key->s1u_sgw_teid, &gen);
+	/* slot taken by another teid, this one stays in the hash only */
+	if (ul_teid_tbl[idx] && (ul_teid_tbl[idx] & UL_TEID_GEN_MASK) != gen)
+		return;
+
+	/* entry is complete before workers can see it */
+	rte_wmb();
+	ul_teid_tbl[idx] = gen | (uintptr_t)psdf;
+}
+
+/**
+ * @brief Remove an uplink hash entry from ul_teid_tbl.
+ */
+static void
+ul_teid_del(const struct ul_bm_key *key, void *psdf)
+{
+	uint64_t gen;
+	uint32_t idx;
+
+	if (ul_teid_tbl == NULL || key->rid != UL_TEID_RID)
+		return;
+
+	idx = ul_teid_idx(key->s1u_sgw_teid, &gen);
+	if (ul_teid_tbl[idx] == (gen | (uintptr_t)psdf))
+		ul_teid_tbl[idx] = 0;
+}
+
+/**
+ * @brief Create ul_teid_tbl on the socket of the workers.
+ */
+static void
+ul_teid_tbl_init(void)
+{
+	int socket_id = rte_socket_id();
+
+	if (epc_app.num_workers)
+		socket_id = rte_lcore_to_socket_id(epc_app.worker_cores[0]);
+
+	ul_teid_tbl = rte_zmalloc_socket("ul_teid_tbl",
+			sizeof(uint64_t) * UL_TEID_TBL_SIZE,
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (ul_teid_tbl == NULL)
+		RTE_LOG(ERR, DP, "Failed to allocate uplink teid table, "
+				"using uplink hash only\n");
+}
+#else
+#define ul_teid_add(key, psdf) do {} while (0)
+#define ul_teid_del(key, psdf) do {} while (0)
+#endif	/* UL_TEID_TABLE */
+
 int
 iface_lookup_uplink_data(struct ul_bm_key *key,
 		void **value)
 {
-	return rte_hash_lookup_data(rte_uplink_hash, key, value);
+	return fixed_hash_lookup_data(rte_uplink_hash, key, value);
 }
 
 int
 iface_lookup_uplink_bulk_data(const void **key, uint32_t n,
 		uint64_t *hit_mask, void **value)
 {
-	return rte_hash_lookup_bulk_data(rte_uplink_hash, key, n, hit_mask, value);
+#ifdef UL_TEID_TABLE
+	const void *miss_key[RTE_HASH_LOOKUP_BULK_MAX];
+	void *miss_value[RTE_HASH_LOOKUP_BULK_MAX];
+	uint8_t miss_pos[RTE_HASH_LOOKUP_BULK_MAX];
+	uint64_t miss_hit = 0, hit = 0;
+	uint32_t i, n_miss = 0;
+
+	if (ul_teid_tbl == NULL)
+		return fixed_hash_lookup_bulk_data(rte_uplink_hash, key, n,
+				hit_mask, value);
+
+	for (i = 0; i < n; i++) {
+		const struct ul_bm_key *k = key[i];
+		uint64_t gen, e;
+
+		e = ul_teid_tbl[ul_teid_idx(k->s1u_sgw_teid, &gen)];
+		if (e && (e & UL_TEID_GEN_MASK) == gen &&
+				k->rid == UL_TEID_RID) {
+			value[i] = (void *)(uintptr_t)(e & ~UL_TEID_GEN_MASK);
+			hit |= 1ULL << i;
+		} else {
+			miss_key[n_miss] = k;
+			miss_pos[n_miss++] = i;
+		}
+	}
+
+	if (n_miss) {
+		if (fixed_hash_lookup_bulk_data(rte_uplink_hash, miss_key,
+				n_miss, &miss_hit, miss_value) < 0)
+			miss_hit = 0;
+		for (i = 0; i < n_miss; i++) {
+			if (ISSET_BIT(miss_hit, i)) {
+				value[miss_pos[i]] = miss_value[i];
+				hit |= 1ULL << miss_pos[i];
+			}
+		}
+	}
+
+	*hit_mask = hit;
+	return __builtin_popcountll(hit);
+#else
+	return fixed_hash_lookup_bulk_data(rte_uplink_hash, key, n, hit_mask, value);
+#endif	/* UL_TEID_TABLE */
+}
+
+/**
+ * Downlink bearers of each UE address pool indexed by UE address - pool
+ * network address. Only entries with the rule id of the downlink bearer
+ * lookup are kept, rte_downlink_hash holds every entry and serves the
+ * addresses outside the pools.
+ */
+static void **dl_ue_pool_tbl[MAX_UE_POOLS];
+
+/**
+ * Rule id of the downlink bearer lookup, see dl_sess_info_get.
+ */
+#define DL_UE_POOL_RID		1
+
+/**
+ * @brief Slot of a UE address in dl_ue_pool_tbl, NULL if the address
+ * is outside every pool.
+ */
+static inline void **
+dl_ue_pool_slot(uint32_t ue_ipv4)
+{
+	uint32_t i;
+
+	for (i = 0; i < app.n_ue_pools; i++) {
+		uint32_t off = ue_ipv4 - app.ue_pool[i].net;
+
+		if (off < app.ue_pool[i].size && dl_ue_pool_tbl[i] != NULL)
+			return &dl_ue_pool_tbl[i][off];
+	}
+	return NULL;
+}
+
+/**
+ * @brief Index a downlink hash entry in dl_ue_pool_tbl.
+ */
+static void
+dl_ue_pool_add(const struct dl_bm_key *key, void *psdf)
+{
+	void **slot;
+
+	if (key->rid != DL_UE_POOL_RID)
+		return;
+
+	slot = dl_ue_pool_slot(key->ue_ipv4);
+	if (slot == NULL)
+		return;
+
+	/* entry is complete before workers can see it */
+	rte_wmb();
+	*slot = psdf;
+}
+
+/**
+ * @brief Remove a downlink hash entry from dl_ue_pool_tbl.
+ */
+static void
+dl_ue_pool_del(const struct dl_bm_key *key)
+{
+	void **slot;
+
+	if (key->rid != DL_UE_POOL_RID)
+		return;
+
+	slot = dl_ue_pool_slot(key->ue_ipv4);
+	if (slot != NULL)
+		*slot = NULL;
+}
+
+/**
+ * @brief Create the downlink array of each UE address pool on the socket
+ * of the workers.
+ */
+static void
+dl_ue_pool_tbl_init(void)
+{
+	int socket_id = rte_socket_id();
+	uint32_t i;
+
+	if (epc_app.num_workers)
+		socket_id = rte_lcore_to_socket_id(epc_app.worker_cores[0]);
+
+	for (i = 0; i < app.n_ue_pools; i++) {
+		dl_ue_pool_tbl[i] = rte_zmalloc_socket("dl_ue_pool_tbl",
+				sizeof(void *) * app.ue_pool[i].size,
+				RTE_CACHE_LINE_SIZE, socket_id);
+		if (dl_ue_pool_tbl[i] == NULL)
+			RTE_LOG(ERR, DP, "Failed to allocate downlink table of "
+					"ue pool "IPV4_ADDR", using downlink "
+					"hash only\n",
+					IPV4_ADDR_HOST_FORMAT(app.ue_pool[i].net));
+	}
 }
 
 int
 iface_lookup_downlink_data(struct dl_bm_key *key,
 		void **value)
 {
-	return rte_hash_lookup_data(rte_downlink_hash, key, value);
+	return fixed_hash_lookup_data(rte_downlink_hash, key, value);
 }
 
 int
 iface_lookup_downlink_bulk_data(const void **key, uint32_t n,
 		uint64_t *hit_mask, void **value)
 {
-	return rte_hash_lookup_bulk_data(rte_downlink_hash, key, n, hit_mask, value);
+	const void *miss_key[RTE_HASH_LOOKUP_BULK_MAX];
+	void *miss_value[RTE_HASH_LOOKUP_BULK_MAX];
+	uint8_t miss_pos[RTE_HASH_LOOKUP_BULK_MAX];
+	uint64_t miss_hit = 0, hit = 0;
+	uint32_t i, n_miss = 0;
+
+	if (!app.n_ue_pools)
+		return fixed_hash_lookup_bulk_data(rte_downlink_hash, key, n,
+				hit_mask, value);
+
+	for (i = 0; i < n; i++) {
+		const struct dl_bm_key *k = key[i];
+		void **slot = NULL;
+
+		if (k->rid == DL_UE_POOL_RID)
+			slot = dl_ue_pool_slot(k->ue_ipv4);
+
+		if (slot != NULL) {
+			/* the pool array is authoritative for its addresses */
+			value[i] = *slot;
+			if (value[i] != NULL)
+				hit |= 1ULL << i;
+		} else {
+			miss_key[n_miss] = k;
+			miss_pos[n_miss++] = i;
+		}
+	}
+
+	if (n_miss) {
+		if (fixed_hash_lookup_bulk_data(rte_downlink_hash, miss_key,
+				n_miss, &miss_hit, miss_value) < 0)
+			miss_hit = 0;
+		for (i = 0; i < n_miss; i++) {
+			if (ISSET_BIT(miss_hit, i)) {
+				value[miss_pos[i]] = miss_value[i];
+				hit |= 1ULL << miss_pos[i];
+			}
+		}
+	}
+
+	*hit_mask = hit;
+	return __builtin_popcountll(hit);
 }
 
 int
 iface_lookup_adc_ue_data(struct dl_bm_key *key,
 		void **value)
 {
-	return rte_hash_lookup_data(rte_adc_ue_hash, key, value);
+	return grow_hash_lookup_data(rte_adc_ue_hash, key, value);
 }
 
 /******************** DP- ADC, PCC funcitons **********************/
 int iface_lookup_adc_data(const uint32_t key32,
 		void **value)
 {
-	return rte_hash_lookup_data(rte_adc_hash, &key32, (void **)value);
+	return fixed_hash_lookup_data(rte_adc_hash, &key32, (void **)value);
 }
 
 int iface_lookup_adc_bulk_data(const void **key, uint32_t n,
 		uint64_t *hit_mask, void **value)
 {
-	return rte_hash_lookup_bulk_data(rte_adc_hash, key, n, hit_mask, value);
+	return fixed_hash_lookup_bulk_data(rte_adc_hash, key, n, hit_mask, value);
 }
-struct rte_hash_bucket *bucket_ul_addr(uint64_t key)
+struct fixed_hash_bucket *bucket_ul_addr(uint64_t key)
 {
-	uint32_t bucket_idx;
-	hash_sig_t sig = rte_hash_hash(rte_uplink_hash, &key);
+	return fixed_hash_bucket_addr(rte_uplink_hash, &key);
+}
 
-	bucket_idx = sig & rte_uplink_hash->bucket_bitmask;
-	return &rte_uplink_hash->buckets[bucket_idx];
+struct fixed_hash_bucket *bucket_dl_addr(uint64_t key)
+{
+	return fixed_hash_bucket_addr(rte_downlink_hash, &key);
 }
 
-struct rte_hash_bucket *bucket_dl_addr(uint64_t key)
+/**
+ * @brief Bucket occupancy of a fixed key hash table. The probes of a key
+ * are its distance to its home bucket + 1.
+ */
+static void
+fixed_hash_occupancy(const struct fixed_hash *h, const char *name,
+		struct hash_occupancy *occ)
+{
+	const struct fixed_hash_bucket *b;
+	uint32_t i, e, n, dist;
+
+	memset(occ, 0, sizeof(*occ));
+	occ->name = name;
+	occ->buckets = h->num_buckets;
+	occ->bucket_entries = FIXED_HASH_BUCKET_ENTRIES;
+	occ->capacity = (uint64_t)h->num_buckets * FIXED_HASH_BUCKET_ENTRIES;
+
+	for (i = 0; i < h->num_buckets; i++) {
+		b = &h->buckets[i];
+		n = 0;
+		for (e = 0; e < FIXED_HASH_BUCKET_ENTRIES; e++) {
+			if (b->sig[e] == 0)
+				continue;
+			n++;
+			dist = (i - (uint32_t)(fixed_hash_bucket_addr(h,
+					&b->key[e]) - h->buckets)) &
+					h->bucket_mask;
+			if (dist)
+				occ->alt++;
+			occ->probes += dist + 1;
+		}
+		occ->hist[n]++;
+		occ->entries += n;
+	}
+}
+
+/**
+ * @brief Bucket occupancy of a rte_hash table. A key in its secondary
+ * bucket takes two bucket reads. Cuckoo moves swap the current and alt
+ * signatures, so the primary bucket is recomputed from the key.
+ */
+static void
+cuckoo_hash_occupancy(const struct rte_hash *h, const char *name,
+		struct hash_occupancy *occ)
 {
-	uint32_t bucket_idx;
-	hash_sig_t sig = rte_hash_hash(rte_downlink_hash, &key);
+	const struct rte_hash_bucket *b;
+	const struct rte_hash_key *k;
+	uint32_t i, e, n;
+
+	memset(occ, 0, sizeof(*occ));
+	occ->name = name;
+	occ->buckets = h->num_buckets;
+	occ->bucket_entries = RTE_HASH_BUCKET_ENTRIES;
+	occ->capacity = (uint64_t)h->num_buckets * RTE_HASH_BUCKET_ENTRIES;
+
+	for (i = 0; i < h->num_buckets; i++) {
+		b = &h->buckets[i];
+		n = 0;
+		for (e = 0; e < RTE_HASH_BUCKET_ENTRIES; e++) {
+			if (b->signatures[e].sig == 0)
+				continue;
+			n++;
+			k = (const struct rte_hash_key *)
+				((const char *)h->key_store +
+				 (size_t)b->key_idx[e] * h->key_entry_size);
+			if ((rte_hash_hash(h, k->key) &
+					h->bucket_bitmask) != i) {
+				occ->alt++;
+				occ->probes += 2;
+			} else {
+				occ->probes++;
+			}
+		}
+		occ->hist[n]++;
+		occ->entries += n;
+	}
+}
 
-	bucket_idx = sig & rte_downlink_hash->bucket_bitmask;
-	return &rte_downlink_hash->buckets[bucket_idx];
+unsigned sess_tbl_occupancy(struct hash_occupancy *occ, unsigned n)
+{
+	unsigned i = 0;
+
+	if (i < n && rte_uplink_hash != NULL)
+		fixed_hash_occupancy(rte_uplink_hash, "uplink", &occ[i++]);
+	if (i < n && rte_downlink_hash != NULL)
+		fixed_hash_occupancy(rte_downlink_hash, "downlink", &occ[i++]);
+	if (i < n && rte_adc_hash != NULL)
+		fixed_hash_occupancy(rte_adc_hash, "adc_domain", &occ[i++]);
+	/* growable tables: the table adds go to */
+	if (i < n && rte_sess_hash != NULL)
+		cuckoo_hash_occupancy(rte_sess_hash->cur, "session", &occ[i++]);
+	if (i < n && rte_ue_hash != NULL)
+		cuckoo_hash_occupancy(rte_ue_hash->cur, "ue_session", &occ[i++]);
+	if (i < n && rte_adc_ue_hash != NULL)
+		cuckoo_hash_occupancy(rte_adc_ue_hash->cur, "adc_ue", &occ[i++]);
+	return i;
 }
 
 int
@@ -227,13 +906,13 @@ add_ul_pcc_entry_key_with_idx(struct dp_session_info *old,
 	uint32_t pcc_id;
 	struct dp_sdf_per_bearer_info *psdf;
 
-	pcc_id = data->ul_pcc_rule_id[idx];
+	pcc_id = data->cold->ul_pcc_rule_id[idx];
 	if (pcc_id == 0)
 		return;
 
 	/* get pcc rule info address*/
 	iface_lookup_pcc_data(pcc_id, &pcc_info);
-	old->ul_pcc_rule_id[idx] = pcc_id;
+	old->cold->ul_pcc_rule_id[idx] = pcc_id;
 
 	/* update rating group idx*/
 	if (old->ue_info_ptr != NULL) {
@@ -245,12 +924,10 @@ add_ul_pcc_entry_key_with_idx(struct dp_session_info *old,
 	/* look for previously allocated sdf per bearer info in downlink hash */
 	dl_key.ue_ipv4 = old->ue_addr.u.ipv4_addr;
 	dl_key.rid = pcc_id;
-	if (rte_hash_lookup_data(rte_downlink_hash, &dl_key,
+	if (fixed_hash_lookup_data(rte_downlink_hash, &dl_key,
 			(void **)&psdf) < 0) {
 		/* alloc memory for per sdf per bearer info structure*/
-		psdf = rte_zmalloc("sdf per bearer",
-				sizeof(struct dp_sdf_per_bearer_info),
-				RTE_CACHE_LINE_SIZE);
+		psdf = sess_pool_alloc(SESS_POOL_SDF_BEARER);
 		if (psdf == NULL) {
 			RTE_LOG(ERR, DP, "Failed to allocate memory for sdf "
 					"per bearer info");
@@ -273,11 +950,13 @@ add_ul_pcc_entry_key_with_idx(struct dp_session_info *old,
 	RTE_LOG(DEBUG, DP, "SDF ADD:UL_KEY: teid:%u, rid:%u\n",
 			ul_key.s1u_sgw_teid, ul_key.rid);
 
-	ret = rte_hash_add_key_data(rte_uplink_hash,
+	ret = fixed_hash_add_key_data(rte_uplink_hash,
 			&ul_key, psdf);
 
 	if (ret < 0)
 		rte_panic("Failed to add entry in hash table");
+
+	ul_teid_add(&ul_key, psdf);
 }
 
 /**
@@ -294,7 +973,7 @@ del_ul_pcc_entry_key_with_idx(struct dp_session_info *data, uint32_t idx)
 	struct dp_sdf_per_bearer_info *psdf;
 
 	ul_key.s1u_sgw_teid = data->ul_s1_info.sgw_teid;
-	ul_key.rid = data->ul_pcc_rule_id[idx];
+	ul_key.rid = data->cold->ul_pcc_rule_id[idx];
 
 	RTE_LOG(DEBUG, DP, "BEAR_SESS DEL:UL_KEY: teid:%u, rid:%u\n",
 			ul_key.s1u_sgw_teid, ul_key.rid);
@@ -310,7 +989,8 @@ del_ul_pcc_entry_key_with_idx(struct dp_session_info *data, uint32_t idx)
 		return ;
 	}
 
-	ret = rte_hash_del_key(rte_uplink_hash,
+	ul_teid_del(&ul_key, psdf);
+	ret = fixed_hash_del_key(rte_uplink_hash,
 			&ul_key);
 	if (ret == -ENOENT)
 		RTE_LOG(DEBUG, DP, "key is not found\n");
@@ -322,11 +1002,11 @@ del_ul_pcc_entry_key_with_idx(struct dp_session_info *data, uint32_t idx)
 
 	/* look for sdf per bearer info in downlink hash */
 	dl_key.ue_ipv4 = data->ue_addr.u.ipv4_addr;
-	dl_key.rid = data->dl_pcc_rule_id[idx];
-	if (rte_hash_lookup_data(rte_downlink_hash, &dl_key,
+	dl_key.rid = data->cold->dl_pcc_rule_id[idx];
+	if (fixed_hash_lookup_data(rte_downlink_hash, &dl_key,
 			(void **)&psdf) < 0) {
 		/* remove sdf per bearer info if not present in downlink hash */
-		rte_free(psdf);
+		sess_defer_free(SESS_POOL_SDF_BEARER, psdf);
 	}
 }
 
@@ -346,7 +1026,7 @@ add_dl_pcc_entry_key_with_idx(struct dp_session_info *old,
 	uint32_t pcc_id;
 	struct dp_sdf_per_bearer_info *psdf;
 
-	pcc_id = data->dl_pcc_rule_id[idx];
+	pcc_id = data->cold->dl_pcc_rule_id[idx];
 	if (pcc_id == 0)
 		return;
 
@@ -354,7 +1034,7 @@ add_dl_pcc_entry_key_with_idx(struct dp_session_info *old,
 	iface_lookup_pcc_data(pcc_id, &pcc_info);
 	if (pcc_info == NULL)
 		return;
-	old->dl_pcc_rule_id[idx] = pcc_id;
+	old->cold->dl_pcc_rule_id[idx] = pcc_id;
 
 	/* update rating group idx*/
 	if (old->ue_info_ptr != NULL) {
@@ -366,12 +1046,10 @@ add_dl_pcc_entry_key_with_idx(struct dp_session_info *old,
 	/* look for previously allocated sdf per bearer info in uplink hash */
 	ul_key.s1u_sgw_teid = data->ul_s1_info.sgw_teid;
 	ul_key.rid = pcc_id;
-	if (rte_hash_lookup_data(rte_uplink_hash, &ul_key,
+	if (fixed_hash_lookup_data(rte_uplink_hash, &ul_key,
 			(void **)&psdf) < 0) {
 		/* alloc memory for per sdf per bearer info */
-		psdf = rte_zmalloc("sdf per bearer",
-				sizeof(struct dp_sdf_per_bearer_info),
-				RTE_CACHE_LINE_SIZE);
+		psdf = sess_pool_alloc(SESS_POOL_SDF_BEARER);
 		if (psdf == NULL) {
 			RTE_LOG(ERR, DP, "Failed to allocate memory for sdf "
 					"per bearer info");
@@ -394,12 +1072,14 @@ add_dl_pcc_entry_key_with_idx(struct dp_session_info *old,
 	RTE_LOG(DEBUG, DP, "SDF ADD:DL_KEY: ue_addr:"IPV4_ADDR ", rid: %d\n",
 			IPV4_ADDR_HOST_FORMAT(dl_key.ue_ipv4), pcc_id);
 
-	ret = rte_hash_add_key_data(rte_downlink_hash,
+	ret = fixed_hash_add_key_data(rte_downlink_hash,
 			&dl_key, psdf);
 
 
 	if (ret < 0)
 		rte_panic("Failed to add entry in hash table");
+
+	dl_ue_pool_add(&dl_key, psdf);
 }
 
 #ifdef SDF_MTR
@@ -437,7 +1117,7 @@ del_dl_pcc_entry_key_with_idx(struct dp_session_info *data, uint32_t idx)
 	struct dp_sdf_per_bearer_info *psdf;
 
 	dl_key.ue_ipv4 = data->ue_addr.u.ipv4_addr;
-	dl_key.rid = data->dl_pcc_rule_id[idx];
+	dl_key.rid = data->cold->dl_pcc_rule_id[idx];
 
 	if (dl_key.rid == 0)
 		return;
@@ -454,7 +1134,8 @@ del_dl_pcc_entry_key_with_idx(struct dp_session_info *data, uint32_t idx)
 		return ;
 	}
 
-	ret = rte_hash_del_key(rte_downlink_hash,
+	dl_ue_pool_del(&dl_key);
+	ret = fixed_hash_del_key(rte_downlink_hash,
 			&dl_key);
 	if (ret < 0)
 		rte_panic("Failed to del entry from hash table");
@@ -465,11 +1146,11 @@ del_dl_pcc_entry_key_with_idx(struct dp_session_info *data, uint32_t idx)
 
 	/* look for sdf per bearer info in uplink hash */
 	ul_key.s1u_sgw_teid = data->ul_s1_info.sgw_teid;
-	ul_key.rid = data->dl_pcc_rule_id[idx];
-	if (rte_hash_lookup_data(rte_uplink_hash, &ul_key,
+	ul_key.rid = data->cold->dl_pcc_rule_id[idx];
+	if (fixed_hash_lookup_data(rte_uplink_hash, &ul_key,
 			(void **)&psdf) < 0) {
 		/* remove sdf per bearer info if not present in uplink hash */
-		rte_free(psdf);
+		sess_defer_free(SESS_POOL_SDF_BEARER, psdf);
 	}
 }
 
@@ -488,10 +1169,10 @@ update_pcc_rules(struct dp_session_info *old,
 	uint32_t n;
 
 	/* Modify UL PCC rule keys*/
-	p1 = old->ul_pcc_rule_id;
-	p2 = new->ul_pcc_rule_id;
-	n1 = old->num_ul_pcc_rules;
-	n2 = new->num_ul_pcc_rules;
+	p1 = old->cold->ul_pcc_rule_id;
+	p2 = new->cold->ul_pcc_rule_id;
+	n1 = old->cold->num_ul_pcc_rules;
+	n2 = new->cold->num_ul_pcc_rules;
 	n = (n1 > n2) ? (n2) : (n1);
 	for (i = 0; i < n; i++)
 		if (p1[i] != p2[i]) {
@@ -510,13 +1191,13 @@ update_pcc_rules(struct dp_session_info *old,
 			i++;
 		}
 
-	old->num_ul_pcc_rules = n2;
+	old->cold->num_ul_pcc_rules = n2;
 
 	/* Modify DL PCC rule keys*/
-	p1 = old->dl_pcc_rule_id;
-	p2 = new->dl_pcc_rule_id;
-	n1 = old->num_dl_pcc_rules;
-	n2 = new->num_dl_pcc_rules;
+	p1 = old->cold->dl_pcc_rule_id;
+	p2 = new->cold->dl_pcc_rule_id;
+	n1 = old->cold->num_dl_pcc_rules;
+	n2 = new->cold->num_dl_pcc_rules;
 	n = (n1 > n2) ? (n2) : (n1);
 	for (i = 0; i < n; i++)
 		if (p1[i] != p2[i]) {
@@ -533,7 +1214,7 @@ update_pcc_rules(struct dp_session_info *old,
 			add_dl_pcc_entry_key_with_idx(old, new, i);
 			i++;
 		}
-	old->num_dl_pcc_rules = n2;
+	old->cold->num_dl_pcc_rules = n2;
 }
 
 /******************** ADC rules update functions **************/
@@ -572,7 +1253,7 @@ add_adc_entry_key_with_idx(struct ue_session_info *old,
 	key.ue_ipv4 = old->ue_addr.u.ipv4_addr;
 	key.rid = adc_id;
 
-	ret = rte_hash_lookup_data(rte_adc_ue_hash, &key, &data);
+	ret = grow_hash_lookup_data(rte_adc_ue_hash, &key, &data);
 	if (data)
 		return;
 
@@ -581,8 +1262,7 @@ add_adc_entry_key_with_idx(struct ue_session_info *old,
 	old->adc_rule_id[idx] = adc_id;
 
 	/* alloc memory for per ADC per UE info structure*/
-	padc_ue = rte_zmalloc("adc ue info", sizeof(struct dp_adc_ue_info),
-			RTE_CACHE_LINE_SIZE);
+	padc_ue = sess_pool_alloc(SESS_POOL_ADC_UE);
 	if (padc_ue == NULL) {
 		RTE_LOG(ERR, DP, "Failed to allocate memory for adc ue info");
 		return ;
@@ -593,7 +1273,7 @@ add_adc_entry_key_with_idx(struct ue_session_info *old,
 					IPV4_ADDR_HOST_FORMAT(key.ue_ipv4));
 	RTE_LOG(DEBUG, DP, "adc_id:%u\n",
 					old->adc_rule_id[idx]);
-	ret = rte_hash_add_key_data(rte_adc_ue_hash,
+	ret = grow_hash_add_key_data(rte_adc_ue_hash,
 					&key, padc_ue);
 	if (ret < 0)
 			rte_panic("Failed to add entry in hash table");
@@ -632,14 +1312,14 @@ del_adc_entry_key_with_idx(struct ue_session_info *data, uint32_t idx)
 		return ;
 	}
 
-	ret = rte_hash_del_key(rte_adc_ue_hash,
+	ret = grow_hash_del_key(rte_adc_ue_hash,
 			&key);
 
 	if (ret < 0)
 		rte_panic("Failed to del entry from hash table");
 
 	/* free the memory*/
-	rte_free(padc_ue);
+	sess_defer_free(SESS_POOL_ADC_UE, padc_ue);
 }
 
 /**
@@ -690,7 +1370,7 @@ void print_adc_hash(void)
 	uint32_t iter = 0;
 
 
-	while (rte_hash_iterate(rte_adc_hash, &next_key, &next_data, &iter) >= 0) {
+	while (fixed_hash_iterate(rte_adc_hash, &next_key, &next_data, &iter) >= 0) {
 
 		struct in_addr tmp_ip_key;
 
@@ -715,12 +1395,14 @@ adc_dns_entry_add(struct msg_adc *data)
 	*adc = *data;
 
 	key32 = adc->ipv4;
-	ret = rte_hash_add_key_data(rte_adc_hash, &key32,
+	ret = fixed_hash_add_key_data(rte_adc_hash, &key32,
 			adc);
 	if (ret < 0){
 		RTE_LOG(ERR, DP, "Failed to add entry in hash table");
 		return -1;
 	}
+	/* flows to the domain take its ADC rule */
+	flow_cache_invalidate();
 	return 0;
 }
 
@@ -730,7 +1412,7 @@ int adc_dns_entry_delete(struct msg_adc *data)
 	uint32_t key32 = 0;
 	int32_t ret;
 	key32 = data->ipv4;
-	ret = rte_hash_lookup_data(rte_adc_hash, &key32,
+	ret = fixed_hash_lookup_data(rte_adc_hash, &key32,
 			(void **)&adc);
 	if (ret < 0) {
 		RTE_LOG(ERR, DP, "Failed to del\n"
@@ -738,12 +1420,12 @@ int adc_dns_entry_delete(struct msg_adc *data)
 				data->ipv4);
 		return -1;
 	}
-	ret = rte_hash_del_key(rte_adc_hash, &key32);
+	ret = fixed_hash_del_key(rte_adc_hash, &key32);
 	if (ret < 0){
 		RTE_LOG(ERR, DP, "Failed to del entry in hash table");
 		return -1;
 	}
-	rte_free(adc);
+	sess_defer_free(SESS_DEFER_HEAP, adc);
 	return 0;
 }
 
@@ -770,7 +1452,7 @@ get_session_data(uint64_t sess_id, uint32_t is_mod)
 		return NULL;
 	}
 
-	rte_hash_lookup_data(rte_sess_hash, &sess_id, (void **)&data);
+	grow_hash_lookup_data(rte_sess_hash, &sess_id, (void **)&data);
 
 	if (data != NULL)
 		return data;
@@ -780,18 +1462,24 @@ get_session_data(uint64_t sess_id, uint32_t is_mod)
 		return NULL;
 
 	/* allocate memory for session info*/
-	data = rte_zmalloc("data", sizeof(struct dp_session_info),
-			RTE_CACHE_LINE_SIZE);
+	data = sess_pool_alloc(SESS_POOL_BEARER);
 	if (data == NULL){
 		RTE_LOG(ERR, DP, "Failed to allocate memory for session info");
 		return NULL;
 	}
+	data->cold = sess_pool_alloc(SESS_POOL_BEARER_COLD);
+	if (data->cold == NULL) {
+		RTE_LOG(ERR, DP, "Failed to allocate memory for session info");
+		sess_pool_free(SESS_POOL_BEARER, data);
+		return NULL;
+	}
 
 	/* add entry*/
-	ret = rte_hash_add_key_data(rte_sess_hash, &sess_id, data);
+	ret = grow_hash_add_key_data(rte_sess_hash, &sess_id, data);
 	if (ret < 0){
 		RTE_LOG(ERR, DP, "Failed to add entry in hash table");
-		rte_free(data);
+		sess_pool_free(SESS_POOL_BEARER_COLD, data->cold);
+		sess_pool_free(SESS_POOL_BEARER, data);
 		return NULL;
 	}
 
@@ -802,21 +1490,23 @@ int
 dp_session_table_create(struct dp_id dp_id, uint32_t max_elements)
 {
 	RTE_SET_USED(dp_id);
-	int rc;
 	if (rte_sess_hash) {
 		RTE_LOG(INFO, DP, "PCC table: \"%s\" exist\n", dp_id.name);
 		return 0;
 	}
-	rc = hash_create(dp_id.name, &rte_sess_hash, max_elements * 4,
+	rte_sess_hash = grow_hash_create(dp_id.name, max_elements * 4,
 			sizeof(uint64_t));
-	return rc;
+	if (rte_sess_hash == NULL)
+		return -1;
+	return 0;
 }
 
 int
 dp_session_table_delete(struct dp_id dp_id)
 {
 	RTE_SET_USED(dp_id);
-	rte_hash_free(rte_sess_hash);
+	grow_hash_free(rte_sess_hash);
+	rte_sess_hash = NULL;
 	return 0;
 }
 
@@ -828,32 +1518,96 @@ copy_session_info(struct dp_session_info *dst,
 	dst->ue_addr = src->ue_addr;
 	dst->ul_s1_info = src->ul_s1_info;
 	dst->dl_s1_info = src->dl_s1_info;
-	dst->num_ul_pcc_rules = src->num_ul_pcc_rules;
-	for (i = 0; i < dst->num_ul_pcc_rules; i++)
-		dst->ul_pcc_rule_id[i] = src->ul_pcc_rule_id[i];
-	dst->num_dl_pcc_rules = src->num_dl_pcc_rules;
-	for (i = 0; i < dst->num_dl_pcc_rules; i++)
-		dst->dl_pcc_rule_id[i] = src->dl_pcc_rule_id[i];
-	dst->ipcan_dp_bearer_cdr = src->ipcan_dp_bearer_cdr;
+	dst->cold->num_ul_pcc_rules = src->num_ul_pcc_rules;
+	for (i = 0; i < dst->cold->num_ul_pcc_rules; i++)
+		dst->cold->ul_pcc_rule_id[i] = src->ul_pcc_rule_id[i];
+	dst->cold->num_dl_pcc_rules = src->num_dl_pcc_rules;
+	for (i = 0; i < dst->cold->num_dl_pcc_rules; i++)
+		dst->cold->dl_pcc_rule_id[i] = src->dl_pcc_rule_id[i];
+	dst->cold->ipcan_dp_bearer_cdr = src->ipcan_dp_bearer_cdr;
 	dst->sess_id = src->sess_id;
 	dst->client_id = src->client_id;
-	dst->service_id = src->service_id;
+	dst->cold->service_id = src->service_id;
 }
 
-int
-dp_session_create(struct dp_id dp_id,
-		struct session_info *entry)
+/**
+ * @brief Remove a bearer that session_add could not complete. It is not
+ * yet linked to the uplink/downlink tables, no worker can hold it.
+ */
+static void
+session_add_undo(struct dp_session_info *data, uint64_t sess_id)
+{
+	grow_hash_del_key(rte_sess_hash, &sess_id);
+	sess_pool_free(SESS_POOL_ENCAP_HDR, data->encap_hdr);
+	sess_pool_free(SESS_POOL_BEARER_COLD, data->cold);
+	sess_pool_free(SESS_POOL_BEARER, data);
+}
+
+/**
+ * @brief Create a bearer session that exists already. Workers use it, so
+ * like a modify the owner worker applies the dl info, outer headers and
+ * sess_state, the iface core updates the rules.
+ */
+static int
+session_readd(struct dp_session_info *data, struct session_info *entry,
+		enum dp_session_state sess_state)
+{
+	struct dp_session_cold new_cold;
+	struct dp_session_info new = { .cold = &new_cold };
+	struct sess_ctrl_msg *msg;
+	struct rte_mbuf *buf_pkt;
+	uint32_t wk_id;
+	int i;
+
+	/* the UE address selects the owner worker and the dl bearer */
+	if (data->ue_addr.u.ipv4_addr != entry->ue_addr.u.ipv4_addr) {
+		RTE_LOG(ERR, DP, "Session id 0x%"PRIx64" exists with another "
+				"UE address\n", entry->sess_id);
+		return -1;
+	}
+
+	copy_session_info(&new, entry);
+
+	buf_pkt = sess_ctrl_prepare(data, SESS_CTRL_CREATE,
+			&new.dl_s1_info, &wk_id);
+	if (buf_pkt == NULL)
+		return -1;
+	msg = rte_pktmbuf_mtod(buf_pkt, struct sess_ctrl_msg *);
+	msg->sess_state = sess_state;
+	if (sess_ctrl_post(buf_pkt, wk_id) < 0)
+		return -1;
+
+	if (entry->num_adc_rules) {
+		struct ue_session_info new_ue_data;
+		new_ue_data.num_adc_rules = entry->num_adc_rules;
+		for (i = 0; i < new_ue_data.num_adc_rules; i++)
+			new_ue_data.adc_rule_id[i] = entry->adc_rule_id[i];
+		update_adc_rules(data->ue_info_ptr, &new_ue_data);
+	}
+	update_pcc_rules(data, &new);
+	data->cold->service_id = entry->service_id;
+	data->cold->ipcan_dp_bearer_cdr = entry->ipcan_dp_bearer_cdr;
+	flow_cache_invalidate();
+
+	return 0;
+}
+
+/**
+ * @brief Add a bearer session, in state sess_state once linked to the
+ * uplink/downlink tables.
+ */
+static int
+session_add(struct session_info *entry, enum dp_session_state sess_state)
 {
-	PRINT_SESSION_INFO(entry);
 	int ret;
 	int i;
 	struct dp_session_info *data;
-	struct dp_session_info new;
+	struct dp_session_cold new_cold;
+	struct dp_session_info new = { .cold = &new_cold };
 	struct ue_session_info *ue_data = NULL;
 	uint32_t ue_sess_id = UE_SESS_ID(entry->sess_id);
 	uint32_t bear_id = UE_BEAR_ID(entry->sess_id);
 
-	RTE_SET_USED(dp_id);
 	RTE_LOG(DEBUG, DP, "BEAR_SESS ADD:sess_id:%u, bear_id:%u, ue_addr:"
 			IPV4_ADDR "\n",
 			ue_sess_id, bear_id,
@@ -878,14 +1632,26 @@ dp_session_create(struct dp_id dp_id,
 		return -1;
 	}
 
+	/* a new bearer has no outer headers yet */
+	if (data->encap_hdr != NULL)
+		return session_readd(data, entry, sess_state);
+
 	copy_session_info(data, entry);
+	data->encap_hdr = sess_pool_alloc(SESS_POOL_ENCAP_HDR);
+	if (data->encap_hdr == NULL) {
+		RTE_LOG(ERR, DP, "Failed to alloc outer headers for "
+				"sess_id:0x%"PRIx64"\n", entry->sess_id);
+		session_add_undo(data, entry->sess_id);
+		return -ENOMEM;
+	}
+	build_gtpu_encap_hdr(data->encap_hdr, &data->dl_s1_info);
 
-	data->num_ul_pcc_rules = 0;
-	data->num_dl_pcc_rules = 0;
+	data->cold->num_ul_pcc_rules = 0;
+	data->cold->num_dl_pcc_rules = 0;
 
 	copy_session_info(&new, entry);
 
-	ret = rte_hash_lookup_data(rte_ue_hash, &ue_sess_id, (void **)&ue_data);
+	ret = grow_hash_lookup_data(rte_ue_hash, &ue_sess_id, (void **)&ue_data);
 	if ((ue_data == NULL) || (ret == -ENOENT)) {
 		/* return if this is not a default bearer and ue_data not created.
 		 * only default bearer can create ue_data.*/
@@ -896,19 +1662,38 @@ dp_session_create(struct dp_id dp_id,
 			 */
 			RTE_LOG(ERR, DP, "BEAR_SESS ADD Fail: Default bearer not found for sess_id:%u, bear_id:%u\n",
 						ue_sess_id, bear_id);
-			rte_hash_del_key(rte_sess_hash, &entry->sess_id);
-			free(data);
-			return 0;
+			session_add_undo(data, entry->sess_id);
+			return -1;
 		}
 		/* add UE data*/
-		ue_data = rte_zmalloc("ue sess info", sizeof(struct ue_session_info),
-				RTE_CACHE_LINE_SIZE);
-		if (ue_data == NULL)
-			rte_panic("Failed to alloc mem for ue session");
-		ret = rte_hash_add_key_data(rte_ue_hash, &ue_sess_id, ue_data);
+		ue_data = sess_pool_alloc(SESS_POOL_UE);
+		if (ue_data == NULL) {
+			RTE_LOG(ERR, DP, "Failed to alloc mem for ue session "
+					"%u\n", ue_sess_id);
+			session_add_undo(data, entry->sess_id);
+			return -ENOMEM;
+		}
+#ifdef RATING_GRP_CDR
+		ue_data->rating_grp = sess_pool_alloc(SESS_POOL_RATING_GRP);
+		if (ue_data->rating_grp == NULL) {
+			RTE_LOG(ERR, DP, "Failed to alloc mem for rating group "
+					"cdr of ue session %u\n", ue_sess_id);
+			sess_pool_free(SESS_POOL_UE, ue_data);
+			session_add_undo(data, entry->sess_id);
+			return -ENOMEM;
+		}
+#endif /* RATING_GRP_CDR */
+		ret = grow_hash_add_key_data(rte_ue_hash, &ue_sess_id, ue_data);
 		if (ret < 0) {
-			rte_panic("Failed to add entry in hash table");
-			return -1;
+			RTE_LOG(ERR, DP, "Failed to add ue session %u in hash "
+					"table\n", ue_sess_id);
+#ifdef RATING_GRP_CDR
+			sess_pool_free(SESS_POOL_RATING_GRP,
+					ue_data->rating_grp);
+#endif /* RATING_GRP_CDR */
+			sess_pool_free(SESS_POOL_UE, ue_data);
+			session_add_undo(data, entry->sess_id);
+			return ret;
 		}
 
 		ue_data->ue_addr = data->ue_addr;
@@ -940,7 +1725,7 @@ dp_session_create(struct dp_id dp_id,
 
 	/* Update UE session info ptr */
 	data->ue_info_ptr = ue_data;
-	data->sess_state = IN_PROGRESS;
+	data->sess_state = sess_state;
 	/* Update adc rules */
 	if (entry->num_adc_rules) {
 		struct ue_session_info new_ue_data;
@@ -957,16 +1742,37 @@ dp_session_create(struct dp_id dp_id,
 	data->client_id = entry->client_id;
 	new.client_id = entry->client_id;
 
+	/* flows of the UE resolve to the new bearer */
+	flow_cache_invalidate();
+
 	return 0;
 }
 
+int
+dp_session_create(struct dp_id dp_id,
+		struct session_info *entry)
+{
+	PRINT_SESSION_INFO(entry);
+	RTE_SET_USED(dp_id);
+
+	return session_add(entry, IN_PROGRESS);
+}
+
+int
+sess_restore_bearer(struct session_info *entry,
+		enum dp_session_state sess_state)
+{
+	return session_add(entry, sess_state);
+}
+
 int
 dp_session_modify(struct dp_id dp_id,
 		struct session_info *entry)
 {
 	PRINT_SESSION_INFO(entry);
 	struct dp_session_info *data;
-	struct dp_session_info mod_data;
+	struct dp_session_cold mod_cold;
+	struct dp_session_info mod_data = { .cold = &mod_cold };
 	uint32_t ue_sess_id = UE_SESS_ID(entry->sess_id);
 	uint32_t bear_id = UE_BEAR_ID(entry->sess_id);
 	int i;
@@ -999,6 +1805,12 @@ dp_session_modify(struct dp_id dp_id,
 
 
 	copy_session_info(&mod_data, entry);
+
+	/* dl information and session state belong to the owner worker,
+	 * the only step that can fail goes first */
+	if (sess_ctrl_send(data, &mod_data.dl_s1_info) < 0)
+		return -1;
+
 	/* Update adc rules */
 	if (entry->num_adc_rules) {
 		struct ue_session_info new_ue_data;
@@ -1011,52 +1823,7 @@ dp_session_modify(struct dp_id dp_id,
 
 	/* Update PCC rules addr*/
 	update_pcc_rules(data, &mod_data);
-
-	/* Copy dl information */
-	struct dl_s1_info *dl_info;
-	dl_info = &data->dl_s1_info;
-	*dl_info = mod_data.dl_s1_info;
-
-	if (!dl_info->enb_teid) {
-		if (data->sess_state == CONNECTED)
-			data->sess_state = IDLE;
-	} else {
-		switch (data->sess_state) {
-		case IDLE:
-			data->sess_state = CONNECTED;
-		break;
-
-		case IN_PROGRESS:
-			{
-			struct ue_session_info *ue_data = NULL;
-			int ret;
-			uint32_t hash;
-			int wk_id;
-			uint32_t ue_sess_id = UE_SESS_ID(entry->sess_id);
-
-			ret = rte_hash_lookup_data(rte_ue_hash, &ue_sess_id,
-					(void **)&ue_data);
-			hash = rte_hash_crc_4byte(ue_data->ue_addr.u.ipv4_addr,
-					PRIME_VALUE);
-			wk_id = hash % (epc_app.num_workers);
-			{
-				struct rte_mbuf *buf_pkt =
-					rte_ctrlmbuf_alloc(
-					epc_app.worker[wk_id].notify_msg_pool);
-				uint64_t *sess =
-					rte_pktmbuf_mtod(buf_pkt, uint64_t *);
-
-				*sess = entry->sess_id;
-				rte_ring_enqueue(
-					epc_app.worker[wk_id].notify_ring,
-					buf_pkt);
-			}
-			}
-		break;
-		default:
-			RTE_LOG(DEBUG, DP, "No state change");
-		}
-	}
+	flow_cache_invalidate();
 
 	return 0;
 }
@@ -1080,21 +1847,21 @@ flush_session_pcc_records(struct dp_session_info *session)
 
 	/* list of pcc rules for all all ul and dl */
 	uint32_t ul_dl_pcc_rules[MAX_PCC_RULES + MAX_PCC_RULES];
-	uint32_t num_ul_dl_pcc_rules = session->num_dl_pcc_rules;
+	uint32_t num_ul_dl_pcc_rules = session->cold->num_dl_pcc_rules;
 
 	/* add all dl pcc rules to list */
-	for (i = 0; i < session->num_dl_pcc_rules; ++i)
-		ul_dl_pcc_rules[i] = session->dl_pcc_rule_id[i];
+	for (i = 0; i < session->cold->num_dl_pcc_rules; ++i)
+		ul_dl_pcc_rules[i] = session->cold->dl_pcc_rule_id[i];
 	/* add all ul pcc rules to list if not added previously */
-	for (i = 0; i < session->num_ul_pcc_rules; i++) {
-		for (j = 0; j < session->num_dl_pcc_rules; ++j) {
-			if (session->ul_pcc_rule_id[i] ==
-					session->dl_pcc_rule_id[j])
+	for (i = 0; i < session->cold->num_ul_pcc_rules; i++) {
+		for (j = 0; j < session->cold->num_dl_pcc_rules; ++j) {
+			if (session->cold->ul_pcc_rule_id[i] ==
+					session->cold->dl_pcc_rule_id[j])
 				break;
 		}
-		if (j == session->num_dl_pcc_rules) {
+		if (j == session->cold->num_dl_pcc_rules) {
 			ul_dl_pcc_rules[num_ul_dl_pcc_rules] =
-					session->ul_pcc_rule_id[i];
+					session->cold->ul_pcc_rule_id[i];
 			++num_ul_dl_pcc_rules;
 		}
 	}
@@ -1105,11 +1872,11 @@ flush_session_pcc_records(struct dp_session_info *session)
 		dl_key.rid = ul_dl_pcc_rules[i];
 		ul_key.rid = ul_dl_pcc_rules[i];
 
-		rte_hash_lookup_data(rte_downlink_hash, &dl_key,
+		fixed_hash_lookup_data(rte_downlink_hash, &dl_key,
 				(void **)&psdf);
 
 		if (psdf == NULL)
-			rte_hash_lookup_data(rte_uplink_hash, &ul_key,
+			fixed_hash_lookup_data(rte_uplink_hash, &ul_key,
 					(void **)&psdf);
 
 		if (psdf == NULL) {
@@ -1156,7 +1923,7 @@ flush_session_adc_records(struct dp_session_info *session)
 		adc_rule_info_get(&adc_id, 1, &m, (void **)&adc_info);
 
 		key.rid = adc_id;
-		if ((rte_hash_lookup_data(rte_adc_ue_hash, &key, (void **)&adc_ue_info)) < 0)
+		if ((grow_hash_lookup_data(rte_adc_ue_hash, &key, (void **)&adc_ue_info)) < 0)
 			continue;
 		export_session_adc_record(adc_info, &adc_ue_info->adc_cdr, session);
 	}
@@ -1183,8 +1950,8 @@ flush_apn_records(struct dp_session_info *session)
 			session->sess_id, (uint8_t)UE_BEAR_ID(session->sess_id),
 			IPV4_ADDR_HOST_FORMAT(session->ue_addr.u.ipv4_addr));
 	dl_key.ue_ipv4 = session->ue_addr.u.ipv4_addr;
-	dl_key.rid = session->dl_pcc_rule_id[0];
-	if ((rte_hash_lookup_data(rte_downlink_hash, &dl_key,
+	dl_key.rid = session->cold->dl_pcc_rule_id[0];
+	if ((fixed_hash_lookup_data(rte_downlink_hash, &dl_key,
 			(void **)&psdf)) < 0)
 		return;
 	flush_apn_mtr(psdf);
@@ -1203,7 +1970,7 @@ static void
 export_bearer_cdr_record(struct dp_session_info *session)
 {
 	export_cdr_record(session, "BEARER",
-				UE_BEAR_ID(session->sess_id), &session->ipcan_dp_bearer_cdr);
+				UE_BEAR_ID(session->sess_id), &session->cold->ipcan_dp_bearer_cdr);
 }
 
 /**
@@ -1226,7 +1993,7 @@ export_adc_cdr_record(struct dp_session_info *session)
 	key.ue_ipv4 = session->ue_addr.u.ipv4_addr;
 	for (i = 0; i < session->ue_info_ptr->num_adc_rules; i++) {
 		key.rid = session->ue_info_ptr->adc_rule_id[i];
-		if ((rte_hash_lookup_data(rte_adc_ue_hash, &key, (void **)&adc_ue_info)) < 0) {
+		if ((grow_hash_lookup_data(rte_adc_ue_hash, &key, (void **)&adc_ue_info)) < 0) {
 			RTE_LOG(ERR, DP, "CDR read error for session id 0x%"PRIx64", ADC %d, "IPV4_ADDR"\n",
 			session->sess_id, key.rid,
 			IPV4_ADDR_HOST_FORMAT(session->ue_addr.u.ipv4_addr));
@@ -1255,21 +2022,21 @@ export_flow_cdr_record(struct dp_session_info *session)
 
 	/* list of pcc rules for all all ul and dl */
 	uint32_t ul_dl_pcc_rules[MAX_PCC_RULES + MAX_PCC_RULES];
-	uint32_t num_ul_dl_pcc_rules = session->num_dl_pcc_rules;
+	uint32_t num_ul_dl_pcc_rules = session->cold->num_dl_pcc_rules;
 
 	/* add all dl pcc rules to list */
-	for (i = 0; i < session->num_dl_pcc_rules; ++i)
-		ul_dl_pcc_rules[i] = session->dl_pcc_rule_id[i];
+	for (i = 0; i < session->cold->num_dl_pcc_rules; ++i)
+		ul_dl_pcc_rules[i] = session->cold->dl_pcc_rule_id[i];
 	/* add all ul pcc rules to list if not added previously */
-	for (i = 0; i < session->num_ul_pcc_rules; i++) {
-		for (j = 0; j < session->num_dl_pcc_rules; ++j) {
-			if (session->ul_pcc_rule_id[i] ==
-					session->dl_pcc_rule_id[j])
+	for (i = 0; i < session->cold->num_ul_pcc_rules; i++) {
+		for (j = 0; j < session->cold->num_dl_pcc_rules; ++j) {
+			if (session->cold->ul_pcc_rule_id[i] ==
+					session->cold->dl_pcc_rule_id[j])
 				break;
 		}
-		if (j == session->num_dl_pcc_rules) {
+		if (j == session->cold->num_dl_pcc_rules) {
 			ul_dl_pcc_rules[num_ul_dl_pcc_rules] =
-					session->ul_pcc_rule_id[i];
+					session->cold->ul_pcc_rule_id[i];
 			++num_ul_dl_pcc_rules;
 		}
 	}
@@ -1280,11 +2047,11 @@ export_flow_cdr_record(struct dp_session_info *session)
 		dl_key.rid = ul_dl_pcc_rules[i];
 		ul_key.rid = ul_dl_pcc_rules[i];
 
-		rte_hash_lookup_data(rte_downlink_hash, &dl_key,
+		fixed_hash_lookup_data(rte_downlink_hash, &dl_key,
 				(void **)&psdf);
 
 		if (psdf == NULL)
-			rte_hash_lookup_data(rte_uplink_hash, &ul_key,
+			fixed_hash_lookup_data(rte_uplink_hash, &ul_key,
 					(void **)&psdf);
 
 		if (psdf == NULL) {
@@ -1307,49 +2074,24 @@ dp_session_delete(struct dp_id dp_id,
 {
 	PRINT_SESSION_INFO(entry);
 	struct dp_session_info *data;
+	struct rte_mbuf *buf_pkt;
+	uint32_t wk_id;
 	RTE_SET_USED(dp_id);
 	data = get_session_data(entry->sess_id, SESS_MODIFY);
 	if (data == NULL) {
 		printf("Session id 0x%"PRIx64" not found\n", entry->sess_id);
 		return -1;
 	}
-	if (data->dl_ring != NULL) {
-		uint32_t worker_core_id;
-		uint32_t ue_ipv4_hash;
-		set_ue_ipv4_hash(&ue_ipv4_hash, &data->ue_addr.u.ipv4_addr);
-		set_worker_core_id(&worker_core_id, &ue_ipv4_hash);
-		struct epc_worker_params *wk_params =
-				&epc_app.worker[worker_core_id];
-
-		struct rte_ring *ring = data->dl_ring;
-
-		data->dl_ring = NULL;
-		/* This is going to be nasty. We could potentially have a race
-		 * condition if modify bearer occurs directly before a delete
-		 * session, causing scan_notify_ring_func to work on the same
-		 * ring as this function. For our current tests, we *should* be
-		 * okay. For now.
-		 */
-
-		struct rte_mbuf *m[MAX_BURST_SZ];
-		int ret;
-		int i;
-		int count = 0;
-
-		do {
-			ret = rte_ring_sc_dequeue_burst(ring,
-					(void **)m, MAX_BURST_SZ);
-			for (i = 0; i < ret; ++i)
-				rte_pktmbuf_free(m[i]);
-			count += ret;
-		} while (ret);
-
-		if (rte_ring_enqueue(wk_params->dl_ring_container, ring) ==
-				ENOBUFS) {
-			RTE_LOG(ERR, DP, "Can't put ring back, so free it - "
-					"dropped %d pkts\n", count);
-			rte_ring_free(ring);
-		}
+	/* dl_ring and the bearer itself are released by the owner worker,
+	 * nothing is unlinked before the command is known to be sendable */
+	buf_pkt = sess_ctrl_prepare(data, SESS_CTRL_DELETE, NULL, &wk_id);
+	if (buf_pkt == NULL)
+		return -1;
+
+	/* remove entry from session hash table*/
+	if (grow_hash_del_key(rte_sess_hash, &entry->sess_id) < 0) {
+		sess_ctrl_cancel(buf_pkt);
+		return -1;
 	}
 
 #ifdef ADC_UPFRONT
@@ -1366,9 +2108,9 @@ dp_session_delete(struct dp_id dp_id,
 	export_flow_cdr_record(data);
 
 
-	struct dp_session_info new;
+	struct dp_session_cold new_cold = {0};
+	struct dp_session_info new = { .cold = &new_cold };
 
-	memset(&new, 0, sizeof(struct dp_session_info));
 	/* Update PCC rules addr*/
 	update_pcc_rules(data, &new);
 	/* Update adc rules */
@@ -1378,10 +2120,17 @@ dp_session_delete(struct dp_id dp_id,
 		update_adc_rules(data->ue_info_ptr, &new_ue_data);
 	}
 
-	/* remove entry from session hash table*/
-	if (rte_hash_del_key(rte_sess_hash, &entry->sess_id) < 0)
+	/* data is freed by sess_ctrl_reclaim once the worker is done */
+	if (sess_ctrl_post(buf_pkt, wk_id) < 0) {
+		/* the bearer is unlinked already, free it here, its dl ring
+		 * stays with the owner worker */
+		RTE_LOG(ERR, DP, "Delete of sess_id:0x%"PRIx64" not sent, "
+				"dl ring leaked\n", data->sess_id);
+		sess_defer_free(SESS_POOL_ENCAP_HDR, data->encap_hdr);
+		sess_defer_free(SESS_POOL_BEARER_COLD, data->cold);
+		sess_defer_free(SESS_POOL_BEARER, data);
 		return -1;
-	rte_free(data);
+	}
 	return 0;
 }
 
@@ -1555,12 +2304,34 @@ cb_session_delete(struct msgbuf *msg_payload)
 			msg_payload->msg_union.sess_entry);
 }
 
+void sess_tbl_resize_step(void)
+{
+	/* replaced outer headers, also when no more modify comes */
+	if (sess_ctrl_done_ring != NULL)
+		sess_ctrl_reclaim();
+	if (rte_sess_hash != NULL)
+		grow_hash_step(rte_sess_hash);
+	grow_hash_step(rte_ue_hash);
+	grow_hash_step(rte_adc_ue_hash);
+}
+
 /**
  * Initialization of Session Table Callback functions.
  */
 void
 app_sess_tbl_init(void)
 {
+	/* downlink fast path fields must share the first cache line */
+	RTE_BUILD_BUG_ON(offsetof(struct dp_session_info, sess_state) +
+			sizeof(enum dp_session_state) > RTE_CACHE_LINE_SIZE);
+#ifdef UL_TEID_TABLE
+	ul_teid_tbl_init();
+#endif
+	dl_ue_pool_tbl_init();
+	sess_ctrl_done_ring = rte_ring_create("sess_ctrl_done",
+			SESS_CTRL_DONE_SIZE, rte_socket_id(), RING_F_SC_DEQ);
+	if (sess_ctrl_done_ring == NULL)
+		rte_panic("Failed to create sess_ctrl_done ring\n");
 	/* register msg type in DB*/
 	iface_ipc_register_msg_cb(MSG_SESS_TBL_CRE, cb_session_table_create);
 	iface_ipc_register_msg_cb(MSG_SESS_TBL_DES, cb_session_table_delete);
@@ -17,6 +17,9 @@
 #include <string.h>
 #include <sched.h>
 #include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
 
 #include <rte_ring.h>
 #include <rte_pipeline.h>
@@ -48,6 +51,14 @@
 #include "meter.h"
 #include "acl.h"
 #include "commands.h"
+#include "sess_pool.h"
+#include "grow_hash.h"
+#include "flow_cache.h"
+#include "cdr.h"
+
+extern struct grow_hash *rte_sess_hash;
+extern struct grow_hash *rte_ue_hash;
+extern struct grow_hash *rte_adc_ue_hash;
 
 #ifdef MTR_STATS
 
@@ -144,15 +155,19 @@ void display_pip_ictrs(void)
 	uint32_t i = 0;
 
 	printf("----- Ring IN counters ------\n");
-	display_pip_istats(epc_app.rx_params[0].pipeline,
-			epc_app.rx_params[0].name, 0);
-	display_pip_istats(epc_app.rx_params[1].pipeline,
-			epc_app.rx_params[1].name, 0);
+	for (i = 0; i < epc_app.n_rx_queues; i++) {
+		display_pip_istats(epc_app.rx_params[0][i].pipeline,
+				epc_app.rx_params[0][i].name, 0);
+		display_pip_istats(epc_app.rx_params[1][i].pipeline,
+				epc_app.rx_params[1][i].name, 0);
+	}
 
+#ifndef RX_WORKER_DIRECT
 	display_pip_istats(epc_app.lb_params.pipeline, epc_app.lb_params.name,
 			0);
 	display_pip_istats(epc_app.lb_params.pipeline, epc_app.lb_params.name,
 			1);
+#endif
 
 	for (i = 0; i < epc_app.num_workers; i++) {
 		display_pip_istats(epc_app.worker[i].pipeline,
@@ -163,12 +178,14 @@ void display_pip_ictrs(void)
 			"ddn", epc_app.worker[i].port_in_id[NUM_SPGW_PORTS]);
 	}
 
+#ifndef TX_WORKER_DIRECT
 	for (i = 0; i < epc_app.num_workers; i++) {
 		display_pip_istats(epc_app.tx_params[0].pipeline,
 				epc_app.tx_params[0].name, i);
 		display_pip_istats(epc_app.tx_params[1].pipeline,
 				epc_app.tx_params[1].name, i);
 	}
+#endif
 }
 
 #endif /* STATS */
@@ -195,11 +212,14 @@ display_pip_octrs(void)
 	uint32_t i = 0;
 
 	printf("----- Ring OUT counters ------\n");
-	display_pip_ostats(epc_app.rx_params[0].pipeline,
-			epc_app.rx_params[0].name, 0);
-	display_pip_ostats(epc_app.rx_params[1].pipeline,
-			epc_app.rx_params[1].name, 0);
+	for (i = 0; i < epc_app.n_rx_queues; i++) {
+		display_pip_ostats(epc_app.rx_params[0][i].pipeline,
+				epc_app.rx_params[0][i].name, 0);
+		display_pip_ostats(epc_app.rx_params[1][i].pipeline,
+				epc_app.rx_params[1][i].name, 0);
+	}
 
+#ifndef RX_WORKER_DIRECT
 	for (i = 0; i < epc_app.num_workers; i++) {
 		unsigned core_id = epc_app.worker_cores[i];
 		display_pip_ostats(epc_app.lb_params.pipeline,
@@ -209,6 +229,7 @@ display_pip_octrs(void)
 				epc_app.lb_params.name,
 				epc_app.lb_params.port_out_id[core_id][1]);
 	}
+#endif
 
 	for (i = 0; i < epc_app.num_workers; i++) {
 		display_pip_ostats(epc_app.worker[i].pipeline,
@@ -217,10 +238,16 @@ display_pip_octrs(void)
 				epc_app.worker[i].name, 1);
 	}
 
+#ifndef TX_WORKER_DIRECT
 	display_pip_ostats(epc_app.tx_params[0].pipeline,
 			epc_app.tx_params[0].name, 0);
 	display_pip_ostats(epc_app.tx_params[1].pipeline,
 			epc_app.tx_params[1].name, 0);
+#endif
+#ifdef RETA_BALANCE
+	printf(" RETA migrations: %10" PRIu64 " held drops: %10" PRIu64 "\n",
+			epc_app.reta_migrations, epc_app.reta_drops);
+#endif
 
 }
 #endif
@@ -266,11 +293,21 @@ void display_ah_ctrs(void)
 
 #ifdef INSTMNT
 
-uint64_t diff_tsc_wrkr, total_wrkr_pkts_processed;
-uint32_t flag_wrkr_update_diff;
-
 void display_instmnt_wrkr(void)
 {
+	uint64_t diff_tsc_wrkr = 0, total_wrkr_pkts_processed = 0;
+	unsigned i;
+
+	for (i = 0; i < epc_app.num_workers; i++) {
+		struct epc_worker_params *wk = &epc_app.worker[i];
+
+		if (wk->instmnt_pkts)
+			printf("  Wrkr %u cycles per packet:     %10" PRIu64 "\n",
+					i, wk->instmnt_cycles / wk->instmnt_pkts);
+		diff_tsc_wrkr += wk->instmnt_cycles;
+		total_wrkr_pkts_processed += wk->instmnt_pkts;
+	}
+
 	printf("  Total cycles taken by wrkr:      %10" PRIu64 "\n",
 			diff_tsc_wrkr);
 
@@ -282,7 +319,183 @@ void display_instmnt_wrkr(void)
 				diff_tsc_wrkr / total_wrkr_pkts_processed);
 
 }
+
+void display_instmnt_rx(void)
+{
+	unsigned i, j;
+
+	for (i = 0; i < NUM_SPGW_PORTS; i++) {
+		for (j = 0; j < epc_app.n_rx_queues; j++) {
+			struct epc_rx_params *rx = &epc_app.rx_params[i][j];
+
+			if (rx->instmnt_pkts)
+				printf("  %s cycles per packet: %10" PRIu64 "\n",
+						rx->name,
+						rx->instmnt_cycles / rx->instmnt_pkts);
+		}
+	}
+}
 #endif
+static void display_grow_hash(const struct grow_hash *gh)
+{
+	uint64_t us = rte_get_tsc_hz() / US_PER_S;
+
+	if (gh == NULL)
+		return;
+
+	printf("  %-16s %10u %10u %4u%% %8" PRIu64 " %12" PRIu64
+			" %12" PRIu64 " %8" PRIu64 " %8" PRIu64 "%s\n",
+			gh->name, gh->count, gh->capacity, grow_hash_load(gh),
+			gh->resizes, gh->last_resize_cycles / us,
+			gh->max_resize_cycles / us, gh->add_fail, gh->move_fail,
+			gh->old != NULL ? " resizing" : "");
+}
+
+void display_sess_mem(void)
+{
+	struct sess_pool *pool;
+	uint64_t in_use, total = 0;
+	unsigned i;
+
+	printf("\n  Session table memory\n");
+	printf("  %-24s %6s %10s %10s %10s %10s\n", "object", "size",
+			"in use", "free", "allocs", "failed");
+	for (i = 0; i < SESS_POOL_MAX; i++) {
+		pool = &sess_pools[i];
+		if (pool->mp == NULL)
+			continue;
+
+		in_use = sess_pool_in_use(i);
+		total += in_use * pool->elt_size;
+		printf("  %-24s %6u %10" PRIu64 " %10u %10" PRIu64
+				" %10" PRIu64 "\n",
+				pool->name, pool->elt_size, in_use,
+				rte_mempool_count(pool->mp),
+				pool->alloc, pool->alloc_fail);
+	}
+
+	printf("  Total in use:            %12" PRIu64 " B\n", total);
+	in_use = sess_pool_in_use(SESS_POOL_BEARER);
+	if (in_use)
+		printf("  Per bearer:              %12" PRIu64 " B\n",
+				total / in_use);
+
+	printf("\n  Session hash tables\n");
+	printf("  %-16s %10s %10s %5s %8s %12s %12s %8s %8s\n", "table",
+			"entries", "capacity", "load", "resizes",
+			"last us", "max us", "failed", "retried");
+	display_grow_hash(rte_sess_hash);
+	display_grow_hash(rte_ue_hash);
+	display_grow_hash(rte_adc_ue_hash);
+}
+
+/** Max. DP hash tables reported */
+#define MAX_OCC_TABLES		8
+/** Hash table occupancy export file, in the CDR directory */
+#define HASH_OCC_FILE		"hash_occupancy.csv"
+
+static inline double
+occ_pct(uint64_t n, uint64_t total)
+{
+	return total ? (double)n * 100 / total : 0;
+}
+
+void display_hash_occupancy(void)
+{
+	struct hash_occupancy occ[MAX_OCC_TABLES];
+	unsigned i, j, n;
+
+	n = sess_tbl_occupancy(occ, MAX_OCC_TABLES);
+
+	printf("\n  Hash table occupancy\n");
+	printf("  %-12s %10s %10s %6s %6s %6s  %s\n", "table", "entries",
+			"capacity", "load", "alt", "probes",
+			"% buckets with 0..n entries");
+	for (i = 0; i < n; i++) {
+		printf("  %-12s %10" PRIu64 " %10" PRIu64 " %5.1f%% %5.1f%%"
+				" %6.2f ", occ[i].name, occ[i].entries,
+				occ[i].capacity,
+				occ_pct(occ[i].entries, occ[i].capacity),
+				occ_pct(occ[i].alt, occ[i].entries),
+				occ[i].entries ?
+				(double)occ[i].probes / occ[i].entries : 0);
+		for (j = 0; j <= occ[i].bucket_entries; j++)
+			printf(" %5.1f", occ_pct(occ[i].hist[j],
+						occ[i].buckets));
+		printf("\n");
+	}
+}
+
+int export_hash_occupancy(void)
+{
+	struct hash_occupancy occ[MAX_OCC_TABLES];
+	char filename[PATH_MAX];
+	char time_str[RECORD_TIME_LENGTH];
+	time_t t = time(NULL);
+	struct tm *tmp = localtime(&t);
+	unsigned i, j, n;
+	long pos;
+	FILE *f;
+
+	snprintf(filename, sizeof(filename), "%s"HASH_OCC_FILE, cdr_path);
+	f = fopen(filename, "a");
+	if (f == NULL) {
+		RTE_LOG(ERR, DP, "Cannot open %s: %s\n", filename,
+				strerror(errno));
+		return -1;
+	}
+
+	if (tmp == NULL ||
+			!strftime(time_str, sizeof(time_str),
+				RECORD_TIME_FORMAT, tmp))
+		time_str[0] = '\0';
+
+	pos = ftell(f);
+	if (pos == 0) {
+		fprintf(f, "#time,table,entries,capacity,buckets,"
+				"alt_entries,probes");
+		for (j = 0; j <= HASH_OCC_BUCKET_ENTRIES; j++)
+			fprintf(f, ",buckets_%u", j);
+		fprintf(f, "\n");
+	}
+
+	n = sess_tbl_occupancy(occ, MAX_OCC_TABLES);
+	for (i = 0; i < n; i++) {
+		fprintf(f, "%s,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+				",%" PRIu64, time_str, occ[i].name,
+				occ[i].entries, occ[i].capacity,
+				occ[i].buckets, occ[i].alt, occ[i].probes);
+		for (j = 0; j <= HASH_OCC_BUCKET_ENTRIES; j++)
+			fprintf(f, ",%" PRIu64, occ[i].hist[j]);
+		fprintf(f, "\n");
+	}
+
+	fclose(f);
+	printf("  Hash table occupancy appended to %s\n", filename);
+	return 0;
+}
+
+#ifdef FLOW_CACHE
+void display_flow_cache_stats(void)
+{
+	struct flow_cache *fc;
+	uint32_t i;
+
+	printf("\n  Flow cache, epoch %" PRIu64 "\n", flow_cache_epoch);
+	printf("  %-16s %12s %12s %12s %6s\n", "worker", "hits", "misses",
+			"stale", "hit");
+	for (i = 0; i < epc_app.num_workers; i++) {
+		fc = epc_app.worker[i].flow_cache;
+		if (fc == NULL)
+			continue;
+		printf("  %-16s %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+				" %5.1f%%\n", epc_app.worker[i].name,
+				fc->hits, fc->misses, fc->stale,
+				occ_pct(fc->hits, fc->hits + fc->misses));
+	}
+}
+#endif	/* FLOW_CACHE */
+
 #ifdef STATS
 void display_nic_stats(void)
 {
@@ -361,8 +574,12 @@ static void timer_cb(__attribute__ ((unused))
 #ifdef DNS_STATS
 	display_dns_stats();
 #endif
+#ifdef FLOW_CACHE
+	display_flow_cache_stats();
+#endif
 
 #ifdef INSTMNT
+	display_instmnt_rx();
 	display_instmnt_wrkr();
 #endif
 #ifdef AH_STATS
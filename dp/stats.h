@@ -105,6 +105,67 @@ void display_ah_ctrs(void);
  */
 void display_instmnt_wrkr(void);
 
+/**
+ * Function to display cycles per packet of the RX classifiers.
+ *
+ * @param
+ *	Void
+ *
+ * @return
+ *	None
+ */
+void display_instmnt_rx(void);
+
+/**
+ * Function to display size and count of the session table objects and
+ * the memory used per bearer.
+ *
+ * @param
+ *	Void
+ *
+ * @return
+ *	None
+ */
+void display_sess_mem(void);
+
+/**
+ * Function to display entries, load factor, bucket occupancy histogram,
+ * keys outside their primary bucket and average probes per key of the
+ * DP hash tables.
+ *
+ * @param
+ *	Void
+ *
+ * @return
+ *	None
+ */
+void display_hash_occupancy(void);
+
+/**
+ * Function to append the hash table occupancy, one record per table, to
+ * HASH_OCC_FILE in the CDR directory.
+ *
+ * @param
+ *	Void
+ *
+ * @return
+ *	- 0 on success
+ *	- -1 if the file cannot be opened
+ */
+int export_hash_occupancy(void);
+
+/**
+ * Function to display the flow cache hits, misses and misses on flows
+ * of an old epoch of each worker.
+ *
+ * @param
+ *	Void
+ *
+ * @return
+ *	None
+ */
+void display_flow_cache_stats(void);
+
 /**
  * Core to print the pipeline stats.
  *
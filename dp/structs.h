@@ -31,6 +31,21 @@ struct filter_pcc_data {
 enum filter_pcc_type {
 	FILTER_SDF,		/* SDF filter type */
 	FILTER_ADC,		/* ADC filter type */
+	FILTER_TYPES,
 };
 
+/* PCC decision of a SDF/ADC rule, resolved when the ACL is built */
+struct pcc_decision {
+	uint32_t pcc_id;		/* pcc rule id, 0 none */
+	uint8_t precedence;		/* precedence */
+	uint8_t gate_status;	/* gate status */
+	uint16_t ul_mtr_idx;	/* uplink meter profile index */
+	uint16_t dl_mtr_idx;	/* downlink meter profile index */
+	uint16_t pad;
+	uint32_t rating_group;	/* rating group */
+};
+
+/* PCC decision tables, one per ACL table (active and standby) */
+#define PCC_DECISION_TBLS	2
+
 #endif /*_STRUCTS_H_ */
@@ -56,6 +56,10 @@ enum dp_msg_type {
 	MSG_EXP_CDR,
 	/* DDN from DP to CP*/
 	MSG_DDN,
+	/* Session snapshot restore, DP replies*/
+	MSG_SESS_RESTORE,
+	/* Commit of staged SDF & ADC filters*/
+	MSG_FILTER_COMMIT,
 
 	MSG_END,
 };
@@ -81,6 +85,7 @@ struct msgbuf {
 		struct mtr_entry mtr_entry;
 		struct cb_args_table msg_table;
 		struct msg_ue_cdr ue_cdr;
+		struct msg_sess_restore sess_restore;
 	} msg_union;
 };
 struct msgbuf sbuf;
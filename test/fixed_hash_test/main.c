@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the fixed key hash of the bearer and ADC domain tables with keys
+ * colliding on their home bucket: they probe into the next buckets, are
+ * found single and in bursts, deletes keep the others reachable, and a
+ * key is refused once all the buckets it may probe are full.
+ *
+ * Usage: fixed_hash_test <EAL options>
+ * Exits with 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include <rte_eal.h>
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_lcore.h>
+
+#include "fixed_hash.h"
+
+#define UE_BASE		0x0a000000
+/** Sized for 16 buckets, every bucket is probed by a full home bucket */
+#define ENTRIES		64
+/** Keys filling all the buckets a key may probe */
+#define MAX_KEYS	(FIXED_HASH_MAX_PROBE * FIXED_HASH_BUCKET_ENTRIES)
+
+#define CHECK(cond, ...) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s:%d: ", __func__, __LINE__);		\
+		printf(__VA_ARGS__);					\
+		printf("\n");						\
+		return -1;						\
+	}								\
+} while (0)
+
+/**
+ * Keys shaped like the DP keys, UE addresses with a rule id for 8 byte
+ * keys, with the same home bucket as the first one.
+ */
+static void
+colliding_keys(const struct fixed_hash *h, uint32_t key_len,
+		uint64_t *keys, uint32_t n)
+{
+	const struct fixed_hash_bucket *home = NULL;
+	uint64_t key;
+	uint32_t i = 0, ue;
+
+	for (ue = UE_BASE; i < n; ue++) {
+		key = ue;
+		if (key_len == sizeof(uint64_t))
+			key |= 1ULL << 32;
+		if (home == NULL)
+			home = fixed_hash_bucket_addr(h, &key);
+		if (fixed_hash_bucket_addr(h, &key) == home)
+			keys[i++] = key;
+	}
+}
+
+static void *key_data(uint32_t i)
+{
+	return (void *)(uintptr_t)(i + 1);
+}
+
+/**
+ * Check that keys [0, n) are found with their data, single and in bursts,
+ * and keys [n, m) are not.
+ */
+static int
+check_keys(const struct fixed_hash *h, const uint64_t *keys, uint32_t n,
+		uint32_t m)
+{
+	const void *key_ptr[RTE_HASH_LOOKUP_BULK_MAX];
+	void *data[RTE_HASH_LOOKUP_BULK_MAX];
+	uint64_t hit_mask;
+	uint32_t i, j, burst;
+	void *d;
+
+	for (i = 0; i < m; i++) {
+		d = NULL;
+		if (i < n)
+			CHECK(fixed_hash_lookup_data(h, &keys[i], &d) == 0 &&
+					d == key_data(i),
+					"key %u not found", i);
+		else
+			CHECK(fixed_hash_lookup_data(h, &keys[i], &d) ==
+					-ENOENT && d == NULL,
+					"key %u found", i);
+	}
+
+	for (i = 0; i < m; i += burst) {
+		burst = RTE_MIN(m - i, (uint32_t)RTE_HASH_LOOKUP_BULK_MAX);
+		for (j = 0; j < burst; j++)
+			key_ptr[j] = &keys[i + j];
+		fixed_hash_lookup_bulk_data(h, key_ptr, burst, &hit_mask,
+				data);
+		for (j = 0; j < burst; j++) {
+			CHECK(!(hit_mask & (1ULL << j)) == (i + j >= n),
+					"key %u: wrong hit in burst", i + j);
+			CHECK(i + j >= n || data[j] == key_data(i + j),
+					"key %u: wrong data in burst", i + j);
+		}
+	}
+	return 0;
+}
+
+static int test_collisions(uint32_t key_len)
+{
+	uint64_t keys[MAX_KEYS + 1];
+	struct fixed_hash *h;
+	struct fixed_hash_bucket *home;
+	uint32_t i, n;
+	void *d;
+
+	h = fixed_hash_create("fh_collide", ENTRIES, key_len,
+			rte_socket_id());
+	CHECK(h != NULL, "create failed");
+	CHECK(h->num_buckets == FIXED_HASH_MAX_PROBE, "%u buckets",
+			h->num_buckets);
+
+	colliding_keys(h, key_len, keys, RTE_DIM(keys));
+	home = fixed_hash_bucket_addr(h, &keys[0]);
+
+	/* three buckets: the home bucket and two probed past it */
+	n = 3 * FIXED_HASH_BUCKET_ENTRIES;
+	for (i = 0; i < n; i++)
+		CHECK(fixed_hash_add_key_data(h, &keys[i], key_data(i)) == 0,
+				"add of key %u failed", i);
+	CHECK(h->count == n, "count %u", h->count);
+	CHECK(home->ovf == n - FIXED_HASH_BUCKET_ENTRIES, "home ovf %u",
+			home->ovf);
+	if (check_keys(h, keys, n, n + 1) < 0)
+		return -1;
+
+	/* a delete in the home bucket keeps the keys past it reachable */
+	CHECK(fixed_hash_del_key(h, &keys[0]) == 0, "del of key 0");
+	CHECK(fixed_hash_del_key(h, &keys[0]) == -ENOENT, "second del");
+	CHECK(home->ovf == n - FIXED_HASH_BUCKET_ENTRIES, "home ovf %u",
+			home->ovf);
+	CHECK(fixed_hash_lookup_data(h, &keys[0], &d) == -ENOENT,
+			"key 0 found after del");
+	for (i = 1; i < n; i++)
+		CHECK(fixed_hash_lookup_data(h, &keys[i], &d) == 0 &&
+				d == key_data(i),
+				"key %u lost after del of key 0", i);
+
+	/* re-added, it takes the free entry of its home bucket */
+	CHECK(fixed_hash_add_key_data(h, &keys[0], key_data(0)) == 0,
+			"re-add of key 0");
+	CHECK(home->ovf == n - FIXED_HASH_BUCKET_ENTRIES, "home ovf %u",
+			home->ovf);
+
+	/* an add of a stored key updates its data */
+	CHECK(fixed_hash_add_key_data(h, &keys[n - 1], key_data(0)) == 0,
+			"update of key %u", n - 1);
+	CHECK(h->count == n, "count %u after update", h->count);
+	CHECK(fixed_hash_add_key_data(h, &keys[n - 1], key_data(n - 1)) == 0,
+			"update of key %u", n - 1);
+
+	/* the last key probed past the home bucket */
+	CHECK(fixed_hash_del_key(h, &keys[n - 1]) == 0, "del of key %u",
+			n - 1);
+	CHECK(home->ovf == n - FIXED_HASH_BUCKET_ENTRIES - 1, "home ovf %u",
+			home->ovf);
+	if (check_keys(h, keys, n - 1, n) < 0)
+		return -1;
+
+	/* every bucket is full of keys of one home bucket */
+	for (i = n - 1; i < MAX_KEYS; i++)
+		CHECK(fixed_hash_add_key_data(h, &keys[i], key_data(i)) == 0,
+				"add of key %u failed", i);
+	CHECK(fixed_hash_add_key_data(h, &keys[MAX_KEYS], NULL) == -ENOSPC,
+			"add past the last probed bucket");
+	CHECK(h->count == MAX_KEYS, "count %u", h->count);
+	if (check_keys(h, keys, MAX_KEYS, MAX_KEYS + 1) < 0)
+		return -1;
+
+	for (i = 0; i < MAX_KEYS; i++)
+		CHECK(fixed_hash_del_key(h, &keys[i]) == 0, "del of key %u", i);
+	CHECK(h->count == 0, "count %u", h->count);
+	for (i = 0; i < h->num_buckets; i++)
+		CHECK(h->buckets[i].ovf == 0, "bucket %u ovf %u", i,
+				h->buckets[i].ovf);
+
+	fixed_hash_free(h);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret, fail = 0;
+
+	ret = rte_eal_init(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
+
+	if (fixed_hash_create("fh_bad", ENTRIES, 2, rte_socket_id()) != NULL) {
+		printf("FAIL: 2 byte keys accepted\n");
+		fail++;
+	}
+	if (test_collisions(sizeof(uint32_t)) < 0)
+		fail++;
+	if (test_collisions(sizeof(uint64_t)) < 0)
+		fail++;
+
+	printf("fixed_hash_test: %s\n", fail ? "FAIL" : "PASS");
+	return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
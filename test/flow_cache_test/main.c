@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the worker flow cache: a flow inserted with the epoch of its
+ * burst is hit by the next bursts, an invalidation makes every entry miss
+ * until it is resolved again, and flows differing in any key field do not
+ * hit each other.
+ *
+ * Usage: flow_cache_test <EAL options>
+ * Exits with 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+
+#include <rte_eal.h>
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_lcore.h>
+
+#include "flow_cache.h"
+
+#define BURST		32
+#define UE_BASE		0x0a000000
+#define REMOTE_BASE	0xc0000000
+#define UL_DIR		1
+#define DL_DIR		2
+
+#define CHECK(cond, ...) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s:%d: ", __func__, __LINE__);		\
+		printf(__VA_ARGS__);					\
+		printf("\n");						\
+		return -1;						\
+	}								\
+} while (0)
+
+/**
+ * Downlink flows of one UE per key, to distinct remote ports.
+ */
+static void set_keys(struct flow_key *key, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		flow_key_set(&key[i], IPPROTO_UDP, htonl(REMOTE_BASE),
+				htonl(UE_BASE + i), htons(1024 + i), htons(53),
+				0, DL_DIR);
+}
+
+/**
+ * Look a burst up, resolve and insert the flows missed as a worker does.
+ * Returns the hit mask.
+ */
+static uint64_t
+resolve(struct flow_cache *fc, const struct flow_key *key, uint32_t n)
+{
+	struct flow_cache_entry *ent[BURST];
+	uint64_t hit_mask, epoch;
+	uint32_t i;
+
+	hit_mask = flow_cache_lookup(fc, key, n, RTE_LEN2MASK(n, uint64_t),
+			ent, &epoch);
+	for (i = 0; i < n; i++) {
+		if (hit_mask & (1ULL << i))
+			continue;
+		ent[i]->sdf_rule_id = i + 1;
+		ent[i]->bearer = (void *)(uintptr_t)(i + 1);
+		flow_cache_insert(ent[i], &key[i], epoch);
+	}
+	return hit_mask;
+}
+
+static int test_epoch(void)
+{
+	struct flow_key key[BURST];
+	struct flow_cache_entry *ent[BURST];
+	struct flow_cache *fc;
+	uint64_t all = RTE_LEN2MASK(BURST, uint64_t);
+	uint64_t hit_mask, epoch, stale;
+	uint32_t i;
+
+	fc = flow_cache_create("fc_test", rte_socket_id());
+	set_keys(key, BURST);
+
+	/* zeroed entries never hit, not even a zeroed key */
+	memset(&key[0], 0, sizeof(key[0]));
+	CHECK(resolve(fc, key, BURST) == 0, "hit in an empty cache");
+	CHECK(fc->misses == BURST && fc->hits == 0,
+			"%" PRIu64 " misses, %" PRIu64 " hits",
+			fc->misses, fc->hits);
+
+	CHECK(resolve(fc, key, BURST) == all, "inserted flows missed");
+	CHECK(fc->hits == BURST, "%" PRIu64 " hits", fc->hits);
+	hit_mask = flow_cache_lookup(fc, key, BURST, all, ent, &epoch);
+	CHECK(hit_mask == all, "inserted flows missed");
+	for (i = 0; i < BURST; i++)
+		CHECK(ent[i]->sdf_rule_id == i + 1 &&
+				ent[i]->bearer == (void *)(uintptr_t)(i + 1),
+				"flow %u: wrong results", i);
+
+	/* only the flows of the lookup mask are looked up and counted */
+	hit_mask = flow_cache_lookup(fc, key, BURST, 0x5, ent, &epoch);
+	CHECK(hit_mask == 0x5, "hit mask %" PRIx64 " for mask 0x5",
+			hit_mask);
+
+	/* a change of the tables misses every flow once */
+	stale = fc->stale;
+	flow_cache_invalidate();
+	CHECK(resolve(fc, key, BURST) == 0, "hit after an invalidation");
+	CHECK(fc->stale - stale == BURST, "%" PRIu64 " stale misses",
+			fc->stale - stale);
+	CHECK(resolve(fc, key, BURST) == all, "resolved flows missed");
+
+	/* an invalidation between lookup and insert, a table change while
+	 * the burst is resolved: the entry is of the old epoch */
+	flow_cache_invalidate();
+	hit_mask = flow_cache_lookup(fc, key, 1, 1, ent, &epoch);
+	CHECK(hit_mask == 0, "hit after an invalidation");
+	flow_cache_invalidate();
+	flow_cache_insert(ent[0], &key[0], epoch);
+	hit_mask = flow_cache_lookup(fc, key, 1, 1, ent, &epoch);
+	CHECK(hit_mask == 0, "flow resolved before a change hit");
+
+	flow_cache_free(fc);
+	return 0;
+}
+
+static int test_key(void)
+{
+	struct flow_key key[8];
+	struct flow_cache *fc;
+	uint32_t i;
+
+	fc = flow_cache_create("fc_key", rte_socket_id());
+
+	/* each key differs from the first in one field */
+	for (i = 0; i < RTE_DIM(key); i++)
+		flow_key_set(&key[i], IPPROTO_UDP, htonl(UE_BASE),
+				htonl(REMOTE_BASE), htons(1024), htons(53),
+				0, UL_DIR);
+	key[1].proto = IPPROTO_TCP;
+	key[2].src_addr++;
+	key[3].dst_addr++;
+	key[4].src_port++;
+	key[5].dst_port++;
+	key[6].teid = 1;
+	key[7].dir = DL_DIR;
+
+	for (i = 0; i < RTE_DIM(key); i++)
+		CHECK(flow_key_equal(&key[i], &key[i]) &&
+				(i == 0 || !flow_key_equal(&key[0], &key[i])),
+				"key %u: wrong compare", i);
+
+	CHECK(resolve(fc, key, 1) == 0, "hit in an empty cache");
+	for (i = 1; i < RTE_DIM(key); i++)
+		CHECK(resolve(fc, &key[i], 1) == 0, "key %u hit key 0", i);
+	CHECK(resolve(fc, key, RTE_DIM(key)) == RTE_LEN2MASK(RTE_DIM(key),
+			uint64_t), "resolved flows missed");
+
+	flow_cache_free(fc);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret, fail = 0;
+
+	ret = rte_eal_init(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
+
+	if (test_epoch() < 0)
+		fail++;
+	if (test_key() < 0)
+		fail++;
+
+	printf("flow_cache_test: %s\n", fail ? "FAIL" : "PASS");
+	return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
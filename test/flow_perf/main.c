@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares the downlink flow resolution of a worker without and with the
+ * flow cache: the per packet path is a multi-category ACL classify, the
+ * SDF and ADC PCC decisions by rule id, the ADC domain and the bearer
+ * lookups, as in filter_dl_traffic. The cache takes it on misses only.
+ *
+ * Traffic mixes: 1K, 16K and 256K flows, 4 per UE, picked uniformly or
+ * with a Zipf (s = 1) popularity, without invalidations and with one
+ * every 64K packets (session or rule churn).
+ *
+ * Usage: flow_perf <EAL options> -- [rules]
+ * Default rules: 1000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+
+#include <rte_eal.h>
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_cycles.h>
+#include <rte_random.h>
+#include <rte_malloc.h>
+#include <rte_lcore.h>
+#include <rte_byteorder.h>
+#include <rte_acl.h>
+
+#include "fixed_hash.h"
+#include "flow_cache.h"
+
+#define BURST		32
+#define TRACE_PKTS	(1 << 20)
+#define FLOWS_PER_UE	4
+#define UE_BASE		0x0a000000
+#define REMOTE_BASE	0xc0000000
+#define DL_DIR		2
+/** ACL categories, SDF, ADC UL and ADC DL as in the DP */
+#define NUM_CATEGORIES	4
+#define SDF_CAT		0
+#define ADC_UL_CAT	1
+#define ADC_DL_CAT	2
+
+/** UE packet 5-tuple, laid out as struct epc_5tuple */
+struct bench_tuple {
+	uint8_t proto;
+	uint16_t pad0;
+	uint32_t src_addr;
+	uint32_t dst_addr;
+	uint16_t src_port;
+	uint16_t dst_port;
+	uint8_t pad1;
+} __attribute__((__packed__));
+
+enum {
+	PROTO_FIELD,
+	SRC_FIELD,
+	DST_FIELD,
+	SRCP_FIELD,
+	DSTP_FIELD,
+	NUM_FIELDS
+};
+
+static struct rte_acl_field_def bench_acl_defs[NUM_FIELDS] = {
+	{
+		.type = RTE_ACL_FIELD_TYPE_BITMASK,
+		.size = sizeof(uint8_t),
+		.field_index = PROTO_FIELD,
+		.input_index = 0,
+		.offset = offsetof(struct bench_tuple, proto),
+	},
+	{
+		.type = RTE_ACL_FIELD_TYPE_MASK,
+		.size = sizeof(uint32_t),
+		.field_index = SRC_FIELD,
+		.input_index = 1,
+		.offset = offsetof(struct bench_tuple, src_addr),
+	},
+	{
+		.type = RTE_ACL_FIELD_TYPE_MASK,
+		.size = sizeof(uint32_t),
+		.field_index = DST_FIELD,
+		.input_index = 2,
+		.offset = offsetof(struct bench_tuple, dst_addr),
+	},
+	{
+		.type = RTE_ACL_FIELD_TYPE_RANGE,
+		.size = sizeof(uint16_t),
+		.field_index = SRCP_FIELD,
+		.input_index = 3,
+		.offset = offsetof(struct bench_tuple, src_port),
+	},
+	{
+		.type = RTE_ACL_FIELD_TYPE_RANGE,
+		.size = sizeof(uint16_t),
+		.field_index = DSTP_FIELD,
+		.input_index = 3,
+		.offset = offsetof(struct bench_tuple, dst_port),
+	},
+};
+
+RTE_ACL_RULE_DEF(bench_rule, NUM_FIELDS);
+
+/** PCC decision of a rule */
+struct bench_pcc {
+	uint32_t pcc_id;
+	uint8_t precedence;
+	uint8_t gate_status;
+};
+
+/** Results of a burst */
+struct bench_result {
+	uint32_t sdf_rule_id[BURST];
+	uint32_t adc_rule_id[BURST];
+	uint32_t sdf_pcc_id[BURST];
+	uint32_t adc_pcc_id[BURST];
+	uint8_t sdf_precedence[BURST];
+	uint8_t adc_precedence[BURST];
+	void *bearer[BURST];
+};
+
+static uint32_t n_rules = 1000;
+static struct rte_acl_ctx *acx;
+static struct fixed_hash *adc_domain_hash;
+static struct bench_pcc *pcc;
+static const struct bench_pcc default_pcc = { 0, 255, 1 };
+static volatile uint64_t sink;
+
+static struct rte_acl_ctx *
+bench_acl_create(void)
+{
+	struct rte_acl_param prm = {
+		.name = "flow_perf",
+		.socket_id = rte_socket_id(),
+		.rule_size = RTE_ACL_RULE_SZ(NUM_FIELDS),
+		.max_rule_num = n_rules + 2,
+	};
+	struct rte_acl_config cfg;
+	struct bench_rule rule;
+	struct rte_acl_ctx *ctx;
+	uint32_t k;
+
+	ctx = rte_acl_create(&prm);
+	if (ctx == NULL)
+		rte_exit(EXIT_FAILURE, "ACL create failed\n");
+
+	/* one remote /24 per rule, SDF and ADC DL rules in turn */
+	for (k = 0; k < n_rules + 2; k++) {
+		memset(&rule, 0, sizeof(rule));
+		rule.data.userdata = k + 1;
+		rule.field[SRCP_FIELD].mask_range.u16 = UINT16_MAX;
+		rule.field[DSTP_FIELD].mask_range.u16 = UINT16_MAX;
+
+		if (k < n_rules) {
+			rule.data.category_mask = (k & 1) ?
+				1 << ADC_DL_CAT : 1 << SDF_CAT;
+			rule.data.priority = 2;
+			rule.field[SRC_FIELD].value.u32 = REMOTE_BASE + (k << 8);
+			rule.field[SRC_FIELD].mask_range.u32 = 24;
+		} else {
+			/* default SDF and ADC rules */
+			rule.data.category_mask = (k == n_rules) ?
+				1 << SDF_CAT :
+				(1 << ADC_UL_CAT) | (1 << ADC_DL_CAT);
+			rule.data.priority = 1;
+		}
+
+		if (rte_acl_add_rules(ctx, (struct rte_acl_rule *)&rule, 1) < 0)
+			rte_exit(EXIT_FAILURE, "ACL add of rule %u failed\n", k);
+	}
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.num_categories = NUM_CATEGORIES;
+	cfg.num_fields = NUM_FIELDS;
+	memcpy(cfg.defs, bench_acl_defs, sizeof(bench_acl_defs));
+	if (rte_acl_build(ctx, &cfg) != 0)
+		rte_exit(EXIT_FAILURE, "ACL build of %u rules failed\n",
+				n_rules);
+
+	return ctx;
+}
+
+static void
+bench_tables_create(void)
+{
+	uint32_t k, key32;
+
+	pcc = rte_zmalloc("flow_perf pcc",
+			sizeof(struct bench_pcc) * (n_rules + 3), 0);
+	if (pcc == NULL)
+		rte_exit(EXIT_FAILURE, "PCC alloc failed\n");
+	for (k = 1; k <= n_rules + 2; k++) {
+		pcc[k].pcc_id = k;
+		pcc[k].precedence = rte_rand() & 0xff;
+		pcc[k].gate_status = 1;
+	}
+
+	acx = bench_acl_create();
+
+	/* a resolved domain address in every ADC subnet */
+	adc_domain_hash = fixed_hash_create("flow_perf_adc", n_rules,
+			sizeof(uint32_t), rte_socket_id());
+	if (adc_domain_hash == NULL)
+		rte_exit(EXIT_FAILURE, "adc domain hash create failed\n");
+	for (k = 1; k < n_rules; k += 2) {
+		key32 = htonl(REMOTE_BASE + (k << 8) + 1);
+		fixed_hash_add_key_data(adc_domain_hash, &key32,
+				(void *)(uintptr_t)(k + 1));
+	}
+}
+
+/**
+ * PCC decision of a rule id, as filter_pcc_entry_lookup.
+ */
+static inline const struct bench_pcc *
+bench_pcc_lookup(uint32_t rid)
+{
+	if (rid > n_rules + 2)
+		return &default_pcc;
+	return &pcc[rid];
+}
+
+/**
+ * Per packet path of filter_dl_traffic.
+ */
+static void
+bench_resolve(struct fixed_hash *bearer_hash,
+		const struct bench_tuple **t, uint32_t n,
+		struct bench_result *r)
+{
+	const uint8_t *data[BURST];
+	uint32_t res[BURST * NUM_CATEGORIES];
+	uint32_t key32[BURST];
+	uint64_t key64[BURST];
+	const void *key_ptr[BURST];
+	void *d[BURST];
+	const struct bench_pcc *p;
+	uint64_t hit_mask;
+	uint32_t i, adc;
+
+	for (i = 0; i < n; i++)
+		data[i] = (const uint8_t *)t[i];
+	rte_acl_classify(acx, data, res, n, NUM_CATEGORIES);
+
+	for (i = 0; i < n; i++) {
+		r->sdf_rule_id[i] = res[i * NUM_CATEGORIES + SDF_CAT];
+		r->adc_rule_id[i] = res[i * NUM_CATEGORIES + ADC_DL_CAT];
+		p = bench_pcc_lookup(r->sdf_rule_id[i]);
+		r->sdf_pcc_id[i] = p->pcc_id;
+		r->sdf_precedence[i] = p->precedence;
+	}
+
+	for (i = 0; i < n; i++) {
+		key32[i] = t[i]->src_addr;
+		key_ptr[i] = &key32[i];
+	}
+	fixed_hash_lookup_bulk_data(adc_domain_hash, key_ptr, n, &hit_mask, d);
+
+	for (i = 0; i < n; i++) {
+		adc = (hit_mask & (1ULL << i)) ?
+			(uint32_t)(uintptr_t)d[i] : r->adc_rule_id[i];
+		p = bench_pcc_lookup(adc);
+		r->adc_pcc_id[i] = p->pcc_id;
+		r->adc_precedence[i] = p->precedence;
+	}
+
+	/* dl_bm_key, rule id 1 */
+	for (i = 0; i < n; i++) {
+		key64[i] = ntohl(t[i]->dst_addr) | (1ULL << 32);
+		key_ptr[i] = &key64[i];
+	}
+	fixed_hash_lookup_bulk_data(bearer_hash, key_ptr, n, &hit_mask, d);
+	for (i = 0; i < n; i++)
+		r->bearer[i] = (hit_mask & (1ULL << i)) ? d[i] : NULL;
+}
+
+/**
+ * Flow cache in front of the per packet path, as flow_cache_resolve.
+ */
+static void
+bench_resolve_cached(struct flow_cache *fc, struct fixed_hash *bearer_hash,
+		const struct bench_tuple **t, uint32_t n,
+		struct bench_result *r)
+{
+	struct flow_key key[BURST];
+	struct flow_cache_entry *ent[BURST];
+	const struct bench_tuple *miss_t[BURST];
+	uint32_t miss_idx[BURST];
+	struct bench_result m;
+	struct flow_cache_entry *e;
+	uint64_t hit_mask, epoch;
+	uint32_t i, j, nb_miss = 0;
+
+	for (i = 0; i < n; i++)
+		flow_key_set(&key[i], t[i]->proto, t[i]->src_addr,
+				t[i]->dst_addr, t[i]->src_port,
+				t[i]->dst_port, 0, DL_DIR);
+
+	hit_mask = flow_cache_lookup(fc, key, n, (~0ULL) >> (64 - n), ent,
+			&epoch);
+
+	for (i = 0; i < n; i++) {
+		if (!(hit_mask & (1ULL << i))) {
+			miss_idx[nb_miss] = i;
+			miss_t[nb_miss++] = t[i];
+			continue;
+		}
+		e = ent[i];
+		r->sdf_rule_id[i] = e->sdf_rule_id;
+		r->adc_rule_id[i] = e->adc_rule_id;
+		r->sdf_pcc_id[i] = e->sdf_pcc_id;
+		r->adc_pcc_id[i] = e->adc_pcc_id;
+		r->sdf_precedence[i] = e->sdf_precedence;
+		r->adc_precedence[i] = e->adc_precedence;
+		r->bearer[i] = e->bearer;
+	}
+
+	if (nb_miss == 0)
+		return;
+
+	bench_resolve(bearer_hash, miss_t, nb_miss, &m);
+
+	for (j = 0; j < nb_miss; j++) {
+		i = miss_idx[j];
+		r->sdf_rule_id[i] = m.sdf_rule_id[j];
+		r->adc_rule_id[i] = m.adc_rule_id[j];
+		r->sdf_pcc_id[i] = m.sdf_pcc_id[j];
+		r->adc_pcc_id[i] = m.adc_pcc_id[j];
+		r->sdf_precedence[i] = m.sdf_precedence[j];
+		r->adc_precedence[i] = m.adc_precedence[j];
+		r->bearer[i] = m.bearer[j];
+		if (m.bearer[j] == NULL)
+			continue;
+
+		e = ent[i];
+		e->sdf_rule_id = m.sdf_rule_id[j];
+		e->adc_rule_id = m.adc_rule_id[j];
+		e->sdf_pcc_id = m.sdf_pcc_id[j];
+		e->adc_pcc_id = m.adc_pcc_id[j];
+		e->sdf_precedence = m.sdf_precedence[j];
+		e->adc_precedence = m.adc_precedence[j];
+		e->bearer = m.bearer[j];
+		e->adc_ue_info = NULL;
+		flow_cache_insert(e, &key[i], epoch);
+	}
+}
+
+/**
+ * Flows of the mix, downlink 5-tuples to n_flows / FLOWS_PER_UE UEs.
+ */
+static struct bench_tuple *
+bench_flows(uint32_t n_flows)
+{
+	struct bench_tuple *flows;
+	uint32_t i, n_ues = RTE_MAX(n_flows / FLOWS_PER_UE, 1U);
+
+	flows = rte_zmalloc("flow_perf flows",
+			sizeof(struct bench_tuple) * n_flows, 0);
+	if (flows == NULL)
+		rte_exit(EXIT_FAILURE, "alloc of %u flows failed\n", n_flows);
+
+	for (i = 0; i < n_flows; i++) {
+		flows[i].proto = (rte_rand() & 1) ? IPPROTO_TCP : IPPROTO_UDP;
+		flows[i].src_addr = htonl(REMOTE_BASE +
+				((rte_rand() % n_rules) << 8) +
+				(rte_rand() & 0xff));
+		flows[i].dst_addr = htonl(UE_BASE + i % n_ues);
+		flows[i].src_port = htons(rte_rand() & 0xffff);
+		flows[i].dst_port = htons(1024 + rte_rand() % 60000);
+	}
+	return flows;
+}
+
+/**
+ * Flow of each packet, uniform or Zipf (s = 1) popularity.
+ */
+static uint32_t *
+bench_trace(uint32_t n_flows, int zipf)
+{
+	uint32_t *trace;
+	double *cdf = NULL, u;
+	uint32_t i, lo, hi, mid;
+
+	trace = rte_malloc("flow_perf trace", sizeof(uint32_t) * TRACE_PKTS, 0);
+	if (trace == NULL)
+		rte_exit(EXIT_FAILURE, "trace alloc failed\n");
+
+	if (!zipf) {
+		for (i = 0; i < TRACE_PKTS; i++)
+			trace[i] = rte_rand() % n_flows;
+		return trace;
+	}
+
+	cdf = rte_malloc("flow_perf cdf", sizeof(double) * n_flows, 0);
+	if (cdf == NULL)
+		rte_exit(EXIT_FAILURE, "cdf alloc failed\n");
+	for (i = 0; i < n_flows; i++)
+		cdf[i] = (i ? cdf[i - 1] : 0) + 1.0 / (i + 1);
+
+	for (i = 0; i < TRACE_PKTS; i++) {
+		u = (double)(rte_rand() >> 11) / (1ULL << 53) * cdf[n_flows - 1];
+		lo = 0;
+		hi = n_flows - 1;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (cdf[mid] < u)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		trace[i] = lo;
+	}
+	rte_free(cdf);
+	return trace;
+}
+
+static void
+bench_run(uint32_t n_flows, int zipf, uint32_t inval)
+{
+	const struct bench_tuple *t[BURST];
+	struct bench_result r;
+	struct bench_tuple *flows;
+	struct fixed_hash *bearer_hash;
+	struct flow_cache *fc;
+	uint32_t *trace;
+	void *bearer;
+	uint32_t i, j, n_ues = RTE_MAX(n_flows / FLOWS_PER_UE, 1U);
+	uint64_t key64, start, per_pkt, cached, sum = 0;
+
+	flows = bench_flows(n_flows);
+	trace = bench_trace(n_flows, zipf);
+
+	bearer = rte_zmalloc("flow_perf bearers",
+			RTE_CACHE_LINE_SIZE * n_ues, RTE_CACHE_LINE_SIZE);
+	if (bearer == NULL)
+		rte_exit(EXIT_FAILURE, "bearer alloc failed\n");
+	bearer_hash = fixed_hash_create("flow_perf_bearer", n_ues,
+			sizeof(uint64_t), rte_socket_id());
+	if (bearer_hash == NULL)
+		rte_exit(EXIT_FAILURE, "bearer hash create failed\n");
+	for (i = 0; i < n_ues; i++) {
+		key64 = (UE_BASE + i) | (1ULL << 32);
+		fixed_hash_add_key_data(bearer_hash, &key64,
+				RTE_PTR_ADD(bearer, i * RTE_CACHE_LINE_SIZE));
+	}
+
+	start = rte_rdtsc();
+	for (i = 0; i < TRACE_PKTS; i += BURST) {
+		for (j = 0; j < BURST; j++)
+			t[j] = &flows[trace[i + j]];
+		bench_resolve(bearer_hash, t, BURST, &r);
+		sum += r.sdf_pcc_id[0] + r.adc_pcc_id[BURST - 1];
+	}
+	per_pkt = rte_rdtsc() - start;
+
+	fc = flow_cache_create("flow_perf_cache", rte_socket_id());
+	start = rte_rdtsc();
+	for (i = 0; i < TRACE_PKTS; i += BURST) {
+		if (inval && i % inval == 0)
+			flow_cache_invalidate();
+		for (j = 0; j < BURST; j++)
+			t[j] = &flows[trace[i + j]];
+		bench_resolve_cached(fc, bearer_hash, t, BURST, &r);
+		sum += r.sdf_pcc_id[0] + r.adc_pcc_id[BURST - 1];
+	}
+	cached = rte_rdtsc() - start;
+	sink += sum;
+
+	printf("%8u %8s %8u %10.1f %10.1f %7.1f%%\n", n_flows,
+			zipf ? "zipf" : "uniform", inval,
+			(double)per_pkt / TRACE_PKTS,
+			(double)cached / TRACE_PKTS,
+			(double)fc->hits * 100 / (fc->hits + fc->misses));
+
+	flow_cache_free(fc);
+	fixed_hash_free(bearer_hash);
+	rte_free(bearer);
+	rte_free(trace);
+	rte_free(flows);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32_t flow_counts[] = { 1 << 10, 1 << 14, 1 << 18 };
+	static const uint32_t invals[] = { 0, 1 << 16 };
+	unsigned f, z, v;
+	int ret;
+
+	ret = rte_eal_init(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
+	argc -= ret;
+	argv += ret;
+
+	if (argc > 1)
+		n_rules = strtoul(argv[1], NULL, 0);
+	if (n_rules < 2 || n_rules > (1 << 16))
+		rte_exit(EXIT_FAILURE, "rules must be 2 to 65536\n");
+
+	bench_tables_create();
+
+	printf("cycles per packet, %u rules, %u flow cache entries, "
+			"bursts of %u\n", n_rules, FLOW_CACHE_ENTRIES, BURST);
+	printf("%8s %8s %8s %10s %10s %8s\n", "flows", "mix", "inval",
+			"per pkt", "cached", "hit");
+
+	for (f = 0; f < RTE_DIM(flow_counts); f++)
+		for (z = 0; z < 2; z++)
+			for (v = 0; v < RTE_DIM(invals); v++)
+				bench_run(flow_counts[f], z, invals[v]);
+
+	return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the growable hash of the DP session tables: a resize moves every
+ * key while lookups keep finding them, and a key failing to move stays in
+ * the old table until the move is retried.
+ *
+ * Usage: grow_hash_test <EAL options>
+ * Exits with 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include <rte_eal.h>
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_hash.h>
+
+#include "main.h"
+#include "grow_hash.h"
+
+#define UE_BASE		0x0a000000
+#define FILL_BASE	0x0b000000
+/** Two resizes from GROW_HASH_MIN_ENTRIES */
+#define MAX_ENTRIES	(GROW_HASH_MIN_ENTRIES * 4)
+
+/* grace periods: no worker runs, qsbr_done() is always QSBR_OFFLINE */
+struct epc_app_params epc_app;
+
+#define CHECK(cond, ...) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s:%d: ", __func__, __LINE__);		\
+		printf(__VA_ARGS__);					\
+		printf("\n");						\
+		return -1;						\
+	}								\
+} while (0)
+
+static void *key_data(uint32_t key)
+{
+	return (void *)(uintptr_t)(key - UE_BASE + 1);
+}
+
+/**
+ * Check that keys [0, n) are found with their data, single and in bursts.
+ */
+static int check_keys(struct grow_hash *gh, uint32_t n)
+{
+	uint32_t keys[RTE_HASH_LOOKUP_BULK_MAX];
+	const void *key_ptr[RTE_HASH_LOOKUP_BULK_MAX];
+	void *data[RTE_HASH_LOOKUP_BULK_MAX];
+	uint64_t hit_mask;
+	uint32_t i, j, burst;
+	void *d;
+
+	for (i = 0; i < n; i++) {
+		keys[0] = UE_BASE + i;
+		CHECK(grow_hash_lookup_data(gh, &keys[0], &d) == 0 &&
+				d == key_data(keys[0]),
+				"key %u not found", i);
+	}
+
+	for (i = 0; i < n; i += burst) {
+		burst = RTE_MIN(n - i, (uint32_t)RTE_HASH_LOOKUP_BULK_MAX);
+		for (j = 0; j < burst; j++) {
+			keys[j] = UE_BASE + i + j;
+			key_ptr[j] = &keys[j];
+		}
+		CHECK(grow_hash_lookup_bulk_data(gh, key_ptr, burst,
+				&hit_mask, data) == (int)burst,
+				"burst at key %u: %d hits", i,
+				__builtin_popcountll(hit_mask));
+		for (j = 0; j < burst; j++)
+			CHECK(data[j] == key_data(keys[j]),
+					"key %u: wrong data in burst", i + j);
+	}
+	return 0;
+}
+
+static void finish_resize(struct grow_hash *gh)
+{
+	while (gh->old != NULL)
+		grow_hash_step(gh);
+}
+
+/**
+ * Adds past the load factor resize the table, lookups find every key
+ * during and after the move.
+ */
+static int test_resize(void)
+{
+	struct grow_hash *gh;
+	uint32_t n = GROW_HASH_MIN_ENTRIES * 2, key, i;
+	uint32_t resize_at = 0;
+	void *d;
+
+	gh = grow_hash_create("gh_resize", MAX_ENTRIES, sizeof(uint32_t));
+	CHECK(gh != NULL, "create failed");
+	CHECK(gh->capacity == GROW_HASH_MIN_ENTRIES, "capacity %u",
+			gh->capacity);
+
+	for (i = 0; i < n; i++) {
+		key = UE_BASE + i;
+		CHECK(grow_hash_add_key_data(gh, &key, key_data(key)) == 0,
+				"add of key %u failed", i);
+		if (gh->old != NULL && resize_at == 0) {
+			resize_at = i;
+			/* keys not moved yet are served by the old table */
+			if (check_keys(gh, i + 1) < 0)
+				return -1;
+		}
+	}
+
+	CHECK(resize_at == GROW_HASH_MIN_ENTRIES * GROW_HASH_LOAD_MAX / 100,
+			"resize started at %u keys", resize_at);
+	CHECK(gh->count == n, "count %u", gh->count);
+	finish_resize(gh);
+	CHECK(gh->capacity == MAX_ENTRIES, "capacity %u after %u keys",
+			gh->capacity, n);
+	CHECK(gh->resizes == 2, "%" PRIu64 " resizes", gh->resizes);
+	CHECK(gh->add_fail == 0 && gh->move_fail == 0,
+			"%" PRIu64 " failed adds, %" PRIu64 " failed moves",
+			gh->add_fail, gh->move_fail);
+	if (check_keys(gh, n) < 0)
+		return -1;
+
+	/* the moved table is freed by the next step */
+	grow_hash_step(gh);
+	CHECK(gh->retired == NULL, "old table not freed");
+
+	/* an update replaces the data, the key is not counted twice */
+	key = UE_BASE;
+	CHECK(grow_hash_add_key_data(gh, &key, key_data(key + 1)) == 0 &&
+			grow_hash_lookup_data(gh, &key, &d) == 0 &&
+			d == key_data(key + 1), "update not seen");
+	CHECK(gh->count == n, "count %u after update", gh->count);
+
+	for (i = 0; i < n; i += 2) {
+		key = UE_BASE + i;
+		CHECK(grow_hash_del_key(gh, &key) == 0, "del of key %u", i);
+		CHECK(grow_hash_lookup_data(gh, &key, &d) == -ENOENT,
+				"key %u found after del", i);
+	}
+	CHECK(grow_hash_del_key(gh, &key) == -ENOENT, "second del");
+	CHECK(gh->count == n / 2, "count %u after del", gh->count);
+
+	grow_hash_free(gh);
+	return 0;
+}
+
+/**
+ * A key failing to move, the new table being full, stays in the old
+ * table and is moved by a later step.
+ */
+static int test_move_retry(void)
+{
+	struct grow_hash *gh;
+	uint32_t n = GROW_HASH_MIN_ENTRIES * GROW_HASH_LOAD_MAX / 100 + 1;
+	uint32_t key, n_fill, i;
+	uint64_t move_fail;
+
+	gh = grow_hash_create("gh_retry", MAX_ENTRIES, sizeof(uint32_t));
+	CHECK(gh != NULL, "create failed");
+
+	for (i = 0; i < n; i++) {
+		key = UE_BASE + i;
+		CHECK(grow_hash_add_key_data(gh, &key, key_data(key)) == 0,
+				"add of key %u failed", i);
+	}
+	CHECK(gh->old != NULL, "no resize after %u keys", n);
+
+	/* fill the new table behind the back of the move */
+	for (n_fill = 0; ; n_fill++) {
+		key = FILL_BASE + n_fill;
+		if (rte_hash_add_key_data(gh->cur, &key, NULL) < 0)
+			break;
+	}
+
+	move_fail = gh->move_fail;
+	grow_hash_step(gh);
+	grow_hash_step(gh);
+	CHECK(gh->move_fail > move_fail, "move into a full table succeeded");
+	CHECK(gh->old != NULL, "resize completed into a full table");
+	if (check_keys(gh, n) < 0)
+		return -1;
+
+	for (i = 0; i < n_fill; i++) {
+		key = FILL_BASE + i;
+		rte_hash_del_key(gh->cur, &key);
+	}
+
+	finish_resize(gh);
+	CHECK(gh->resizes == 1, "%" PRIu64 " resizes", gh->resizes);
+	CHECK(gh->count == n, "count %u", gh->count);
+	if (check_keys(gh, n) < 0)
+		return -1;
+
+	grow_hash_free(gh);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret, fail = 0;
+
+	ret = rte_eal_init(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
+
+	if (test_resize() < 0)
+		fail++;
+	if (test_move_retry() < 0)
+		fail++;
+
+	printf("grow_hash_test: %s\n", fail ? "FAIL" : "PASS");
+	return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
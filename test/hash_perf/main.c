@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares the DP lookup tables: rte_hash with rte_jhash as created by
+ * hash_create() and the fixed key hash, for 4 byte (ADC domain) and
+ * 8 byte (uplink/downlink bearer) keys.
+ *
+ * Usage: hash_perf <EAL options> -- [entries ...]
+ * Default entries: 1M 4M 16M, 16M needs about 2 GB of hugepages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_eal.h>
+#include <rte_common.h>
+#include <rte_debug.h>
+#include <rte_cycles.h>
+#include <rte_random.h>
+#include <rte_malloc.h>
+#include <rte_lcore.h>
+#include <rte_hash.h>
+#include <rte_jhash.h>
+
+#include "fixed_hash.h"
+
+#define BURST		32
+#define UE_BASE		0x0a000000
+
+/** Table under test */
+struct bench_ops {
+	const char *name;
+	void *(*create)(uint32_t entries, uint32_t key_len);
+	int (*add)(void *h, const void *key, void *data);
+	int (*lookup_bulk)(void *h, const void **keys, uint32_t n,
+			uint64_t *hit_mask, void **data);
+	int (*del)(void *h, const void *key);
+	void (*free)(void *h);
+};
+
+static void *jhash_create(uint32_t entries, uint32_t key_len)
+{
+	struct rte_hash_parameters rte_hash_params = {
+		.name = "hash_perf",
+		.entries = entries,
+		.key_len = key_len,
+		.hash_func = rte_jhash,
+		.hash_func_init_val = 0,
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_hash *h = rte_hash_create(&rte_hash_params);
+
+	if (h == NULL)
+		rte_exit(EXIT_FAILURE, "rte_hash create of %u entries failed\n",
+				entries);
+	return h;
+}
+
+static int jhash_add(void *h, const void *key, void *data)
+{
+	return rte_hash_add_key_data(h, key, data);
+}
+
+static int jhash_lookup_bulk(void *h, const void **keys, uint32_t n,
+		uint64_t *hit_mask, void **data)
+{
+	rte_hash_lookup_bulk_data(h, keys, n, hit_mask, data);
+	return __builtin_popcountll(*hit_mask);
+}
+
+static int jhash_del(void *h, const void *key)
+{
+	return rte_hash_del_key(h, key);
+}
+
+static void jhash_free_table(void *h)
+{
+	rte_hash_free(h);
+}
+
+static void *fixed_create(uint32_t entries, uint32_t key_len)
+{
+	struct fixed_hash *h = fixed_hash_create("hash_perf", entries,
+			key_len, rte_socket_id());
+
+	if (h == NULL)
+		rte_exit(EXIT_FAILURE, "fixed hash create of %u entries "
+				"failed\n", entries);
+	return h;
+}
+
+static int fixed_add(void *h, const void *key, void *data)
+{
+	return fixed_hash_add_key_data(h, key, data);
+}
+
+static int fixed_lookup_bulk(void *h, const void **keys, uint32_t n,
+		uint64_t *hit_mask, void **data)
+{
+	return fixed_hash_lookup_bulk_data(h, keys, n, hit_mask, data);
+}
+
+static int fixed_del(void *h, const void *key)
+{
+	return fixed_hash_del_key(h, key);
+}
+
+static void fixed_free_table(void *h)
+{
+	fixed_hash_free(h);
+}
+
+static const struct bench_ops bench_ops[] = {
+	{ "rte_hash", jhash_create, jhash_add, jhash_lookup_bulk, jhash_del,
+		jhash_free_table },
+	{ "fixed_hash", fixed_create, fixed_add, fixed_lookup_bulk, fixed_del,
+		fixed_free_table },
+};
+
+/**
+ * Keys shaped like the DP keys: UE addresses, with a rule id for 8 byte
+ * keys, in random order.
+ */
+static uint64_t *
+bench_keys(uint32_t n, uint32_t key_len)
+{
+	uint64_t *keys, tmp;
+	uint32_t i, j;
+
+	keys = rte_malloc("hash_perf keys", sizeof(uint64_t) * n, 0);
+	if (keys == NULL)
+		rte_exit(EXIT_FAILURE, "key alloc of %u keys failed\n", n);
+
+	for (i = 0; i < n; i++) {
+		keys[i] = UE_BASE + i;
+		if (key_len == sizeof(uint64_t))
+			keys[i] |= (uint64_t)(1 + (i & 3)) << 32;
+	}
+	for (i = n - 1; i > 0; i--) {
+		j = rte_rand() % (i + 1);
+		tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+	return keys;
+}
+
+static void
+bench_run(const struct bench_ops *ops, uint32_t n, uint32_t key_len,
+		const uint64_t *keys)
+{
+	const void *key_ptr[BURST];
+	void *data[BURST];
+	uint64_t hit_mask, start, add, lookup, del;
+	uint32_t i, j, hits = 0, fail = 0;
+	void *h;
+
+	h = ops->create(n, key_len);
+
+	start = rte_rdtsc();
+	for (i = 0; i < n; i++)
+		if (ops->add(h, &keys[i], (void *)(uintptr_t)(i + 1)) < 0)
+			fail++;
+	add = rte_rdtsc() - start;
+
+	start = rte_rdtsc();
+	for (i = 0; i + BURST <= n; i += BURST) {
+		/* lookup in a different order than the adds */
+		for (j = 0; j < BURST; j++)
+			key_ptr[j] = &keys[(i + j) * 7 % n];
+		hits += ops->lookup_bulk(h, key_ptr, BURST, &hit_mask, data);
+	}
+	lookup = rte_rdtsc() - start;
+
+	start = rte_rdtsc();
+	for (i = 0; i < n; i++)
+		ops->del(h, &keys[i]);
+	del = rte_rdtsc() - start;
+
+	ops->free(h);
+
+	printf("%-10s %2uB %10u %10.1f %10.1f %10.1f %10u %10u\n",
+			ops->name, key_len, n, (double)add / n,
+			(double)lookup / (i ? i : 1), (double)del / n,
+			i - hits, fail);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32_t key_lens[] = { sizeof(uint32_t), sizeof(uint64_t) };
+	uint32_t sizes[16] = { 1 << 20, 4 << 20, 16 << 20 };
+	uint32_t n_sizes = 3;
+	uint64_t *keys;
+	unsigned i, k, t;
+	int ret;
+
+	ret = rte_eal_init(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
+	argc -= ret;
+	argv += ret;
+
+	if (argc > 1) {
+		n_sizes = 0;
+		for (i = 1; i < (unsigned)argc && n_sizes < RTE_DIM(sizes); i++)
+			sizes[n_sizes++] = strtoul(argv[i], NULL, 0);
+	}
+
+	printf("cycles per key, lookups in bursts of %u\n", BURST);
+	printf("%-10s %3s %10s %10s %10s %10s %10s %10s\n", "table", "key",
+			"entries", "add", "lookup", "del", "misses",
+			"add fail");
+
+	for (i = 0; i < n_sizes; i++) {
+		for (k = 0; k < RTE_DIM(key_lens); k++) {
+			keys = bench_keys(sizes[i], key_lens[k]);
+			for (t = 0; t < RTE_DIM(bench_ops); t++)
+				bench_run(&bench_ops[t], sizes[i], key_lens[k],
+						keys);
+			rte_free(keys);
+		}
+	}
+
+	return 0;
+}